@@ -0,0 +1,306 @@
+/**********************************************************************************
+* ESP8266 MQTT CBOR
+*
+* NOTE
+* -----
+*   (1) STREAMING CBOR ENCODER. SEE HEADER
+*
+*   (2) FLOATS ARE CONVERTED TO HALF PRECISION WITH INTEGER OPERATIONS ONLY
+*       (THE CORE HAS NO FPU)
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_MQTT_CBOR.h"
+
+//LOCAL LIBRARY FUNCTIONS////////////////////////////////
+static uint8_t* ICACHE_FLASH_ATTR s_esp8266_mqtt_cbor_reserve(esp8266_mqtt_cbor_t* cbor, uint16_t len);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_cbor_head(esp8266_mqtt_cbor_t* cbor, uint8_t major, uint32_t value);
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_cbor_half(uint32_t bits, uint16_t* half);
+//END LOCAL LIBRARY FUNCTIONS////////////////////////////////
+
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Initialize(esp8266_mqtt_cbor_t* cbor, uint8_t* buffer, uint16_t size)
+{
+    //START ENCODING INTO buffer (size BYTES)
+
+    cbor->buffer = buffer;
+    cbor->size = (buffer != NULL) ? size : 0;
+    cbor->len = 0;
+    cbor->overflow = false;
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Uint(esp8266_mqtt_cbor_t* cbor, uint32_t value)
+{
+    //UNSIGNED INTEGER
+
+    s_esp8266_mqtt_cbor_head(cbor, ESP8266_MQTT_CBOR_MAJOR_UINT, value);
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Int(esp8266_mqtt_cbor_t* cbor, int32_t value)
+{
+    //SIGNED INTEGER (NEGATIVE n IS SENT AS -1 - n)
+
+    if(value < 0)
+    {
+        s_esp8266_mqtt_cbor_head(cbor, ESP8266_MQTT_CBOR_MAJOR_NINT, (uint32_t)(-(value + 1)));
+    }
+    else
+    {
+        s_esp8266_mqtt_cbor_head(cbor, ESP8266_MQTT_CBOR_MAJOR_UINT, (uint32_t)value);
+    }
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Float(esp8266_mqtt_cbor_t* cbor, float value)
+{
+    //FLOAT. HALF PRECISION IF EXACT, SINGLE PRECISION OTHERWISE
+
+    uint32_t bits;
+    uint16_t half;
+    uint8_t* dest;
+
+    os_memcpy(&bits, &value, 4);
+    if(s_esp8266_mqtt_cbor_half(bits, &half))
+    {
+        dest = s_esp8266_mqtt_cbor_reserve(cbor, 3);
+        if(dest != NULL)
+        {
+            dest[0] = (ESP8266_MQTT_CBOR_MAJOR_SIMPLE << 5) | 25;
+            dest[1] = (uint8_t)(half >> 8);
+            dest[2] = (uint8_t)(half & 0xFF);
+        }
+        return;
+    }
+    dest = s_esp8266_mqtt_cbor_reserve(cbor, 5);
+    if(dest != NULL)
+    {
+        dest[0] = (ESP8266_MQTT_CBOR_MAJOR_SIMPLE << 5) | 26;
+        dest[1] = (uint8_t)(bits >> 24);
+        dest[2] = (uint8_t)((bits >> 16) & 0xFF);
+        dest[3] = (uint8_t)((bits >> 8) & 0xFF);
+        dest[4] = (uint8_t)(bits & 0xFF);
+    }
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Bool(esp8266_mqtt_cbor_t* cbor, bool value)
+{
+    //TRUE / FALSE
+
+    s_esp8266_mqtt_cbor_head(cbor, ESP8266_MQTT_CBOR_MAJOR_SIMPLE, value ? 21 : 20);
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Null(esp8266_mqtt_cbor_t* cbor)
+{
+    //NULL (EG SENSOR READING NOT AVAILABLE)
+
+    s_esp8266_mqtt_cbor_head(cbor, ESP8266_MQTT_CBOR_MAJOR_SIMPLE, 22);
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Text(esp8266_mqtt_cbor_t* cbor, const char* text)
+{
+    //UTF-8 TEXT STRING (NUL TERMINATED)
+
+    ESP8266_MQTT_CBOR_TextLen(cbor, text, os_strlen(text));
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_TextLen(esp8266_mqtt_cbor_t* cbor, const char* text, uint16_t len)
+{
+    //UTF-8 TEXT STRING OF len BYTES
+
+    uint8_t* dest;
+
+    s_esp8266_mqtt_cbor_head(cbor, ESP8266_MQTT_CBOR_MAJOR_TEXT, len);
+    dest = s_esp8266_mqtt_cbor_reserve(cbor, len);
+    if(dest != NULL)
+    {
+        os_memcpy(dest, text, len);
+    }
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Bytes(esp8266_mqtt_cbor_t* cbor, const uint8_t* data, uint16_t len)
+{
+    //BYTE STRING OF len BYTES
+
+    uint8_t* dest;
+
+    s_esp8266_mqtt_cbor_head(cbor, ESP8266_MQTT_CBOR_MAJOR_BYTES, len);
+    dest = s_esp8266_mqtt_cbor_reserve(cbor, len);
+    if(dest != NULL)
+    {
+        os_memcpy(dest, data, len);
+    }
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Array(esp8266_mqtt_cbor_t* cbor, uint32_t count)
+{
+    //START AN ARRAY OF count ITEMS (ESP8266_MQTT_CBOR_INDEFINITE : UNTIL
+    //ESP8266_MQTT_CBOR_Break)
+
+    s_esp8266_mqtt_cbor_head(cbor, ESP8266_MQTT_CBOR_MAJOR_ARRAY, count);
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Map(esp8266_mqtt_cbor_t* cbor, uint32_t count)
+{
+    //START A MAP OF count KEY / VALUE PAIRS (ESP8266_MQTT_CBOR_INDEFINITE :
+    //UNTIL ESP8266_MQTT_CBOR_Break)
+
+    s_esp8266_mqtt_cbor_head(cbor, ESP8266_MQTT_CBOR_MAJOR_MAP, count);
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Tag(esp8266_mqtt_cbor_t* cbor, uint32_t tag)
+{
+    //TAG THE NEXT ITEM (EG 1 = EPOCH TIME)
+
+    s_esp8266_mqtt_cbor_head(cbor, ESP8266_MQTT_CBOR_MAJOR_TAG, tag);
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Break(esp8266_mqtt_cbor_t* cbor)
+{
+    //CLOSE THE INNERMOST INDEFINITE ARRAY / MAP
+
+    uint8_t* dest = s_esp8266_mqtt_cbor_reserve(cbor, 1);
+
+    if(dest != NULL)
+    {
+        dest[0] = 0xFF;
+    }
+}
+
+uint16_t ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Finish(esp8266_mqtt_cbor_t* cbor)
+{
+    //RETURN NUMBER OF BYTES ENCODED (0 IF SOMETHING DID NOT FIT)
+
+    return cbor->overflow ? 0 : cbor->len;
+}
+
+static uint8_t* ICACHE_FLASH_ATTR s_esp8266_mqtt_cbor_reserve(esp8266_mqtt_cbor_t* cbor, uint16_t len)
+{
+    //RETURN WHERE THE NEXT len BYTES GO (NULL IF THEY DO NOT FIT. ENCODER
+    //STAYS IN ERROR)
+
+    uint8_t* dest;
+
+    if(cbor->overflow || len > (cbor->size - cbor->len))
+    {
+        cbor->overflow = true;
+        return NULL;
+    }
+    dest = &cbor->buffer[cbor->len];
+    cbor->len += len;
+    return dest;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_cbor_head(esp8266_mqtt_cbor_t* cbor, uint8_t major, uint32_t value)
+{
+    //WRITE AN ITEM HEAD (MAJOR TYPE + SHORTEST ARGUMENT)
+    //ESP8266_MQTT_CBOR_INDEFINITE FOR ARRAY / MAP : INDEFINITE LENGTH
+
+    uint8_t* dest;
+
+    if(value == ESP8266_MQTT_CBOR_INDEFINITE &&
+        (major == ESP8266_MQTT_CBOR_MAJOR_ARRAY || major == ESP8266_MQTT_CBOR_MAJOR_MAP))
+    {
+        dest = s_esp8266_mqtt_cbor_reserve(cbor, 1);
+        if(dest != NULL)
+        {
+            dest[0] = (major << 5) | 31;
+        }
+        return;
+    }
+
+    if(value < 24)
+    {
+        dest = s_esp8266_mqtt_cbor_reserve(cbor, 1);
+        if(dest != NULL)
+        {
+            dest[0] = (major << 5) | (uint8_t)value;
+        }
+    }
+    else if(value <= 0xFF)
+    {
+        dest = s_esp8266_mqtt_cbor_reserve(cbor, 2);
+        if(dest != NULL)
+        {
+            dest[0] = (major << 5) | 24;
+            dest[1] = (uint8_t)value;
+        }
+    }
+    else if(value <= 0xFFFF)
+    {
+        dest = s_esp8266_mqtt_cbor_reserve(cbor, 3);
+        if(dest != NULL)
+        {
+            dest[0] = (major << 5) | 25;
+            dest[1] = (uint8_t)(value >> 8);
+            dest[2] = (uint8_t)(value & 0xFF);
+        }
+    }
+    else
+    {
+        dest = s_esp8266_mqtt_cbor_reserve(cbor, 5);
+        if(dest != NULL)
+        {
+            dest[0] = (major << 5) | 26;
+            dest[1] = (uint8_t)(value >> 24);
+            dest[2] = (uint8_t)((value >> 16) & 0xFF);
+            dest[3] = (uint8_t)((value >> 8) & 0xFF);
+            dest[4] = (uint8_t)(value & 0xFF);
+        }
+    }
+}
+
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_cbor_half(uint32_t bits, uint16_t* half)
+{
+    //CONVERT SINGLE PRECISION BITS TO HALF PRECISION
+    //RETURN FALSE IF THE VALUE CANNOT BE HELD EXACTLY
+
+    uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    int16_t exponent = (int16_t)((bits >> 23) & 0xFF);
+    uint32_t mantissa = bits & 0x007FFFFF;
+    uint8_t shift;
+
+    if(exponent == 0xFF)
+    {
+        //INFINITY / NAN (CANONICAL)
+        *half = (mantissa == 0) ? (sign | 0x7C00) : 0x7E00;
+        return true;
+    }
+    if(exponent == 0 && mantissa == 0)
+    {
+        *half = sign;
+        return true;
+    }
+    if(exponent == 0)
+    {
+        //SINGLE PRECISION SUBNORMAL. FAR BELOW HALF PRECISION RANGE
+        return false;
+    }
+
+    exponent -= 127;
+    if(exponent >= -14 && exponent <= 15)
+    {
+        //NORMAL. LOW 13 MANTISSA BITS MUST BE 0
+        if((mantissa & 0x1FFF) != 0)
+        {
+            return false;
+        }
+        *half = sign | (uint16_t)((exponent + 15) << 10) | (uint16_t)(mantissa >> 13);
+        return true;
+    }
+    if(exponent >= -24 && exponent < -14)
+    {
+        //HALF PRECISION SUBNORMAL (IMPLICIT 1 BECOMES EXPLICIT)
+        mantissa |= 0x00800000;
+        shift = (uint8_t)(-1 - exponent);
+        if((mantissa & ((1UL << shift) - 1)) != 0)
+        {
+            return false;
+        }
+        *half = sign | (uint16_t)(mantissa >> shift);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,89 @@
+/**********************************************************************************
+* ESP8266 MQTT CBOR
+*
+* NOTE
+* -----
+*   (1) MINIMAL STREAMING CBOR (RFC 8949) ENCODER FOR TELEMETRY PAYLOADS. ITEMS
+*       ARE WRITTEN ONE AFTER THE OTHER STRAIGHT INTO A CALLER BUFFER (NO HEAP,
+*       NO INTERMEDIATE STRINGS). THE BUFFER CAN BE THE PAYLOAD AREA RETURNED
+*       BY ESP8266_MQTT_CLIENT_Send_PublishBegin
+*
+*           esp8266_mqtt_cbor_t cbor;
+*           uint16_t max_len;
+*           uint8_t* payload = ESP8266_MQTT_CLIENT_Send_PublishBegin("t", &max_len);
+*
+*           ESP8266_MQTT_CBOR_Initialize(&cbor, payload, max_len);
+*           ESP8266_MQTT_CBOR_Map(&cbor, 2);
+*           ESP8266_MQTT_CBOR_Text(&cbor, "t");
+*           ESP8266_MQTT_CBOR_Float(&cbor, 21.5);
+*           ESP8266_MQTT_CBOR_Text(&cbor, "rh");
+*           ESP8266_MQTT_CBOR_Uint(&cbor, 48);
+*           ESP8266_MQTT_CLIENT_Send_PublishCommit(ESP8266_MQTT_CBOR_Finish(&cbor));
+*
+*   (2) INTEGERS USE THE SHORTEST HEAD (1, 2, 3 OR 5 BYTES). FLOATS ARE SENT AS
+*       HALF PRECISION (3 BYTES) WHEN THAT IS EXACT, SINGLE PRECISION OTHERWISE
+*
+*   (3) ARRAYS / MAPS OF UNKNOWN SIZE ARE OPENED WITH A COUNT OF
+*       ESP8266_MQTT_CBOR_INDEFINITE AND CLOSED WITH ESP8266_MQTT_CBOR_Break
+*
+*   (4) ITEMS THAT DO NOT FIT ARE NOT WRITTEN AND THE ENCODER STAYS IN ERROR.
+*       ESP8266_MQTT_CBOR_Finish THEN RETURNS 0 (CHECK IT BEFORE SENDING)
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#ifndef _ESP8266_MQTT_CBOR_H_
+#define _ESP8266_MQTT_CBOR_H_
+
+#include "ets_sys.h"
+#include "osapi.h"
+#include "os_type.h"
+#include "user_interface.h"
+
+#define ESP8266_MQTT_CBOR_INDEFINITE			(0xFFFFFFFF)
+
+//CUSTOM VARIABLE STRUCTURES/////////////////////////////
+typedef enum
+{
+	ESP8266_MQTT_CBOR_MAJOR_UINT = 0,
+	ESP8266_MQTT_CBOR_MAJOR_NINT,
+	ESP8266_MQTT_CBOR_MAJOR_BYTES,
+	ESP8266_MQTT_CBOR_MAJOR_TEXT,
+	ESP8266_MQTT_CBOR_MAJOR_ARRAY,
+	ESP8266_MQTT_CBOR_MAJOR_MAP,
+	ESP8266_MQTT_CBOR_MAJOR_TAG,
+	ESP8266_MQTT_CBOR_MAJOR_SIMPLE
+}esp8266_mqtt_cbor_major_t;
+
+typedef struct
+{
+	uint8_t* buffer;
+	uint16_t size;
+	uint16_t len;
+	bool overflow;
+}esp8266_mqtt_cbor_t;
+//END CUSTOM VARIABLE STRUCTURES/////////////////////////
+
+//FUNCTION PROTOTYPES/////////////////////////////////////////////
+//CONFIGURATION FUNCTIONS
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Initialize(esp8266_mqtt_cbor_t* cbor, uint8_t* buffer, uint16_t size);
+
+//OPERATION FUNCTIONS
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Uint(esp8266_mqtt_cbor_t* cbor, uint32_t value);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Int(esp8266_mqtt_cbor_t* cbor, int32_t value);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Float(esp8266_mqtt_cbor_t* cbor, float value);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Bool(esp8266_mqtt_cbor_t* cbor, bool value);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Null(esp8266_mqtt_cbor_t* cbor);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Text(esp8266_mqtt_cbor_t* cbor, const char* text);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_TextLen(esp8266_mqtt_cbor_t* cbor, const char* text, uint16_t len);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Bytes(esp8266_mqtt_cbor_t* cbor, const uint8_t* data, uint16_t len);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Array(esp8266_mqtt_cbor_t* cbor, uint32_t count);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Map(esp8266_mqtt_cbor_t* cbor, uint32_t count);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Tag(esp8266_mqtt_cbor_t* cbor, uint32_t tag);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Break(esp8266_mqtt_cbor_t* cbor);
+uint16_t ICACHE_FLASH_ATTR ESP8266_MQTT_CBOR_Finish(esp8266_mqtt_cbor_t* cbor);
+
+#endif
@@ -3,15 +3,16 @@
 *
 * NOTE
 * -----
-*   (1) DOES NOT PROVIDE SUBSCRIBE FUNCTIONALITY. THIS LIB IS ONLY FOR SENDING
-*       MESSAGES
+*   (1) MQTT 3.1 / 3.1.1 / 5 CLIENT. PUBLISH (QOS 0 / 1 / 2 WITH AN IN-FLIGHT
+*       WINDOW), SUBSCRIBE / UNSUBSCRIBE WITH PER FILTER HANDLERS AND AN
+*       OPTIONAL PERSISTENT SESSION (AUTOMATIC PINGREQ, RECONNECT WITH
+*       BACKOFF). SEE THE NOTES OF ESP8266_MQTT_CLIENT.h FOR THE FULL LIST
 *
-*   (2) DOES NOT PROVIDE PING FUNCTIONALITY AS THE IDEA IS THAT THE CLIENT WILL
-*       NOT NEED TO CONNECT TO MQTT BROKER FOR EXTENDED PERIOD OF TIME. IT WILL
-*       CONNECT, PUBLISH THE MESSAGE AND DISCONNECT
+*   (2) BY DEFAULT THE CLIENT CONNECTS, PUBLISHES AND DISCONNECTS. NOTHING IS
+*       SENT ON ITS OWN UNLESS THE PERSISTENT SESSION MODE (OR THE STATS
+*       PUBLISH) IS ON
 *
-*   (3) ONLY SUPPORTS QOS = 0 BECAUSE OF POINT (2). THE FUNCTIONALITY PROVIDED
-*       IS FIRE AND FORGET
+*   (3) ALL PROTOCOL STATE LIVES IN THE SELECTED esp8266_mqtt_client_t (s_client)
 *
 *   (4) FREE ONLINE MQTT BROKER
 *       DIOTY
@@ -35,72 +36,318 @@
 
 #include "ESP8266_TCP_GENERIC.h"
 #include "ESP8266_MQTT_CLIENT.h"
+#include "ESP8266_MQTT_FLASH_QUEUE.h"
+#include "ESP8266_MQTT_COMPRESS.h"
+#include "ESP8266_MQTT_LOG.h"
+
+//SUSPEND RECORD CHECK. THE BUILD FAILS (NEGATIVE ARRAY SIZE) IF THE PENDING
+//IDS OUTGROW THE 32 BIT QOS 2 BITMAPS (pending_qos2 / resume_qos2)
+typedef char s_esp8266_mqtt_suspend_pending_check[(ESP8266_MQTT_CLIENT_SUSPEND_PENDING_MAX <= 32) ? 1 : -1];
 
 //LOCAL LIBRARY VARIABLES////////////////////////////////
-//DEBUG RELATED
-static uint8_t s_esp8266_mqtt_client_debug;
-
-//OPERATION RELATED
-static uint16_t s_buffer_size;
-static uint16_t s_mqtt_message_id = 0;
-static esp8266_mqtt_client_packet_type_t s_current_packet_type;
-
-//CB FUNCTIONS
-static void (*s_esp8266_mqtt_client_tcp_conn_cb_function)(void);
-static void (*s_esp8266_mqtt_client_dns_cb_function)(ip_addr_t*);
-static void (*s_esp8266_mqtt_client_data_send_cb)(void*);
-static void (*s_esp8266_mqtt_client_data_recv_cb)(esp8266_mqtt_client_packet_type_t ptype,char*, unsigned short);
-
-//MQTT RELATED (WITH DEFAULT VALUES)
-static bool s_flag_dup = false;
-static uint8_t s_qos = ESP8266_MQTT_QOS_0;
-static uint8_t s_flag_retain = false;
-static bool s_flag_username = false;
-static char* s_username = NULL;
-static bool s_flag_password = false;
-static char* s_password = NULL;
-static bool s_flag_clean_session = true;
-static uint16_t s_keepalive_timer = 0;
-static bool s_flag_will = false;
-static char* s_will_topic = NULL;
-static char* s_will_message = NULL;
-static uint8_t s_will_qos = ESP8266_MQTT_QOS_0;
-static char* s_client_id = NULL;
-static char* s_packet_return_code[7] = {"Connection Accpted",
-                                        "Connection Refused : unaccepted protocol version",
-                                        "Connection Refused : identifier rejected",
-                                        "Connection Refused : server unavailable",
-                                        "Connection Refused : bad username / password",
-                                        "Connection Refused : not authorized",
-                                        "Reserved"};
-static char* s_last_topic;
-static char* s_last_message;
-static esp8266_mqtt_qos_t s_last_qos;
+//TRANSPORT RELATED
+//ESP8266_TCP_GENERIC IS A SINGLE CONNECTION LIBRARY. THE DEFAULT TRANSPORT
+//FORWARDS ITS CBS TO THE ONE INSTANCE THAT OWNS IT (s_tcp_generic_owner)
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_initialize(void* ctx,
+                                                            const char* hostname,
+                                                            const char* host_ip,
+                                                            uint16_t host_port,
+                                                            uint16_t buffer_size);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_set_dns_server(void* ctx, char num_dns, ip_addr_t* dns);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_set_callback_functions(void* ctx,
+                                                                        void* cb_arg,
+                                                                        void (*conn_cb)(void*),
+                                                                        void (*discon_cb)(void*),
+                                                                        void (*send_cb)(void*),
+                                                                        void (*recv_cb)(void*, char*, unsigned short),
+                                                                        void (*dns_cb)(void*, ip_addr_t*));
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_resolve_host_name(void* ctx);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_connect(void* ctx);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_disconnect(void* ctx);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_send(void* ctx, uint8_t* data, uint16_t len);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_set_host_ip(void* ctx, ip_addr_t* ip);
+static const esp8266_mqtt_transport_t s_transport_tcp_generic = {s_esp8266_mqtt_tcp_initialize,
+                                                                    s_esp8266_mqtt_tcp_set_dns_server,
+                                                                    s_esp8266_mqtt_tcp_set_callback_functions,
+                                                                    s_esp8266_mqtt_tcp_resolve_host_name,
+                                                                    s_esp8266_mqtt_tcp_connect,
+                                                                    s_esp8266_mqtt_tcp_disconnect,
+                                                                    s_esp8266_mqtt_tcp_send,
+                                                                    s_esp8266_mqtt_tcp_set_host_ip};
+static void* s_tcp_cb_arg;
+static void (*s_tcp_conn_cb)(void*);
+static void (*s_tcp_discon_cb)(void*);
+static void (*s_tcp_send_cb)(void*);
+static void (*s_tcp_recv_cb)(void*, char*, unsigned short);
+static void (*s_tcp_dns_cb)(void*, ip_addr_t*);
+static const char* s_tcp_hostname;
+static uint16_t s_tcp_host_port;
+static uint16_t s_tcp_buffer_size;
+static ip_addr_t s_tcp_host_ip;
+//THE ONE INSTANCE ALLOWED ON THE DEFAULT TRANSPORT (FIRST TO INITIALIZE ON IT)
+static esp8266_mqtt_client_t* s_tcp_generic_owner = NULL;
+
+//INSTANCE RELATED
+//s_client IS THE INSTANCE THE API ACTS ON (ESP8266_MQTT_CLIENT_Select). EVENT
+//CBS (TRANSPORT / TIMERS) MAKE THEIR OWN INSTANCE CURRENT WHILE THEY RUN
+static esp8266_mqtt_client_t s_client_default = {.transport = &s_transport_tcp_generic,
+                                                    .coalesce_threshold = ESP8266_MQTT_CLIENT_COALESCE_THRESHOLD_DEFAULT,
+                                                    .coalesce_timeout_ms = ESP8266_MQTT_CLIENT_COALESCE_TIMEOUT_MS_DEFAULT,
+                                                    .compress_threshold = ESP8266_MQTT_CLIENT_COMPRESS_THRESHOLD_DEFAULT,
+                                                    .inflight_window = ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_DEFAULT,
+                                                    .protocol_version = ESP8266_MQTT_PROTOCOL_VERSION,
+                                                    .server_receive_max = 0xFFFF,
+                                                    .dns_ttl_s = ESP8266_MQTT_CLIENT_DNS_TTL_DEFAULT_S,
+                                                    .flag_clean_session = true};
+static esp8266_mqtt_client_t* s_client = &s_client_default;
+
+//STATS RELATED
+//UPPER BOUND (MS) OF EACH LATENCY HISTOGRAM BUCKET. THE LAST ONE IS OPEN ENDED
+static const uint16_t s_esp8266_mqtt_stats_bucket_ms[ESP8266_MQTT_CLIENT_STATS_BUCKETS - 1] = {10, 25, 50, 100, 250, 500, 1000};
+static const char* s_esp8266_mqtt_stats_stage_names[ESP8266_MQTT_STATS_STAGE_COUNT] = {"dns", "tcp", "connack", "puback", "pingresp"};
+
+//OFFLINE QUEUE RELATED
+//THERE IS ONE FLASH QUEUE. ONLY ONE INSTANCE CAN USE IT AT A TIME
+static esp8266_mqtt_client_t* s_offline_queue_owner = NULL;
+
+//CONNACK RETURN CODE LOG FORMATS (THE STRINGS ARE THE LOG EVENT IDS)
+static const char* s_packet_return_code[7] = {"CONNACK 0x%02X : Connection Accpted",
+                                                "CONNACK 0x%02X : Connection Refused : unaccepted protocol version",
+                                                "CONNACK 0x%02X : Connection Refused : identifier rejected",
+                                                "CONNACK 0x%02X : Connection Refused : server unavailable",
+                                                "CONNACK 0x%02X : Connection Refused : bad username / password",
+                                                "CONNACK 0x%02X : Connection Refused : not authorized",
+                                                "CONNACK 0x%02X : Reserved"};
 //END LOCAL LIBRARY VARIABLES/////////////////////////////
 
 //LOCAL LIBRARY FUNCTIONS////////////////////////////////
 static void ICACHE_FLASH_ATTR s_esp8266_mqtt_print_packet(uint8_t* packet, uint16_t len);
-static uint8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_insert_string(uint8_t* dest_buff, 
-                                                                char* src_buff, 
-                                                                uint8_t len);
-static uint8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_calculate_remaining_length(uint16_t len_variable_header, 
-                                                                            uint16_t len_payload, 
-                                                                            uint8_t* ptr_remaining_length);
-static void ICACHE_FLASH_ATTR s_esp8266_mqtt_send_packet(esp8266_mqtt_packet_t packet);
-static esp8266_mqtt_client_packet_type_t ICACHE_FLASH_ATTR s_esp8266_mqtt_parse_response_packet(uint8_t* packet, uint16_t len);
-
-static void ICACHE_FLASH_ATTR s_esp8266_mqtt_client_dns_found_cb(ip_addr_t* ipAddr);
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_insert_string(uint8_t* dest_buff, 
+                                                                const char* src_buff, 
+                                                                uint16_t len);
+static uint8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_remaining_length_size(uint32_t len_remaining);
+static uint8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_insert_varint(uint8_t* dest_buff, uint32_t value);
+static uint8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_decode_varint(uint8_t* data, uint16_t len, uint32_t* value);
+static int32_t ICACHE_FLASH_ATTR s_esp8266_mqtt_properties_decode(uint8_t* data,
+                                                                    uint16_t len,
+                                                                    uint8_t** properties,
+                                                                    uint16_t* len_properties);
+static int32_t ICACHE_FLASH_ATTR s_esp8266_mqtt_property_size(uint8_t id, uint8_t* value, uint16_t len);
+static uint8_t* ICACHE_FLASH_ATTR s_esp8266_mqtt_property_find(uint8_t* properties, uint16_t len_properties, uint8_t id);
+static uint8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_insert_fixed_header(uint8_t* dest_buff, 
+                                                                    uint8_t byte1, 
+                                                                    uint32_t len_remaining);
+static uint8_t* ICACHE_FLASH_ATTR s_esp8266_mqtt_tx_reserve(uint32_t len_remaining);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tx_flush(void);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tx_flush_timer_cb(void* arg);
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_tx_queue_segment(uint8_t* data,
+                                                                uint16_t len,
+                                                                void (*release_cb)(void*),
+                                                                void* release_arg);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tx_pump(void);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tx_reset(void);
+static uint32_t ICACHE_FLASH_ATTR s_esp8266_mqtt_publish_remaining_length(char* topic,
+                                                                        esp8266_mqtt_topic_handle_t* topic_handle,
+                                                                        uint16_t len_message,
+                                                                        esp8266_mqtt_qos_t qos_level,
+                                                                        bool raw);
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_publish_fits(char* topic,
+                                                            esp8266_mqtt_topic_handle_t* topic_handle,
+                                                            uint16_t len_message,
+                                                            esp8266_mqtt_qos_t qos_level,
+                                                            bool zero_copy,
+                                                            bool raw);
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_store_fits(char* topic,
+                                                        uint16_t len_topic,
+                                                        uint16_t len_message,
+                                                        esp8266_mqtt_qos_t qos_level,
+                                                        bool raw);
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_encode_publish(char* topic,
+                                                                esp8266_mqtt_topic_handle_t* topic_handle,
+                                                                char* message,
+                                                                uint16_t len_message,
+                                                                esp8266_mqtt_qos_t qos_level,
+                                                                uint16_t packet_id,
+                                                                bool dup,
+                                                                bool zero_copy,
+                                                                bool raw);
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_connect_build(void);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_send_packet(uint16_t len, bool allow_coalesce);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_send_ack(uint8_t byte1, uint16_t packet_id);
+static int8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_decode_fixed_header(uint8_t* data, uint16_t len, uint32_t* len_remaining);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_rx_reset(void);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_rx_feed(uint8_t* data, uint16_t len);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_handle_packet(uint8_t* packet, uint16_t len, uint8_t len_header);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_handle_publish(uint8_t* packet, uint16_t len, uint8_t len_header);
+static int8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_inbound_qos2_find(uint16_t packet_id);
+static esp8266_mqtt_client_packet_type_t ICACHE_FLASH_ATTR s_esp8266_mqtt_parse_response_packet(uint8_t* packet,
+                                                                                                uint16_t len,
+                                                                                                uint8_t len_header);
+
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_publish_submit(char* topic,
+                                                            esp8266_mqtt_topic_handle_t* topic_handle,
+                                                            char* message,
+                                                            uint16_t len_message,
+                                                            esp8266_mqtt_qos_t qos_level,
+                                                            bool raw,
+                                                            void (*complete_cb)(void*, bool),
+                                                            void* cb_arg,
+                                                            void (*release_cb)(void*),
+                                                            void* release_arg);
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_publish(char* topic,
+                                                        esp8266_mqtt_topic_handle_t* topic_handle,
+                                                        char* message,
+                                                        uint16_t len_message,
+                                                        esp8266_mqtt_qos_t qos_level,
+                                                        bool raw,
+                                                        void (*complete_cb)(void*, bool),
+                                                        void* cb_arg,
+                                                        void (*release_cb)(void*),
+                                                        void* release_arg,
+                                                        uint32_t store_addr);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_store_drain(void);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_store_dropped_cb(uint32_t start_addr, uint32_t end_addr);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_send_queue_link(esp8266_mqtt_send_queue_entry_t* entry);
+static esp8266_mqtt_send_queue_entry_t* ICACHE_FLASH_ATTR s_esp8266_mqtt_send_queue_find(char* topic, uint32_t topic_hash);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_send_queue_remove(esp8266_mqtt_send_queue_entry_t* entry, bool sent);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_send_queue_expire(void);
+static esp8266_mqtt_send_queue_entry_t* ICACHE_FLASH_ATTR s_esp8266_mqtt_send_queue_next(void);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_send_queue_dispatch(void);
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_stream_start(bool dup);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_stream_next(void);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_stream_chunk_sent_cb(void* arg);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_stream_end(bool success);
+static uint8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_inflight_limit(void);
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_topic_alias_get(esp8266_mqtt_topic_handle_t* topic_handle, bool* alias_known);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_topic_alias_reset(void);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_report_reason(esp8266_mqtt_client_packet_type_t ptype,
+                                                            uint16_t packet_id,
+                                                            uint8_t reason_code);
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_next_packet_id(void);
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_send_subscribe(char* topic_filter,
+                                                            uint16_t len_filter,
+                                                            uint8_t qos_level,
+                                                            bool unsubscribe);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_resubscribe_cb(void* arg,
+                                                            char* topic_filter,
+                                                            uint16_t len_filter,
+                                                            uint8_t qos_level);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_resubscribe(void);
+static esp8266_mqtt_inflight_entry_t* ICACHE_FLASH_ATTR s_esp8266_mqtt_inflight_alloc(void);
+static esp8266_mqtt_inflight_entry_t* ICACHE_FLASH_ATTR s_esp8266_mqtt_inflight_find(uint16_t packet_id);
+static esp8266_mqtt_inflight_entry_t* ICACHE_FLASH_ATTR s_esp8266_mqtt_inflight_find_store(uint32_t store_addr);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_inflight_complete(esp8266_mqtt_inflight_entry_t* entry, bool success);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_inflight_retransmit(esp8266_mqtt_inflight_entry_t* entry);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_inflight_retransmit_all(void);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_inflight_resend(void);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_inflight_session_lost(void);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_inflight_timer_cb(void* arg);
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_keepalive_start(uint32_t timeout_ms);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_keepalive_stop(void);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_keepalive_timer_cb(void* arg);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_pingresp_timer_cb(void* arg);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_session_reconnect(void);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_reconnect_schedule(void);
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_connack_retryable(uint8_t return_code);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_reconnect_timer_cb(void* arg);
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_generic_conn_cb(void* arg);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_generic_discon_cb(void* arg);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_generic_send_cb(void* arg);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_generic_recv_cb(char* pusrdata, unsigned short length);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_generic_dns_cb(ip_addr_t* ipAddr);
+
+static esp8266_mqtt_client_t* ICACHE_FLASH_ATTR s_esp8266_mqtt_instance_enter(void* client);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_instance_leave(esp8266_mqtt_client_t* previous);
+static uint32_t ICACHE_FLASH_ATTR s_esp8266_mqtt_hash(const uint8_t* data, uint16_t len);
+static uint32_t ICACHE_FLASH_ATTR s_esp8266_mqtt_dns_cache_age(void);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_dns_cache_load(void);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_dns_cache_save(uint32_t sleep_s);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_dns_cache_drop(void);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_dns_cache_timer_cb(void* arg);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_dns_report(ip_addr_t* ipAddr);
+static int8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_resume_find(uint16_t packet_id);
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_resume_release(uint16_t packet_id);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_resume_connected(bool session_lost);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_stats_start(esp8266_mqtt_stats_stage_t stage);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_stats_stop(esp8266_mqtt_stats_stage_t stage);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_stats_record(esp8266_mqtt_stats_stage_t stage, uint32_t elapsed_us);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_stats_heap(int32_t delta);
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_stats_format(char* dest);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_stats_timer_cb(void* arg);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_client_dns_found_cb(void* arg, ip_addr_t* ipAddr);
 static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_conn_cb(void* arg);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_discon_cb(void* arg);
 static void ICACHE_FLASH_ATTR s_esp8266_mqtt_client_send_cb(void* arg);
-static void ICACHE_FLASH_ATTR s_esp8266_mqtt_client_receive_cb(char* pusrdata, unsigned short length);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_client_receive_cb(void* arg, char* pusrdata, unsigned short length);
 //END LOCAL LIBRARY FUNCTIONS////////////////////////////////
 
 
 void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetDebug(uint8_t debug_on)
 {
 	//SET DEBUG PRINTF ON(1) OR OFF(0)
+    //ONLY SELECTS WHEN LOG RECORDS ARE PRINTED. WHAT IS LOGGED IS FIXED AT
+    //BUILD TIME BY ESP8266_MQTT_LOG_LEVEL
+    //ON : LOG RECORDS ARE PRINTED FROM A LOW PRIORITY TASK (ESP8266_MQTT_LOG).
+    //OFF : THEY STAY IN THE LOG RING UNTIL ESP8266_MQTT_LOG_Drain
+
+    ESP8266_MQTT_LOG_SetAutoDrain(debug_on != 0);
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_InitInstance(esp8266_mqtt_client_t* client)
+{
+    //SET UP A NEW CLIENT INSTANCE WITH DEFAULT OPTIONS
+    //SELECT IT (ESP8266_MQTT_CLIENT_Select) AND CONFIGURE / INITIALIZE IT WITH
+    //THE USUAL FUNCTIONS. THE STRUCTURE MUST STAY VALID WHILE IT IS IN USE
+
+    if(s_tcp_generic_owner == client)
+    {
+        s_tcp_generic_owner = NULL;
+    }
+    os_memset(client, 0, sizeof(esp8266_mqtt_client_t));
+    client->transport = &s_transport_tcp_generic;
+    client->coalesce_threshold = ESP8266_MQTT_CLIENT_COALESCE_THRESHOLD_DEFAULT;
+    client->coalesce_timeout_ms = ESP8266_MQTT_CLIENT_COALESCE_TIMEOUT_MS_DEFAULT;
+    client->compress_threshold = ESP8266_MQTT_CLIENT_COMPRESS_THRESHOLD_DEFAULT;
+    client->inflight_window = ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_DEFAULT;
+    client->protocol_version = ESP8266_MQTT_PROTOCOL_VERSION;
+    client->server_receive_max = 0xFFFF;
+    client->dns_ttl_s = ESP8266_MQTT_CLIENT_DNS_TTL_DEFAULT_S;
+    client->flag_clean_session = true;
+}
+
+esp8266_mqtt_client_t* ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Select(esp8266_mqtt_client_t* client)
+{
+    //MAKE client THE INSTANCE ALL OTHER FUNCTIONS ACT ON (NULL = DEFAULT INSTANCE)
+    //RETURN THE PREVIOUSLY SELECTED INSTANCE
+
+    esp8266_mqtt_client_t* previous = s_client;
+
+    s_client = (client != NULL) ? client : &s_client_default;
+    return previous;
+}
+
+esp8266_mqtt_client_t* ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_GetInstance(void)
+{
+    //RETURN THE SELECTED INSTANCE
+    //INSIDE A USER CB THIS IS THE INSTANCE THE EVENT BELONGS TO
 
-    s_esp8266_mqtt_client_debug = debug_on;
+    return s_client;
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetTransport(const esp8266_mqtt_transport_t* transport, void* transport_ctx)
+{
+    //SET THE TRANSPORT USED FOR ALL NETWORK I/O (NULL = ESP8266_TCP_GENERIC)
+    //transport_ctx IS PASSED BACK TO EVERY TRANSPORT OPERATION (ONE PER CONNECTION)
+    //MUST BE CALLED BEFORE ESP8266_MQTT_CLIENT_Initialize
+
+    if(s_tcp_generic_owner == s_client && transport != NULL && transport != &s_transport_tcp_generic)
+    {
+        s_tcp_generic_owner = NULL;
+    }
+    s_client->transport = (transport != NULL) ? transport : &s_transport_tcp_generic;
+    s_client->transport_ctx = transport_ctx;
 }
 
 void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Initialize(const char* hostname,
@@ -110,17 +357,112 @@ void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Initialize(const char* hostname,
 {
     //INITIALIZE MQTT CLIENT MODULE PARAMETERS
 
-    //SET DEBUG ON
-    s_esp8266_mqtt_client_debug = 1;
-    
-    //INTIALIZE UNDERLYING TCP GENERIC MODULE
-    ESP8266_TCP_GENERIC_Initialize(hostname, host_ip, host_port, "", buffer_size);
-    s_buffer_size = buffer_size;
+    uint16_t previous_buffer_size = s_client->buffer_size;
+    uint8_t i;
+
+    //ESP8266_TCP_GENERIC HANDLES ONE CONNECTION SO ONLY ONE INSTANCE CAN USE
+    //THE DEFAULT TRANSPORT. ANY OTHER ONE IS LEFT UNUSABLE (ITS TRANSPORT CALLS
+    //ARE IGNORED) UNTIL IT IS GIVEN ITS OWN (ESP8266_MQTT_CLIENT_SetTransport)
+    if(s_client->transport == &s_transport_tcp_generic)
+    {
+        if(s_tcp_generic_owner != NULL && s_tcp_generic_owner != s_client)
+        {
+            ESP8266_MQTT_LOG_ERROR("Error ! Default transport used by another instance");
+            return;
+        }
+        s_tcp_generic_owner = s_client;
+    }
+
+    //RE-INITIALIZE ENDS THE OLD CONNECTION. UNACKNOWLEDGED MESSAGES FAIL
+    //(COMPLETION CBS CALLED, ZERO COPY PAYLOADS HANDED BACK, STORED ONES
+    //STAY IN FLASH) BEFORE THE IN-FLIGHT TABLE IS CLEARED. NOTHING QUEUED
+    //IS SENT MEANWHILE
+    s_client->mqtt_connected = false;
+    for(i = 0; i < ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX; i++)
+    {
+        if(s_client->inflight[i].state != ESP8266_MQTT_INFLIGHT_STATE_FREE)
+        {
+            s_esp8266_mqtt_inflight_complete(&s_client->inflight[i], false);
+        }
+    }
+
+    //INTIALIZE UNDERLYING TRANSPORT (TCP GENERIC MODULE BY DEFAULT)
+    (*s_client->transport->initialize)(s_client->transport_ctx, hostname, host_ip, host_port, buffer_size);
+    s_client->buffer_size = buffer_size;
+
+    //DNS CACHE ENTRIES ARE ONLY VALID FOR THIS HOST NAME
+    s_client->dns_host_hash = (hostname != NULL) ? s_esp8266_mqtt_hash((const uint8_t*)hostname, os_strlen(hostname)) : 0;
+    s_client->dns_valid = false;
+    if(s_client->flag_dns_cache)
+    {
+        s_esp8266_mqtt_dns_cache_load();
+    }
+    os_timer_disarm(&s_client->dns_os_timer);
+    os_timer_setfn(&s_client->dns_os_timer, (os_timer_func_t*)s_esp8266_mqtt_dns_cache_timer_cb, s_client);
+
+    //NOTHING RESTORED YET (ESP8266_MQTT_CLIENT_Resume). THE PACKET ID COUNTER
+    //STARTS OVER HERE ONLY, SO OPTIONS SET AFTER A RESUME KEEP THE RESTORED ONE
+    s_client->mqtt_message_id = 0;
+    s_client->host_ip.addr = 0;
+    s_client->resume_count = 0;
+    s_client->resume_qos2 = 0;
+
+    //SET TCP LAYER CB FUNCTIONS
+    //THE TX SEGMENT QUEUE NEEDS THE SENT CB EVEN IF NO USER CB IS EVER SET
+    (*s_client->transport->set_callback_functions)(s_client->transport_ctx,
+                                                    s_client,
+                                                    s_esp8266_mqtt_tcp_conn_cb,
+                                                    s_esp8266_mqtt_tcp_discon_cb,
+                                                    s_esp8266_mqtt_client_send_cb,
+                                                    s_esp8266_mqtt_client_receive_cb,
+                                                    s_esp8266_mqtt_client_dns_found_cb);
+
+    //ALLOCATE CLIENT TX BUFFER ONCE
+    //ALL OUTGOING PACKETS ARE SERIALIZED DIRECTLY INTO IT
+    if(s_client->tx_buffer != NULL)
+    {
+        os_free(s_client->tx_buffer);
+        s_esp8266_mqtt_stats_heap(-(int32_t)previous_buffer_size);
+    }
+    s_client->tx_buffer = (uint8_t*)os_zalloc(s_client->buffer_size);
+    if(s_client->tx_buffer != NULL)
+    {
+        s_esp8266_mqtt_stats_heap(s_client->buffer_size);
+    }
+    s_esp8266_mqtt_tx_reset();
+    os_timer_disarm(&s_client->tx_flush_os_timer);
+    os_timer_setfn(&s_client->tx_flush_os_timer, (os_timer_func_t*)s_esp8266_mqtt_tx_flush_timer_cb, s_client);
+
+    //ALLOCATE CLIENT RX BUFFER ONCE
+    //ONLY USED TO REASSEMBLE PACKETS SPLIT ACROSS TCP RECEIVE CALLS
+    if(s_client->rx_buffer != NULL)
+    {
+        os_free(s_client->rx_buffer);
+        s_esp8266_mqtt_stats_heap(-(int32_t)previous_buffer_size);
+    }
+    s_client->rx_buffer = (uint8_t*)os_zalloc(s_client->buffer_size);
+    if(s_client->rx_buffer != NULL)
+    {
+        s_esp8266_mqtt_stats_heap(s_client->buffer_size);
+    }
+    s_esp8266_mqtt_rx_reset();
+
+    //SETUP IN-FLIGHT TABLE
+    os_memset(s_client->inflight, 0, sizeof(s_client->inflight));
+    s_client->inflight_count = 0;
+    os_timer_disarm(&s_client->inflight_os_timer);
+    os_timer_setfn(&s_client->inflight_os_timer, (os_timer_func_t*)s_esp8266_mqtt_inflight_timer_cb, s_client);
 
-    os_printf("ESP8266 MQTT_CLIENT : Initialized. Debug ON\n");
+    //SETUP PERSISTENT SESSION TIMERS
+    os_timer_setfn(&s_client->keepalive_os_timer, (os_timer_func_t*)s_esp8266_mqtt_keepalive_timer_cb, s_client);
+    os_timer_setfn(&s_client->pingresp_os_timer, (os_timer_func_t*)s_esp8266_mqtt_pingresp_timer_cb, s_client);
+    os_timer_setfn(&s_client->reconnect_os_timer, (os_timer_func_t*)s_esp8266_mqtt_reconnect_timer_cb, s_client);
+    os_timer_setfn(&s_client->stats_os_timer, (os_timer_func_t*)s_esp8266_mqtt_stats_timer_cb, s_client);
+
+    ESP8266_MQTT_LOG_INFO("Initialized. Buffer size %u", buffer_size);
 }
 
-void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetOptions(uint8_t dup,
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetOptions(uint8_t dup,
 														uint8_t qos,
 														uint8_t retain,
 														bool use_username,
@@ -135,30 +477,463 @@ void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetOptions(uint8_t dup,
 														uint8_t will_qos,
                                                         char* client_id)
 {
-    //SET THE BASIC GLOBAL MQTT OPTIONS
-
-    s_flag_dup = dup;
-    s_qos = qos;
-    s_flag_retain = retain;
-    s_flag_username = use_username;
-    s_username = username;
-    s_flag_password = use_password;
-    s_password = password;
-    s_flag_clean_session = use_clean_session;
-    s_keepalive_timer = keepalive_timer_val;
-    s_flag_will = use_will;
-    s_will_topic = s_will_topic;
-    s_will_message = s_will_message;
-    s_will_qos = s_will_qos;
-    s_client_id = client_id;
-    s_mqtt_message_id = 0;
+    //SET THE BASIC MQTT OPTIONS OF THE SELECTED INSTANCE
+    //THE CONNECT PACKET IS BUILT FROM THEM RIGHT AWAY AND REUSED FOR EVERY
+    //(RE)CONNECT. RETURN FALSE IF THEY ARE INVALID (NULL CLIENT ID, MISSING
+    //WILL / USERNAME / PASSWORD STRING ...). NO CONNECT CAN BE SENT UNTIL
+    //VALID OPTIONS ARE SET
+
+    s_client->flag_dup = dup;
+    s_client->qos = qos;
+    s_client->flag_retain = retain;
+    s_client->flag_username = use_username;
+    s_client->username = username;
+    s_client->flag_password = use_password;
+    s_client->password = password;
+    s_client->flag_clean_session = use_clean_session;
+    s_client->keepalive_timer = keepalive_timer_val;
+    s_client->flag_will = use_will;
+    s_client->will_topic = will_topic;
+    s_client->will_message = will_message;
+    s_client->will_qos = will_qos;
+    s_client->client_id = client_id;
+    return s_esp8266_mqtt_connect_build();
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetInflightWindow(uint8_t window_size)
+{
+    //SET THE MAXIMUM NUMBER OF UNACKNOWLEDGED QOS 1 MESSAGES
+    //(1 - ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX)
+
+    if(window_size == 0)
+    {
+        window_size = 1;
+    }
+    if(window_size > ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX)
+    {
+        window_size = ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX;
+    }
+    s_client->inflight_window = window_size;
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetCoalescing(bool enable,
+                                                        uint16_t flush_threshold,
+                                                        uint16_t flush_timeout_ms)
+{
+    //ENABLE / DISABLE PUBLISH COALESCING
+    //PUBLISH PACKETS ARE APPENDED TO THE TX BUFFER AND SENT AS ONE TCP SEGMENT
+    //ONCE flush_threshold BYTES ARE WAITING (CAPPED TO BUFFER SIZE) OR
+    //flush_timeout_ms AFTER THE FIRST ONE WAS QUEUED
+
+    s_client->flag_coalesce = enable;
+    s_client->coalesce_threshold = flush_threshold;
+    s_client->coalesce_timeout_ms = flush_timeout_ms;
+    if(!s_client->flag_coalesce)
+    {
+        s_esp8266_mqtt_tx_flush();
+    }
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetCompression(bool enable, uint16_t threshold)
+{
+    //ENABLE / DISABLE PUBLISH PAYLOAD COMPRESSION
+    //PAYLOADS OF threshold BYTES OR MORE ARE SENT COMPRESSED IF THAT SAVES BYTES
+
+    s_client->flag_compress = enable;
+    s_client->compress_threshold = threshold;
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetOfflineQueue(bool enable,
+                                                            uint16_t start_sector,
+                                                            uint16_t sector_count)
+{
+    //ENABLE / DISABLE THE FLASH BACKED OFFLINE QUEUE ON THE SPECIFIED FLASH
+    //SECTOR RANGE. PUBLISHES MADE WHILE NOT CONNECTED ARE STORED AND SENT IN
+    //ORDER ONCE CONNECTED. MUST BE CALLED AFTER ESP8266_MQTT_CLIENT_Initialize
+    //THERE IS ONE FLASH QUEUE SO ONLY ONE INSTANCE CAN HAVE IT ENABLED
+    //RETURN FALSE IF THE QUEUE COULD NOT BE SET UP
+
+    if(!enable)
+    {
+        s_client->flag_offline_queue = false;
+        if(s_offline_queue_owner == s_client)
+        {
+            s_offline_queue_owner = NULL;
+            ESP8266_MQTT_FLASH_QUEUE_SetDropCallback(NULL);
+        }
+        return true;
+    }
+    if(s_offline_queue_owner != NULL && s_offline_queue_owner != s_client)
+    {
+        //FLASH QUEUE ALREADY USED BY ANOTHER INSTANCE
+        return false;
+    }
+    if(s_client->buffer_size == 0 || !ESP8266_MQTT_FLASH_QUEUE_Initialize(start_sector, sector_count))
+    {
+        return false;
+    }
+
+    //BUFFER TO READ STORED RECORDS BACK INTO
+    if(s_client->store_buffer == NULL)
+    {
+        s_client->store_buffer = (uint8_t*)os_zalloc(s_client->buffer_size);
+        if(s_client->store_buffer != NULL)
+        {
+            s_esp8266_mqtt_stats_heap(s_client->buffer_size);
+        }
+    }
+    s_client->flag_offline_queue = true;
+    s_offline_queue_owner = s_client;
+    ESP8266_MQTT_FLASH_QUEUE_SetDropCallback(s_esp8266_mqtt_store_dropped_cb);
+    return true;
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetPersistentSession(bool enable)
+{
+    //ENABLE / DISABLE PERSISTENT SESSION MODE
+    //IN PERSISTENT MODE THE TCP CONNECTION IS KEPT OPEN AFTER CONNECT.
+    //PINGREQ IS SENT WHEN THE LINK HAS BEEN IDLE FOR THE KEEPALIVE INTERVAL
+    //AND THE SESSION IS TORN DOWN + RECONNECTED IF NO PINGRESP ARRIVES
+
+    s_client->flag_persistent = enable;
+    if(!s_client->flag_persistent)
+    {
+        s_esp8266_mqtt_keepalive_stop();
+        os_timer_disarm(&s_client->reconnect_os_timer);
+        s_client->session_active = false;
+        s_client->session_reconnecting = false;
+        s_client->reconnect_pending = false;
+        s_client->reconnect_resolving = false;
+    }
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetReconnectBackoff(uint32_t min_delay_ms, uint32_t max_delay_ms)
+{
+    //SET THE PERSISTENT SESSION RECONNECT DELAY RANGE
+    //THE DELAY DOUBLES WITH EVERY FAILED ATTEMPT FROM min_delay_ms UP TO
+    //max_delay_ms (0 = DEFAULT). EACH DELAY IS RANDOMIZED TO 50 - 100%
+
+    s_client->reconnect_min_ms = min_delay_ms;
+    s_client->reconnect_max_ms = max_delay_ms;
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetProtocolVersion(esp8266_mqtt_protocol_version_t version)
+{
+    //SELECT THE MQTT PROTOCOL VERSION USED FROM THE NEXT CONNECT
+    //3.1 ("MQIsdp"), 3.1.1 OR 5.0
+    //RETURN FALSE IF THE VERSION IS NOT SUPPORTED (OR THE CONNECT PACKET
+    //COULD NOT BE BUILT AGAIN FOR IT)
+
+    if(version != ESP8266_MQTT_PROTOCOL_VERSION_3_1 &&
+        version != ESP8266_MQTT_PROTOCOL_VERSION_3_1_1 &&
+        version != ESP8266_MQTT_PROTOCOL_VERSION_5)
+    {
+        return false;
+    }
+    s_client->protocol_version = version;
+    if(s_client->client_id != NULL)
+    {
+        return s_esp8266_mqtt_connect_build();
+    }
+    return true;
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetReasonCodeCallback(void (*reason_cb)(esp8266_mqtt_client_packet_type_t ptype,
+                                                                                    uint16_t packet_id,
+                                                                                    uint8_t reason_code))
+{
+    //SET CB CALLED WITH THE REASON CODE (RETURN CODE FOR CONNACK / SUBACK) OF
+    //EVERY RECEIVED ACKNOWLEDGEMENT. ACKS WITHOUT ONE (MQTT 3.x PUBACK ETC)
+    //REPORT 0 (SUCCESS). packet_id IS 0 FOR CONNACK / DISCONNECT
+
+    s_client->reason_cb = reason_cb;
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_IsConnected(void)
+{
+    //RETURN TRUE IF CONNACK (ACCEPTED) HAS BEEN RECEIVED ON THE CURRENT
+    //TCP CONNECTION
+
+    return s_client->mqtt_connected;
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_IsSessionPresent(void)
+{
+    //RETURN TRUE IF THE BROKER RESUMED A STORED SESSION ON THE CURRENT
+    //CONNECTION (CONNACK SESSION PRESENT FLAG, MQTT 3.1.1 / 5 ONLY)
+
+    return s_client->session_present;
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_GetStats(esp8266_mqtt_stats_t* stats)
+{
+    //COPY A SNAPSHOT OF THE INSTANCE STATS
+
+    os_memcpy(stats, &s_client->stats, sizeof(esp8266_mqtt_stats_t));
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_ResetStats(void)
+{
+    //CLEAR ALL STATS. HEAP IN USE / SEND QUEUE DEPTH ARE KEPT (THEY BECOME
+    //THE NEW PEAKS)
+
+    uint32_t heap_used = s_client->stats.heap_used;
+
+    os_memset(&s_client->stats, 0, sizeof(esp8266_mqtt_stats_t));
+    s_client->stats.heap_used = heap_used;
+    s_client->stats.heap_peak = heap_used;
+    s_client->stats.queue_depth = s_client->send_queue_count;
+    s_client->stats.queue_peak = s_client->send_queue_count;
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetConflation(bool enable)
+{
+    //ENABLE / DISABLE LAST VALUE WINS CONFLATION OF THE SEND QUEUE
+    //A PUBLISH QUEUED TO A TOPIC THAT STILL HAS AN UNSENT ONE REPLACES IT
+
+    s_client->flag_conflate = enable;
+}
+
+uint8_t ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_GetSendQueueDepth(void)
+{
+    //RETURN NUMBER OF PUBLISHES WAITING IN THE SEND QUEUE
+
+    return s_client->send_queue_count;
+}
+
+uint8_t ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_GetInflightCount(void)
+{
+    //RETURN NUMBER OF QOS 1 / 2 MESSAGES WAITING FOR THE BROKER
+
+    return s_client->inflight_count;
 }
 
 void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetDnsServer(char num_dns, ip_addr_t* dns)
 {
     //SET DNS SERVER FOR HOST NAME RESOLVING
 
-    ESP8266_TCP_GENERIC_SetDnsServer(num_dns, dns);
+    (*s_client->transport->set_dns_server)(s_client->transport_ctx, num_dns, dns);
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetDnsCache(bool enable, uint32_t ttl_s, uint8_t rtc_block)
+{
+    //ENABLE / DISABLE THE BROKER ADDRESS CACHE
+    //ttl_s : SECONDS A RESOLVED ADDRESS IS USED WITHOUT RE-RESOLVING
+    //        (0 = DEFAULT, CAPPED TO ESP8266_MQTT_CLIENT_DNS_TTL_MAX_S)
+    //rtc_block : FIRST RTC USER MEMORY BLOCK (64 - 191) TO KEEP THE ENTRY IN
+    //            ACROSS DEEP SLEEP (0 = RAM ONLY). AN ENTRY ALREADY THERE FOR THE
+    //            SAME HOST IS LOADED (NOW OR IN ESP8266_MQTT_CLIENT_Initialize)
+    //RETURN FALSE IF THE RTC BLOCK RANGE IS INVALID
+
+    if(rtc_block != 0 &&
+        (rtc_block < 64 || (rtc_block + ESP8266_MQTT_CLIENT_DNS_CACHE_RTC_BLOCKS) > 192))
+    {
+        return false;
+    }
+
+    s_client->flag_dns_cache = enable;
+    s_client->dns_valid = false;
+    s_client->dns_from_cache = false;
+    s_client->dns_refresh = false;
+    if(!enable)
+    {
+        return true;
+    }
+
+    if(ttl_s == 0)
+    {
+        ttl_s = ESP8266_MQTT_CLIENT_DNS_TTL_DEFAULT_S;
+    }
+    if(ttl_s > ESP8266_MQTT_CLIENT_DNS_TTL_MAX_S)
+    {
+        //system_get_time WRAPS AFTER ~71 MINUTES
+        ttl_s = ESP8266_MQTT_CLIENT_DNS_TTL_MAX_S;
+    }
+    s_client->dns_ttl_s = ttl_s;
+    s_client->dns_rtc_block = rtc_block;
+    s_esp8266_mqtt_dns_cache_load();
+    return true;
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SaveDnsCache(uint32_t sleep_s)
+{
+    //WRITE THE CACHED ADDRESS TO RTC MEMORY BEFORE DEEP SLEEP
+    //sleep_s IS COUNTED AS AGE SO THE ENTRY EXPIRES ON TIME AFTER WAKE UP
+
+    if(s_client->flag_dns_cache && s_client->dns_valid)
+    {
+        s_esp8266_mqtt_dns_cache_save(sleep_s);
+    }
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Suspend(uint8_t rtc_block)
+{
+    //WRITE THE SESSION STATE OF THE INSTANCE TO RTC MEMORY BEFORE DEEP SLEEP
+    //(ESP8266_MQTT_CLIENT_Resume RESTORES IT AFTER WAKE UP). PACKET IDS BEYOND
+    //ESP8266_MQTT_CLIENT_SUSPEND_PENDING_MAX ARE NOT KEPT
+    //rtc_block : FIRST RTC USER MEMORY BLOCK (64 - 191)
+    //RETURN FALSE IF THE RTC BLOCK RANGE IS INVALID OR THE WRITE FAILS
+
+    esp8266_mqtt_suspend_record_t record;
+    uint8_t i;
+
+    if(rtc_block < 64 || (rtc_block + ESP8266_MQTT_CLIENT_SUSPEND_RTC_BLOCKS) > 192)
+    {
+        return false;
+    }
+
+    os_memset(&record, 0, sizeof(record));
+    record.magic = ESP8266_MQTT_CLIENT_SUSPEND_MAGIC;
+    record.host_hash = s_client->dns_host_hash;
+    record.host_ip = s_client->host_ip.addr;
+    record.message_id = s_client->mqtt_message_id;
+    record.keepalive_timer = s_client->keepalive_timer;
+    record.protocol_version = s_client->protocol_version;
+    record.flag_clean_session = s_client->flag_clean_session;
+
+    //RESTORED IDS NOT RELEASED YET + MESSAGES IN FLIGHT (A FULL WINDOW FITS.
+    //OLDER RESTORED IDS GO FIRST IF BOTH ARE THERE)
+    for(i = 0; i < s_client->resume_count; i++)
+    {
+        if(s_client->resume_qos2 & (1UL << i))
+        {
+            record.pending_qos2 |= (1UL << record.pending_count);
+        }
+        record.pending_ids[record.pending_count++] = s_client->resume_ids[i];
+    }
+    for(i = 0; i < ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX &&
+                record.pending_count < ESP8266_MQTT_CLIENT_SUSPEND_PENDING_MAX; i++)
+    {
+        if(s_client->inflight[i].state > ESP8266_MQTT_INFLIGHT_STATE_RESERVED)
+        {
+            if(s_client->inflight[i].qos == ESP8266_MQTT_QOS_2)
+            {
+                record.pending_qos2 |= (1UL << record.pending_count);
+            }
+            record.pending_ids[record.pending_count++] = s_client->inflight[i].packet_id;
+        }
+    }
+
+    if(s_client->connect_packet != NULL && s_client->connect_len <= ESP8266_MQTT_CLIENT_SUSPEND_CONNECT_MAX)
+    {
+        record.connect_len = s_client->connect_len;
+        os_memcpy(record.connect_packet, s_client->connect_packet, s_client->connect_len);
+    }
+    record.checksum = s_esp8266_mqtt_hash((uint8_t*)&record, sizeof(record) - 4);
+    if(!system_rtc_mem_write(rtc_block, &record, sizeof(record)))
+    {
+        return false;
+    }
+    ESP8266_MQTT_LOG_INFO("Suspended. id %u, %u ids pending", record.message_id, record.pending_count);
+    return true;
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Resume(uint8_t rtc_block)
+{
+    //RESTORE THE SESSION STATE WRITTEN BY ESP8266_MQTT_CLIENT_Suspend (CALL AFTER
+    //ESP8266_MQTT_CLIENT_Initialize). THE KEPT CONNECT PACKET IS USED IF NO
+    //OPTIONS ARE SET. THE LAST BROKER ADDRESS IS HANDED TO THE TRANSPORT. THE
+    //RECORD IS CLEARED (USED ONCE)
+    //RETURN TRUE IF ESP8266_MQTT_CLIENT_TcpConnect CAN FOLLOW RIGHT AWAY. FALSE :
+    //SET OPTIONS / RESOLVE AS USUAL (NOTHING IS RESTORED IF THE RECORD IS
+    //MISSING, CORRUPT OR FOR ANOTHER HOST NAME / OTHER CONNECT OPTIONS)
+
+    esp8266_mqtt_suspend_record_t record;
+    uint32_t len_remaining = 0;
+    uint8_t len_size = 0;
+    uint8_t* packet;
+    bool address_known;
+
+    if(rtc_block < 64 || (rtc_block + ESP8266_MQTT_CLIENT_SUSPEND_RTC_BLOCKS) > 192 ||
+        !system_rtc_mem_read(rtc_block, &record, sizeof(record)))
+    {
+        return false;
+    }
+    if(record.magic != ESP8266_MQTT_CLIENT_SUSPEND_MAGIC ||
+        record.checksum != s_esp8266_mqtt_hash((uint8_t*)&record, sizeof(record) - 4) ||
+        record.host_hash != s_client->dns_host_hash ||
+        record.pending_count > ESP8266_MQTT_CLIENT_SUSPEND_PENDING_MAX ||
+        record.connect_len > ESP8266_MQTT_CLIENT_SUSPEND_CONNECT_MAX)
+    {
+        return false;
+    }
+    if(record.connect_len > 1)
+    {
+        len_size = s_esp8266_mqtt_decode_varint(&record.connect_packet[1], record.connect_len - 1, &len_remaining);
+    }
+    if(record.connect_len != 0 && (len_size == 0 || (1 + len_size + len_remaining) != record.connect_len))
+    {
+        return false;
+    }
+
+    //CONNECT PACKET. OPTIONS ALREADY SET MUST MATCH THE KEPT ONE
+    if(s_client->connect_packet != NULL)
+    {
+        if(record.connect_len != 0 &&
+            (record.connect_len != s_client->connect_len ||
+                os_memcmp(record.connect_packet, s_client->connect_packet, record.connect_len) != 0))
+        {
+            ESP8266_MQTT_LOG_WARN("Resume record ignored. CONNECT options changed");
+            return false;
+        }
+    }
+    else if(record.connect_len != 0)
+    {
+        packet = (uint8_t*)os_malloc(record.connect_len);
+        if(packet == NULL)
+        {
+            return false;
+        }
+        s_esp8266_mqtt_stats_heap(record.connect_len);
+        os_memcpy(packet, record.connect_packet, record.connect_len);
+        s_client->connect_packet = packet;
+        s_client->connect_len = record.connect_len;
+        s_client->connect_len_remaining = len_remaining;
+        s_client->keepalive_timer = record.keepalive_timer;
+        s_client->protocol_version = record.protocol_version;
+        s_client->flag_clean_session = record.flag_clean_session;
+    }
+
+    //PACKET IDS
+    s_client->mqtt_message_id = record.message_id;
+    os_memcpy(s_client->resume_ids, record.pending_ids, sizeof(s_client->resume_ids));
+    s_client->resume_qos2 = record.pending_qos2;
+    s_client->resume_count = record.pending_count;
+
+    //BROKER ADDRESS (NOT NEEDED IF GIVEN BY IP)
+    address_known = (record.host_hash == 0);
+    if(record.host_hash != 0 && record.host_ip != 0 && s_client->transport->set_host_ip != NULL)
+    {
+        s_client->host_ip.addr = record.host_ip;
+        (*s_client->transport->set_host_ip)(s_client->transport_ctx, &s_client->host_ip);
+        address_known = true;
+    }
+
+    os_memset(&record, 0, sizeof(record));
+    system_rtc_mem_write(rtc_block, &record, sizeof(record));
+    ESP8266_MQTT_LOG_INFO("Resumed. id %u, %u ids pending", s_client->mqtt_message_id, s_client->resume_count);
+    return (s_client->connect_packet != NULL && address_known);
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetStatsPublish(char* topic, uint32_t interval_ms)
+{
+    //PUBLISH THE STATS (JSON, QOS 0) TO topic EVERY interval_ms WHILE CONNECTED
+    //topic MUST STAY VALID. NULL topic OR 0 interval_ms STOPS IT
+    //RETURN FALSE IF THE CLIENT BUFFER CANNOT HOLD THE STATS MESSAGE
+
+    os_timer_disarm(&s_client->stats_os_timer);
+    s_client->stats_topic = NULL;
+    if(topic == NULL || interval_ms == 0)
+    {
+        return true;
+    }
+    if(s_client->buffer_size < (ESP8266_MQTT_CLIENT_STATS_PAYLOAD_MAX + 2 + strlen(topic) + 2 + 5))
+    {
+        return false;
+    }
+    s_client->stats_topic = topic;
+    os_timer_arm(&s_client->stats_os_timer, interval_ms, 1);
+    return true;
 }
 
 void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetCallbackFunctions(void (tcp_conn_cb)(void),
@@ -168,564 +943,4063 @@ void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetCallbackFunctions(void (tcp_conn_c
 {
     //SET MODULE EVENTS CB FUNCTIONS
 
-    s_esp8266_mqtt_client_tcp_conn_cb_function = tcp_conn_cb;
-    s_esp8266_mqtt_client_dns_cb_function = user_dns_cb_fn;
-    s_esp8266_mqtt_client_data_send_cb = data_send_cb;
-    s_esp8266_mqtt_client_data_recv_cb = data_recv_cb;
+    s_client->tcp_conn_cb_function = tcp_conn_cb;
+    s_client->dns_cb_function = user_dns_cb_fn;
+    s_client->data_send_cb = data_send_cb;
+    s_client->data_recv_cb = data_recv_cb;
 
     //SET TCP LAYER CB FUNCTIONS
-    ESP8266_TCP_GENERIC_SetCallbackFunctions(s_esp8266_mqtt_tcp_conn_cb, 
-                                                NULL, 
-                                                s_esp8266_mqtt_client_send_cb, 
-                                                s_esp8266_mqtt_client_receive_cb, 
-                                                s_esp8266_mqtt_client_dns_found_cb);
+    (*s_client->transport->set_callback_functions)(s_client->transport_ctx,
+                                                    s_client,
+                                                    s_esp8266_mqtt_tcp_conn_cb,
+                                                    s_esp8266_mqtt_tcp_discon_cb,
+                                                    s_esp8266_mqtt_client_send_cb,
+                                                    s_esp8266_mqtt_client_receive_cb,
+                                                    s_esp8266_mqtt_client_dns_found_cb);
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Connect(void)
+{
+    //CONNECT IN PERSISTENT SESSION MODE WITHOUT USER INVOLVEMENT
+    //DNS (IF A HOST NAME WAS GIVEN) -> TCP -> CONNECT, RETRIED WITH BACKOFF
+    //UNTIL A CONNACK ACCEPTS OR PERMANENTLY REFUSES THE CONNECTION. THE USER
+    //DNS / TCP CONNECT CBS ARE NOT CALLED. CONNACK GOES TO THE RECEIVE CB
+    //RETURN FALSE IF NOT IN PERSISTENT SESSION MODE
+
+    if(!s_client->flag_persistent)
+    {
+        return false;
+    }
+
+    os_timer_disarm(&s_client->reconnect_os_timer);
+    s_client->session_active = true;
+    s_client->session_reconnecting = true;
+    s_client->reconnect_attempt = 0;
+    s_client->reconnect_pending = false;
+    if(s_client->dns_host_hash != 0)
+    {
+        s_client->reconnect_resolving = true;
+        ESP8266_MQTT_CLIENT_ResolveHostName();
+    }
+    else
+    {
+        s_esp8266_mqtt_stats_start(ESP8266_MQTT_STATS_STAGE_TCP_CONNECT);
+        (*s_client->transport->connect)(s_client->transport_ctx);
+    }
+    return true;
 }
 
 void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_ResolveHostName(void)
 {
     //RESOLVE TCP SERVER HOSTNAME
+    //A CACHED ADDRESS IS REPORTED THROUGH THE DNS CB WITHOUT ANY DNS TRAFFIC
 
-    ESP8266_TCP_GENERIC_ResolveHostName();
+    if(s_client->flag_dns_cache &&
+        s_client->dns_valid &&
+        s_client->transport->set_host_ip != NULL)
+    {
+        //EXPIRED ENTRY IS STILL USED. FRESH ADDRESS IS FETCHED ONCE CONNECTED
+        s_client->dns_refresh = (s_esp8266_mqtt_dns_cache_age() >= s_client->dns_ttl_s);
+        os_timer_disarm(&s_client->dns_os_timer);
+        os_timer_arm(&s_client->dns_os_timer, 0, 0);
+        return;
+    }
+
+    s_client->dns_from_cache = false;
+    s_client->dns_background = false;
+    s_esp8266_mqtt_stats_start(ESP8266_MQTT_STATS_STAGE_DNS);
+    (*s_client->transport->resolve_host_name)(s_client->transport_ctx);
 }
 
 void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_TcpConnect(void)
 {
     //CONNECT TO MQTT TCP SERVER
 
-    ESP8266_TCP_GENERIC_Connect();
+    s_esp8266_mqtt_stats_start(ESP8266_MQTT_STATS_STAGE_TCP_CONNECT);
+    (*s_client->transport->connect)(s_client->transport_ctx);
 }
 
 void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_TcpDisonnect(void)
 {
     //DISCONNECT FROM MQTT TCP SERVER
-    
-    ESP8266_TCP_GENERIC_Disonnect();
+    //USER INITIATED SO PERSISTENT SESSION (IF ANY) ENDS HERE
+    //ANY COALESCED PACKETS STILL WAITING ARE SENT FIRST
+
+    s_esp8266_mqtt_tx_flush();
+    s_client->session_active = false;
+    s_client->session_reconnecting = false;
+    s_client->reconnect_pending = false;
+    s_client->reconnect_resolving = false;
+    s_client->mqtt_connected = false;
+    s_esp8266_mqtt_keepalive_stop();
+    os_timer_disarm(&s_client->reconnect_os_timer);
+
+    (*s_client->transport->disconnect)(s_client->transport_ctx);
 }
 
 void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_Connect(void)
 {
     //SEND MQTT CONNECT PACKET
-    //CLEAN_SESSION = TRUE
     //QOS ENABLED (SINCE WE WANT CONNACK BEFORE SENDING PUBLISH)
+    //THE PACKET IS BUILT + VALIDATED WHEN THE OPTIONS ARE SET
+    //(s_esp8266_mqtt_connect_build). IT IS ONLY COPIED TO THE TX BUFFER HERE
 
-    s_current_packet_type = ESP8266_MQTT_CONTROL_PACKET_TYPE_CONNECT;
-
-    esp8266_mqtt_packet_t p;
-    uint16_t len_variable_header = 0;
-    uint16_t len_payload = 0;
-    uint8_t* buffer_variable_header;
-    uint8_t* buffer_payload;
+    uint8_t* dest;
 
-    //GENERATE PACKET
-    buffer_variable_header = (uint8_t*)os_zalloc(ESP8266_MQTT_VARIABLE_HEADER_MAX_SIZE);
-    buffer_payload = (uint8_t*)os_zalloc(s_buffer_size - ESP8266_MQTT_VARIABLE_HEADER_MAX_SIZE);
-
-    //FIXED HEADER
-    p.fixed_header_byte1 = (ESP8266_MQTT_CONTROL_PACKET_TYPE_CONNECT << 4) | 
-                            ESP8266_MQTT_CONTROL_PACKET_FLAG_CONNECT;
-    
-    //VARIABLE HEADER
-    s_esp8266_mqtt_insert_string(buffer_variable_header, "MQIsdp", 6);
-    buffer_variable_header[8] = ESP8266_MQTT_PROTOCOL_VERSION;
-    buffer_variable_header[9] = (s_flag_username << 7) |
-                                    (s_flag_password << 6) |
-                                    (s_flag_will << 5) |
-                                    (s_will_qos << 4) |
-                                    (s_flag_will << 2) |
-                                    (s_flag_clean_session);
-    buffer_variable_header[10] = (uint8_t)((s_keepalive_timer & 0xFF00) >> 8);
-    buffer_variable_header[11] = (uint8_t)((s_keepalive_timer & 0x00FF));
-    len_variable_header = 12;
+    s_client->current_packet_type = ESP8266_MQTT_CONTROL_PACKET_TYPE_CONNECT;
+    s_client->mqtt_connected = false;
+    s_client->session_present = false;
 
-    //PAYLOAD
-    if(!s_client_id)
+    if(s_client->connect_packet == NULL)
     {
-        if(s_esp8266_mqtt_client_debug)
-        {
-            os_printf("ESP8266 MQTT_CLIENT : Error ! Client id NULL\n");
-        }
+        ESP8266_MQTT_LOG_ERROR("Error ! No valid CONNECT options");
         return;
     }
-    len_payload += s_esp8266_mqtt_insert_string(&buffer_payload[0],
-                                                s_client_id, 
-                                                strlen(s_client_id));
-    if(s_flag_will)
+    dest = s_esp8266_mqtt_tx_reserve(s_client->connect_len_remaining);
+    if(dest == NULL)
     {
-        // WILL IS SET
-        if(!s_will_topic)
+        return;
+    }
+    os_memcpy(dest, s_client->connect_packet, s_client->connect_len);
+
+    //SEND PACKET
+    s_esp8266_mqtt_stats_start(ESP8266_MQTT_STATS_STAGE_CONNACK);
+    s_client->connect_sent_us = system_get_time();
+    s_esp8266_mqtt_send_packet(s_client->connect_len, false);
+    ESP8266_MQTT_LOG_DEBUG("CONNECT packet sent");
+    if(s_client->flag_persistent)
+    {
+        //NO CONNACK IN TIME IS HANDLED LIKE A MISSING PINGRESP (RECONNECT)
+        s_client->session_active = true;
+        os_timer_disarm(&s_client->pingresp_os_timer);
+        os_timer_arm(&s_client->pingresp_os_timer, ESP8266_MQTT_CLIENT_REPLY_TIMEOUT_MS, 0);
+    }
+}
+
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_connect_build(void)
+{
+    //VALIDATE THE CONNECT OPTIONS AND SERIALIZE THE WHOLE CONNECT PACKET
+    //INTO A HEAP BUFFER KEPT BY THE INSTANCE. ESP8266_MQTT_CLIENT_Send_Connect
+    //SENDS IT AS IS ON EVERY (RE)CONNECT
+    //RETURN FALSE IF THE OPTIONS ARE INVALID OR OUT OF MEMORY (NO PACKET KEPT)
+
+    uint32_t len_client_id;
+    uint32_t len_will_topic = 0;
+    uint32_t len_will_message = 0;
+    uint32_t len_username = 0;
+    uint32_t len_password = 0;
+    uint8_t len_properties = 0;
+    uint32_t len_remaining;
+    uint16_t len_packet;
+    uint16_t counter;
+    uint8_t* dest;
+
+    //DROP THE OLD PACKET (OPTIONS CHANGED)
+    if(s_client->connect_packet != NULL)
+    {
+        os_free(s_client->connect_packet);
+        s_esp8266_mqtt_stats_heap(-(int32_t)s_client->connect_len);
+        s_client->connect_packet = NULL;
+        s_client->connect_len = 0;
+    }
+
+    //VALIDATE OPTIONS
+    if(!s_client->client_id)
+    {
+        ESP8266_MQTT_LOG_ERROR("Error ! Client id NULL");
+        return false;
+    }
+    if(s_client->flag_will && !s_client->will_topic)
+    {
+        ESP8266_MQTT_LOG_ERROR("Error ! Will topic not provided");
+        return false;
+    }
+    if(s_client->flag_will && !s_client->will_message)
+    {
+        ESP8266_MQTT_LOG_ERROR("Error ! Will message not provided");
+        return false;
+    }
+    if(s_client->flag_will && s_client->will_qos > ESP8266_MQTT_QOS_2)
+    {
+        ESP8266_MQTT_LOG_ERROR("Error ! Will qos %u not supported", s_client->will_qos);
+        return false;
+    }
+    if(s_client->flag_username && !s_client->username)
+    {
+        ESP8266_MQTT_LOG_ERROR("Error ! username not provided");
+        return false;
+    }
+    if(s_client->flag_password && !s_client->password)
+    {
+        ESP8266_MQTT_LOG_ERROR("Error ! password not provided");
+        return false;
+    }
+
+    //CALCULATE EXACT PACKET SIZE
+    //VARIABLE HEADER : PROTOCOL NAME (2 + 6 "MQIsdp" OR 2 + 4 "MQTT") + VERSION (1)
+    //+ FLAGS (1) + KEEPALIVE (2) [+ PROPERTIES (MQTT 5)]
+    len_client_id = strlen(s_client->client_id);
+    len_remaining = ((s_client->protocol_version == ESP8266_MQTT_PROTOCOL_VERSION_3_1) ? 12 : 10) + 2 + len_client_id;
+    if(s_client->protocol_version == ESP8266_MQTT_PROTOCOL_VERSION_5)
+    {
+        //RECEIVE MAXIMUM (1 + 2) [+ SESSION EXPIRY INTERVAL (1 + 4)]
+        len_properties = 3 + (s_client->flag_clean_session ? 0 : 5);
+        len_remaining += 1 + len_properties;
+    }
+    if(s_client->flag_will)
+    {
+        len_will_topic = strlen(s_client->will_topic);
+        len_will_message = strlen(s_client->will_message);
+        len_remaining += 2 + len_will_topic + 2 + len_will_message;
+        if(s_client->protocol_version == ESP8266_MQTT_PROTOCOL_VERSION_5)
+        {
+            //EMPTY WILL PROPERTIES
+            len_remaining += 1;
+        }
+    }
+    if(s_client->flag_username)
+    {
+        len_username = strlen(s_client->username);
+        len_remaining += 2 + len_username;
+    }
+    if(s_client->flag_password)
+    {
+        len_password = strlen(s_client->password);
+        len_remaining += 2 + len_password;
+    }
+    if((1 + s_esp8266_mqtt_remaining_length_size(len_remaining) + len_remaining) > 0xFFFF)
+    {
+        ESP8266_MQTT_LOG_ERROR("Error ! CONNECT packet too big (%u)", len_remaining);
+        return false;
+    }
+    len_packet = 1 + s_esp8266_mqtt_remaining_length_size(len_remaining) + len_remaining;
+    dest = (uint8_t*)os_malloc(len_packet);
+    if(dest == NULL)
+    {
+        ESP8266_MQTT_LOG_ERROR("Error ! CONNECT packet malloc fail");
+        return false;
+    }
+    s_esp8266_mqtt_stats_heap(len_packet);
+
+    //FIXED HEADER
+    counter = s_esp8266_mqtt_insert_fixed_header(dest,
+                                                    (ESP8266_MQTT_CONTROL_PACKET_TYPE_CONNECT << 4) |
+                                                    ESP8266_MQTT_CONTROL_PACKET_FLAG_CONNECT,
+                                                    len_remaining);
+
+    //VARIABLE HEADER
+    if(s_client->protocol_version == ESP8266_MQTT_PROTOCOL_VERSION_3_1)
+    {
+        counter += s_esp8266_mqtt_insert_string(&dest[counter], "MQIsdp", 6);
+    }
+    else
+    {
+        counter += s_esp8266_mqtt_insert_string(&dest[counter], "MQTT", 4);
+    }
+    dest[counter++] = s_client->protocol_version;
+    dest[counter++] = (s_client->flag_username << 7) |
+                                (s_client->flag_password << 6) |
+                                ((s_client->flag_will && s_client->flag_retain) << 5) |
+                                ((s_client->flag_will ? s_client->will_qos : 0) << 3) |
+                                (s_client->flag_will << 2) |
+                                (s_client->flag_clean_session << 1);
+    dest[counter++] = (uint8_t)((s_client->keepalive_timer & 0xFF00) >> 8);
+    dest[counter++] = (uint8_t)((s_client->keepalive_timer & 0x00FF));
+    if(s_client->protocol_version == ESP8266_MQTT_PROTOCOL_VERSION_5)
+    {
+        //LIMIT INBOUND QOS 1 / 2 MESSAGES TO WHAT THE INBOUND QOS 2 TABLE HOLDS
+        dest[counter++] = len_properties;
+        dest[counter++] = ESP8266_MQTT_PROPERTY_RECEIVE_MAXIMUM;
+        dest[counter++] = 0;
+        dest[counter++] = ESP8266_MQTT_CLIENT_INBOUND_QOS2_MAX;
+        if(!s_client->flag_clean_session)
+        {
+            //KEEP SESSION STATE ON THE BROKER ACROSS RECONNECTS
+            dest[counter++] = ESP8266_MQTT_PROPERTY_SESSION_EXPIRY_INTERVAL;
+            dest[counter++] = (uint8_t)((ESP8266_MQTT_CLIENT_SESSION_EXPIRY_S >> 24) & 0xFF);
+            dest[counter++] = (uint8_t)((ESP8266_MQTT_CLIENT_SESSION_EXPIRY_S >> 16) & 0xFF);
+            dest[counter++] = (uint8_t)((ESP8266_MQTT_CLIENT_SESSION_EXPIRY_S >> 8) & 0xFF);
+            dest[counter++] = (uint8_t)(ESP8266_MQTT_CLIENT_SESSION_EXPIRY_S & 0xFF);
+        }
+    }
+
+    //PAYLOAD
+    counter += s_esp8266_mqtt_insert_string(&dest[counter], s_client->client_id, len_client_id);
+    if(s_client->flag_will)
+    {
+        if(s_client->protocol_version == ESP8266_MQTT_PROTOCOL_VERSION_5)
+        {
+            dest[counter++] = 0;
+        }
+        counter += s_esp8266_mqtt_insert_string(&dest[counter], s_client->will_topic, len_will_topic);
+        counter += s_esp8266_mqtt_insert_string(&dest[counter], s_client->will_message, len_will_message);
+    }
+    if(s_client->flag_username)
+    {
+        counter += s_esp8266_mqtt_insert_string(&dest[counter], s_client->username, len_username);
+    }
+    if(s_client->flag_password)
+    {
+        counter += s_esp8266_mqtt_insert_string(&dest[counter], s_client->password, len_password);
+    }
+
+    s_client->connect_packet = dest;
+    s_client->connect_len = counter;
+    s_client->connect_len_remaining = len_remaining;
+    ESP8266_MQTT_LOG_DEBUG("CONNECT packet created. %u bytes", counter);
+    return true;
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_Publish(char* topic,
+														char* message,
+                                                        esp8266_mqtt_qos_t qos_level)
+{
+    //SEND MQTT PUBLISH PACKET
+    //NO PER MESSAGE COMPLETION CB
+
+    ESP8266_MQTT_CLIENT_Send_PublishWithCb(topic, message, qos_level, NULL, NULL);
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_PublishWithCb(char* topic,
+                                                                char* message,
+                                                                esp8266_mqtt_qos_t qos_level,
+                                                                void (*complete_cb)(void*, bool),
+                                                                void* cb_arg)
+{
+    //SEND MQTT PUBLISH PACKET
+    //QOS 1 MESSAGES ARE TRACKED IN THE IN-FLIGHT TABLE UNTIL PUBACK, QOS 2
+    //MESSAGES UNTIL PUBCOMP. TOPIC AND MESSAGE MUST STAY VALID UNTIL complete_cb
+    //IS CALLED (THEY ARE USED FOR RETRANSMISSION)
+    //WITH THE OFFLINE QUEUE ON, A PUBLISH MADE WHILE NOT CONNECTED (OR WHILE
+    //OLDER STORED PUBLISHES ARE STILL WAITING) IS COPIED TO FLASH AND complete_cb
+    //IS CALLED RIGHT AWAY. IT IS SENT IN ORDER ONCE CONNECTED
+    //RETURN FALSE IF THE PUBLISH COULD NOT BE SENT (complete_cb NOT CALLED)
+
+    return s_esp8266_mqtt_publish_submit(topic, NULL, message, strlen(message), qos_level, false, complete_cb, cb_arg, NULL, NULL);
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_PublishBinary(char* topic,
+                                                                uint8_t* payload,
+                                                                uint16_t payload_len,
+                                                                esp8266_mqtt_qos_t qos_level,
+                                                                void (*complete_cb)(void*, bool),
+                                                                void* cb_arg)
+{
+    //SEND MQTT PUBLISH PACKET WITH A BINARY PAYLOAD OF payload_len BYTES
+    //(ZERO BYTES ALLOWED). THE PAYLOAD IS SENT AS IS, WITHOUT THE 2 BYTE
+    //LENGTH PREFIX OF THE STRING PUBLISH FUNCTIONS. OTHERWISE SAME AS
+    //ESP8266_MQTT_CLIENT_Send_PublishWithCb
+
+    return s_esp8266_mqtt_publish_submit(topic, NULL, (char*)payload, payload_len, qos_level, true, complete_cb, cb_arg, NULL, NULL);
+}
+
+uint8_t* ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_PublishBegin(char* topic, uint16_t* max_len)
+{
+    //START A QOS 0 BINARY PUBLISH WHOSE PAYLOAD IS WRITTEN IN PLACE
+    //THE HEADERS ARE WRITTEN TO THE CLIENT TX BUFFER. RETURN WHERE THE PAYLOAD
+    //GOES (UP TO *max_len BYTES, EG WITH ESP8266_MQTT_CBOR) OR NULL IF THE TX
+    //BUFFER HAS NO ROOM. ESP8266_MQTT_CLIENT_Send_PublishCommit (OR _Cancel)
+    //MUST FOLLOW BEFORE ANY OTHER CLIENT CALL OR RETURN TO THE SDK
+    //PAYLOAD IS NEVER COMPRESSED. topic MUST STAY VALID UNTIL COMMIT
+
+    uint16_t len_topic = strlen(topic);
+    uint16_t len_vheader = 2 + len_topic + ((s_client->protocol_version == ESP8266_MQTT_PROTOCOL_VERSION_5) ? 1 : 0);
+    uint16_t len_free;
+    uint8_t len_header;
+    uint8_t* dest;
+
+    s_client->inplace_active = false;
+    dest = s_esp8266_mqtt_tx_reserve(len_vheader);
+    if(dest == NULL)
+    {
+        return NULL;
+    }
+
+    //LARGEST PAYLOAD LEFT IN THE TX BUFFER. FIXED HEADER SIZED FOR IT
+    len_free = s_client->buffer_size - s_client->tx_len;
+    len_header = 1 + s_esp8266_mqtt_remaining_length_size(len_free);
+    if(len_free < (len_header + len_vheader))
+    {
+        return NULL;
+    }
+    s_esp8266_mqtt_insert_string(&dest[len_header], topic, len_topic);
+    if(s_client->protocol_version == ESP8266_MQTT_PROTOCOL_VERSION_5)
+    {
+        dest[len_header + 2 + len_topic] = 0;
+    }
+
+    s_client->inplace_active = true;
+    s_client->inplace_topic = topic;
+    s_client->inplace_tx_len = s_client->tx_len;
+    s_client->inplace_len_header = len_header;
+    s_client->inplace_len_vheader = len_vheader;
+    s_client->inplace_max = len_free - len_header - len_vheader;
+    *max_len = s_client->inplace_max;
+    return &dest[len_header + len_vheader];
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_PublishCommit(uint16_t payload_len)
+{
+    //SEND THE PUBLISH STARTED WITH ESP8266_MQTT_CLIENT_Send_PublishBegin WITH
+    //THE FIRST payload_len BYTES WRITTEN. STORED IN THE OFFLINE QUEUE INSTEAD
+    //LIKE ANY OTHER PUBLISH WHILE NOT CONNECTED
+    //RETURN FALSE IF NOTHING WAS STARTED, payload_len IS TOO BIG OR THE TX
+    //BUFFER WAS USED IN BETWEEN (PUBLISH DROPPED)
+
+    uint32_t len_remaining;
+    uint16_t len_topic;
+    uint8_t len_header;
+    uint8_t* dest;
+
+    if(!s_client->inplace_active)
+    {
+        return false;
+    }
+    s_client->inplace_active = false;
+    if(payload_len > s_client->inplace_max || s_client->tx_len != s_client->inplace_tx_len)
+    {
+        ESP8266_MQTT_LOG_WARN("PUBLISH Fail. In place payload %u dropped", payload_len);
+        return false;
+    }
+    dest = &s_client->tx_buffer[s_client->inplace_tx_len];
+    len_remaining = s_client->inplace_len_vheader + payload_len;
+    len_header = 1 + s_esp8266_mqtt_remaining_length_size(len_remaining);
+
+    //STORE AND FORWARD
+    if(s_client->flag_offline_queue && (!s_client->mqtt_connected || !ESP8266_MQTT_FLASH_QUEUE_IsEmpty()))
+    {
+        len_topic = s_client->inplace_len_vheader - 2 - ((s_client->protocol_version == ESP8266_MQTT_PROTOCOL_VERSION_5) ? 1 : 0);
+        if(!s_esp8266_mqtt_store_fits(s_client->inplace_topic, len_topic, payload_len, ESP8266_MQTT_QOS_0, true))
+        {
+            ESP8266_MQTT_LOG_WARN("PUBLISH Fail. %u bytes too big for the offline queue", payload_len);
+            return false;
+        }
+        if(!ESP8266_MQTT_FLASH_QUEUE_Append(s_client->inplace_topic,
+                                            len_topic,
+                                            (char*)&dest[s_client->inplace_len_header + s_client->inplace_len_vheader],
+                                            payload_len,
+                                            ESP8266_MQTT_QOS_0 | ESP8266_MQTT_FLASH_QUEUE_FLAG_RAW))
+        {
+            ESP8266_MQTT_LOG_WARN("PUBLISH Fail. Offline queue full");
+            return false;
+        }
+        ESP8266_MQTT_LOG_DEBUG("PUBLISH stored in offline queue");
+        s_esp8266_mqtt_store_drain();
+        return true;
+    }
+
+    //FIXED HEADER (MAY BE SHORTER THAN THE ONE RESERVED)
+    if(len_header < s_client->inplace_len_header)
+    {
+        os_memmove(&dest[len_header], &dest[s_client->inplace_len_header], len_remaining);
+    }
+    s_esp8266_mqtt_insert_fixed_header(dest,
+                                        (ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBLISH << 4) |
+                                        ESP8266_MQTT_CONTROL_PACKET_FLAG_PUBLISH |
+                                        (s_client->flag_retain ? 0x01 : 0x00),
+                                        len_remaining);
+    s_client->current_packet_type = ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBLISH;
+    ESP8266_MQTT_LOG_DEBUG("PUBLISH packet created. id 0 qos 0 message %u bytes", payload_len);
+    s_esp8266_mqtt_send_packet(len_header + len_remaining, true);
+
+    //QOS 0 : NO PUBACK WILL BE RECEIVED
+    //CALL THE TCP DATA RECEIVE CB FUNCTION RIGHT AWAY WITH NULL DATA
+    s_esp8266_mqtt_client_receive_cb(s_client, NULL, 0);
+    return true;
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_PublishCancel(void)
+{
+    //DROP THE PUBLISH STARTED WITH ESP8266_MQTT_CLIENT_Send_PublishBegin
+
+    s_client->inplace_active = false;
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_PublishQueued(char* topic,
+                                                                char* message,
+                                                                esp8266_mqtt_qos_t qos_level,
+                                                                esp8266_mqtt_priority_t priority,
+                                                                uint32_t deadline_ms,
+                                                                void (*complete_cb)(void*, bool),
+                                                                void* cb_arg)
+{
+    //PUT A PUBLISH IN THE SEND QUEUE. IT IS SENT AHEAD OF LOWER PRIORITY ONES
+    //AND DROPPED IF STILL QUEUED deadline_ms AFTER THIS CALL (0 = NO DEADLINE,
+    //CAPPED TO ESP8266_MQTT_CLIENT_SEND_QUEUE_DEADLINE_MAX_MS)
+    //TOPIC AND MESSAGE MUST STAY VALID UNTIL complete_cb IS CALLED. A DROPPED
+    //PUBLISH COMPLETES WITH FALSE. ONCE HANDED TO THE PUBLISH PATH IT BEHAVES
+    //LIKE ESP8266_MQTT_CLIENT_Send_PublishWithCb
+    //QUEUE FULL : THE OLDEST PUBLISH OF THE LOWEST PRIORITY BELOW priority IS
+    //DROPPED TO MAKE ROOM
+    //RETURN FALSE IF THE PUBLISH WAS NOT QUEUED (complete_cb NOT CALLED)
+
+    esp8266_mqtt_send_queue_entry_t* entry = NULL;
+    esp8266_mqtt_send_queue_entry_t* victim = NULL;
+    void (*dropped_cb)(void*, bool) = NULL;
+    void* dropped_arg = NULL;
+    uint32_t topic_hash;
+    uint8_t i;
+
+    if(qos_level > ESP8266_MQTT_QOS_2 || priority >= ESP8266_MQTT_PRIORITY_COUNT)
+    {
+        ESP8266_MQTT_LOG_WARN("PUBLISH queue Fail. qos %u priority %u not supported", qos_level, priority);
+        return false;
+    }
+    topic_hash = s_esp8266_mqtt_hash((const uint8_t*)topic, os_strlen(topic));
+    s_esp8266_mqtt_send_queue_expire();
+
+    //CONFLATION : AN UNSENT PUBLISH TO THE SAME TOPIC IS REPLACED IN PLACE
+    //(KEEPS ITS QUEUE POSITION. PRIORITY IS NEVER LOWERED)
+    if(s_client->flag_conflate)
+    {
+        entry = s_esp8266_mqtt_send_queue_find(topic, topic_hash);
+    }
+    if(entry != NULL)
+    {
+        ESP8266_MQTT_LOG_DEBUG("PUBLISH queue conflated. priority %u", entry->priority);
+        s_client->stats.queue_conflated++;
+        dropped_cb = entry->complete_cb;
+        dropped_arg = entry->cb_arg;
+        if(entry->priority > priority)
+        {
+            priority = entry->priority;
+        }
+    }
+    else
+    {
+        //FREE A SLOT (EXPIRED ENTRIES ARE GONE ALREADY, THEN A LOWER PRIORITY ONE)
+        for(i = 0; i < ESP8266_MQTT_CLIENT_SEND_QUEUE_MAX; i++)
+        {
+            if(!s_client->send_queue[i].used)
+            {
+                entry = &s_client->send_queue[i];
+                break;
+            }
+            if(s_client->send_queue[i].priority < priority &&
+                (victim == NULL ||
+                    s_client->send_queue[i].priority < victim->priority ||
+                    (s_client->send_queue[i].priority == victim->priority &&
+                        (int32_t)(s_client->send_queue[i].seq - victim->seq) < 0)))
+            {
+                victim = &s_client->send_queue[i];
+            }
+        }
+        if(entry == NULL)
+        {
+            if(victim == NULL)
+            {
+                ESP8266_MQTT_LOG_WARN("PUBLISH queue Fail. Queue full");
+                s_client->stats.queue_dropped++;
+                return false;
+            }
+            //VICTIM IS COMPLETED ONCE THE SLOT IS TAKEN (ITS CB MAY QUEUE AGAIN)
+            ESP8266_MQTT_LOG_DEBUG("PUBLISH queue full. Dropped priority %u", victim->priority);
+            s_client->stats.queue_dropped++;
+            dropped_cb = victim->complete_cb;
+            dropped_arg = victim->cb_arg;
+            s_esp8266_mqtt_send_queue_remove(victim, true);
+            entry = victim;
+        }
+
+        entry->used = true;
+        entry->seq = s_client->send_queue_seq++;
+        entry->topic_hash = topic_hash;
+        s_esp8266_mqtt_send_queue_link(entry);
+        s_client->send_queue_count++;
+        s_client->stats.queue_depth = s_client->send_queue_count;
+        if(s_client->stats.queue_depth > s_client->stats.queue_peak)
+        {
+            s_client->stats.queue_peak = s_client->stats.queue_depth;
+        }
+    }
+
+    entry->qos = qos_level;
+    entry->priority = priority;
+    entry->topic = topic;
+    entry->message = message;
+    entry->message_len = strlen(message);
+    entry->complete_cb = complete_cb;
+    entry->cb_arg = cb_arg;
+    entry->queued_time_us = system_get_time();
+    entry->deadline_ms = (deadline_ms > ESP8266_MQTT_CLIENT_SEND_QUEUE_DEADLINE_MAX_MS) ?
+                            ESP8266_MQTT_CLIENT_SEND_QUEUE_DEADLINE_MAX_MS : deadline_ms;
+
+    if(dropped_cb != NULL)
+    {
+        (*dropped_cb)(dropped_arg, false);
+    }
+    s_esp8266_mqtt_send_queue_dispatch();
+    return true;
+}
+
+esp8266_mqtt_topic_handle_t* ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_RegisterTopic(const char* topic)
+{
+    //REGISTER A TOPIC THAT IS PUBLISHED TO REPEATEDLY
+    //THE TOPIC IS COPIED AND ITS LENGTH PREFIXED ENCODING PRECOMPUTED, ALL IN
+    //ONE ALLOCATION. RETURN NULL IF OUT OF MEMORY
+
+    esp8266_mqtt_topic_handle_t* topic_handle;
+    uint16_t len_topic;
+
+    if(topic == NULL)
+    {
+        return NULL;
+    }
+    len_topic = strlen(topic);
+    topic_handle = (esp8266_mqtt_topic_handle_t*)os_zalloc(sizeof(esp8266_mqtt_topic_handle_t) + 2 + len_topic + 1);
+    if(topic_handle == NULL)
+    {
+        return NULL;
+    }
+    s_esp8266_mqtt_stats_heap(sizeof(esp8266_mqtt_topic_handle_t) + 2 + len_topic + 1);
+    topic_handle->encoded = (uint8_t*)(topic_handle + 1);
+    topic_handle->topic = (char*)&topic_handle->encoded[2];
+    topic_handle->topic_len = len_topic;
+    s_esp8266_mqtt_insert_string(topic_handle->encoded, topic, len_topic);
+    return topic_handle;
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_UnregisterTopic(esp8266_mqtt_topic_handle_t* topic_handle)
+{
+    //FREE THE TOPIC HANDLE
+    //MUST NOT BE USED BY A QOS 1 / 2 MESSAGE STILL IN FLIGHT
+
+    if(topic_handle != NULL)
+    {
+        if(topic_handle->alias != 0)
+        {
+            s_client->topic_alias_handles[topic_handle->alias - 1] = NULL;
+        }
+        s_esp8266_mqtt_stats_heap(-(int32_t)(sizeof(esp8266_mqtt_topic_handle_t) + 2 + topic_handle->topic_len + 1));
+        os_free(topic_handle);
+    }
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_PublishHandle(esp8266_mqtt_topic_handle_t* topic_handle,
+                                                                char* message,
+                                                                esp8266_mqtt_qos_t qos_level,
+                                                                void (*complete_cb)(void*, bool),
+                                                                void* cb_arg)
+{
+    //SEND MQTT PUBLISH PACKET TO A REGISTERED TOPIC
+    //SAME AS ESP8266_MQTT_CLIENT_Send_PublishWithCb BUT THE TOPIC IS COPIED
+    //FROM THE PRECOMPUTED ENCODING IN THE HANDLE
+
+    if(topic_handle == NULL)
+    {
+        return false;
+    }
+    return s_esp8266_mqtt_publish_submit(topic_handle->topic,
+                                            topic_handle,
+                                            message,
+                                            strlen(message),
+                                            qos_level,
+                                            false,
+                                            complete_cb,
+                                            cb_arg,
+                                            NULL,
+                                            NULL);
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_PublishRef(char* topic,
+                                                            uint8_t* payload,
+                                                            uint16_t payload_len,
+                                                            esp8266_mqtt_qos_t qos_level,
+                                                            void (*release_cb)(void*),
+                                                            void* release_arg)
+{
+    //SEND MQTT PUBLISH PACKET WITHOUT COPYING THE PAYLOAD
+    //THE PAYLOAD IS QUEUED AS A TX SEGMENT POINTING AT THE CALLER BUFFER.
+    //release_cb IS CALLED ONCE THE CLIENT NO LONGER USES IT : QOS 0 WHEN THE
+    //TCP LAYER HAS SENT IT, QOS 1 / 2 WHEN THE MESSAGE IS COMPLETE (ACKED OR
+    //GIVEN UP), STORED IN THE OFFLINE QUEUE RIGHT AWAY (COPIED TO FLASH)
+    //PAYLOAD IS NEVER COMPRESSED. TOPIC MUST STAY VALID LIKE THE PAYLOAD
+    //RETURN FALSE IF THE PUBLISH COULD NOT BE SENT (release_cb NOT CALLED)
+
+    if(release_cb == NULL)
+    {
+        return false;
+    }
+    return s_esp8266_mqtt_publish_submit(topic, NULL, (char*)payload, payload_len, qos_level, false, NULL, NULL, release_cb, release_arg);
+}
+
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_publish_submit(char* topic,
+                                                            esp8266_mqtt_topic_handle_t* topic_handle,
+                                                            char* message,
+                                                            uint16_t len_message,
+                                                            esp8266_mqtt_qos_t qos_level,
+                                                            bool raw,
+                                                            void (*complete_cb)(void*, bool),
+                                                            void* cb_arg,
+                                                            void (*release_cb)(void*),
+                                                            void* release_arg)
+{
+    //CHECK THE PUBLISH REQUEST AND EITHER SEND IT OR STORE IT IN THE OFFLINE
+    //QUEUE
+    //release_cb != NULL : ZERO COPY PAYLOAD
+    //STORED : complete_cb(true) RIGHT AWAY, ALSO FOR QOS 1 / 2. THE QUEUE THEN
+    //OWNS THE MESSAGE AND SENDS IT UNTIL ACKNOWLEDGED (NO FURTHER CB). A
+    //MESSAGE THAT COULD NOT BE SENT FROM THE QUEUE IS REFUSED, NOT STORED
+
+    uint16_t len_topic = (topic_handle != NULL) ? topic_handle->topic_len : strlen(topic);
+
+    //ONLY QOS = 0, 1 or 2 SUPPORTED
+    if(qos_level > ESP8266_MQTT_QOS_2)
+    {
+        ESP8266_MQTT_LOG_WARN("PUBLISH Fail. Only Qos 0, 1 or 2 supported");
+        return false;
+    }
+
+    //STORE AND FORWARD
+    if(s_client->flag_offline_queue && (!s_client->mqtt_connected || !ESP8266_MQTT_FLASH_QUEUE_IsEmpty()))
+    {
+        if(!s_esp8266_mqtt_store_fits(topic, len_topic, len_message, qos_level, raw))
+        {
+            ESP8266_MQTT_LOG_WARN("PUBLISH Fail. %u bytes too big for the offline queue", len_message);
+            return false;
+        }
+        if(!ESP8266_MQTT_FLASH_QUEUE_Append(topic,
+                                            len_topic,
+                                            message,
+                                            len_message,
+                                            qos_level | (raw ? ESP8266_MQTT_FLASH_QUEUE_FLAG_RAW : 0)))
+        {
+            ESP8266_MQTT_LOG_WARN("PUBLISH Fail. Offline queue full");
+            return false;
+        }
+        ESP8266_MQTT_LOG_DEBUG("PUBLISH stored in offline queue");
+        if(complete_cb != NULL)
+        {
+            (*complete_cb)(cb_arg, true);
+        }
+        if(release_cb != NULL)
+        {
+            (*release_cb)(release_arg);
+        }
+        s_esp8266_mqtt_store_drain();
+        return true;
+    }
+
+    return s_esp8266_mqtt_publish(topic,
+                                    topic_handle,
+                                    message,
+                                    len_message,
+                                    qos_level,
+                                    raw,
+                                    complete_cb,
+                                    cb_arg,
+                                    release_cb,
+                                    release_arg,
+                                    0);
+}
+
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_publish(char* topic,
+                                                        esp8266_mqtt_topic_handle_t* topic_handle,
+                                                        char* message,
+                                                        uint16_t len_message,
+                                                        esp8266_mqtt_qos_t qos_level,
+                                                        bool raw,
+                                                        void (*complete_cb)(void*, bool),
+                                                        void* cb_arg,
+                                                        void (*release_cb)(void*),
+                                                        void* release_arg,
+                                                        uint32_t store_addr)
+{
+    //SEND MQTT PUBLISH PACKET AND TRACK IT IN THE IN-FLIGHT TABLE IF QOS > 0
+    //store_addr IS THE OFFLINE QUEUE RECORD THE MESSAGE CAME FROM (0 IF NONE)
+    //ZERO COPY (release_cb != NULL) : ONLY THE HEADERS ARE SERIALIZED. THE
+    //PAYLOAD FOLLOWS AS ITS OWN TX SEGMENT
+
+    esp8266_mqtt_inflight_entry_t* entry = NULL;
+    uint16_t packet_id = 0;
+    uint16_t len;
+    bool zero_copy = (release_cb != NULL);
+
+    s_client->current_packet_type = ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBLISH;
+
+    //ZERO COPY NEEDS 2 FREE TX SEGMENTS (HEADERS + PAYLOAD)
+    if(zero_copy && (s_client->tx_flush_pending || (s_client->tx_segment_count + 2) > ESP8266_MQTT_CLIENT_TX_SEGMENTS_MAX))
+    {
+        ESP8266_MQTT_LOG_WARN("PUBLISH Fail. TX segment queue full");
+        return false;
+    }
+
+    //RESERVE IN-FLIGHT SLOT + PACKET ID
+    if(qos_level != ESP8266_MQTT_QOS_0)
+    {
+        entry = s_esp8266_mqtt_inflight_alloc();
+        if(entry == NULL)
+        {
+            ESP8266_MQTT_LOG_WARN("PUBLISH Fail. In-flight window full");
+            return false;
+        }
+        packet_id = entry->packet_id;
+    }
+
+    len = s_esp8266_mqtt_encode_publish(topic, topic_handle, message, len_message, qos_level, packet_id, false, zero_copy, raw);
+    if(len == 0)
+    {
+        if(entry != NULL)
+        {
+            entry->state = ESP8266_MQTT_INFLIGHT_STATE_FREE;
+            s_client->inflight_count--;
+        }
+        return false;
+    }
+    ESP8266_MQTT_LOG_DEBUG("PUBLISH packet created. id %u qos %u message %u bytes", packet_id, qos_level, len_message);
+
+    //TRACK QOS 1 / 2 MESSAGE
+    if(entry != NULL)
+    {
+        entry->state = (qos_level == ESP8266_MQTT_QOS_1) ? ESP8266_MQTT_INFLIGHT_STATE_WAIT_PUBACK :
+                                                            ESP8266_MQTT_INFLIGHT_STATE_WAIT_PUBREC;
+        entry->qos = qos_level;
+        entry->raw = raw;
+        entry->retries = 0;
+        entry->topic = topic;
+        entry->topic_handle = topic_handle;
+        entry->message = message;
+        entry->message_len = len_message;
+        entry->complete_cb = complete_cb;
+        entry->cb_arg = cb_arg;
+        entry->release_cb = release_cb;
+        entry->release_arg = release_arg;
+        entry->store_addr = store_addr;
+        entry->sent_time_us = system_get_time();
+        os_timer_disarm(&s_client->inflight_os_timer);
+        os_timer_arm(&s_client->inflight_os_timer, ESP8266_MQTT_CLIENT_INFLIGHT_CHECK_MS, 1);
+    }
+
+    //SEND PACKET
+    //QOS 1 / 2 ZERO COPY PAYLOAD IS RELEASED WHEN THE MESSAGE COMPLETES
+    s_esp8266_mqtt_send_packet(len, !zero_copy);
+    if(zero_copy)
+    {
+        s_esp8266_mqtt_tx_queue_segment((uint8_t*)message,
+                                        len_message,
+                                        (entry == NULL) ? release_cb : NULL,
+                                        release_arg);
+        s_esp8266_mqtt_tx_pump();
+    }
+    ESP8266_MQTT_LOG_DEBUG("PUBLISH packet sent");
+
+    //QOS = 0
+    //NO PUBACK WILL BE RECEIVED
+    //CALL THE TCP DATA RECEIVE CB FUNCTION RIGHT AWAY WITH NULL DATA
+    //SET RETRY COUNT TO ESP8266_MQTT_RETRY_COUNT SO NO MORE TRIES ARE ATTEMPTED
+
+    if(qos_level == ESP8266_MQTT_QOS_0)
+    {
+        ESP8266_MQTT_LOG_DEBUG("PUBLISH done as Qos = 0. No PUBACK expected");
+        if(complete_cb != NULL)
+        {
+            (*complete_cb)(cb_arg, true);
+        }
+        if(store_addr != 0)
+        {
+            ESP8266_MQTT_FLASH_QUEUE_Consume(store_addr);
+        }
+        s_esp8266_mqtt_client_receive_cb(s_client, NULL, 0);
+    }
+    return true;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_store_drain(void)
+{
+    //SEND STORED (OFFLINE QUEUE) PUBLISHES IN ORDER WHILE CONNECTED AND THE
+    //IN-FLIGHT WINDOW HAS ROOM
+    //IF THE TX BUFFER IS BUSY THE DRAIN STOPS AND GOES ON FROM THE TCP SENT CB
+
+    esp8266_mqtt_flash_queue_record_t record;
+    bool raw;
+
+    if(!s_client->flag_offline_queue || s_client->store_draining)
+    {
+        return;
+    }
+    s_client->store_draining = true;
+    s_client->store_drain_pending = false;
+    while(s_client->mqtt_connected && s_client->inflight_count < s_esp8266_mqtt_inflight_limit())
+    {
+        if(!ESP8266_MQTT_FLASH_QUEUE_Read(&record, s_client->store_buffer, s_client->buffer_size))
+        {
+            break;
+        }
+        if(s_esp8266_mqtt_inflight_find_store(record.addr) != NULL)
+        {
+            //ALREADY IN FLIGHT (RESENT WITH ITS OWN PACKET ID)
+            continue;
+        }
+        raw = ((record.qos & ESP8266_MQTT_FLASH_QUEUE_FLAG_RAW) != 0);
+        record.qos &= ~ESP8266_MQTT_FLASH_QUEUE_FLAG_RAW;
+        if(s_esp8266_mqtt_publish(record.topic,
+                                    NULL,
+                                    record.message,
+                                    record.message_len,
+                                    record.qos,
+                                    raw,
+                                    NULL,
+                                    NULL,
+                                    NULL,
+                                    NULL,
+                                    record.addr))
+        {
+            continue;
+        }
+        if(!s_esp8266_mqtt_publish_fits(record.topic, NULL, record.message_len, record.qos, false, raw))
+        {
+            //CAN NEVER BE SENT (TOO BIG). DROP IT
+            ESP8266_MQTT_LOG_WARN("PUBLISH stored %u bytes dropped. Bigger than the buffer", record.message_len);
+            ESP8266_MQTT_FLASH_QUEUE_Consume(record.addr);
+            continue;
+        }
+
+        //TX BUFFER BUSY. READ THE RECORD AGAIN ONCE IT HAS ROOM
+        ESP8266_MQTT_FLASH_QUEUE_Rewind();
+        s_client->store_drain_pending = true;
+        break;
+    }
+    s_client->store_draining = false;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_store_dropped_cb(uint32_t start_addr, uint32_t end_addr)
+{
+    //OFFLINE QUEUE FULL. ITS OLDEST SECTOR IS ABOUT TO BE ERASED AND REUSED
+    //IN-FLIGHT MESSAGES SENT FROM RECORDS IN IT CAN NOT BE READ BACK FOR
+    //RETRANSMISSION (OR CONSUMED) ANYMORE. THEY FAIL, FORGETTING THE ADDRESS
+    //SO A NEW RECORD AT THE SAME PLACE IS NEVER TAKEN FOR THEM
+
+    esp8266_mqtt_client_t* previous = s_esp8266_mqtt_instance_enter(s_offline_queue_owner);
+    uint8_t i;
+
+    for(i = 0; i < ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX; i++)
+    {
+        if(s_client->inflight[i].state != ESP8266_MQTT_INFLIGHT_STATE_FREE &&
+            s_client->inflight[i].store_addr >= start_addr &&
+            s_client->inflight[i].store_addr < end_addr)
+        {
+            s_client->inflight[i].store_addr = 0;
+            s_esp8266_mqtt_inflight_complete(&s_client->inflight[i], false);
+        }
+    }
+    s_esp8266_mqtt_instance_leave(previous);
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_send_queue_link(esp8266_mqtt_send_queue_entry_t* entry)
+{
+    //ADD THE SEND QUEUE ENTRY TO THE TOPIC HASH INDEX
+    //BUCKET HEADS / NEXT LINKS HOLD SLOT + 1 (0 = END)
+
+    uint8_t* bucket = &s_client->send_queue_buckets[entry->topic_hash & (ESP8266_MQTT_CLIENT_SEND_QUEUE_BUCKETS - 1)];
+
+    entry->hash_next = *bucket;
+    *bucket = (entry - s_client->send_queue) + 1;
+}
+
+static esp8266_mqtt_send_queue_entry_t* ICACHE_FLASH_ATTR s_esp8266_mqtt_send_queue_find(char* topic, uint32_t topic_hash)
+{
+    //RETURN THE SEND QUEUE ENTRY FOR topic (NULL IF NONE)
+
+    esp8266_mqtt_send_queue_entry_t* entry;
+    uint8_t next = s_client->send_queue_buckets[topic_hash & (ESP8266_MQTT_CLIENT_SEND_QUEUE_BUCKETS - 1)];
+
+    while(next != 0)
+    {
+        entry = &s_client->send_queue[next - 1];
+        if(entry->topic_hash == topic_hash && os_strcmp(entry->topic, topic) == 0)
+        {
+            return entry;
+        }
+        next = entry->hash_next;
+    }
+    return NULL;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_send_queue_remove(esp8266_mqtt_send_queue_entry_t* entry, bool sent)
+{
+    //FREE THE SEND QUEUE SLOT (AND ITS TOPIC HASH INDEX LINK)
+    //NOT SENT : COMPLETE THE PUBLISH WITH FALSE
+
+    void (*complete_cb)(void*, bool) = entry->complete_cb;
+    uint8_t* link = &s_client->send_queue_buckets[entry->topic_hash & (ESP8266_MQTT_CLIENT_SEND_QUEUE_BUCKETS - 1)];
+    uint8_t slot = (entry - s_client->send_queue) + 1;
+
+    while(*link != 0)
+    {
+        if(*link == slot)
+        {
+            *link = entry->hash_next;
+            break;
+        }
+        link = &s_client->send_queue[*link - 1].hash_next;
+    }
+    entry->used = false;
+    entry->complete_cb = NULL;
+    s_client->send_queue_count--;
+    s_client->stats.queue_depth = s_client->send_queue_count;
+    if(!sent && complete_cb != NULL)
+    {
+        (*complete_cb)(entry->cb_arg, false);
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_send_queue_expire(void)
+{
+    //DROP SEND QUEUE ENTRIES PAST THEIR DEADLINE
+
+    uint32_t now = system_get_time();
+    uint8_t i;
+
+    for(i = 0; i < ESP8266_MQTT_CLIENT_SEND_QUEUE_MAX && s_client->send_queue_count > 0; i++)
+    {
+        if(s_client->send_queue[i].used &&
+            s_client->send_queue[i].deadline_ms != 0 &&
+            (now - s_client->send_queue[i].queued_time_us) >= (s_client->send_queue[i].deadline_ms * 1000))
+        {
+            ESP8266_MQTT_LOG_DEBUG("PUBLISH queue expired. priority %u", s_client->send_queue[i].priority);
+            s_client->stats.queue_expired++;
+            s_esp8266_mqtt_send_queue_remove(&s_client->send_queue[i], false);
+        }
+    }
+}
+
+static esp8266_mqtt_send_queue_entry_t* ICACHE_FLASH_ATTR s_esp8266_mqtt_send_queue_next(void)
+{
+    //RETURN THE SEND QUEUE ENTRY TO SEND NOW (NULL IF NONE CAN GO)
+    //HIGHEST PRIORITY, OLDEST FIRST. QOS 1 / 2 NEEDS IN-FLIGHT WINDOW ROOM
+
+    esp8266_mqtt_send_queue_entry_t* next = NULL;
+    esp8266_mqtt_send_queue_entry_t* entry;
+    bool window_full = (s_client->inflight_count >= s_esp8266_mqtt_inflight_limit());
+    uint8_t i;
+
+    for(i = 0; i < ESP8266_MQTT_CLIENT_SEND_QUEUE_MAX; i++)
+    {
+        entry = &s_client->send_queue[i];
+        if(!entry->used || (entry->qos != ESP8266_MQTT_QOS_0 && window_full))
+        {
+            continue;
+        }
+        if(next == NULL ||
+            entry->priority > next->priority ||
+            (entry->priority == next->priority && (int32_t)(entry->seq - next->seq) < 0))
+        {
+            next = entry;
+        }
+    }
+    return next;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_send_queue_dispatch(void)
+{
+    //HAND QUEUED PUBLISHES TO THE PUBLISH PATH WHILE CONNECTED AND NO TX
+    //SEGMENT IS WAITING BEHIND THE ONE BEING SENT (SO A LATER URGENT PUBLISH
+    //NEVER WAITS BEHIND A BACKLOG). CALLED AGAIN FROM THE TCP SENT CB, WHEN
+    //A QOS 1 / 2 MESSAGE COMPLETES AND ON CONNACK
+
+    esp8266_mqtt_send_queue_entry_t* entry;
+    esp8266_mqtt_send_queue_entry_t queued;
+
+    if(s_client->send_queue_count == 0 || s_client->send_queue_dispatching)
+    {
+        return;
+    }
+    s_client->send_queue_dispatching = true;
+    s_esp8266_mqtt_send_queue_expire();
+    while(s_client->mqtt_connected &&
+            !s_client->stream_sending &&
+            (s_client->tx_segment_count - (s_client->tx_sending ? 1 : 0)) == 0)
+    {
+        entry = s_esp8266_mqtt_send_queue_next();
+        if(entry == NULL)
+        {
+            break;
+        }
+        queued = *entry;
+        s_esp8266_mqtt_send_queue_remove(entry, true);
+        if(s_esp8266_mqtt_publish_submit(queued.topic,
+                                            NULL,
+                                            queued.message,
+                                            queued.message_len,
+                                            queued.qos,
+                                            false,
+                                            queued.complete_cb,
+                                            queued.cb_arg,
+                                            NULL,
+                                            NULL))
+        {
+            s_client->stats.queue_sent++;
+        }
+        else
+        {
+            s_client->stats.queue_dropped++;
+            if(queued.complete_cb != NULL)
+            {
+                (*queued.complete_cb)(queued.cb_arg, false);
+            }
+        }
+    }
+    s_client->send_queue_dispatching = false;
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_PublishStream(char* topic,
+                                                                uint32_t payload_len,
+                                                                esp8266_mqtt_qos_t qos_level,
+                                                                uint16_t (*read_cb)(void* arg,
+                                                                                    uint32_t offset,
+                                                                                    uint8_t* dest,
+                                                                                    uint16_t max_len),
+                                                                void (*complete_cb)(void*, bool),
+                                                                void* cb_arg)
+{
+    //SEND MQTT PUBLISH PACKET WITH A PAYLOAD OF ANY SIZE (UP TO THE MQTT
+    //REMAINING LENGTH LIMIT) PULLED FROM read_cb
+    //read_cb(cb_arg, offset, dest, max_len) COPIES UP TO max_len PAYLOAD BYTES
+    //STARTING AT offset INTO dest AND RETURNS THE NUMBER COPIED (0 = ERROR,
+    //THE TCP CONNECTION IS CLOSED AS THE PACKET CANNOT BE COMPLETED). IT CAN
+    //BE ASKED FOR THE SAME OFFSET AGAIN (QOS 1 / 2 RETRANSMISSION)
+    //complete_cb IS CALLED WHEN THE PAYLOAD IS SENT (QOS 0) OR ACKNOWLEDGED
+    //(QOS 1 / 2). PAYLOAD IS SENT AS IS. NOT STORED IN THE OFFLINE QUEUE
+    //RETURN FALSE IF IT CANNOT BE STARTED (NOT CONNECTED, STREAM ACTIVE)
+
+    esp8266_mqtt_inflight_entry_t* entry = NULL;
+    uint32_t len_remaining;
+
+    if(qos_level > ESP8266_MQTT_QOS_2 || read_cb == NULL || !s_client->mqtt_connected || s_client->stream_active)
+    {
+        return false;
+    }
+    len_remaining = 2 + strlen(topic) + ((qos_level != ESP8266_MQTT_QOS_0) ? 2 : 0) +
+                        ((s_client->protocol_version == ESP8266_MQTT_PROTOCOL_VERSION_5) ? 1 : 0);
+    if(payload_len > (ESP8266_MQTT_CLIENT_REMAINING_LENGTH_MAX - len_remaining))
+    {
+        return false;
+    }
+
+    s_client->stream_chunk = (uint8_t*)os_malloc(s_client->buffer_size);
+    if(s_client->stream_chunk == NULL)
+    {
+        return false;
+    }
+    s_esp8266_mqtt_stats_heap(s_client->buffer_size);
+    if(qos_level != ESP8266_MQTT_QOS_0)
+    {
+        entry = s_esp8266_mqtt_inflight_alloc();
+        if(entry == NULL)
+        {
+            os_free(s_client->stream_chunk);
+            s_client->stream_chunk = NULL;
+            s_esp8266_mqtt_stats_heap(-(int32_t)s_client->buffer_size);
+            return false;
+        }
+    }
+
+    s_client->stream_active = true;
+    s_client->stream_topic = topic;
+    s_client->stream_len = payload_len;
+    s_client->stream_qos = qos_level;
+    s_client->stream_packet_id = (entry != NULL) ? entry->packet_id : 0;
+    s_client->stream_read_cb = read_cb;
+    s_client->stream_complete_cb = complete_cb;
+    s_client->stream_cb_arg = cb_arg;
+
+    if(!s_esp8266_mqtt_stream_start(false))
+    {
+        if(entry != NULL)
+        {
+            entry->state = ESP8266_MQTT_INFLIGHT_STATE_FREE;
+            s_client->inflight_count--;
+        }
+        s_client->stream_complete_cb = NULL;
+        s_esp8266_mqtt_stream_end(false);
+        return false;
+    }
+
+    //TRACK QOS 1 / 2 MESSAGE
+    //COMPLETION CB IS CALLED THROUGH THE IN-FLIGHT ENTRY
+    if(entry != NULL)
+    {
+        entry->state = (qos_level == ESP8266_MQTT_QOS_1) ? ESP8266_MQTT_INFLIGHT_STATE_WAIT_PUBACK :
+                                                            ESP8266_MQTT_INFLIGHT_STATE_WAIT_PUBREC;
+        entry->qos = qos_level;
+        entry->retries = 0;
+        entry->stream = true;
+        entry->topic = topic;
+        entry->topic_handle = NULL;
+        entry->message = NULL;
+        entry->message_len = 0;
+        entry->complete_cb = complete_cb;
+        entry->cb_arg = cb_arg;
+        entry->release_cb = NULL;
+        entry->store_addr = 0;
+        entry->sent_time_us = system_get_time();
+        s_client->stream_complete_cb = NULL;
+        os_timer_disarm(&s_client->inflight_os_timer);
+        os_timer_arm(&s_client->inflight_os_timer, ESP8266_MQTT_CLIENT_INFLIGHT_CHECK_MS, 1);
+    }
+    s_esp8266_mqtt_stream_next();
+    return true;
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_IsStreaming(void)
+{
+    //RETURN TRUE WHILE A STREAMING PUBLISH IS ACTIVE (NEXT ONE CANNOT START)
+
+    return s_client->stream_active;
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Flush(void)
+{
+    //SEND ALL COALESCED PACKETS WAITING IN THE TX BUFFER NOW
+
+    s_esp8266_mqtt_tx_flush();
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Subscribe(char* topic_filter,
+                                                    esp8266_mqtt_qos_t qos_level,
+                                                    esp8266_mqtt_topic_handler_t handler,
+                                                    void* handler_arg)
+{
+    //REGISTER handler FOR RECEIVED MESSAGES MATCHING topic_filter ('+' / '#'
+    //WILDCARDS ALLOWED). SUBSCRIBE IS SENT NOW IF CONNECTED, OTHERWISE ON THE
+    //NEXT CONNACK. ALL FILTERS ARE SUBSCRIBED AGAIN AFTER EVERY (RE)CONNECT
+    //HANDLER GETS TOPIC + PAYLOAD POINTING INTO THE RECEIVED PACKET (NOT NUL
+    //TERMINATED, ONLY VALID DURING THE CALL)
+    //RETURN FALSE IF THE FILTER IS INVALID OR COULD NOT BE STORED
+
+    uint16_t len_filter;
+
+    if(topic_filter == NULL || handler == NULL || qos_level > ESP8266_MQTT_QOS_2)
+    {
+        return false;
+    }
+    len_filter = strlen(topic_filter);
+    if(!ESP8266_MQTT_TOPIC_TRIE_Insert(&s_client->subscriptions, topic_filter, len_filter, qos_level, handler, handler_arg))
+    {
+        ESP8266_MQTT_LOG_WARN("SUBSCRIBE Fail. Invalid topic filter");
+        return false;
+    }
+    if(s_client->mqtt_connected)
+    {
+        s_esp8266_mqtt_send_subscribe(topic_filter, len_filter, qos_level, false);
+    }
+    return true;
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Unsubscribe(char* topic_filter)
+{
+    //REMOVE THE HANDLER OF topic_filter AND SEND UNSUBSCRIBE IF CONNECTED
+    //RETURN FALSE IF THE FILTER WAS NOT SUBSCRIBED
+
+    uint16_t len_filter;
+
+    if(topic_filter == NULL)
+    {
+        return false;
+    }
+    len_filter = strlen(topic_filter);
+    if(!ESP8266_MQTT_TOPIC_TRIE_Remove(&s_client->subscriptions, topic_filter, len_filter))
+    {
+        return false;
+    }
+    if(s_client->mqtt_connected)
+    {
+        s_esp8266_mqtt_send_subscribe(topic_filter, len_filter, 0, true);
+    }
+    return true;
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_Pingreq(void)
+{
+    //SEND MQTT PINGREQ PACKET
+    //FIXED HEADER ONLY. NO VARIABLE HEADER / PAYLOAD
+    //IN PERSISTENT MODE THIS IS CALLED AUTOMATICALLY BY THE KEEPALIVE TIMER
+
+    uint16_t counter;
+    uint8_t* dest;
+
+    dest = s_esp8266_mqtt_tx_reserve(0);
+    if(dest == NULL)
+    {
+        return;
+    }
+    counter = s_esp8266_mqtt_insert_fixed_header(dest,
+                                                    (ESP8266_MQTT_CONTROL_PACKET_TYPE_PINGREQ << 4) |
+                                                    ESP8266_MQTT_CONTROL_PACKET_FLAG_PINGREQ,
+                                                    0);
+    ESP8266_MQTT_LOG_DEBUG("PINGREQ packet created");
+
+    //SEND PACKET
+    s_esp8266_mqtt_stats_start(ESP8266_MQTT_STATS_STAGE_PINGRESP);
+    s_esp8266_mqtt_send_packet(counter, false);
+    ESP8266_MQTT_LOG_DEBUG("PINGREQ packet sent");
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_Disconnect(void)
+{
+    //SEND MQTT DISCONNECT PACKET
+    //FIXED HEADER ONLY. NO VARIABLE HEADER / PAYLOAD
+    //ENDS THE PERSISTENT SESSION (IF ANY)
+
+    uint16_t counter;
+    uint8_t* dest;
+
+    s_client->session_active = false;
+    s_client->mqtt_connected = false;
+    s_esp8266_mqtt_keepalive_stop();
+
+    dest = s_esp8266_mqtt_tx_reserve(0);
+    if(dest == NULL)
+    {
+        return;
+    }
+    counter = s_esp8266_mqtt_insert_fixed_header(dest,
+                                                    (ESP8266_MQTT_CONTROL_PACKET_TYPE_DISCONNECT << 4) |
+                                                    ESP8266_MQTT_CONTROL_PACKET_FLAG_DISCONNECT,
+                                                    0);
+    ESP8266_MQTT_LOG_DEBUG("DISCONNECT packet created");
+
+    //SEND PACKET
+    s_esp8266_mqtt_send_packet(counter, false);
+    ESP8266_MQTT_LOG_DEBUG("DISCONNECT packet sent");
+}
+
+//INTERNAL FUNCTIONS
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_initialize(void* ctx,
+                                                            const char* hostname,
+                                                            const char* host_ip,
+                                                            uint16_t host_port,
+                                                            uint16_t buffer_size)
+{
+    //DEFAULT TRANSPORT INITIALIZE (ESP8266_TCP_GENERIC, NO PATH)
+
+    s_tcp_hostname = hostname;
+    s_tcp_host_port = host_port;
+    s_tcp_buffer_size = buffer_size;
+    s_tcp_host_ip.addr = 0;
+    ESP8266_TCP_GENERIC_Initialize(hostname, host_ip, host_port, "", buffer_size);
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_set_dns_server(void* ctx, char num_dns, ip_addr_t* dns)
+{
+    //DEFAULT TRANSPORT SET DNS SERVER
+
+    //NOT THE INSTANCE THAT OWNS ESP8266_TCP_GENERIC
+    if(s_client != s_tcp_generic_owner)
+    {
+        return;
+    }
+
+    ESP8266_TCP_GENERIC_SetDnsServer(num_dns, dns);
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_set_callback_functions(void* ctx,
+                                                                        void* cb_arg,
+                                                                        void (*conn_cb)(void*),
+                                                                        void (*discon_cb)(void*),
+                                                                        void (*send_cb)(void*),
+                                                                        void (*recv_cb)(void*, char*, unsigned short),
+                                                                        void (*dns_cb)(void*, ip_addr_t*))
+{
+    //DEFAULT TRANSPORT SET CB FUNCTIONS
+    //ESP8266_TCP_GENERIC CBS DO NOT CARRY A CONTEXT. REMEMBER THE CLIENT CBS +
+    //ARG AND REGISTER THE FORWARDING CBS INSTEAD
+
+    if(s_client != s_tcp_generic_owner)
+    {
+        return;
+    }
+
+    s_tcp_cb_arg = cb_arg;
+    s_tcp_conn_cb = conn_cb;
+    s_tcp_discon_cb = discon_cb;
+    s_tcp_send_cb = send_cb;
+    s_tcp_recv_cb = recv_cb;
+    s_tcp_dns_cb = dns_cb;
+
+    ESP8266_TCP_GENERIC_SetCallbackFunctions(s_esp8266_mqtt_tcp_generic_conn_cb,
+                                                s_esp8266_mqtt_tcp_generic_discon_cb,
+                                                s_esp8266_mqtt_tcp_generic_send_cb,
+                                                s_esp8266_mqtt_tcp_generic_recv_cb,
+                                                s_esp8266_mqtt_tcp_generic_dns_cb);
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_resolve_host_name(void* ctx)
+{
+    //DEFAULT TRANSPORT RESOLVE HOST NAME
+
+    if(s_client != s_tcp_generic_owner)
+    {
+        return;
+    }
+
+    ESP8266_TCP_GENERIC_ResolveHostName();
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_connect(void* ctx)
+{
+    //DEFAULT TRANSPORT CONNECT
+
+    if(s_client != s_tcp_generic_owner)
+    {
+        return;
+    }
+
+    ESP8266_TCP_GENERIC_Connect();
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_disconnect(void* ctx)
+{
+    //DEFAULT TRANSPORT DISCONNECT
+
+    if(s_client != s_tcp_generic_owner)
+    {
+        return;
+    }
+
+    ESP8266_TCP_GENERIC_Disonnect();
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_send(void* ctx, uint8_t* data, uint16_t len)
+{
+    //DEFAULT TRANSPORT SEND
+
+    if(s_client != s_tcp_generic_owner)
+    {
+        return;
+    }
+
+    ESP8266_TCP_GENERIC_SendAndGetReply(data, len);
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_set_host_ip(void* ctx, ip_addr_t* ip)
+{
+    //DEFAULT TRANSPORT SET HOST IP
+    //ESP8266_TCP_GENERIC HAS NO CALL FOR THIS. RE-INITIALIZE IT WITH THE IP
+    //(ONLY IF IT CHANGED) AND REGISTER THE FORWARDING CBS AGAIN
+
+    char host_ip[16];
+
+    if(s_client != s_tcp_generic_owner || ip->addr == s_tcp_host_ip.addr)
+    {
+        return;
+    }
+    s_tcp_host_ip = *ip;
+    os_sprintf(host_ip, IPSTR, IP2STR(ip));
+    ESP8266_TCP_GENERIC_Initialize(s_tcp_hostname, host_ip, s_tcp_host_port, "", s_tcp_buffer_size);
+    ESP8266_TCP_GENERIC_SetCallbackFunctions(s_esp8266_mqtt_tcp_generic_conn_cb,
+                                                s_esp8266_mqtt_tcp_generic_discon_cb,
+                                                s_esp8266_mqtt_tcp_generic_send_cb,
+                                                s_esp8266_mqtt_tcp_generic_recv_cb,
+                                                s_esp8266_mqtt_tcp_generic_dns_cb);
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_generic_conn_cb(void* arg)
+{
+    //ESP8266_TCP_GENERIC CONNECT CB -> CLIENT
+
+    if(s_tcp_conn_cb != NULL)
+    {
+        (*s_tcp_conn_cb)(s_tcp_cb_arg);
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_generic_discon_cb(void* arg)
+{
+    //ESP8266_TCP_GENERIC DISCONNECT CB -> CLIENT
+
+    if(s_tcp_discon_cb != NULL)
+    {
+        (*s_tcp_discon_cb)(s_tcp_cb_arg);
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_generic_send_cb(void* arg)
+{
+    //ESP8266_TCP_GENERIC SENT CB -> CLIENT
+
+    if(s_tcp_send_cb != NULL)
+    {
+        (*s_tcp_send_cb)(s_tcp_cb_arg);
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_generic_recv_cb(char* pusrdata, unsigned short length)
+{
+    //ESP8266_TCP_GENERIC RECEIVE CB -> CLIENT
+
+    if(s_tcp_recv_cb != NULL)
+    {
+        (*s_tcp_recv_cb)(s_tcp_cb_arg, pusrdata, length);
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_generic_dns_cb(ip_addr_t* ipAddr)
+{
+    //ESP8266_TCP_GENERIC DNS CB -> CLIENT
+    //ESP8266_TCP_GENERIC CONNECTS TO THE RESOLVED ADDRESS FROM NOW ON
+
+    if(ipAddr != NULL)
+    {
+        s_tcp_host_ip = *ipAddr;
+    }
+    if(s_tcp_dns_cb != NULL)
+    {
+        (*s_tcp_dns_cb)(s_tcp_cb_arg, ipAddr);
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_print_packet(uint8_t* packet, uint16_t len)
+{
+    //PRINT MQTT PACKET
+    //AS HEX BYTES ON TERMINAL
+    //SYNCHRONOUS UART OUTPUT. ONLY COMPILED IN AT ESP8266_MQTT_LOG_LEVEL_TRACE
+
+#if ESP8266_MQTT_LOG_LEVEL >= ESP8266_MQTT_LOG_LEVEL_TRACE
+    uint16_t counter;
+    for(counter = 0; counter < len; counter++)
+    {
+        if((counter % 8) == 0)
+        {
+            os_printf("\n");
+        }
+        os_printf("%02X ", packet[counter]);
+    }
+    os_printf("\n\n");
+#endif
+}
+
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_insert_string(uint8_t* dest_buff, const char* src_buff, uint16_t len)
+{
+    //PROCESS MQTT STRING
+    //INSERT INTO SPECIFIED BUFFER LOCATION + PREPEND 2 BYTES FOR STRING LENGTH
+    //AS MQTT REQUIRES
+
+    dest_buff[0] = (uint8_t)((len & 0xFF00) >> 8);
+    dest_buff[1] = (uint8_t)(len & 0x00FF);
+    os_memcpy(&dest_buff[2], src_buff, len);
+
+    return (len+2);
+}
+
+static uint8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_remaining_length_size(uint32_t len_remaining)
+{
+    //RETURN THE NUMBER OF BYTES THE REMAINING LENGTH FIELD (IN FIXED HEADER)
+    //NEEDS TO ENCODE THE SPECIFIED LENGTH (1 - 4)
+
+    if(len_remaining < 128)
+    {
+        return 1;
+    }
+    if(len_remaining < 16384)
+    {
+        return 2;
+    }
+    if(len_remaining < 2097152)
+    {
+        return 3;
+    }
+    return 4;
+}
+
+static uint8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_insert_fixed_header(uint8_t* dest_buff, uint8_t byte1, uint32_t len_remaining)
+{
+    //INSERT THE FIXED HEADER (BYTE 1 + REMAINING LENGTH) INTO SPECIFIED BUFFER
+    //LOCATION. REMAINING LENGTH IS ENCODED USING MQTT SUPPLIED ALGORITHM
+    //RETURN NUMBER OF BYTES WRITTEN
+
+    dest_buff[0] = byte1;
+    return (1 + s_esp8266_mqtt_insert_varint(&dest_buff[1], len_remaining));
+}
+
+static uint8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_insert_varint(uint8_t* dest_buff, uint32_t value)
+{
+    //INSERT A VARIABLE BYTE INTEGER (REMAINING LENGTH / MQTT 5 PROPERTY
+    //LENGTH) INTO SPECIFIED BUFFER LOCATION
+    //RETURN NUMBER OF BYTES WRITTEN (1 - 4)
+
+    uint8_t byte;
+    uint8_t counter = 0;
+
+    do
+    {
+        byte = value % 128;
+        value = value / 128;
+        if(value > 0)
+        {
+            byte = byte | 0x80;
+        }
+        dest_buff[counter] = byte;
+        counter++;
+    }while(value > 0);
+    return counter;
+}
+
+static uint8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_decode_varint(uint8_t* data, uint16_t len, uint32_t* value)
+{
+    //DECODE A VARIABLE BYTE INTEGER AT THE SPECIFIED LOCATION
+    //RETURN NUMBER OF BYTES USED (0 IF TRUNCATED OR MALFORMED)
+
+    uint8_t counter = 0;
+    uint32_t multiplier = 1;
+
+    *value = 0;
+    while(counter < len && counter < 4)
+    {
+        *value += (uint32_t)(data[counter] & 0x7F) * multiplier;
+        if((data[counter] & 0x80) == 0)
+        {
+            return (counter + 1);
+        }
+        multiplier *= 128;
+        counter++;
+    }
+    return 0;
+}
+
+static int32_t ICACHE_FLASH_ATTR s_esp8266_mqtt_properties_decode(uint8_t* data,
+                                                                    uint16_t len,
+                                                                    uint8_t** properties,
+                                                                    uint16_t* len_properties)
+{
+    //DECODE AN MQTT 5 PROPERTY BLOCK (PROPERTY LENGTH + PROPERTIES) AT THE
+    //SPECIFIED LOCATION
+    //RETURN TOTAL BLOCK SIZE OR -1 IF MALFORMED
+
+    uint32_t value;
+    uint8_t len_varint = s_esp8266_mqtt_decode_varint(data, len, &value);
+
+    if(len_varint == 0 || value > (uint32_t)(len - len_varint))
+    {
+        return -1;
+    }
+    *properties = &data[len_varint];
+    *len_properties = value;
+    return (len_varint + value);
+}
+
+static int32_t ICACHE_FLASH_ATTR s_esp8266_mqtt_property_size(uint8_t id, uint8_t* value, uint16_t len)
+{
+    //RETURN SIZE OF THE VALUE OF THE SPECIFIED MQTT 5 PROPERTY
+    //(-1 IF UNKNOWN OR TRUNCATED)
+
+    int32_t size;
+    uint32_t varint;
+
+    switch(id)
+    {
+        case ESP8266_MQTT_PROPERTY_PAYLOAD_FORMAT_INDICATOR:
+        case ESP8266_MQTT_PROPERTY_REQUEST_PROBLEM_INFORMATION:
+        case ESP8266_MQTT_PROPERTY_REQUEST_RESPONSE_INFORMATION:
+        case ESP8266_MQTT_PROPERTY_MAXIMUM_QOS:
+        case ESP8266_MQTT_PROPERTY_RETAIN_AVAILABLE:
+        case ESP8266_MQTT_PROPERTY_WILDCARD_SUBSCRIPTION_AVAILABLE:
+        case ESP8266_MQTT_PROPERTY_SUBSCRIPTION_IDENTIFIER_AVAILABLE:
+        case ESP8266_MQTT_PROPERTY_SHARED_SUBSCRIPTION_AVAILABLE:
+            size = 1;
+            break;
+
+        case ESP8266_MQTT_PROPERTY_SERVER_KEEP_ALIVE:
+        case ESP8266_MQTT_PROPERTY_RECEIVE_MAXIMUM:
+        case ESP8266_MQTT_PROPERTY_TOPIC_ALIAS_MAXIMUM:
+        case ESP8266_MQTT_PROPERTY_TOPIC_ALIAS:
+            size = 2;
+            break;
+
+        case ESP8266_MQTT_PROPERTY_MESSAGE_EXPIRY_INTERVAL:
+        case ESP8266_MQTT_PROPERTY_SESSION_EXPIRY_INTERVAL:
+        case ESP8266_MQTT_PROPERTY_WILL_DELAY_INTERVAL:
+        case ESP8266_MQTT_PROPERTY_MAXIMUM_PACKET_SIZE:
+            size = 4;
+            break;
+
+        case ESP8266_MQTT_PROPERTY_SUBSCRIPTION_IDENTIFIER:
+            size = s_esp8266_mqtt_decode_varint(value, len, &varint);
+            if(size == 0)
+            {
+                return -1;
+            }
+            break;
+
+        case ESP8266_MQTT_PROPERTY_CONTENT_TYPE:
+        case ESP8266_MQTT_PROPERTY_RESPONSE_TOPIC:
+        case ESP8266_MQTT_PROPERTY_CORRELATION_DATA:
+        case ESP8266_MQTT_PROPERTY_ASSIGNED_CLIENT_IDENTIFIER:
+        case ESP8266_MQTT_PROPERTY_AUTHENTICATION_METHOD:
+        case ESP8266_MQTT_PROPERTY_AUTHENTICATION_DATA:
+        case ESP8266_MQTT_PROPERTY_RESPONSE_INFORMATION:
+        case ESP8266_MQTT_PROPERTY_SERVER_REFERENCE:
+        case ESP8266_MQTT_PROPERTY_REASON_STRING:
+            //2 BYTE LENGTH + DATA
+            if(len < 2)
+            {
+                return -1;
+            }
+            size = 2 + ((value[0] << 8) | value[1]);
+            break;
+
+        case ESP8266_MQTT_PROPERTY_USER_PROPERTY:
+            //STRING PAIR
+            if(len < 2)
+            {
+                return -1;
+            }
+            size = 2 + ((value[0] << 8) | value[1]);
+            if((size + 2) > len)
+            {
+                return -1;
+            }
+            size += 2 + ((value[size] << 8) | value[size + 1]);
+            break;
+
+        default:
+            return -1;
+    }
+    return (size <= len) ? size : -1;
+}
+
+static uint8_t* ICACHE_FLASH_ATTR s_esp8266_mqtt_property_find(uint8_t* properties, uint16_t len_properties, uint8_t id)
+{
+    //RETURN LOCATION OF THE VALUE OF THE SPECIFIED PROPERTY IN AN MQTT 5
+    //PROPERTY LIST (NULL IF NOT PRESENT OR THE LIST IS MALFORMED)
+
+    uint16_t pos = 0;
+    uint8_t property_id;
+    int32_t size;
+
+    while(pos < len_properties)
+    {
+        property_id = properties[pos++];
+        size = s_esp8266_mqtt_property_size(property_id, &properties[pos], len_properties - pos);
+        if(size < 0)
+        {
+            return NULL;
+        }
+        if(property_id == id)
+        {
+            return &properties[pos];
+        }
+        pos += size;
+    }
+    return NULL;
+}
+
+static uint8_t* ICACHE_FLASH_ATTR s_esp8266_mqtt_tx_reserve(uint32_t len_remaining)
+{
+    //RETURN THE LOCATION IN THE CLIENT TX BUFFER WHERE A PACKET WITH THE
+    //SPECIFIED REMAINING LENGTH CAN BE SERIALIZED
+    //IF IT DOES NOT FIT BEHIND THE PACKETS ALREADY WAITING (COALESCING) THOSE
+    //ARE FLUSHED FIRST. RETURN NULL IF IT DOES NOT FIT THE TX BUFFER AT ALL
+
+    uint32_t len_packet = 1 + s_esp8266_mqtt_remaining_length_size(len_remaining) + len_remaining;
+
+    if(s_client->tx_buffer == NULL)
+    {
+        ESP8266_MQTT_LOG_ERROR("Error ! Not initialized");
+        return NULL;
+    }
+    if(len_packet > s_client->buffer_size)
+    {
+        ESP8266_MQTT_LOG_ERROR("Error ! Packet size %u > buffer size %u", len_packet, s_client->buffer_size);
+        return NULL;
+    }
+    if((s_client->tx_len + len_packet) > s_client->buffer_size)
+    {
+        s_esp8266_mqtt_tx_flush();
+        if((s_client->tx_len + len_packet) > s_client->buffer_size)
+        {
+            //TX BUFFER STILL HELD BY SEGMENTS WAITING FOR THE TCP SENT CB
+            ESP8266_MQTT_LOG_ERROR("Error ! TX buffer busy");
+            return NULL;
+        }
+    }
+    return &s_client->tx_buffer[s_client->tx_len];
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tx_flush(void)
+{
+    //QUEUE ALL PACKETS WAITING IN THE CLIENT TX BUFFER (ONE SEGMENT, SO THEY
+    //GO OUT AS ONE TCP SEGMENT) AND START SENDING
+    //IF THE SEGMENT QUEUE IS FULL THEY ARE QUEUED FROM THE NEXT TCP SENT CB
+
+    os_timer_disarm(&s_client->tx_flush_os_timer);
+    s_client->tx_flush_pending = false;
+    if(s_client->stream_sending && s_client->tx_len > s_client->tx_queued)
+    {
+        //STREAM PAYLOAD STILL GOING OUT. PACKETS MUST NOT END UP INSIDE IT
+        s_client->tx_flush_pending = true;
+        s_esp8266_mqtt_tx_pump();
+        return;
+    }
+    if(s_client->tx_len > s_client->tx_queued)
+    {
+        if(!s_esp8266_mqtt_tx_queue_segment(&s_client->tx_buffer[s_client->tx_queued], s_client->tx_len - s_client->tx_queued, NULL, NULL))
+        {
+            s_client->tx_flush_pending = true;
+            return;
+        }
+        s_client->tx_queued = s_client->tx_len;
+    }
+    s_esp8266_mqtt_tx_pump();
+}
+
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_tx_queue_segment(uint8_t* data,
+                                                                uint16_t len,
+                                                                void (*release_cb)(void*),
+                                                                void* release_arg)
+{
+    //ADD A SEGMENT TO THE END OF THE TX SEGMENT QUEUE
+    //TX BUFFER BYTES RIGHT BEHIND THE LAST SEGMENT (NOT YET HANDED TO THE
+    //TRANSPORT) EXTEND IT INSTEAD
+    //RETURN FALSE IF THE QUEUE IS FULL
+
+    esp8266_mqtt_tx_segment_t* segment;
+
+    if(s_client->tx_segment_count > 0)
+    {
+        segment = &s_client->tx_segments[(s_client->tx_segment_head + s_client->tx_segment_count - 1) % ESP8266_MQTT_CLIENT_TX_SEGMENTS_MAX];
+        if(release_cb == NULL && segment->release_cb == NULL && (segment->data + segment->len) == data &&
+            !(s_client->tx_sending && s_client->tx_segment_count == 1))
+        {
+            segment->len += len;
+            return true;
+        }
+    }
+    if(s_client->tx_segment_count >= ESP8266_MQTT_CLIENT_TX_SEGMENTS_MAX)
+    {
+        return false;
+    }
+    segment = &s_client->tx_segments[(s_client->tx_segment_head + s_client->tx_segment_count) % ESP8266_MQTT_CLIENT_TX_SEGMENTS_MAX];
+    segment->data = data;
+    segment->len = len;
+    segment->release_cb = release_cb;
+    segment->release_arg = release_arg;
+    s_client->tx_segment_count++;
+    return true;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tx_pump(void)
+{
+    //HAND THE FIRST QUEUED SEGMENT TO THE TRANSPORT IF NOTHING IS BEING SENT
+    //THE REST FOLLOW ONE BY ONE FROM THE TCP SENT CB
+
+    esp8266_mqtt_tx_segment_t* segment;
+
+    if(s_client->tx_sending || s_client->tx_segment_count == 0)
+    {
+        return;
+    }
+    segment = &s_client->tx_segments[s_client->tx_segment_head];
+    s_client->tx_sending = true;
+    s_client->last_tx_time_us = system_get_time();
+    s_client->stats.bytes_sent += segment->len;
+
+    //PRINT SEGMENT (HEX DUMP ONLY COMPILED IN AT ESP8266_MQTT_LOG_LEVEL_TRACE)
+    s_esp8266_mqtt_print_packet(segment->data, segment->len);
+    ESP8266_MQTT_LOG_DEBUG("Packet sent! %u bytes", segment->len);
+    (*s_client->transport->send)(s_client->transport_ctx, segment->data, segment->len);
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tx_reset(void)
+{
+    //DROP EVERYTHING WAITING TO BE SENT (CONNECTION GONE)
+    //ZERO COPY PAYLOADS ARE HANDED BACK TO THEIR OWNERS
+
+    esp8266_mqtt_tx_segment_t* segment;
+
+    os_timer_disarm(&s_client->tx_flush_os_timer);
+
+    //PARTLY SENT STREAM IS LOST. QOS 0 ENDS HERE, QOS 1 / 2 IS STREAMED AGAIN
+    //BY THE RETRANSMISSION AFTER RECONNECT
+    s_client->stream_sending = false;
+    if(s_client->stream_active && s_client->stream_qos == ESP8266_MQTT_QOS_0)
+    {
+        s_esp8266_mqtt_stream_end(false);
+    }
+    while(s_client->tx_segment_count > 0)
+    {
+        segment = &s_client->tx_segments[s_client->tx_segment_head];
+        s_client->tx_segment_head = (s_client->tx_segment_head + 1) % ESP8266_MQTT_CLIENT_TX_SEGMENTS_MAX;
+        s_client->tx_segment_count--;
+        if(segment->release_cb != NULL)
+        {
+            (*segment->release_cb)(segment->release_arg);
+        }
+    }
+    s_client->tx_segment_head = 0;
+    s_client->tx_sending = false;
+    s_client->tx_flush_pending = false;
+    s_client->tx_len = 0;
+    s_client->tx_queued = 0;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tx_flush_timer_cb(void* arg)
+{
+    //COALESCING FLUSH DEADLINE CB
+
+    esp8266_mqtt_client_t* previous = s_esp8266_mqtt_instance_enter(arg);
+    s_esp8266_mqtt_tx_flush();
+    s_esp8266_mqtt_instance_leave(previous);
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_send_packet(uint16_t len, bool allow_coalesce)
+{
+    //COMMIT THE MQTT PACKET SERIALIZED AT THE END OF THE CLIENT TX BUFFER
+    //AND SEND IT THROUGH TCP LAYER
+    //WITH COALESCING ON, PACKETS THAT ALLOW IT ARE HELD BACK UNTIL THE FLUSH
+    //THRESHOLD IS REACHED OR THE FLUSH DEADLINE EXPIRES. ANY OTHER PACKET
+    //FLUSHES EVERYTHING WAITING (IN ORDER) RIGHT AWAY
+
+    s_client->tx_len += len;
+    s_client->stats.packets_sent++;
+
+    if(!s_client->flag_coalesce || !allow_coalesce || (s_client->tx_len - s_client->tx_queued) >= s_client->coalesce_threshold)
+    {
+        s_esp8266_mqtt_tx_flush();
+        return;
+    }
+
+    //ARM FLUSH DEADLINE FOR THE FIRST PACKET WAITING
+    if((s_client->tx_len - s_client->tx_queued) == len)
+    {
+        os_timer_disarm(&s_client->tx_flush_os_timer);
+        os_timer_arm(&s_client->tx_flush_os_timer, s_client->coalesce_timeout_ms, 0);
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_send_ack(uint8_t byte1, uint16_t packet_id)
+{
+    //SEND A 4 BYTE ACKNOWLEDGEMENT PACKET (FIXED HEADER + PACKET ID)
+    //USED FOR PUBACK / PUBREC / PUBREL / PUBCOMP
+
+    uint16_t counter;
+    uint8_t* dest;
+
+    dest = s_esp8266_mqtt_tx_reserve(2);
+    if(dest == NULL)
+    {
+        return;
+    }
+    counter = s_esp8266_mqtt_insert_fixed_header(dest, byte1, 2);
+    dest[counter++] = (uint8_t)((packet_id & 0xFF00) >> 8);
+    dest[counter++] = (uint8_t)(packet_id & 0x00FF);
+    s_esp8266_mqtt_send_packet(counter, true);
+}
+
+static int8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_decode_fixed_header(uint8_t* data, uint16_t len, uint32_t* len_remaining)
+{
+    //DECODE THE FIXED HEADER (BYTE 1 + REMAINING LENGTH VARINT) AT THE
+    //SPECIFIED LOCATION
+    //RETURN FIXED HEADER LENGTH, 0 IF MORE BYTES ARE NEEDED OR -1 IF THE
+    //REMAINING LENGTH IS MALFORMED (MORE THAN 4 BYTES)
+
+    uint8_t counter = 1;
+    uint32_t multiplier = 1;
+    uint32_t value = 0;
+
+    while(counter < len)
+    {
+        value += (uint32_t)(data[counter] & 0x7F) * multiplier;
+        if((data[counter] & 0x80) == 0)
+        {
+            *len_remaining = value;
+            return (counter + 1);
+        }
+        multiplier *= 128;
+        counter++;
+        if(counter > 4)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_rx_reset(void)
+{
+    //DISCARD ANY PARTIALLY RECEIVED PACKET
+
+    s_client->rx_len = 0;
+    s_client->rx_expected = 0;
+    s_client->rx_discard = 0;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_rx_feed(uint8_t* data, uint16_t len)
+{
+    //STREAMING RECEIVE PARSER
+    //DISPATCH EVERY COMPLETE MQTT PACKET IN THE RECEIVED DATA. PACKETS THAT ARE
+    //FULLY CONTAINED ARE DISPATCHED IN PLACE (NO COPY). ONLY A PACKET SPLIT
+    //ACROSS RECEIVE CALLS IS BUFFERED IN THE CLIENT RX BUFFER UNTIL COMPLETE.
+    //PACKETS BIGGER THAN THE RX BUFFER ARE SKIPPED
+
+    uint16_t pos = 0;
+    uint16_t chunk;
+    uint32_t len_remaining;
+    int8_t len_header;
+
+    while(pos < len)
+    {
+        //SKIP REST OF AN OVERSIZED PACKET
+        if(s_client->rx_discard > 0)
+        {
+            chunk = (s_client->rx_discard < (uint32_t)(len - pos)) ? (uint32_t)s_client->rx_discard : (uint32_t)(len - pos);
+            s_client->rx_discard -= chunk;
+            pos += chunk;
+            continue;
+        }
+
+        //FAST PATH : NOTHING BUFFERED. DISPATCH COMPLETE PACKET IN PLACE
+        if(s_client->rx_len == 0)
+        {
+            len_header = s_esp8266_mqtt_decode_fixed_header(&data[pos], len - pos, &len_remaining);
+            if(len_header < 0)
+            {
+                ESP8266_MQTT_LOG_ERROR("Malformed packet!");
+                s_esp8266_mqtt_rx_reset();
+                return;
+            }
+            if(len_header > 0 && (len_header + len_remaining) <= (uint32_t)(len - pos))
+            {
+                s_esp8266_mqtt_handle_packet(&data[pos], len_header + len_remaining, len_header);
+                pos += len_header + len_remaining;
+                continue;
+            }
+        }
+
+        //SLOW PATH : BUFFER PARTIAL PACKET
+        if(s_client->rx_expected == 0)
+        {
+            //FIXED HEADER NOT COMPLETE YET. BUFFER ONE BYTE AT A TIME
+            s_client->rx_buffer[s_client->rx_len++] = data[pos++];
+            len_header = s_esp8266_mqtt_decode_fixed_header(s_client->rx_buffer, s_client->rx_len, &len_remaining);
+            if(len_header < 0)
+            {
+                ESP8266_MQTT_LOG_ERROR("Malformed packet!");
+                s_esp8266_mqtt_rx_reset();
+                return;
+            }
+            if(len_header == 0)
+            {
+                continue;
+            }
+            s_client->rx_header_len = len_header;
+            s_client->rx_expected = len_header + len_remaining;
+            if(s_client->rx_expected > s_client->buffer_size)
+            {
+                ESP8266_MQTT_LOG_WARN("Packet size %u > buffer size. Skipped", s_client->rx_expected);
+                s_client->rx_discard = s_client->rx_expected - s_client->rx_len;
+                s_client->rx_len = 0;
+                s_client->rx_expected = 0;
+                continue;
+            }
+        }
+        else
+        {
+            chunk = ((s_client->rx_expected - s_client->rx_len) < (uint32_t)(len - pos)) ? (uint32_t)(s_client->rx_expected - s_client->rx_len) : (uint32_t)(len - pos);
+            os_memcpy(&s_client->rx_buffer[s_client->rx_len], &data[pos], chunk);
+            s_client->rx_len += chunk;
+            pos += chunk;
+        }
+
+        if(s_client->rx_len == s_client->rx_expected)
+        {
+            chunk = s_client->rx_len;
+            s_client->rx_len = 0;
+            s_client->rx_expected = 0;
+            s_esp8266_mqtt_handle_packet(s_client->rx_buffer, chunk, s_client->rx_header_len);
+        }
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_handle_packet(uint8_t* packet, uint16_t len, uint8_t len_header)
+{
+    //HANDLE ONE COMPLETE RECEIVED MQTT PACKET
+    //UPDATE SESSION STATE AND PASS IT ON TO THE USER CB
+
+    esp8266_mqtt_client_packet_type_t ptype;
+    esp8266_mqtt_inflight_entry_t* entry;
+    uint8_t* variable_header = &packet[len_header];
+    uint16_t len_remaining = len - len_header;
+    uint16_t packet_id = (len_remaining >= 2) ? ((variable_header[0] << 8) | variable_header[1]) : 0;
+    uint8_t reason_code = (len_remaining >= 3) ? variable_header[2] : 0;
+    uint8_t* properties;
+    uint16_t len_properties;
+    uint8_t* value;
+    int32_t pos;
+
+    //PARSE MQTT PACKET
+    ptype = s_esp8266_mqtt_parse_response_packet(packet, len, len_header);
+    s_client->stats.packets_received++;
+
+    //UPDATE SESSION STATE
+    if(ptype == ESP8266_MQTT_CONTROL_PACKET_TYPE_CONNACK)
+    {
+        s_esp8266_mqtt_stats_stop(ESP8266_MQTT_STATS_STAGE_CONNACK);
+        s_client->mqtt_connected = (len_remaining >= 2 && variable_header[1] == ESP8266_MQTT_CONNACK_ACCEPTED);
+
+        //SESSION PRESENT FLAG (BYTE 1 IS RESERVED IN MQTT 3.1)
+        s_client->session_present = (s_client->mqtt_connected &&
+                                        s_client->protocol_version != ESP8266_MQTT_PROTOCOL_VERSION_3_1 &&
+                                        (variable_header[0] & 0x01));
+
+        //CONNACK (OR ITS ABSENCE) DECIDES THE (RE)CONNECT
+        s_esp8266_mqtt_keepalive_stop();
+        if(s_client->mqtt_connected)
+        {
+            s_client->session_reconnecting = false;
+            s_client->reconnect_attempt = 0;
+        }
+        else if(s_client->flag_persistent && s_client->session_active && len_remaining >= 2)
+        {
+            if(s_esp8266_mqtt_connack_retryable(variable_header[1]))
+            {
+                //TEMPORARY REFUSAL. TRY AGAIN AFTER THE BACKOFF DELAY
+                s_client->session_reconnecting = true;
+                (*s_client->transport->disconnect)(s_client->transport_ctx);
+                s_esp8266_mqtt_reconnect_schedule();
+            }
+            else
+            {
+                //PERMANENT REFUSAL. RETRYING CANNOT HELP
+                ESP8266_MQTT_LOG_WARN("Connection refused permanently (0x%02X)", variable_header[1]);
+                s_client->session_active = false;
+                s_client->session_reconnecting = false;
+                s_client->reconnect_pending = false;
+                os_timer_disarm(&s_client->reconnect_os_timer);
+            }
+        }
+
+        //MQTT 5 : BROKER LIMITS FOR THIS CONNECTION
+        s_esp8266_mqtt_topic_alias_reset();
+        s_client->server_receive_max = 0xFFFF;
+        s_client->server_topic_alias_max = 0;
+        if(s_client->mqtt_connected && s_client->protocol_version == ESP8266_MQTT_PROTOCOL_VERSION_5 &&
+            s_esp8266_mqtt_properties_decode(&variable_header[2], len_remaining - 2, &properties, &len_properties) > 0)
+        {
+            value = s_esp8266_mqtt_property_find(properties, len_properties, ESP8266_MQTT_PROPERTY_RECEIVE_MAXIMUM);
+            if(value != NULL && ((value[0] << 8) | value[1]) != 0)
+            {
+                s_client->server_receive_max = (value[0] << 8) | value[1];
+            }
+            value = s_esp8266_mqtt_property_find(properties, len_properties, ESP8266_MQTT_PROPERTY_TOPIC_ALIAS_MAXIMUM);
+            if(value != NULL)
+            {
+                s_client->server_topic_alias_max = (value[0] << 8) | value[1];
+            }
+            value = s_esp8266_mqtt_property_find(properties, len_properties, ESP8266_MQTT_PROPERTY_SERVER_KEEP_ALIVE);
+            if(value != NULL)
+            {
+                s_client->keepalive_timer = (value[0] << 8) | value[1];
+            }
+        }
+        if(len_remaining >= 2)
+        {
+            s_esp8266_mqtt_report_reason(ptype, 0, variable_header[1]);
+        }
+
+        if(s_client->mqtt_connected && s_client->flag_persistent && s_client->keepalive_timer > 0)
+        {
+            s_esp8266_mqtt_keepalive_start((uint32_t)s_client->keepalive_timer * 1000);
+        }
+        if(s_client->mqtt_connected)
+        {
+            //BROKER SESSION STATE IS GONE (CLEAN SESSION OR NO SESSION PRESENT)
+            //MQTT 3.1 CANNOT TELL SO ONLY CLEAN SESSION COUNTS THERE
+            if(s_client->flag_clean_session ||
+                (s_client->protocol_version != ESP8266_MQTT_PROTOCOL_VERSION_3_1 && !s_client->session_present))
+            {
+                s_client->inbound_qos2_count = 0;
+                s_esp8266_mqtt_inflight_session_lost();
+                s_esp8266_mqtt_resume_connected(true);
+            }
+            else
+            {
+                s_esp8266_mqtt_resume_connected(false);
+            }
+
+            //BROKER STILL HAS THE SUBSCRIPTIONS IF IT RESUMED THE SESSION
+            if(!s_client->session_present)
+            {
+                s_esp8266_mqtt_resubscribe();
+            }
+            s_esp8266_mqtt_inflight_retransmit_all();
+            if(s_client->flag_offline_queue)
+            {
+                ESP8266_MQTT_FLASH_QUEUE_Rewind();
+                s_esp8266_mqtt_store_drain();
+            }
+            s_esp8266_mqtt_send_queue_dispatch();
+        }
+    }
+    else if(ptype == ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBACK && len_remaining >= 2)
+    {
+        //MQTT 5 REASON CODE >= 0x80 : BROKER REFUSED THE MESSAGE
+        s_esp8266_mqtt_report_reason(ptype, packet_id, reason_code);
+        entry = s_esp8266_mqtt_inflight_find(packet_id);
+        if(entry != NULL && entry->state == ESP8266_MQTT_INFLIGHT_STATE_WAIT_PUBACK)
+        {
+            s_esp8266_mqtt_stats_record(ESP8266_MQTT_STATS_STAGE_PUBACK, system_get_time() - entry->sent_time_us);
+            s_esp8266_mqtt_inflight_complete(entry, (reason_code < 0x80));
+        }
+        else if(entry == NULL)
+        {
+            s_esp8266_mqtt_resume_release(packet_id);
+        }
+    }
+    else if(ptype == ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBREC && len_remaining >= 2)
+    {
+        //QOS 2 STEP 2. BROKER OWNS THE MESSAGE NOW. RELEASE IT WITH PUBREL
+        //(A REPEATED PUBREC GETS THE PUBREL AGAIN). MQTT 5 REASON CODE >= 0x80
+        //ENDS THE FLOW (MESSAGE REFUSED)
+        s_esp8266_mqtt_report_reason(ptype, packet_id, reason_code);
+        entry = s_esp8266_mqtt_inflight_find(packet_id);
+        if(entry != NULL && entry->state == ESP8266_MQTT_INFLIGHT_STATE_WAIT_PUBREC)
+        {
+            s_esp8266_mqtt_stats_record(ESP8266_MQTT_STATS_STAGE_PUBACK, system_get_time() - entry->sent_time_us);
+        }
+        if(entry != NULL && reason_code >= 0x80)
+        {
+            s_esp8266_mqtt_inflight_complete(entry, false);
+        }
+        else if(entry != NULL && (entry->state == ESP8266_MQTT_INFLIGHT_STATE_WAIT_PUBREC ||
+                                    entry->state == ESP8266_MQTT_INFLIGHT_STATE_WAIT_PUBCOMP))
+        {
+            entry->state = ESP8266_MQTT_INFLIGHT_STATE_WAIT_PUBCOMP;
+            entry->retries = 0;
+            entry->sent_time_us = system_get_time();
+            if(entry->store_addr != 0)
+            {
+                ESP8266_MQTT_FLASH_QUEUE_Consume(entry->store_addr);
+                entry->store_addr = 0;
+            }
+            s_esp8266_mqtt_send_ack((ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBREL << 4) |
+                                        ESP8266_MQTT_CONTROL_PACKET_FLAG_PUBREL,
+                                        entry->packet_id);
+        }
+    }
+    else if(ptype == ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBCOMP && len_remaining >= 2)
+    {
+        //QOS 2 STEP 4. HANDSHAKE DONE
+        s_esp8266_mqtt_report_reason(ptype, packet_id, reason_code);
+        entry = s_esp8266_mqtt_inflight_find(packet_id);
+        if(entry != NULL && entry->state == ESP8266_MQTT_INFLIGHT_STATE_WAIT_PUBCOMP)
+        {
+            s_esp8266_mqtt_inflight_complete(entry, true);
+        }
+        else if(entry == NULL)
+        {
+            s_esp8266_mqtt_resume_release(packet_id);
+        }
+    }
+    else if(ptype == ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBLISH)
+    {
+        s_esp8266_mqtt_handle_publish(packet, len, len_header);
+    }
+    else if(ptype == ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBREL && len_remaining >= 2)
+    {
+        //INBOUND QOS 2 STEP 3. MESSAGE ID CAN BE REUSED BY THE BROKER NOW
+        int8_t index = s_esp8266_mqtt_inbound_qos2_find(packet_id);
+        s_esp8266_mqtt_report_reason(ptype, packet_id, reason_code);
+        if(index >= 0)
+        {
+            s_client->inbound_qos2_ids[index] = s_client->inbound_qos2_ids[--s_client->inbound_qos2_count];
+        }
+        s_esp8266_mqtt_send_ack((ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBCOMP << 4) |
+                                    ESP8266_MQTT_CONTROL_PACKET_FLAG_PUBCOMP,
+                                    packet_id);
+    }
+    else if((ptype == ESP8266_MQTT_CONTROL_PACKET_TYPE_SUBACK || ptype == ESP8266_MQTT_CONTROL_PACKET_TYPE_UNSUBACK) &&
+            len_remaining >= 2)
+    {
+        //PACKET ID [+ PROPERTIES (MQTT 5)] + ONE RETURN CODE PER FILTER
+        //(MQTT 3.x UNSUBACK HAS NONE)
+        pos = 2;
+        if(s_client->protocol_version == ESP8266_MQTT_PROTOCOL_VERSION_5)
+        {
+            pos = s_esp8266_mqtt_properties_decode(&variable_header[2], len_remaining - 2, &properties, &len_properties);
+            pos = (pos < 0) ? len_remaining : (pos + 2);
+        }
+        reason_code = (pos < len_remaining) ? variable_header[pos] : 0;
+        if(reason_code >= 0x80)
+        {
+            ESP8266_MQTT_LOG_WARN((ptype == ESP8266_MQTT_CONTROL_PACKET_TYPE_SUBACK) ? "SUBSCRIBE id %u refused (0x%02X)" :
+                                                                                    "UNSUBSCRIBE id %u refused (0x%02X)",
+                                    packet_id,
+                                    reason_code);
+        }
+        s_esp8266_mqtt_report_reason(ptype, packet_id, reason_code);
+    }
+    else if(ptype == ESP8266_MQTT_CONTROL_PACKET_TYPE_DISCONNECT)
+    {
+        //MQTT 5 BROKER INITIATED DISCONNECT. TCP CONNECTION CLOSES NEXT
+        s_esp8266_mqtt_report_reason(ptype, 0, (len_remaining >= 1) ? variable_header[0] : 0);
+    }
+    else if(ptype == ESP8266_MQTT_CONTROL_PACKET_TYPE_PINGRESP)
+    {
+        s_esp8266_mqtt_stats_stop(ESP8266_MQTT_STATS_STAGE_PINGRESP);
+        s_client->pingresp_pending = false;
+        os_timer_disarm(&s_client->pingresp_os_timer);
+    }
+
+    //CALL USER CB IF NOT NULL
+    if(s_client->data_recv_cb != NULL)
+    {
+        (*s_client->data_recv_cb)(ptype, (char*)packet, len);
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_handle_publish(uint8_t* packet, uint16_t len, uint8_t len_header)
+{
+    //HANDLE A RECEIVED PUBLISH PACKET
+    //DISPATCH IT TO THE MATCHING SUBSCRIPTION HANDLERS AND ACKNOWLEDGE IT
+    //QOS 1 : PUBACK
+    //QOS 2 : PUBREC. PACKET ID IS REMEMBERED UNTIL PUBREL SO A RETRANSMITTED
+    //        PUBLISH IS NOT DISPATCHED TWICE
+
+    uint8_t qos_level = (packet[0] & 0x06) >> 1;
+    uint16_t pos = len_header;
+    uint16_t len_topic;
+    char* topic;
+    uint16_t packet_id = 0;
+    uint8_t* properties;
+    uint16_t len_properties;
+    int32_t len_block;
+
+    //VARIABLE HEADER : TOPIC + PACKET ID (QOS > 0)
+    if((len - pos) < 2)
+    {
+        return;
+    }
+    len_topic = (packet[pos] << 8) | packet[pos + 1];
+    pos += 2;
+    if(len_topic > (len - pos) || qos_level > ESP8266_MQTT_QOS_2)
+    {
+        ESP8266_MQTT_LOG_ERROR("Malformed PUBLISH!");
+        return;
+    }
+    topic = (char*)&packet[pos];
+    pos += len_topic;
+    if(qos_level != ESP8266_MQTT_QOS_0)
+    {
+        if((len - pos) < 2)
+        {
+            return;
+        }
+        packet_id = (packet[pos] << 8) | packet[pos + 1];
+        pos += 2;
+    }
+    if(s_client->protocol_version == ESP8266_MQTT_PROTOCOL_VERSION_5)
+    {
+        //PROPERTIES ARE NOT USED (NO INBOUND TOPIC ALIASES ALLOWED)
+        len_block = s_esp8266_mqtt_properties_decode(&packet[pos], len - pos, &properties, &len_properties);
+        if(len_block < 0)
+        {
+            return;
+        }
+        pos += len_block;
+    }
+
+    if(qos_level == ESP8266_MQTT_QOS_2)
+    {
+        if(s_esp8266_mqtt_inbound_qos2_find(packet_id) >= 0)
+        {
+            //ALREADY DISPATCHED. PUBREC WAS LOST
+            s_esp8266_mqtt_send_ack((ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBREC << 4) |
+                                        ESP8266_MQTT_CONTROL_PACKET_FLAG_PUBREC,
+                                        packet_id);
+            return;
+        }
+        if(s_client->inbound_qos2_count >= ESP8266_MQTT_CLIENT_INBOUND_QOS2_MAX)
+        {
+            //NO PUBREC. BROKER WILL RETRANSMIT
+            ESP8266_MQTT_LOG_WARN("Inbound Qos 2 table full. PUBLISH id %u deferred", packet_id);
+            return;
+        }
+        s_client->inbound_qos2_ids[s_client->inbound_qos2_count++] = packet_id;
+    }
+
+    //DISPATCH
+    if(ESP8266_MQTT_TOPIC_TRIE_Dispatch(&s_client->subscriptions,
+                                        topic,
+                                        len_topic,
+                                        (char*)&packet[pos],
+                                        len - pos) == 0)
+    {
+        ESP8266_MQTT_LOG_DEBUG("PUBLISH with no matching subscription");
+    }
+
+    //ACKNOWLEDGE
+    if(qos_level == ESP8266_MQTT_QOS_1)
+    {
+        s_esp8266_mqtt_send_ack((ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBACK << 4) |
+                                    ESP8266_MQTT_CONTROL_PACKET_FLAG_PUBACK,
+                                    packet_id);
+    }
+    else if(qos_level == ESP8266_MQTT_QOS_2)
+    {
+        s_esp8266_mqtt_send_ack((ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBREC << 4) |
+                                    ESP8266_MQTT_CONTROL_PACKET_FLAG_PUBREC,
+                                    packet_id);
+    }
+}
+
+static int8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_inbound_qos2_find(uint16_t packet_id)
+{
+    //RETURN INDEX OF THE INBOUND QOS 2 PACKET ID WAITING FOR PUBREL (-1 IF NONE)
+
+    uint8_t i;
+
+    for(i = 0; i < s_client->inbound_qos2_count; i++)
+    {
+        if(s_client->inbound_qos2_ids[i] == packet_id)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static esp8266_mqtt_client_packet_type_t ICACHE_FLASH_ATTR s_esp8266_mqtt_parse_response_packet(uint8_t* packet, uint16_t len, uint8_t len_header)
+{
+    //PARSE THE RESPONSE MQTT PACKET
+    //PACKET IS COMPLETE (FIXED HEADER OF len_header BYTES + REMAINING LENGTH)
+
+    uint16_t len_remaining = len - len_header;
+
+    //BYTE 0 : MESSAGE TYPE + FLAGS
+    switch((packet[0] & 0xF0) >> 4)
+    {
+        case ESP8266_MQTT_CONTROL_PACKET_TYPE_CONNACK:
+        case ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBLISH:
+        case ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBACK:
+        case ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBREC:
+        case ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBREL:
+        case ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBCOMP:
+        case ESP8266_MQTT_CONTROL_PACKET_TYPE_SUBACK:
+        case ESP8266_MQTT_CONTROL_PACKET_TYPE_UNSUBACK:
+        case ESP8266_MQTT_CONTROL_PACKET_TYPE_PINGRESP:
+        case ESP8266_MQTT_CONTROL_PACKET_TYPE_DISCONNECT:
+            break;
+
+        default:
+            //NOT A MQTT PACKET
+            ESP8266_MQTT_LOG_ERROR("Malformed packet!");
+            return ESP8266_MQTT_CONTROL_PACKET_TYPE_INVALID;
+            break;
+    }
+
+    //BYTE 1 - 4 : REMAINING LENGTH
+    ESP8266_MQTT_LOG_DEBUG("packet type = %u flags 0x%02X remaining length %u",
+                            (packet[0] & 0xF0) >> 4,
+                            (packet[0] & 0x0F),
+                            len_remaining);
+
+    //VARIABLE HEADER BYTE 2 : RETURN CODE
+    //ONLY IF CONNACK PACKET TYPE
+    if(((packet[0] & 0xF0) >> 4) == ESP8266_MQTT_CONTROL_PACKET_TYPE_CONNACK)
+    {
+        if(len_remaining < 2)
+        {
+            ESP8266_MQTT_LOG_ERROR("Malformed packet!");
+            return ESP8266_MQTT_CONTROL_PACKET_TYPE_INVALID;
+        }
+        ESP8266_MQTT_LOG_INFO(s_packet_return_code[(packet[len_header + 1] < 6) ? packet[len_header + 1] : 6],
+                                packet[len_header + 1]);
+    }
+
+    //RETURN PACKET TYPE
+    return ((packet[0] & 0xF0) >> 4);
+}
+
+static uint32_t ICACHE_FLASH_ATTR s_esp8266_mqtt_publish_remaining_length(char* topic,
+                                                                        esp8266_mqtt_topic_handle_t* topic_handle,
+                                                                        uint16_t len_message,
+                                                                        esp8266_mqtt_qos_t qos_level,
+                                                                        bool raw)
+{
+    //RETURN THE REMAINING LENGTH OF A PUBLISH PACKET (PAYLOAD NOT COMPRESSED)
+    //PACKET ID ONLY PRESENT FOR QOS > 0
+    //MQTT 5 : PROPERTIES (TOPIC ALIAS). ONCE THE BROKER KNOWS THE ALIAS THE
+    //TOPIC IS SENT EMPTY
+
+    uint32_t len_remaining;
+    uint16_t alias;
+    bool alias_known;
+
+    alias = s_esp8266_mqtt_topic_alias_get(topic_handle, &alias_known);
+    len_remaining = 2 + len_message + (raw ? 0 : 2);
+    if(!alias_known)
+    {
+        len_remaining += (topic_handle != NULL) ? topic_handle->topic_len : strlen(topic);
+    }
+    if(qos_level != ESP8266_MQTT_QOS_0)
+    {
+        len_remaining += 2;
+    }
+    if(s_client->protocol_version == ESP8266_MQTT_PROTOCOL_VERSION_5)
+    {
+        len_remaining += 1 + ((alias != 0) ? 3 : 0);
+    }
+    return len_remaining;
+}
+
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_publish_fits(char* topic,
+                                                            esp8266_mqtt_topic_handle_t* topic_handle,
+                                                            uint16_t len_message,
+                                                            esp8266_mqtt_qos_t qos_level,
+                                                            bool zero_copy,
+                                                            bool raw)
+{
+    //RETURN TRUE IF THE PUBLISH PACKET FITS THE (EMPTY) CLIENT TX BUFFER
+    //FALSE : IT CAN NEVER BE SENT, UNLIKE A PUBLISH REFUSED BECAUSE THE TX
+    //BUFFER IS STILL HELD BY PACKETS WAITING FOR THE TCP SENT CB
+
+    uint32_t len_remaining = s_esp8266_mqtt_publish_remaining_length(topic, topic_handle, len_message, qos_level, raw);
+
+    if(zero_copy)
+    {
+        len_remaining = len_remaining - len_message + 3;
+    }
+    return ((1 + s_esp8266_mqtt_remaining_length_size(len_remaining) + len_remaining) <= s_client->buffer_size);
+}
+
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_store_fits(char* topic,
+                                                        uint16_t len_topic,
+                                                        uint16_t len_message,
+                                                        esp8266_mqtt_qos_t qos_level,
+                                                        bool raw)
+{
+    //RETURN TRUE IF A PUBLISH STORED IN THE OFFLINE QUEUE CAN BE SENT AGAIN
+    //THE RECORD IS READ BACK INTO A BUFFER OF THE CLIENT BUFFER SIZE AND SENT
+    //WITHOUT A TOPIC HANDLE (FULL TOPIC)
+
+    if(ESP8266_MQTT_FLASH_QUEUE_READ_SIZE(len_topic + len_message) > s_client->buffer_size)
+    {
+        return false;
+    }
+    return s_esp8266_mqtt_publish_fits(topic, NULL, len_message, qos_level, false, raw);
+}
+
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_encode_publish(char* topic,
+                                                                esp8266_mqtt_topic_handle_t* topic_handle,
+                                                                char* message,
+                                                                uint16_t len_message,
+                                                                esp8266_mqtt_qos_t qos_level,
+                                                                uint16_t packet_id,
+                                                                bool dup,
+                                                                bool zero_copy,
+                                                                bool raw)
+{
+    //SERIALIZE A PUBLISH PACKET INTO THE CLIENT TX BUFFER
+    //PACKET SIZE IS CALCULATED FIRST AND THE PACKET IS WRITTEN IN ONE PASS
+    //WITH A TOPIC HANDLE THE LENGTH PREFIXED TOPIC IS COPIED AS IS
+    //A COMPRESSED PAYLOAD IS WRITTEN STRAIGHT INTO THE PACKET. THE FIXED
+    //HEADER IS WRITTEN LAST (ITS LENGTH FIELD MAY SHRINK WITH THE PAYLOAD)
+    //ZERO COPY : PAYLOAD BYTES ARE COUNTED BUT NOT WRITTEN
+    //RAW : PAYLOAD WITHOUT THE 2 BYTE LENGTH PREFIX
+    //RETURN NUMBER OF BYTES WRITTEN (0 IF IT DOES NOT FIT)
+
+    uint16_t len_topic;
+    uint16_t len_compressed = 0;
+    uint32_t len_remaining;
+    uint16_t len_body;
+    uint16_t counter;
+    uint8_t len_header;
+    uint8_t* dest;
+    uint16_t alias;
+    bool alias_known;
+
+    //CALCULATE EXACT PACKET SIZE
+    len_topic = (topic_handle != NULL) ? topic_handle->topic_len : strlen(topic);
+    alias = s_esp8266_mqtt_topic_alias_get(topic_handle, &alias_known);
+    len_remaining = s_esp8266_mqtt_publish_remaining_length(topic, topic_handle, len_message, qos_level, raw);
+    //ZERO COPY : ONLY THE HEADERS GO INTO THE TX BUFFER (+ 3 AS THE REMAINING
+    //LENGTH FIELD ALSO COUNTS THE PAYLOAD)
+    dest = s_esp8266_mqtt_tx_reserve(zero_copy ? (len_remaining - len_message + 3) : len_remaining);
+    if(dest == NULL)
+    {
+        return 0;
+    }
+
+    //SPACE FOR FIXED HEADER (UNCOMPRESSED SIZE)
+    len_header = 1 + s_esp8266_mqtt_remaining_length_size(len_remaining);
+    counter = len_header;
+
+    //VARIABLE HEADER
+    if(alias_known)
+    {
+        dest[counter++] = 0;
+        dest[counter++] = 0;
+    }
+    else if(topic_handle != NULL)
+    {
+        os_memcpy(&dest[counter], topic_handle->encoded, 2 + len_topic);
+        counter += 2 + len_topic;
+    }
+    else
+    {
+        counter += s_esp8266_mqtt_insert_string(&dest[counter], topic, len_topic);
+    }
+    if(qos_level != ESP8266_MQTT_QOS_0)
+    {
+        dest[counter++] = (uint8_t)((packet_id & 0xFF00) >> 8);
+        dest[counter++] = (uint8_t)(packet_id & 0x00FF);
+    }
+    if(s_client->protocol_version == ESP8266_MQTT_PROTOCOL_VERSION_5)
+    {
+        dest[counter++] = (alias != 0) ? 3 : 0;
+        if(alias != 0)
+        {
+            dest[counter++] = ESP8266_MQTT_PROPERTY_TOPIC_ALIAS;
+            dest[counter++] = (uint8_t)((alias & 0xFF00) >> 8);
+            dest[counter++] = (uint8_t)(alias & 0x00FF);
+
+            //NEW ALIAS. BROKER LEARNS IT FROM THIS PACKET
+            topic_handle->alias = alias;
+            s_client->topic_alias_handles[alias - 1] = topic_handle;
+        }
+    }
+
+    //PAYLOAD
+    //COMPRESSED ONLY IF IT COMES OUT SMALLER THAN THE ORIGINAL. NEVER A RAW
+    //(BINARY) ONE : IT MAY START WITH THE COMPRESSION MARKER BYTE (0x00)
+    if(zero_copy)
+    {
+        dest[counter++] = (uint8_t)((len_message & 0xFF00) >> 8);
+        dest[counter++] = (uint8_t)(len_message & 0x00FF);
+    }
+    else if(!raw && s_client->flag_compress && len_message >= s_client->compress_threshold)
+    {
+        len_compressed = ESP8266_MQTT_COMPRESS_Encode((uint8_t*)message,
+                                                        len_message,
+                                                        &dest[counter + 2],
+                                                        len_message - 1);
+    }
+    if(zero_copy)
+    {
+        //PAYLOAD FOLLOWS AS ITS OWN TX SEGMENT
+    }
+    else if(len_compressed != 0)
+    {
+        ESP8266_MQTT_LOG_DEBUG("PUBLISH payload compressed %u -> %u", len_message, len_compressed);
+        dest[counter++] = (uint8_t)((len_compressed & 0xFF00) >> 8);
+        dest[counter++] = (uint8_t)(len_compressed & 0x00FF);
+        counter += len_compressed;
+    }
+    else if(raw)
+    {
+        os_memcpy(&dest[counter], message, len_message);
+        counter += len_message;
+    }
+    else
+    {
+        counter += s_esp8266_mqtt_insert_string(&dest[counter], message, len_message);
+    }
+
+    //FIXED HEADER
+    len_body = counter - len_header;
+    len_remaining = len_body + (zero_copy ? len_message : 0);
+    if((1 + s_esp8266_mqtt_remaining_length_size(len_remaining)) < len_header)
+    {
+        os_memmove(&dest[1 + s_esp8266_mqtt_remaining_length_size(len_remaining)], &dest[len_header], len_body);
+        len_header = 1 + s_esp8266_mqtt_remaining_length_size(len_remaining);
+    }
+    s_esp8266_mqtt_insert_fixed_header(dest,
+                                        (ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBLISH << 4) |
+                                        ESP8266_MQTT_CONTROL_PACKET_FLAG_PUBLISH |
+                                        (dup ? 0x08 : 0x00) |
+                                        (qos_level << 1) |
+                                        (s_client->flag_retain ? 0x01 : 0x00),
+                                        len_remaining);
+    return (len_header + len_body);
+}
+
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_next_packet_id(void)
+{
+    //RETURN A NEW PACKET ID
+    //SKIPS 0, IDS STILL IN USE BY IN-FLIGHT MESSAGES AND RESTORED IDS NOT
+    //RELEASED YET (ESP8266_MQTT_CLIENT_Resume)
+
+    do
+    {
+        s_client->mqtt_message_id++;
+        if(s_client->mqtt_message_id == 0)
+        {
+            s_client->mqtt_message_id = 1;
+        }
+    }while(s_esp8266_mqtt_inflight_find(s_client->mqtt_message_id) != NULL ||
+            s_esp8266_mqtt_resume_find(s_client->mqtt_message_id) >= 0);
+    return s_client->mqtt_message_id;
+}
+
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_send_subscribe(char* topic_filter,
+                                                            uint16_t len_filter,
+                                                            uint8_t qos_level,
+                                                            bool unsubscribe)
+{
+    //SEND A SUBSCRIBE (OR UNSUBSCRIBE) PACKET FOR ONE TOPIC FILTER
+    //REPLY (SUBACK / UNSUBACK) IS PASSED TO THE USER DATA RECEIVE CB
+    //RETURN FALSE IF IT DOES NOT FIT THE TX BUFFER
+
+    uint32_t len_remaining;
+    uint16_t packet_id;
+    uint16_t counter;
+    uint8_t* dest;
+
+    //VARIABLE HEADER : PACKET ID (2) [+ PROPERTIES (MQTT 5)]
+    //PAYLOAD : FILTER (2 + LEN) + REQUESTED QOS (1, SUBSCRIBE ONLY)
+    len_remaining = 2 + 2 + len_filter + (unsubscribe ? 0 : 1);
+    if(s_client->protocol_version == ESP8266_MQTT_PROTOCOL_VERSION_5)
+    {
+        //EMPTY PROPERTIES
+        len_remaining += 1;
+    }
+    dest = s_esp8266_mqtt_tx_reserve(len_remaining);
+    if(dest == NULL)
+    {
+        return false;
+    }
+    packet_id = s_esp8266_mqtt_next_packet_id();
+
+    if(unsubscribe)
+    {
+        counter = s_esp8266_mqtt_insert_fixed_header(dest,
+                                                        (ESP8266_MQTT_CONTROL_PACKET_TYPE_UNSUBSCRIBE << 4) |
+                                                        ESP8266_MQTT_CONTROL_PACKET_FLAG_UNSUBSCRIBE,
+                                                        len_remaining);
+    }
+    else
+    {
+        counter = s_esp8266_mqtt_insert_fixed_header(dest,
+                                                        (ESP8266_MQTT_CONTROL_PACKET_TYPE_SUBSCRIBE << 4) |
+                                                        ESP8266_MQTT_CONTROL_PACKET_FLAG_SUBSCRIBE,
+                                                        len_remaining);
+    }
+    dest[counter++] = (uint8_t)((packet_id & 0xFF00) >> 8);
+    dest[counter++] = (uint8_t)(packet_id & 0x00FF);
+    if(s_client->protocol_version == ESP8266_MQTT_PROTOCOL_VERSION_5)
+    {
+        dest[counter++] = 0;
+    }
+    counter += s_esp8266_mqtt_insert_string(&dest[counter], topic_filter, len_filter);
+    if(!unsubscribe)
+    {
+        dest[counter++] = qos_level;
+    }
+    ESP8266_MQTT_LOG_DEBUG(unsubscribe ? "UNSUBSCRIBE packet created. id %u" : "SUBSCRIBE packet created. id %u", packet_id);
+
+    //SEND PACKET
+    s_esp8266_mqtt_send_packet(counter, true);
+    return true;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_resubscribe_cb(void* arg,
+                                                            char* topic_filter,
+                                                            uint16_t len_filter,
+                                                            uint8_t qos_level)
+{
+    //SUBSCRIPTION TRIE WALK CB
+
+    s_esp8266_mqtt_send_subscribe(topic_filter, len_filter, qos_level, false);
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_resubscribe(void)
+{
+    //SEND SUBSCRIBE FOR EVERY REGISTERED TOPIC FILTER (AFTER CONNACK)
+    //FILTER TEXT IS REBUILT FROM THE TRIE INTO A TEMPORARY BUFFER
+
+    char* buffer;
+
+    if(s_client->subscriptions.child == NULL)
+    {
+        return;
+    }
+    buffer = (char*)os_malloc(s_client->buffer_size);
+    if(buffer == NULL)
+    {
+        return;
+    }
+    s_esp8266_mqtt_stats_heap(s_client->buffer_size);
+    ESP8266_MQTT_TOPIC_TRIE_Walk(&s_client->subscriptions, buffer, s_client->buffer_size, s_esp8266_mqtt_resubscribe_cb, NULL);
+    os_free(buffer);
+    s_esp8266_mqtt_stats_heap(-(int32_t)s_client->buffer_size);
+}
+
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_stream_start(bool dup)
+{
+    //SERIALIZE THE HEADERS OF THE STREAMED PUBLISH (REMAINING LENGTH COUNTS
+    //THE WHOLE PAYLOAD) AND START PULLING THE PAYLOAD
+    //RETURN FALSE IF THE HEADERS DO NOT FIT
+
+    uint16_t len_topic = strlen(s_client->stream_topic);
+    uint32_t len_headers;
+    uint16_t counter;
+    uint8_t* dest;
+
+    //HEADERS + FIRST CHUNK NEED 2 FREE TX SEGMENTS
+    if(s_client->tx_flush_pending || (s_client->tx_segment_count + 2) > ESP8266_MQTT_CLIENT_TX_SEGMENTS_MAX)
+    {
+        return false;
+    }
+
+    len_headers = 2 + len_topic + ((s_client->stream_qos != ESP8266_MQTT_QOS_0) ? 2 : 0) +
+                    ((s_client->protocol_version == ESP8266_MQTT_PROTOCOL_VERSION_5) ? 1 : 0);
+
+    //+ 3 AS THE REMAINING LENGTH FIELD ALSO COUNTS THE PAYLOAD
+    dest = s_esp8266_mqtt_tx_reserve(len_headers + 3);
+    if(dest == NULL)
+    {
+        return false;
+    }
+    counter = s_esp8266_mqtt_insert_fixed_header(dest,
+                                                    (ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBLISH << 4) |
+                                                    ESP8266_MQTT_CONTROL_PACKET_FLAG_PUBLISH |
+                                                    (dup ? 0x08 : 0x00) |
+                                                    (s_client->stream_qos << 1) |
+                                                    (s_client->flag_retain ? 0x01 : 0x00),
+                                                    len_headers + s_client->stream_len);
+    counter += s_esp8266_mqtt_insert_string(&dest[counter], s_client->stream_topic, len_topic);
+    if(s_client->stream_qos != ESP8266_MQTT_QOS_0)
+    {
+        dest[counter++] = (uint8_t)((s_client->stream_packet_id & 0xFF00) >> 8);
+        dest[counter++] = (uint8_t)(s_client->stream_packet_id & 0x00FF);
+    }
+    if(s_client->protocol_version == ESP8266_MQTT_PROTOCOL_VERSION_5)
+    {
+        dest[counter++] = 0;
+    }
+    ESP8266_MQTT_LOG_INFO("PUBLISH stream %u bytes. id %u", s_client->stream_len, s_client->stream_packet_id);
+
+    //HEADERS GO OUT FIRST. ANY OTHER PACKET WAITS UNTIL THE PAYLOAD IS QUEUED
+    s_esp8266_mqtt_send_packet(counter, false);
+    s_client->stream_offset = 0;
+    s_client->stream_sending = true;
+    return true;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_stream_next(void)
+{
+    //PULL THE NEXT PAYLOAD CHUNK AND QUEUE IT
+    //ONCE THE WHOLE PAYLOAD IS QUEUED, PACKETS WAITING IN THE TX BUFFER FOLLOW
+
+    uint32_t remaining;
+    uint16_t len;
+
+    if(!s_client->stream_sending)
+    {
+        return;
+    }
+    remaining = s_client->stream_len - s_client->stream_offset;
+    if(remaining == 0)
+    {
+        s_client->stream_sending = false;
+        if(s_client->stream_qos == ESP8266_MQTT_QOS_0)
+        {
+            s_esp8266_mqtt_stream_end(true);
+        }
+        else
         {
-            if(s_esp8266_mqtt_client_debug)
+            //REPLY TIMEOUT COUNTS FROM THE END OF THE PAYLOAD
+            esp8266_mqtt_inflight_entry_t* entry = s_esp8266_mqtt_inflight_find(s_client->stream_packet_id);
+            if(entry != NULL)
             {
-                os_printf("ESP8266 MQTT_CLIENT : Error ! Will topic not provided\n");
+                entry->sent_time_us = system_get_time();
             }
-            return;
         }
-        len_payload += s_esp8266_mqtt_insert_string(&buffer_payload[len_payload], 
-                                                    s_will_topic, 
-                                                    strlen(s_will_topic));
+        s_esp8266_mqtt_tx_flush();
+        return;
+    }
+
+    len = (*s_client->stream_read_cb)(s_client->stream_cb_arg,
+                                s_client->stream_offset,
+                                s_client->stream_chunk,
+                                (remaining < s_client->buffer_size) ? remaining : s_client->buffer_size);
+    if(len == 0 || len > remaining || len > s_client->buffer_size)
+    {
+        //PACKET CANNOT BE COMPLETED. ONLY WAY OUT IS TO DROP THE CONNECTION
+        ESP8266_MQTT_LOG_WARN("PUBLISH stream read failed at %u", s_client->stream_offset);
+        s_client->stream_sending = false;
+        (*s_client->transport->disconnect)(s_client->transport_ctx);
+        return;
+    }
+    s_client->stream_offset += len;
+    s_esp8266_mqtt_tx_queue_segment(s_client->stream_chunk, len, s_esp8266_mqtt_stream_chunk_sent_cb, NULL);
+    s_esp8266_mqtt_tx_pump();
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_stream_chunk_sent_cb(void* arg)
+{
+    //CHUNK SENT (TX SEGMENT RELEASED). CHUNK BUFFER IS FREE FOR THE NEXT ONE
+
+    s_esp8266_mqtt_stream_next();
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_stream_end(bool success)
+{
+    //STREAM DONE. FREE THE CHUNK BUFFER AND CALL THE COMPLETION CB
+    //(QOS 1 / 2 COMPLETION CB IS CALLED BY THE IN-FLIGHT ENTRY INSTEAD)
+
+    void (*complete_cb)(void*, bool) = s_client->stream_complete_cb;
+
+    s_client->stream_active = false;
+    s_client->stream_sending = false;
+    s_client->stream_complete_cb = NULL;
+    if(s_client->stream_chunk != NULL)
+    {
+        os_free(s_client->stream_chunk);
+        s_client->stream_chunk = NULL;
+        s_esp8266_mqtt_stats_heap(-(int32_t)s_client->buffer_size);
+    }
+    if(complete_cb != NULL)
+    {
+        (*complete_cb)(s_client->stream_cb_arg, success);
+    }
+}
+
+static uint8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_inflight_limit(void)
+{
+    //RETURN THE MAXIMUM NUMBER OF QOS 1 / 2 MESSAGES IN FLIGHT
+    //MQTT 5 : CAPPED TO THE BROKER RECEIVE MAXIMUM
+
+    if(s_client->protocol_version == ESP8266_MQTT_PROTOCOL_VERSION_5 && s_client->server_receive_max < s_client->inflight_window)
+    {
+        return (uint8_t)s_client->server_receive_max;
+    }
+    return s_client->inflight_window;
+}
+
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_topic_alias_get(esp8266_mqtt_topic_handle_t* topic_handle, bool* alias_known)
+{
+    //RETURN THE MQTT 5 TOPIC ALIAS TO USE FOR THE TOPIC HANDLE (0 = NONE)
+    //alias_known IS SET IF THE BROKER ALREADY HAS THE ALIAS -> TOPIC MAPPING
+    //OTHERWISE A FREE ALIAS (WITHIN THE BROKER TOPIC ALIAS MAXIMUM) IS RETURNED
+
+    uint16_t i;
+    uint16_t limit;
+
+    *alias_known = false;
+    if(s_client->protocol_version != ESP8266_MQTT_PROTOCOL_VERSION_5 || topic_handle == NULL)
+    {
+        return 0;
+    }
+    if(topic_handle->alias != 0)
+    {
+        *alias_known = true;
+        return topic_handle->alias;
+    }
+    limit = (s_client->server_topic_alias_max < ESP8266_MQTT_CLIENT_TOPIC_ALIAS_MAX) ? s_client->server_topic_alias_max :
+                                                                                ESP8266_MQTT_CLIENT_TOPIC_ALIAS_MAX;
+    for(i = 0; i < limit; i++)
+    {
+        if(s_client->topic_alias_handles[i] == NULL)
+        {
+            return (i + 1);
+        }
+    }
+    return 0;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_topic_alias_reset(void)
+{
+    //FORGET ALL TOPIC ALIASES (THEY ONLY LIVE AS LONG AS THE CONNECTION)
+
+    uint8_t i;
+
+    for(i = 0; i < ESP8266_MQTT_CLIENT_TOPIC_ALIAS_MAX; i++)
+    {
+        if(s_client->topic_alias_handles[i] != NULL)
+        {
+            s_client->topic_alias_handles[i]->alias = 0;
+            s_client->topic_alias_handles[i] = NULL;
+        }
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_report_reason(esp8266_mqtt_client_packet_type_t ptype,
+                                                            uint16_t packet_id,
+                                                            uint8_t reason_code)
+{
+    //CALL USER REASON CODE CB IF NOT NULL
+
+    if(s_client->reason_cb != NULL)
+    {
+        (*s_client->reason_cb)(ptype, packet_id, reason_code);
+    }
+}
+
+static esp8266_mqtt_inflight_entry_t* ICACHE_FLASH_ATTR s_esp8266_mqtt_inflight_alloc(void)
+{
+    //RESERVE A FREE IN-FLIGHT SLOT AND ASSIGN IT A NEW PACKET ID
+    //RETURN NULL IF THE WINDOW IS FULL
+
+    uint8_t i;
+    esp8266_mqtt_inflight_entry_t* entry = NULL;
+
+    if(s_client->inflight_count >= s_esp8266_mqtt_inflight_limit())
+    {
+        return NULL;
+    }
+    for(i = 0; i < ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX; i++)
+    {
+        if(s_client->inflight[i].state == ESP8266_MQTT_INFLIGHT_STATE_FREE)
+        {
+            entry = &s_client->inflight[i];
+            break;
+        }
+    }
+    if(entry == NULL)
+    {
+        return NULL;
+    }
+
+    entry->packet_id = s_esp8266_mqtt_next_packet_id();
+    entry->state = ESP8266_MQTT_INFLIGHT_STATE_RESERVED;
+    s_client->inflight_count++;
+    return entry;
+}
+
+static esp8266_mqtt_inflight_entry_t* ICACHE_FLASH_ATTR s_esp8266_mqtt_inflight_find(uint16_t packet_id)
+{
+    //RETURN THE IN-FLIGHT ENTRY USING THE SPECIFIED PACKET ID (NULL IF NONE)
+
+    uint8_t i;
+
+    for(i = 0; i < ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX; i++)
+    {
+        if(s_client->inflight[i].state != ESP8266_MQTT_INFLIGHT_STATE_FREE &&
+            s_client->inflight[i].packet_id == packet_id)
+        {
+            return &s_client->inflight[i];
+        }
+    }
+    return NULL;
+}
+
+static esp8266_mqtt_inflight_entry_t* ICACHE_FLASH_ATTR s_esp8266_mqtt_inflight_find_store(uint32_t store_addr)
+{
+    //RETURN THE IN-FLIGHT ENTRY SENT FROM THE SPECIFIED OFFLINE QUEUE RECORD
+    //(NULL IF NONE)
+
+    uint8_t i;
+
+    for(i = 0; i < ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX; i++)
+    {
+        if(s_client->inflight[i].state != ESP8266_MQTT_INFLIGHT_STATE_FREE &&
+            s_client->inflight[i].store_addr == store_addr)
+        {
+            return &s_client->inflight[i];
+        }
+    }
+    return NULL;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_inflight_complete(esp8266_mqtt_inflight_entry_t* entry, bool success)
+{
+    //RELEASE THE IN-FLIGHT ENTRY AND CALL ITS COMPLETION CB
+
+    void (*complete_cb)(void*, bool) = entry->complete_cb;
+    void* cb_arg = entry->cb_arg;
+    void (*release_cb)(void*) = entry->release_cb;
+    void* release_arg = entry->release_arg;
+    char* message = entry->message;
+    uint32_t store_addr = entry->store_addr;
+    uint8_t i;
+    esp8266_mqtt_tx_segment_t* segment;
+    bool stream = entry->stream;
 
-        if(!s_will_message)
+    entry->state = ESP8266_MQTT_INFLIGHT_STATE_FREE;
+    entry->stream = false;
+    entry->resend = false;
+    entry->complete_cb = NULL;
+    entry->release_cb = NULL;
+    entry->store_addr = 0;
+    s_client->inflight_count--;
+    if(s_client->inflight_count == 0)
+    {
+        os_timer_disarm(&s_client->inflight_os_timer);
+    }
+
+    //STREAM FINISHED (CHUNK BUFFER IS FREE AGAIN)
+    if(stream)
+    {
+        s_esp8266_mqtt_stream_end(success);
+    }
+    if(complete_cb != NULL)
+    {
+        (*complete_cb)(cb_arg, success);
+    }
+
+    //ZERO COPY PAYLOAD NOT NEEDED FOR RETRANSMISSION ANYMORE
+    //IF A RETRANSMISSION IS STILL QUEUED THE SEGMENT RELEASES IT ONCE SENT
+    if(release_cb != NULL)
+    {
+        for(i = 0; i < s_client->tx_segment_count; i++)
         {
-            if(s_esp8266_mqtt_client_debug)
+            segment = &s_client->tx_segments[(s_client->tx_segment_head + i) % ESP8266_MQTT_CLIENT_TX_SEGMENTS_MAX];
+            if(segment->data == (uint8_t*)message && segment->release_cb == NULL)
             {
-                os_printf("ESP8266 MQTT_CLIENT : Error ! Will message not provided\n");
+                segment->release_cb = release_cb;
+                segment->release_arg = release_arg;
+                release_cb = NULL;
+                break;
             }
+        }
+        if(release_cb != NULL)
+        {
+            (*release_cb)(release_arg);
+        }
+    }
+
+    //MESSAGE DELIVERED. WINDOW HAS ROOM FOR THE NEXT STORED ONE
+    if(success)
+    {
+        if(store_addr != 0)
+        {
+            ESP8266_MQTT_FLASH_QUEUE_Consume(store_addr);
+        }
+        s_esp8266_mqtt_store_drain();
+    }
+    s_esp8266_mqtt_send_queue_dispatch();
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_inflight_retransmit(esp8266_mqtt_inflight_entry_t* entry)
+{
+    //RESEND THE IN-FLIGHT MESSAGE WITH DUP FLAG SET
+    //QOS 2 MESSAGES ALREADY RECEIVED BY THE BROKER (PUBREC) ONLY RESEND PUBREL
+
+    uint16_t len;
+    esp8266_mqtt_flash_queue_record_t record;
+
+    entry->resend = false;
+    if(entry->state == ESP8266_MQTT_INFLIGHT_STATE_WAIT_PUBCOMP)
+    {
+        ESP8266_MQTT_LOG_DEBUG("PUBREL retransmit id %u", entry->packet_id);
+        entry->sent_time_us = system_get_time();
+        s_esp8266_mqtt_send_ack((ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBREL << 4) |
+                                    ESP8266_MQTT_CONTROL_PACKET_FLAG_PUBREL,
+                                    entry->packet_id);
+        return;
+    }
+
+    //STREAMED MESSAGE. STREAM IT AGAIN UNLESS IT IS STILL GOING OUT
+    if(entry->stream)
+    {
+        if(!s_client->stream_sending && s_esp8266_mqtt_stream_start(true))
+        {
+            ESP8266_MQTT_LOG_DEBUG("PUBLISH stream retransmit id %u", entry->packet_id);
+            entry->sent_time_us = system_get_time();
+            s_esp8266_mqtt_stream_next();
+        }
+        return;
+    }
+
+    //STORED MESSAGE. READ IT BACK FROM THE OFFLINE QUEUE
+    if(entry->store_addr != 0)
+    {
+        if(!ESP8266_MQTT_FLASH_QUEUE_ReadAt(entry->store_addr, &record, s_client->store_buffer, s_client->buffer_size))
+        {
+            s_esp8266_mqtt_inflight_complete(entry, false);
+            return;
+        }
+        entry->topic = record.topic;
+        entry->topic_handle = NULL;
+        entry->message = record.message;
+        entry->message_len = record.message_len;
+    }
+
+    //ZERO COPY PAYLOAD NEEDS 2 FREE TX SEGMENTS. TRY AGAIN FROM THE TCP SENT CB
+    if(entry->release_cb != NULL &&
+        (s_client->tx_flush_pending || (s_client->tx_segment_count + 2) > ESP8266_MQTT_CLIENT_TX_SEGMENTS_MAX))
+    {
+        entry->resend = true;
+        s_client->inflight_resend_pending = true;
+        return;
+    }
+
+    len = s_esp8266_mqtt_encode_publish(entry->topic,
+                                        entry->topic_handle,
+                                        entry->message,
+                                        entry->message_len,
+                                        entry->qos,
+                                        entry->packet_id,
+                                        true,
+                                        (entry->release_cb != NULL),
+                                        entry->raw);
+    if(len == 0)
+    {
+        if(!s_esp8266_mqtt_publish_fits(entry->topic,
+                                        entry->topic_handle,
+                                        entry->message_len,
+                                        entry->qos,
+                                        (entry->release_cb != NULL),
+                                        entry->raw))
+        {
+            //CAN NEVER BE SENT (TOO BIG)
+            s_esp8266_mqtt_inflight_complete(entry, false);
             return;
         }
-        len_payload += s_esp8266_mqtt_insert_string(&buffer_payload[len_payload], 
-                                                    s_will_message, 
-                                                    strlen(s_will_message));
+
+        //TX BUFFER BUSY. SENT AGAIN FROM THE TCP SENT CB (OR THE NEXT CHECK)
+        entry->resend = true;
+        s_client->inflight_resend_pending = true;
+        return;
+    }
+    ESP8266_MQTT_LOG_DEBUG("PUBLISH retransmit id %u", entry->packet_id);
+    entry->sent_time_us = system_get_time();
+    if(entry->release_cb != NULL)
+    {
+        s_esp8266_mqtt_send_packet(len, false);
+        s_esp8266_mqtt_tx_queue_segment((uint8_t*)entry->message, entry->message_len, NULL, NULL);
+        s_esp8266_mqtt_tx_pump();
+        return;
     }
-    if(s_flag_username)
+    s_esp8266_mqtt_send_packet(len, true);
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_inflight_retransmit_all(void)
+{
+    //RESEND ALL UNACKNOWLEDGED MESSAGES (AFTER RECONNECT)
+    //EVERY MESSAGE KEEPS ITS PACKET ID SO THE BROKER CAN DROP QOS 2 DUPLICATES.
+    //STORED MESSAGES STILL IN FLIGHT ARE SKIPPED BY THE NEXT DRAIN. MESSAGES
+    //SENT AFTER THE CONNECT (BEFORE ITS CONNACK) ALREADY WENT ON THIS CONNECTION
+    //ONCE THE TX BUFFER IS FULL THE REST WAIT FOR THE TCP SENT CB IN ORDER
+
+    uint8_t i;
+
+    s_client->inflight_resend_pending = false;
+    for(i = 0; i < ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX; i++)
     {
-        if(!s_username)
+        if(s_client->inflight[i].state > ESP8266_MQTT_INFLIGHT_STATE_RESERVED &&
+            (int32_t)(s_client->inflight[i].sent_time_us - s_client->connect_sent_us) < 0)
         {
-            if(s_esp8266_mqtt_client_debug)
+            s_client->inflight[i].retries = 0;
+            if(s_client->inflight_resend_pending)
             {
-                os_printf("ESP8266 MQTT_CLIENT : Error ! username not provided\n");
+                s_client->inflight[i].resend = true;
+                continue;
             }
-            return;
+            s_esp8266_mqtt_inflight_retransmit(&s_client->inflight[i]);
+        }
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_inflight_resend(void)
+{
+    //SEND THE RETRANSMISSIONS THAT FOUND THE TX BUFFER BUSY (TCP SENT CB)
+    //STOP AT THE FIRST ONE STILL NOT FITTING SO THEY GO OUT IN ORDER
+    //NOT COUNTED AS RETRIES
+
+    uint8_t i;
+
+    s_client->inflight_resend_pending = false;
+    for(i = 0; i < ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX && s_client->mqtt_connected; i++)
+    {
+        if(s_client->inflight[i].state > ESP8266_MQTT_INFLIGHT_STATE_RESERVED && s_client->inflight[i].resend)
+        {
+            s_esp8266_mqtt_inflight_retransmit(&s_client->inflight[i]);
+            if(s_client->inflight[i].resend)
+            {
+                break;
+            }
+        }
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_inflight_session_lost(void)
+{
+    //BROKER STARTED A NEW SESSION. A QOS 2 MESSAGE WAITING FOR PUBCOMP WAS
+    //ALREADY RECEIVED (PUBREC) AND THE BROKER NO LONGER KNOWS ITS PACKET ID
+    //SO A PUBREL WOULD NEVER BE ANSWERED. COMPLETE IT AS DELIVERED
+
+    uint8_t i;
+
+    for(i = 0; i < ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX; i++)
+    {
+        if(s_client->inflight[i].state == ESP8266_MQTT_INFLIGHT_STATE_WAIT_PUBCOMP)
+        {
+            s_esp8266_mqtt_inflight_complete(&s_client->inflight[i], true);
+        }
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_inflight_timer_cb(void* arg)
+{
+    //IN-FLIGHT TIMER CB
+    //RETRANSMIT MESSAGES NOT ACKNOWLEDGED WITHIN THE REPLY TIMEOUT. GIVE UP
+    //AFTER ESP8266_MQTT_RETRY_COUNT RETRANSMISSIONS
+
+    uint8_t i;
+    uint32_t now = system_get_time();
+    esp8266_mqtt_client_t* previous = s_esp8266_mqtt_instance_enter(arg);
+
+    //NOTHING CAN BE ACKNOWLEDGED WHILE DISCONNECTED
+    if(!s_client->mqtt_connected)
+    {
+        s_esp8266_mqtt_instance_leave(previous);
+        return;
+    }
+
+    for(i = 0; i < ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX; i++)
+    {
+        esp8266_mqtt_inflight_entry_t* entry = &s_client->inflight[i];
+
+        if(entry->state <= ESP8266_MQTT_INFLIGHT_STATE_RESERVED ||
+            (now - entry->sent_time_us) < ((uint32_t)ESP8266_MQTT_CLIENT_REPLY_TIMEOUT_MS * 1000))
+        {
+            continue;
+        }
+        if(entry->stream && s_client->stream_sending)
+        {
+            //PAYLOAD STILL GOING OUT. NO REPLY CAN BE EXPECTED YET
+            entry->sent_time_us = now;
+            continue;
+        }
+        if(entry->resend)
+        {
+            //STILL WAITING FOR TX BUFFER ROOM. NOT A RETRY
+            s_esp8266_mqtt_inflight_retransmit(entry);
+            continue;
+        }
+        if(entry->retries >= ESP8266_MQTT_RETRY_COUNT)
+        {
+            ESP8266_MQTT_LOG_WARN("PUBLISH id %u failed. No reply", entry->packet_id);
+            s_client->stats.timeouts++;
+            s_esp8266_mqtt_inflight_complete(entry, false);
+            continue;
         }
-        len_payload += s_esp8266_mqtt_insert_string(&buffer_payload[len_payload], 
-                                                    s_username, 
-                                                    strlen(s_username));
+        entry->retries++;
+        s_client->stats.retransmits++;
+        s_esp8266_mqtt_inflight_retransmit(entry);
     }
-    if(s_flag_password)
+    s_esp8266_mqtt_instance_leave(previous);
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_keepalive_start(uint32_t timeout_ms)
+{
+    //(RE)ARM THE KEEPALIVE TIMER TO FIRE AFTER THE SPECIFIED TIME
+
+    os_timer_disarm(&s_client->keepalive_os_timer);
+    os_timer_arm(&s_client->keepalive_os_timer, timeout_ms, 0);
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_keepalive_stop(void)
+{
+    //STOP KEEPALIVE + PINGRESP TIMERS
+
+    os_timer_disarm(&s_client->keepalive_os_timer);
+    os_timer_disarm(&s_client->pingresp_os_timer);
+    s_client->pingresp_pending = false;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_keepalive_timer_cb(void* arg)
+{
+    //KEEPALIVE TIMER CB
+    //SEND PINGREQ ONLY IF NOTHING HAS BEEN SENT FOR THE KEEPALIVE INTERVAL
+    //OTHERWISE REARM FOR THE REMAINING IDLE TIME
+
+    esp8266_mqtt_client_t* previous = s_esp8266_mqtt_instance_enter(arg);
+    uint32_t interval_ms = (uint32_t)s_client->keepalive_timer * 1000;
+    uint32_t idle_ms = (system_get_time() - s_client->last_tx_time_us) / 1000;
+
+    if(!s_client->mqtt_connected || interval_ms == 0)
     {
-        if(!s_password)
-        {
-            if(s_esp8266_mqtt_client_debug)
-            {
-                os_printf("ESP8266 MQTT_CLIENT : Error ! password not provided\n");
-            }
-            return;
-        }
-        len_payload += s_esp8266_mqtt_insert_string(&buffer_payload[len_payload], 
-                                                    s_password, 
-                                                    strlen(s_password));
+        s_esp8266_mqtt_instance_leave(previous);
+        return;
     }
-    
-    //CALCULATE REMAINING LENGTH (IN FIXED HEADER) FIELD
-    p.fixed_header_remaining_length_len = s_esp8266_mqtt_calculate_remaining_length(len_variable_header, 
-                                                                                    len_payload, 
-                                                                                    &p.fixed_header_remaining_length[0]);
 
-    //MAKE MQTT PACKET FROM BUFFERS
-    p.variable_header = buffer_variable_header;
-	p.variable_header_len = len_variable_header;
-	p.payload = buffer_payload;
-	p.payload_len = len_payload;
-    if(s_esp8266_mqtt_client_debug)
+    if(idle_ms + ESP8266_MQTT_CLIENT_KEEPALIVE_MARGIN_MS < interval_ms)
     {
-        os_printf("ESP8266 MQTT_CLIENT : CONNECT packet created\n");
+        s_esp8266_mqtt_keepalive_start(interval_ms - idle_ms);
+        s_esp8266_mqtt_instance_leave(previous);
+        return;
     }
 
-    //SEND PACKET
-    s_esp8266_mqtt_send_packet(p);
-    if(s_esp8266_mqtt_client_debug)
+    if(!s_client->pingresp_pending)
     {
-        os_printf("ESP8266 MQTT_CLIENT : CONNECT packet sent\n");
+        s_client->pingresp_pending = true;
+        os_timer_disarm(&s_client->pingresp_os_timer);
+        os_timer_arm(&s_client->pingresp_os_timer, ESP8266_MQTT_CLIENT_REPLY_TIMEOUT_MS, 0);
+        ESP8266_MQTT_CLIENT_Send_Pingreq();
     }
+    s_esp8266_mqtt_keepalive_start(interval_ms);
+    s_esp8266_mqtt_instance_leave(previous);
+}
 
-    //FREE BUFFER
-    os_free(buffer_variable_header);
-    os_free(buffer_payload);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_pingresp_timer_cb(void* arg)
+{
+    //PINGRESP / CONNACK TIMEOUT CB
+    //BROKER / LINK IS DEAD. TEAR DOWN AND RECONNECT
 
-    //INCREMENT MESSAGE ID
-    s_mqtt_message_id++;
+    esp8266_mqtt_client_t* previous = s_esp8266_mqtt_instance_enter(arg);
+    ESP8266_MQTT_LOG_WARN(s_client->mqtt_connected ? "PINGRESP timeout!" : "CONNACK timeout!");
+    s_client->stats.timeouts++;
+    s_esp8266_mqtt_session_reconnect();
+    s_esp8266_mqtt_instance_leave(previous);
 }
 
-void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_Publish(char* topic,
-														char* message,
-                                                        esp8266_mqtt_qos_t qos_level)
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_session_reconnect(void)
 {
-    //SEND MQTT PUBLISH PACKET
+    //TEAR DOWN THE CURRENT TCP CONNECTION AND SCHEDULE A RECONNECT
+    //CONNECT PACKET IS SENT AUTOMATICALLY ONCE TCP CONNECTS
 
-    //ONLY QOS = 0 or 1 SUPPORTED
-    if(qos_level != ESP8266_MQTT_QOS_0 && qos_level != ESP8266_MQTT_QOS_1)
+    if(!s_client->flag_persistent || !s_client->session_active)
     {
-        os_printf("ESP8266 MQTT_CLIENT : PUBLISH Fail. Only Qos 0 or 1 supported\n");
         return;
     }
 
-    s_current_packet_type = ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBLISH;
+    s_client->session_reconnecting = true;
+    s_client->mqtt_connected = false;
+    s_client->session_present = false;
+    s_esp8266_mqtt_keepalive_stop();
+    (*s_client->transport->disconnect)(s_client->transport_ctx);
+    s_esp8266_mqtt_reconnect_schedule();
+}
 
-    esp8266_mqtt_packet_t p;
-    uint16_t len_variable_header = 0;
-    uint16_t len_payload = 0;
-    uint8_t* buffer_variable_header;
-    uint8_t* buffer_payload;
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_reconnect_schedule(void)
+{
+    //ARM THE RECONNECT TIMER WITH THE NEXT BACKOFF DELAY
+    //min << attempt CAPPED TO max, THEN RANDOMIZED TO 50 - 100% (JITTER)
+    //NOTHING TO DO IF AN ATTEMPT IS ALREADY SCHEDULED
 
-    //STORE DATA REFERENCE
-    s_last_topic = topic;
-    s_last_message = message;
-    s_last_qos = qos_level;
+    uint32_t min_ms = (s_client->reconnect_min_ms != 0) ? s_client->reconnect_min_ms : ESP8266_MQTT_CLIENT_RECONNECT_DELAY_MS;
+    uint32_t max_ms = (s_client->reconnect_max_ms != 0) ? s_client->reconnect_max_ms : ESP8266_MQTT_CLIENT_RECONNECT_DELAY_MAX_MS;
+    uint32_t delay_ms = min_ms;
+    uint8_t i;
 
-    //GENERATE PACKET
-    buffer_variable_header = (uint8_t*)os_zalloc(ESP8266_MQTT_VARIABLE_HEADER_MAX_SIZE);
-    buffer_payload = (uint8_t*)os_zalloc(s_buffer_size - ESP8266_MQTT_VARIABLE_HEADER_MAX_SIZE);
+    if(s_client->reconnect_pending)
+    {
+        return;
+    }
 
-    //FIXED HEADER
-    p.fixed_header_byte1 = (ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBLISH << 4) | 
-                            ESP8266_MQTT_CONTROL_PACKET_FLAG_PUBLISH |
-                            (qos_level << 1);
-    
-    //VARIABLE HEADER
-    len_variable_header += s_esp8266_mqtt_insert_string(&buffer_variable_header[len_variable_header],
-                                                        topic,
-                                                        strlen(topic));
-    buffer_variable_header[len_variable_header] = (uint8_t)((s_mqtt_message_id & 0xFF00) >> 8);
-    len_variable_header++;
-    buffer_variable_header[len_variable_header] = (uint8_t)(s_mqtt_message_id & 0x00FF);
-    len_variable_header++;
+    for(i = 0; i < s_client->reconnect_attempt && delay_ms < max_ms; i++)
+    {
+        delay_ms <<= 1;
+    }
+    if(delay_ms > max_ms)
+    {
+        delay_ms = max_ms;
+    }
+    delay_ms = (delay_ms / 2) + (os_random() % ((delay_ms / 2) + 1));
+    if(s_client->reconnect_attempt < 0xFF)
+    {
+        s_client->reconnect_attempt++;
+    }
 
-    //PAYLOAD
-    len_payload += s_esp8266_mqtt_insert_string(&buffer_payload[len_payload],
-                                                        message,
-                                                        strlen(message));
+    ESP8266_MQTT_LOG_INFO("Reconnect attempt %u in %u ms", s_client->reconnect_attempt, delay_ms);
+    s_client->reconnect_pending = true;
+    os_timer_disarm(&s_client->reconnect_os_timer);
+    os_timer_arm(&s_client->reconnect_os_timer, delay_ms, 0);
+}
 
-    //CALCULATE REMAINING LENGTH (IN FIXED HEADER) FIELD
-    p.fixed_header_remaining_length_len = s_esp8266_mqtt_calculate_remaining_length(len_variable_header, 
-                                                                                    len_payload, 
-                                                                                    &p.fixed_header_remaining_length[0]);
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_connack_retryable(uint8_t return_code)
+{
+    //RETURN TRUE IF A CONNACK REFUSAL IS TEMPORARY (WORTH RETRYING LATER)
+    //MQTT 3.x RETURN CODE / MQTT 5 REASON CODE
 
-    //MAKE MQTT PACKET FROM BUFFERS
-    p.variable_header = buffer_variable_header;
-	p.variable_header_len = len_variable_header;
-	p.payload = buffer_payload;
-	p.payload_len = len_payload;
-    if(s_esp8266_mqtt_client_debug)
+    if(s_client->protocol_version != ESP8266_MQTT_PROTOCOL_VERSION_5)
     {
-        os_printf("ESP8266 MQTT_CLIENT : PUBLISH packet created\n");
-        os_printf("ESP8266 MQTT_CLIENT : topic : %s\n", topic);
-        os_printf("ESP8266 MQTT_CLIENT : message :%s\n", message);
+        return (return_code == ESP8266_MQTT_CONNACK_REFUSED_SERVER_UNAVAILABLE);
     }
-
-    //SEND PACKET
-    s_esp8266_mqtt_send_packet(p);
-    if(s_esp8266_mqtt_client_debug)
+    switch(return_code)
     {
-        os_printf("ESP8266 MQTT_CLIENT : PUBLISH packet sent\n");
+        case 0x80:  //UNSPECIFIED ERROR
+        case 0x83:  //IMPLEMENTATION SPECIFIC ERROR
+        case 0x88:  //SERVER UNAVAILABLE
+        case 0x89:  //SERVER BUSY
+        case 0x97:  //QUOTA EXCEEDED
+        case 0x9C:  //USE ANOTHER SERVER
+        case 0x9D:  //SERVER MOVED
+        case 0x9F:  //CONNECTION RATE EXCEEDED
+            return true;
+        default:
+            return false;
     }
+}
 
-    //FREE BUFFER
-    os_free(buffer_variable_header);
-    os_free(buffer_payload);
-
-    //INCREMENT MESSAGE ID
-    s_mqtt_message_id++;
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_reconnect_timer_cb(void* arg)
+{
+    //RECONNECT TIMER CB
+    //RESOLVE THE HOST NAME AGAIN (NOT FROM THE CACHE) IF THE LAST ATTEMPTS
+    //FAILED. THE ADDRESS MAY HAVE CHANGED
 
-    //QOS = 0
-    //NO PUBACK WILL BE RECEIVED
-    //CALL THE TCP DATA RECEIVE CB FUNCTION RIGHT AWAY WITH NULL DATA
-    //SET RETRY COUNT TO ESP8266_MQTT_RETRY_COUNT SO NO MORE TRIES ARE ATTEMPTED
+    esp8266_mqtt_client_t* previous = s_esp8266_mqtt_instance_enter(arg);
 
-    if(qos_level == ESP8266_MQTT_QOS_0)
+    s_client->reconnect_pending = false;
+    if(s_client->session_active && s_client->session_reconnecting)
     {
-        if(s_esp8266_mqtt_client_debug)
+        ESP8266_MQTT_LOG_INFO("Reconnecting...");
+        s_client->stats.reconnects++;
+        if(s_client->dns_host_hash != 0 &&
+            (s_client->reconnect_attempt % ESP8266_MQTT_CLIENT_RECONNECT_RESOLVE_AFTER) == 0)
+        {
+            s_esp8266_mqtt_dns_cache_drop();
+            s_client->reconnect_resolving = true;
+            ESP8266_MQTT_CLIENT_ResolveHostName();
+        }
+        else
         {
-            os_printf("ESP8266 MQTT_CLIENT : PUBLISH done as Qos = 0. No PUBACK expected\n");
+            s_esp8266_mqtt_stats_start(ESP8266_MQTT_STATS_STAGE_TCP_CONNECT);
+            (*s_client->transport->connect)(s_client->transport_ctx);
         }
-        s_esp8266_mqtt_client_receive_cb(NULL, 0);
     }
+    s_esp8266_mqtt_instance_leave(previous);
 }
 
-void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_Pingreq(void)
+static int8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_resume_find(uint16_t packet_id)
 {
-    //SEND MQTT PINGREQ PACKET
+    //RETURN INDEX OF THE RESTORED PACKET ID (-1 IF NOT FOUND)
 
-    esp8266_mqtt_packet_t p;
+    uint8_t i;
 
-    //FIXED HEADER
-    p.fixed_header_byte1 = (ESP8266_MQTT_CONTROL_PACKET_TYPE_PINGREQ << 4) | 
-                            ESP8266_MQTT_CONTROL_PACKET_FLAG_PINGREQ;
-    p.fixed_header_remaining_length[0] = 0;
-    p.fixed_header_remaining_length_len = 1;
+    for(i = 0; i < s_client->resume_count; i++)
+    {
+        if(s_client->resume_ids[i] == packet_id)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
 
-    //VARIABLE HEADER
-    //NONE
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_resume_release(uint16_t packet_id)
+{
+    //RELEASE A RESTORED PACKET ID (ACKNOWLEDGED). LAST ONE TAKES ITS PLACE
+    //RETURN FALSE IF IT IS NOT A RESTORED ONE
 
-    //PAYLOAD
-    //NONE
+    int8_t index = s_esp8266_mqtt_resume_find(packet_id);
+    uint8_t last;
 
-    //MAKE MQTT PACKET FROM BUFFERS
-    p.variable_header = NULL;
-	p.variable_header_len = 0;
-	p.payload = NULL;
-	p.payload_len = 0;
-    if(s_esp8266_mqtt_client_debug)
+    if(index < 0)
+    {
+        return false;
+    }
+    last = --s_client->resume_count;
+    s_client->resume_ids[index] = s_client->resume_ids[last];
+    s_client->resume_qos2 &= ~(1UL << index);
+    if(s_client->resume_qos2 & (1UL << last))
     {
-        os_printf("ESP8266 MQTT_CLIENT : PINGREQ packet created\n");
+        s_client->resume_qos2 |= (1UL << index);
     }
+    s_client->resume_qos2 &= ~(1UL << last);
+    return true;
+}
 
-    //SEND PACKET
-    s_esp8266_mqtt_send_packet(p);
-    if(s_esp8266_mqtt_client_debug)
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_resume_connected(bool session_lost)
+{
+    //CONNACK WITH RESTORED PACKET IDS
+    //BROKER SESSION GONE : NOTHING LEFT TO RELEASE. OTHERWISE QOS 1 IDS ARE
+    //FREE AGAIN (PAYLOADS DID NOT SURVIVE THE SLEEP) AND QOS 2 IDS GET A PUBREL
+    //SO THE BROKER FORGETS THEM (RELEASED ON PUBCOMP)
+
+    uint8_t i = 0;
+
+    if(session_lost)
+    {
+        s_client->resume_count = 0;
+        s_client->resume_qos2 = 0;
+        return;
+    }
+    while(i < s_client->resume_count)
     {
-        os_printf("ESP8266 MQTT_CLIENT : PINGREQ packet sent\n");
+        if(!(s_client->resume_qos2 & (1UL << i)))
+        {
+            s_esp8266_mqtt_resume_release(s_client->resume_ids[i]);
+            continue;
+        }
+        s_esp8266_mqtt_send_ack((ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBREL << 4) |
+                                    ESP8266_MQTT_CONTROL_PACKET_FLAG_PUBREL,
+                                    s_client->resume_ids[i]);
+        i++;
     }
 }
 
-void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_Disconnect(void)
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_stats_start(esp8266_mqtt_stats_stage_t stage)
 {
-    //SEND MQTT DISCONNECT PACKET
+    //START TIMING A STAGE (RESTARTS IT IF ALREADY RUNNING)
 
-    esp8266_mqtt_packet_t p;
+    s_client->stats_start_us[stage] = system_get_time();
+    s_client->stats_running |= (1 << stage);
+}
 
-    //FIXED HEADER
-    p.fixed_header_byte1 = (ESP8266_MQTT_CONTROL_PACKET_TYPE_DISCONNECT << 4) | 
-                            ESP8266_MQTT_CONTROL_PACKET_FLAG_DISCONNECT;
-    p.fixed_header_remaining_length[0] = 0;
-    p.fixed_header_remaining_length_len = 1;
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_stats_stop(esp8266_mqtt_stats_stage_t stage)
+{
+    //STOP TIMING A STAGE AND RECORD ITS LATENCY (NOTHING IF NOT RUNNING)
 
-    //VARIABLE HEADER
-    //NONE
+    if(s_client->stats_running & (1 << stage))
+    {
+        s_client->stats_running &= ~(1 << stage);
+        s_esp8266_mqtt_stats_record(stage, system_get_time() - s_client->stats_start_us[stage]);
+    }
+}
 
-    //PAYLOAD
-    //NONE
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_stats_record(esp8266_mqtt_stats_stage_t stage, uint32_t elapsed_us)
+{
+    //ADD ONE LATENCY SAMPLE TO THE STAGE TOTALS + HISTOGRAM
 
-    //MAKE MQTT PACKET FROM BUFFERS
-    p.variable_header = NULL;
-	p.variable_header_len = 0;
-	p.payload = NULL;
-	p.payload_len = 0;
-    if(s_esp8266_mqtt_client_debug)
+    esp8266_mqtt_stats_latency_t* latency = &s_client->stats.latency[stage];
+    uint32_t elapsed_ms = elapsed_us / 1000;
+    uint8_t i = 0;
+
+    while(i < (ESP8266_MQTT_CLIENT_STATS_BUCKETS - 1) && elapsed_ms >= s_esp8266_mqtt_stats_bucket_ms[i])
+    {
+        i++;
+    }
+    if(latency->buckets[i] < 0xFFFF)
+    {
+        latency->buckets[i]++;
+    }
+    latency->count++;
+    latency->total_ms += elapsed_ms;
+    if(elapsed_ms > latency->max_ms)
     {
-        os_printf("ESP8266 MQTT_CLIENT : DISCONNECT packet created\n");
+        latency->max_ms = elapsed_ms;
     }
+}
 
-    //SEND PACKET
-    s_esp8266_mqtt_send_packet(p);
-    if(s_esp8266_mqtt_client_debug)
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_stats_heap(int32_t delta)
+{
+    //ACCOUNT FOR MEMORY ALLOCATED (+) / FREED (-) BY THE CLIENT
+
+    s_client->stats.heap_used += delta;
+    if(s_client->stats.heap_used > s_client->stats.heap_peak)
     {
-        os_printf("ESP8266 MQTT_CLIENT : DISCONNECT packet sent\n");
+        s_client->stats.heap_peak = s_client->stats.heap_used;
     }
 }
 
-//INTERNAL FUNCTIONS
-static void ICACHE_FLASH_ATTR s_esp8266_mqtt_print_packet(uint8_t* packet, uint16_t len)
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_stats_format(char* dest)
 {
-    //PRINT MQTT PACKET
-    //AS HEX BYTES ON TERMINAL
+    //WRITE THE STATS AS JSON. RETURN LENGTH
+    //LATENCY : "stage":[COUNT,TOTAL MS,MAX MS,[BUCKETS]]
+    //SEND QUEUE : "queue":[DEPTH,PEAK,SENT,EXPIRED,DROPPED,CONFLATED]
+    //WORST CASE FITS ESP8266_MQTT_CLIENT_STATS_PAYLOAD_MAX
 
-    uint16_t counter;
-    for(counter = 0; counter < len; counter++)
+    esp8266_mqtt_stats_t* stats = &s_client->stats;
+    esp8266_mqtt_stats_latency_t* latency;
+    uint16_t len;
+    uint8_t i;
+    uint8_t j;
+
+    len = os_sprintf(dest,
+                        "{\"tx\":%u,\"rx\":%u,\"txp\":%u,\"rxp\":%u,\"retx\":%u,\"reconn\":%u,\"tmo\":%u,\"heap\":%u,\"heap_peak\":%u,\"lat\":{",
+                        stats->bytes_sent,
+                        stats->bytes_received,
+                        stats->packets_sent,
+                        stats->packets_received,
+                        stats->retransmits,
+                        stats->reconnects,
+                        stats->timeouts,
+                        stats->heap_used,
+                        stats->heap_peak);
+    for(i = 0; i < ESP8266_MQTT_STATS_STAGE_COUNT; i++)
     {
-        if((counter % 8) == 0)
+        latency = &stats->latency[i];
+        len += os_sprintf(&dest[len],
+                            "%s\"%s\":[%u,%u,%u,[",
+                            (i == 0) ? "" : ",",
+                            s_esp8266_mqtt_stats_stage_names[i],
+                            latency->count,
+                            latency->total_ms,
+                            latency->max_ms);
+        for(j = 0; j < ESP8266_MQTT_CLIENT_STATS_BUCKETS; j++)
         {
-            os_printf("\n");
+            len += os_sprintf(&dest[len], (j == 0) ? "%u" : ",%u", latency->buckets[j]);
         }
-        os_printf("%02X ", packet[counter]);
+        len += os_sprintf(&dest[len], "]]");
     }
-    os_printf("\n\n");
+    len += os_sprintf(&dest[len],
+                        "},\"queue\":[%u,%u,%u,%u,%u,%u]}",
+                        stats->queue_depth,
+                        stats->queue_peak,
+                        stats->queue_sent,
+                        stats->queue_expired,
+                        stats->queue_dropped,
+                        stats->queue_conflated);
+    return len;
 }
 
-static uint8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_insert_string(uint8_t* dest_buff, char* src_buff, uint8_t len)
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_stats_timer_cb(void* arg)
 {
-    //PROCESS MQTT STRING
-    //INSERT INTO SPECIFIED BUFFER LOCATION + PREPEND 2 BYTES FOR STRING LENGTH
-    //AS MQTT REQUIRES
+    //STATS PUBLISH TIMER CB
+    //NOTHING IS SENT (OR QUEUED OFFLINE) WHILE NOT CONNECTED
 
-    os_strncpy(&dest_buff[2], src_buff, len);
-    dest_buff[0] = (uint8_t)((len & 0xFF00) >> 8);
-    dest_buff[1] = (uint8_t)(len & 0x00FF);
+    esp8266_mqtt_client_t* previous = s_esp8266_mqtt_instance_enter(arg);
+    char* buffer;
 
-    return (len+2);
+    if(s_client->stats_topic == NULL || !s_client->mqtt_connected)
+    {
+        s_esp8266_mqtt_instance_leave(previous);
+        return;
+    }
+    buffer = (char*)os_malloc(ESP8266_MQTT_CLIENT_STATS_PAYLOAD_MAX);
+    if(buffer == NULL)
+    {
+        s_esp8266_mqtt_instance_leave(previous);
+        return;
+    }
+    s_esp8266_mqtt_stats_heap(ESP8266_MQTT_CLIENT_STATS_PAYLOAD_MAX);
+    s_esp8266_mqtt_stats_format(buffer);
+    ESP8266_MQTT_CLIENT_Send_PublishWithCb(s_client->stats_topic, buffer, ESP8266_MQTT_QOS_0, NULL, NULL);
+    os_free(buffer);
+    s_esp8266_mqtt_stats_heap(-(int32_t)ESP8266_MQTT_CLIENT_STATS_PAYLOAD_MAX);
+    s_esp8266_mqtt_instance_leave(previous);
 }
 
-static uint8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_calculate_remaining_length(uint16_t len_variable_header, uint16_t len_payload, uint8_t* ptr_remaining_length)
+static esp8266_mqtt_client_t* ICACHE_FLASH_ATTR s_esp8266_mqtt_instance_enter(void* client)
 {
-    //CALCULATE THE REMAINING LENGTH FIELD (IN FIXED HEADER) USING VARIABLE HEADER LENGTH &
-    //PAYLOAD LENGTH USING MQTT SUPPLIED ALGORITHM
+    //MAKE THE INSTANCE AN EVENT CB BELONGS TO THE SELECTED ONE WHILE THE CB RUNS
+    //(client IS THE TIMER / TRANSPORT CB ARG). RETURN THE INSTANCE TO RESTORE
+    //WITH s_esp8266_mqtt_instance_leave
 
-    uint8_t byte;
-    uint8_t counter = 0;
-    uint16_t len_total = len_variable_header + len_payload;
+    esp8266_mqtt_client_t* previous = s_client;
 
-    do
+    if(client != NULL)
     {
-        byte = len_total % 128;
-        len_total = len_total / 128;
-        if(len_total > 0)
-        {
-            byte = byte | 0x80;
-        }
-        ptr_remaining_length[counter] = byte;
-        counter++;
-    }while(len_total > 0);
-    return counter;
+        s_client = (esp8266_mqtt_client_t*)client;
+    }
+    return previous;
 }
 
-static void ICACHE_FLASH_ATTR s_esp8266_mqtt_send_packet(esp8266_mqtt_packet_t packet)
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_instance_leave(esp8266_mqtt_client_t* previous)
 {
-    //SEND THE PROVIDED MQTT PAKCET THROUGH TCP LAYER
-
-    //ASSEMBLE THE PACKET
-    uint8_t* assembled_blob = (uint8_t*)os_zalloc(s_buffer_size);
-    uint16_t counter= 0;
+    //RESTORE THE INSTANCE SELECTED BEFORE THE EVENT CB RAN
 
-    assembled_blob[0] = packet.fixed_header_byte1;
-    counter = 1;
-    os_memcpy(&assembled_blob[counter], packet.fixed_header_remaining_length, packet.fixed_header_remaining_length_len);
-    counter += packet.fixed_header_remaining_length_len;
-
-    os_memcpy(&assembled_blob[counter], packet.variable_header, packet.variable_header_len);
-    counter += packet.variable_header_len;
+    s_client = previous;
+}
 
-    os_memcpy(&assembled_blob[counter], packet.payload, packet.payload_len);
-    counter += packet.payload_len;
+static uint32_t ICACHE_FLASH_ATTR s_esp8266_mqtt_hash(const uint8_t* data, uint16_t len)
+{
+    //FNV-1A HASH (HOST NAME KEY / RTC RECORD CHECKSUM / SEND QUEUE TOPIC KEY)
+    //NEVER RETURNS 0 (0 = NO HOST NAME)
 
-    //PRINT PACKET
-    ESP8266_TCP_GENERIC_SendAndGetReply(assembled_blob, counter);
+    uint32_t hash = 2166136261u;
 
-    if(s_esp8266_mqtt_client_debug)
+    while(len--)
     {
-        s_esp8266_mqtt_print_packet(assembled_blob, counter);
-        os_printf("ESP8266 MQTT_CLIENT : Packet sent!\n");
+        hash ^= *data++;
+        hash *= 16777619u;
     }
-    os_free(assembled_blob);
+    return (hash != 0) ? hash : 1;
 }
 
-esp8266_mqtt_client_packet_type_t ICACHE_FLASH_ATTR s_esp8266_mqtt_parse_response_packet(uint8_t* packet, uint16_t len)
+static uint32_t ICACHE_FLASH_ATTR s_esp8266_mqtt_dns_cache_age(void)
 {
-    //PARSE THE RESPONSE MQTT PACKET
+    //RETURN AGE OF THE CACHED ADDRESS IN SECONDS
 
-    //BYTE 0 : MESSAGE TYPE + FLAGS
-    if(s_esp8266_mqtt_client_debug)
+    return s_client->dns_age_offset_s + (system_get_time() - s_client->dns_resolved_time_us) / 1000000;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_dns_cache_load(void)
+{
+    //LOAD THE CACHED ADDRESS FROM RTC MEMORY (IF ANY, INTACT AND FOR THE
+    //HOST NAME GIVEN TO ESP8266_MQTT_CLIENT_Initialize)
+
+    esp8266_mqtt_dns_cache_record_t record;
+
+    if(s_client->dns_rtc_block == 0 ||
+        s_client->dns_host_hash == 0 ||
+        !system_rtc_mem_read(s_client->dns_rtc_block, &record, sizeof(record)))
     {
-        os_printf("ESP8266 MQTT_CLIENT : packet type = %u ", (packet[0] & 0xF0) >> 4);
+        return;
     }
-    switch((packet[0] & 0xF0) >> 4)
+    if(record.magic != ESP8266_MQTT_CLIENT_DNS_CACHE_MAGIC ||
+        record.checksum != s_esp8266_mqtt_hash((uint8_t*)&record, sizeof(record) - 4) ||
+        record.ttl_left_s == 0 ||
+        record.host_hash != s_client->dns_host_hash)
     {
-        case ESP8266_MQTT_CONTROL_PACKET_TYPE_CONNACK:
-            if(s_esp8266_mqtt_client_debug)
-            {
-                os_printf("CONNACK\n");
-            }
-            break;
-            
-        case ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBACK:
-            if(s_esp8266_mqtt_client_debug)
-            {
-                os_printf("PUBACK\n");
-            }
-            break;
+        return;
+    }
 
-        case ESP8266_MQTT_CONTROL_PACKET_TYPE_PINGRESP:
-            if(s_esp8266_mqtt_client_debug)
-            {
-                os_printf("PINGRESP\n");
-            }
-            break;
+    s_client->dns_ip.addr = record.ip;
+    s_client->dns_resolved_time_us = system_get_time();
+    s_client->dns_age_offset_s = (record.ttl_left_s < s_client->dns_ttl_s) ?
+                                    (s_client->dns_ttl_s - record.ttl_left_s) : 0;
+    s_client->dns_valid = true;
+    ESP8266_MQTT_LOG_INFO("DNS cache loaded %d.%d.%d.%d", IP2STR(&s_client->dns_ip));
+}
 
-        default:
-            //NOT A MQTT PACKET
-            if(s_esp8266_mqtt_client_debug)
-            {
-                os_printf("ESP8266 MQTT_CLIENT : Malformed packet!\n");
-            }
-            return ESP8266_MQTT_CONTROL_PACKET_TYPE_INVALID;
-            break;
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_dns_cache_save(uint32_t sleep_s)
+{
+    //WRITE THE CACHED ADDRESS TO RTC MEMORY WITH ITS REMAINING TTL
+    //(LESS sleep_s). AN ENTRY THAT EXPIRES BEFORE WAKE UP IS STILL WRITTEN
+    //WITH 1S LEFT SO IT IS USED (AND REFRESHED) RATHER THAN WAITED ON
+
+    esp8266_mqtt_dns_cache_record_t record;
+    uint32_t age = s_esp8266_mqtt_dns_cache_age() + sleep_s;
+
+    if(s_client->dns_rtc_block == 0)
+    {
+        return;
     }
-    if(s_esp8266_mqtt_client_debug)
+    record.magic = ESP8266_MQTT_CLIENT_DNS_CACHE_MAGIC;
+    record.host_hash = s_client->dns_host_hash;
+    record.ip = s_client->dns_ip.addr;
+    record.ttl_left_s = (age < s_client->dns_ttl_s) ? (s_client->dns_ttl_s - age) : 1;
+    record.checksum = s_esp8266_mqtt_hash((uint8_t*)&record, sizeof(record) - 4);
+    system_rtc_mem_write(s_client->dns_rtc_block, &record, sizeof(record));
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_dns_cache_drop(void)
+{
+    //FORGET THE CACHED ADDRESS (RAM + RTC MEMORY)
+
+    esp8266_mqtt_dns_cache_record_t record;
+
+    s_client->dns_valid = false;
+    s_client->dns_refresh = false;
+    if(s_client->dns_rtc_block != 0)
     {
-        os_printf("ESP8266 MQTT_CLIENT : packet flags 0x%02X !\n", (packet[0] & 0x0F));
+        os_memset(&record, 0, sizeof(record));
+        system_rtc_mem_write(s_client->dns_rtc_block, &record, sizeof(record));
     }
+}
 
-    //BYTE 1 : REMAINING LENGTH
-    if(s_esp8266_mqtt_client_debug)
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_dns_cache_timer_cb(void* arg)
+{
+    //CACHED ADDRESS CB (POSTED BY ESP8266_MQTT_CLIENT_ResolveHostName)
+    //POINT THE TRANSPORT AT THE CACHED ADDRESS AND REPORT IT LIKE A DNS RESULT
+
+    esp8266_mqtt_client_t* previous = s_esp8266_mqtt_instance_enter(arg);
+
+    if(s_client->dns_valid)
     {
-        os_printf("ESP8266 MQTT_CLIENT : remaining length 0x%02X !\n", packet[1]);
+        ESP8266_MQTT_LOG_INFO(s_client->dns_refresh ? "DNS cache hit (expired)" : "DNS cache hit");
+        (*s_client->transport->set_host_ip)(s_client->transport_ctx, &s_client->dns_ip);
+        s_client->host_ip = s_client->dns_ip;
+        s_client->dns_from_cache = true;
+        s_client->dns_background = false;
+        s_esp8266_mqtt_dns_report(&s_client->dns_ip);
     }
+    s_esp8266_mqtt_instance_leave(previous);
+}
 
-    //BYTE 3, BYTE 4 : VARIABLE HEADER
-    //ONLY IF CONNACK PACKET TYPE
-    if(((packet[0] & 0xF0) >> 4) == ESP8266_MQTT_CONTROL_PACKET_TYPE_CONNACK)
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_dns_report(ip_addr_t* ipAddr)
+{
+    //REPORT A HOST NAME RESOLUTION RESULT TO THE USER DNS CB
+    //(OR CONTINUE A LIBRARY DRIVEN RECONNECT WITH IT)
+
+    if(s_client->reconnect_resolving)
     {
-        if(s_esp8266_mqtt_client_debug)
+        s_client->reconnect_resolving = false;
+        if(ipAddr != NULL)
         {
-            os_printf("ESP8266 MQTT_CLIENT : packet return code 0x%02X %s!\n", packet[3], s_packet_return_code[packet[3]]);
+            s_esp8266_mqtt_stats_start(ESP8266_MQTT_STATS_STAGE_TCP_CONNECT);
+            (*s_client->transport->connect)(s_client->transport_ctx);
         }
+        else
+        {
+            s_esp8266_mqtt_reconnect_schedule();
+        }
+        return;
     }
 
-    //RETURN PACKET TYPE
-    return ((packet[0] & 0xF0) >> 4);
+    if(ipAddr == NULL)
+    {
+        ESP8266_MQTT_LOG_WARN("DNS Failed!");
+    }
+    else
+    {
+        ESP8266_MQTT_LOG_INFO("DNS Resolved %d.%d.%d.%d!", IP2STR(ipAddr));
+    }
+
+    if(s_client->dns_cb_function != NULL)
+    {
+        (*s_client->dns_cb_function)(ipAddr);
+    }
 }
 
-static void ICACHE_FLASH_ATTR s_esp8266_mqtt_client_dns_found_cb(ip_addr_t* ipAddr)
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_client_dns_found_cb(void* arg, ip_addr_t* ipAddr)
 {
     //DNS CB
-    if(ipAddr == NULL)
+    //FRESH ADDRESSES GO INTO THE CACHE. BACKGROUND REFRESH RESULTS ARE NOT
+    //REPORTED (USER ALREADY CONNECTED WITH THE CACHED ADDRESS)
+
+    esp8266_mqtt_client_t* previous = s_esp8266_mqtt_instance_enter(arg);
+
+    if(ipAddr != NULL)
     {
-        if(s_esp8266_mqtt_client_debug)
-        {
-            os_printf("ESP8266 MQTT_CLIENT : DNS Failed!\n");
-        }
+        s_esp8266_mqtt_stats_stop(ESP8266_MQTT_STATS_STAGE_DNS);
+        s_client->host_ip = *ipAddr;
     }
-    else
+    s_client->stats_running &= ~(1 << ESP8266_MQTT_STATS_STAGE_DNS);
+
+    if(ipAddr != NULL && s_client->flag_dns_cache)
     {
-        if(s_esp8266_mqtt_client_debug)
-        {
-            os_printf("ESP8266 MQTT_CLIENT : DNS Resolved %d.%d.%d.%d!\n", IP2STR(ipAddr));
-        }
+        s_client->dns_ip = *ipAddr;
+        s_client->dns_resolved_time_us = system_get_time();
+        s_client->dns_age_offset_s = 0;
+        s_client->dns_valid = true;
+        s_esp8266_mqtt_dns_cache_save(0);
+    }
+
+    if(s_client->dns_background)
+    {
+        s_client->dns_background = false;
+        ESP8266_MQTT_LOG_INFO((ipAddr != NULL) ? "DNS cache refreshed" : "DNS cache refresh failed");
     }
-    
-    if(s_esp8266_mqtt_client_dns_found_cb)
+    else
     {
-        (*s_esp8266_mqtt_client_dns_cb_function)(ipAddr);
+        s_esp8266_mqtt_dns_report(ipAddr);
     }
-
+    s_esp8266_mqtt_instance_leave(previous);
 }
 
 static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_conn_cb(void* arg)
 {
     //TCP CONNECT CB
 
-    //CALL USER TCP CONN CB FUNCTION IF NOT NULL
-    if(s_esp8266_mqtt_client_tcp_conn_cb_function)
+    esp8266_mqtt_client_t* previous = s_esp8266_mqtt_instance_enter(arg);
+
+    //NEW CONNECTION. NOTHING PARTIALLY RECEIVED YET
+    s_esp8266_mqtt_stats_stop(ESP8266_MQTT_STATS_STAGE_TCP_CONNECT);
+    s_esp8266_mqtt_rx_reset();
+    s_client->tcp_connected = true;
+    s_client->dns_from_cache = false;
+
+    //CACHED ADDRESS HAS EXPIRED. RE-RESOLVE WHILE THE CONNECTION IS USED
+    if(s_client->dns_refresh)
+    {
+        s_client->dns_refresh = false;
+        s_client->dns_background = true;
+        s_esp8266_mqtt_stats_start(ESP8266_MQTT_STATS_STAGE_DNS);
+        (*s_client->transport->resolve_host_name)(s_client->transport_ctx);
+    }
+
+    //LIBRARY INITIATED RECONNECT OF A PERSISTENT SESSION
+    //SEND CONNECT DIRECTLY. USER IS NOTIFIED THROUGH CONNACK
+    if(s_client->session_reconnecting)
+    {
+        ESP8266_MQTT_CLIENT_Send_Connect();
+    }
+    else if(s_client->tcp_conn_cb_function)
+    {
+        //CALL USER TCP CONN CB FUNCTION IF NOT NULL
+        (*s_client->tcp_conn_cb_function)();
+    }
+    s_esp8266_mqtt_instance_leave(previous);
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tcp_discon_cb(void* arg)
+{
+    //TCP DISCONNECT CB
+
+    esp8266_mqtt_client_t* previous = s_esp8266_mqtt_instance_enter(arg);
+
+    //COALESCED PACKETS / SEGMENTS WAITING CANNOT BE SENT ANYMORE
+    s_esp8266_mqtt_tx_reset();
+    s_esp8266_mqtt_rx_reset();
+    s_client->mqtt_connected = false;
+    s_client->session_present = false;
+    s_esp8266_mqtt_keepalive_stop();
+    s_esp8266_mqtt_topic_alias_reset();
+
+    //NO REPLY CAN ARRIVE ON THIS CONNECTION ANYMORE. A FAILED CONNECT IS NOT
+    //A LATENCY SAMPLE
+    s_client->stats_running &= (1 << ESP8266_MQTT_STATS_STAGE_DNS);
+
+    //CONNECT TO A CACHED ADDRESS FAILED. IT MAY BE STALE. DROP IT AND
+    //RESOLVE AGAIN (USER GETS THE FRESH ADDRESS THROUGH THE DNS CB)
+    //(A LIBRARY DRIVEN RECONNECT RESOLVES AGAIN BY ITSELF)
+    if(!s_client->tcp_connected && s_client->dns_from_cache && !s_client->session_reconnecting)
     {
-        (*s_esp8266_mqtt_client_tcp_conn_cb_function)();
+        ESP8266_MQTT_LOG_WARN("Connect to cached address failed. Resolving");
+        s_esp8266_mqtt_dns_cache_drop();
+        s_client->dns_from_cache = false;
+        s_client->dns_background = false;
+        s_esp8266_mqtt_stats_start(ESP8266_MQTT_STATS_STAGE_DNS);
+        (*s_client->transport->resolve_host_name)(s_client->transport_ctx);
+    }
+    s_client->tcp_connected = false;
+
+    //PERSISTENT SESSION LOST WITHOUT USER REQUEST OR RECONNECT ATTEMPT
+    //FAILED. (TRY TO) RECONNECT
+    if(s_client->flag_persistent && s_client->session_active)
+    {
+        if(!s_client->session_reconnecting)
+        {
+            ESP8266_MQTT_LOG_WARN("TCP connection lost!");
+        }
+        s_client->session_reconnecting = true;
+        s_esp8266_mqtt_reconnect_schedule();
     }
+    s_esp8266_mqtt_instance_leave(previous);
 }
 
 static void ICACHE_FLASH_ATTR s_esp8266_mqtt_client_send_cb(void* arg)
 {
     //DATA SEND CB
-    if(s_esp8266_mqtt_client_data_send_cb != NULL)
+    //SEGMENT HANDED TO THE TRANSPORT IS SENT. RELEASE IT AND SEND THE NEXT ONE
+
+    esp8266_mqtt_tx_segment_t segment;
+    esp8266_mqtt_client_t* previous = s_esp8266_mqtt_instance_enter(arg);
+
+    if(s_client->tx_sending && s_client->tx_segment_count > 0)
+    {
+        segment = s_client->tx_segments[s_client->tx_segment_head];
+        s_client->tx_segment_head = (s_client->tx_segment_head + 1) % ESP8266_MQTT_CLIENT_TX_SEGMENTS_MAX;
+        s_client->tx_segment_count--;
+        s_client->tx_sending = false;
+
+        //NO SEGMENT LEFT. TX BUFFER BYTES NOT YET QUEUED MOVE TO THE FRONT
+        if(s_client->tx_segment_count == 0 && s_client->tx_queued > 0)
+        {
+            os_memmove(s_client->tx_buffer, &s_client->tx_buffer[s_client->tx_queued], s_client->tx_len - s_client->tx_queued);
+            s_client->tx_len -= s_client->tx_queued;
+            s_client->tx_queued = 0;
+        }
+        if(segment.release_cb != NULL)
+        {
+            (*segment.release_cb)(segment.release_arg);
+        }
+        if(s_client->tx_flush_pending)
+        {
+            s_esp8266_mqtt_tx_flush();
+        }
+        else
+        {
+            s_esp8266_mqtt_tx_pump();
+        }
+        if(s_client->inflight_resend_pending)
+        {
+            s_esp8266_mqtt_inflight_resend();
+        }
+        if(s_client->store_drain_pending)
+        {
+            s_esp8266_mqtt_store_drain();
+        }
+        s_esp8266_mqtt_send_queue_dispatch();
+    }
+
+    if(s_client->data_send_cb != NULL)
     {
-        (*s_esp8266_mqtt_client_data_send_cb)(arg);
+        (*s_client->data_send_cb)(arg);
     }
-    return;
+    s_esp8266_mqtt_instance_leave(previous);
 }
 
-static void ICACHE_FLASH_ATTR s_esp8266_mqtt_client_receive_cb(char* pusrdata, unsigned short length)
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_client_receive_cb(void* arg, char* pusrdata, unsigned short length)
 {
     //DATA RECV CB
 
+    esp8266_mqtt_client_t* previous = s_esp8266_mqtt_instance_enter(arg);
     if(!pusrdata)
     {
-        if(s_esp8266_mqtt_client_debug && s_current_packet_type != ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBLISH)
+        if(s_client->current_packet_type != ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBLISH)
         {
-            os_printf("ESP8266 MQTT_CLIENT : reply timeout!\n");
+            ESP8266_MQTT_LOG_WARN("reply timeout!");
         }
         //CALL USER CB IF NOT NULL
-        if(s_esp8266_mqtt_client_data_recv_cb != NULL)
+        if(s_client->data_recv_cb != NULL)
         {
-            (*s_esp8266_mqtt_client_data_recv_cb)(ESP8266_MQTT_CONTROL_PACKET_TYPE_INVALID, NULL, 0);
+            (*s_client->data_recv_cb)(ESP8266_MQTT_CONTROL_PACKET_TYPE_INVALID, NULL, 0);
         }
     }
     else
     {
-        if(s_esp8266_mqtt_client_debug)
-        {
-            os_printf("ESP8266 MQTT_CLIENT : Data received!\n");
-        }
-        //PARSE MQTT PACKET
-        esp8266_mqtt_client_packet_type_t ptype = s_esp8266_mqtt_parse_response_packet(pusrdata, length);
-        //CALL USER CB IF NOT NULL
-        if(s_esp8266_mqtt_client_data_recv_cb != NULL)
-        {
-            (*s_esp8266_mqtt_client_data_recv_cb)(ptype, pusrdata, length);
-        }
+        ESP8266_MQTT_LOG_DEBUG("Data received!");
+        s_client->stats.bytes_received += length;
+        //PARSE + DISPATCH ALL COMPLETE MQTT PACKETS
+        s_esp8266_mqtt_rx_feed((uint8_t*)pusrdata, length);
     }
+    s_esp8266_mqtt_instance_leave(previous);
 }
\ No newline at end of file
@@ -3,17 +3,180 @@
 *
 * NOTE
 * -----
-*   (1) DOES NOT PROVIDE SUBSCRIBE FUNCTIONALITY. THIS LIB IS ONLY FOR SENDING
-*       MESSAGES
+*   (1) SUBSCRIBE (ESP8266_MQTT_CLIENT_Subscribe) REGISTERS A HANDLER PER TOPIC
+*       FILTER ('+' / '#' WILDCARDS ALLOWED). RECEIVED PUBLISH MESSAGES ARE
+*       ROUTED THROUGH A TOPIC LEVEL TRIE (ESP8266_MQTT_TOPIC_TRIE) TO EVERY
+*       MATCHING HANDLER. RECEIVED QOS 1 / 2 MESSAGES ARE ACKNOWLEDGED
+*       AUTOMATICALLY (QOS 2 MESSAGES ARE HANDED TO THE HANDLERS ONLY ONCE)
 *
-*   (2) DOES NOT PROVIDE PING FUNCTIONALITY AS THE IDEA IS THAT THE CLIENT WILL
-*       NOT NEED TO CONNECT TO MQTT BROKER FOR EXTENDED PERIOD OF TIME. IT WILL
-*       CONNECT, PUBLISH THE MESSAGE AND DISCONNECT
+*   (2) BY DEFAULT THE IDEA IS THAT THE CLIENT WILL NOT NEED TO CONNECT TO MQTT
+*       BROKER FOR EXTENDED PERIOD OF TIME. IT WILL CONNECT, PUBLISH THE MESSAGE
+*       AND DISCONNECT
 *
-*   (3) ONLY SUPPORTS QOS = 0 BECAUSE OF POINT (2). THE FUNCTIONALITY PROVIDED
-*       IS FIRE AND FORGET
+*       PERSISTENT SESSION MODE (ESP8266_MQTT_CLIENT_SetPersistentSession) KEEPS
+*       THE TCP CONNECTION OPEN. PINGREQ IS SENT AUTOMATICALLY WHEN THE LINK HAS
+*       BEEN IDLE FOR THE KEEPALIVE INTERVAL. A MISSING PINGRESP OR A DROPPED TCP
+*       CONNECTION CAUSES AN AUTOMATIC RECONNECT (TCP + CONNECT)
 *
-*   (4) FREE ONLINE MQTT BROKER
+*       RECONNECT ATTEMPTS BACK OFF EXPONENTIALLY (DOUBLING FROM THE MINIMUM UP
+*       TO THE MAXIMUM DELAY, ESP8266_MQTT_CLIENT_SetReconnectBackoff) WITH
+*       RANDOM JITTER (50 - 100% OF THE DELAY) SO A FLEET DOES NOT RECONNECT IN
+*       LOCKSTEP. THE HOST NAME IS RESOLVED AGAIN AFTER
+*       ESP8266_MQTT_CLIENT_RECONNECT_RESOLVE_AFTER FAILED ATTEMPTS. A MISSING
+*       CONNACK OR A REFUSED ONE WITH A TEMPORARY CODE (SERVER UNAVAILABLE /
+*       BUSY ...) IS RETRIED. A PERMANENT REFUSAL (BAD CREDENTIALS, NOT
+*       AUTHORIZED ...) ENDS THE SESSION. ESP8266_MQTT_CLIENT_Connect RUNS THE
+*       WHOLE DNS -> TCP -> CONNECT CHAIN THIS WAY. THE USER IS NOTIFIED
+*       THROUGH THE CONNACK PASSED TO THE RECEIVE CB
+*
+*       IF THE BROKER STILL HAS THE SESSION (SESSION PRESENT) SUBSCRIPTIONS ARE
+*       NOT SENT AGAIN. ONLY UNACKNOWLEDGED MESSAGES ARE REPLAYED EITHER WAY
+*
+*   (3) SUPPORTS QOS = 0 (FIRE AND FORGET), QOS = 1 AND QOS = 2 (EXACTLY ONCE,
+*       PUBLISH -> PUBREC -> PUBREL -> PUBCOMP). UP TO
+*       ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX QOS 1 / 2 MESSAGES CAN BE IN
+*       FLIGHT AT ONCE, EACH TRACKED BY PACKET ID. UNACKNOWLEDGED MESSAGES ARE
+*       RETRANSMITTED WITH THE DUP FLAG SET (PUBREL ONCE PUBREC IS RECEIVED)
+*
+*   (4) OPTIONAL FLASH BACKED OFFLINE QUEUE (ESP8266_MQTT_FLASH_QUEUE). PUBLISHES
+*       MADE WHILE NOT CONNECTED ARE STORED AND SENT IN ORDER ONCE CONNECTED.
+*       IF THE QUEUE FILLS UP ITS OLDEST SECTOR IS DROPPED. STORED MESSAGES IN IT
+*       THAT ARE STILL IN FLIGHT THEN COMPLETE WITH FALSE. FOR A STORED PUBLISH
+*       (ANY QOS) complete_cb(true) MEANS STORED : IT IS CALLED RIGHT AWAY AND
+*       NOT AGAIN ON PUBACK / PUBCOMP. A PUBLISH TOO BIG TO BE SENT FROM THE
+*       QUEUE LATER (CLIENT BUFFER SIZE) IS REFUSED INSTEAD OF STORED
+*
+*   (5) TOPICS PUBLISHED TO REPEATEDLY CAN BE REGISTERED ONCE
+*       (ESP8266_MQTT_CLIENT_RegisterTopic). THE HANDLE CACHES THE LENGTH
+*       PREFIXED TOPIC SO ESP8266_MQTT_CLIENT_Send_PublishHandle ONLY COPIES
+*       PRECOMPUTED BYTES (NO strlen / RE-ENCODING PER PUBLISH)
+*
+*   (6) ALL NETWORK I/O GOES THROUGH A TRANSPORT OPERATIONS TABLE
+*       (esp8266_mqtt_transport_t). THE DEFAULT IS THE ESP8266_TCP_GENERIC
+*       LIBRARY. ESP8266_MQTT_CLIENT_SetTransport REPLACES IT (EG WITH THE
+*       ESP8266_MQTT_TLS TRANSPORT, OR A MOCK TO EXERCISE / MEASURE THE
+*       ENCODER + PARSER WITHOUT A NETWORK). EVERY
+*       OPERATION GETS THE TRANSPORT CONTEXT OF THE INSTANCE SO ONE TRANSPORT
+*       CAN SERVE SEVERAL CONNECTIONS
+*
+*   (7) PROTOCOL VERSION IS SELECTABLE (ESP8266_MQTT_CLIENT_SetProtocolVersion)
+*       3.1 ("MQIsdp", DEFAULT), 3.1.1 OR 5.0. IN MQTT 5 MODE
+*       - PUBLISHES TO A TOPIC HANDLE USE A TOPIC ALIAS (UP TO THE BROKER TOPIC
+*         ALIAS MAXIMUM). AFTER THE FIRST PUBLISH ONLY THE 2 BYTE ALIAS IS SENT
+*       - THE IN-FLIGHT WINDOW IS CAPPED TO THE BROKER RECEIVE MAXIMUM
+*       - REASON CODES OF CONNACK / PUBACK / PUBREC / PUBREL / PUBCOMP /
+*         SUBACK / UNSUBACK / DISCONNECT ARE PASSED TO THE REASON CODE CB
+*         (ESP8266_MQTT_CLIENT_SetReasonCodeCallback)
+*
+*   (8) OPTIONAL PAYLOAD COMPRESSION (ESP8266_MQTT_CLIENT_SetCompression). PUBLISH
+*       PAYLOADS OF AT LEAST THE THRESHOLD SIZE ARE SENT LZ COMPRESSED
+*       (ESP8266_MQTT_COMPRESS, MARKER HEADER + LZF STREAM) IF THAT MAKES THEM
+*       SMALLER. ESP8266_MQTT_COMPRESS_GetStats GIVES THE BYTES SAVED / CPU TIME.
+*       BINARY PAYLOADS (NOTE 16) ARE NEVER COMPRESSED
+*
+*   (9) OUTGOING BYTES GO THROUGH A QUEUE OF SEGMENTS HANDED TO THE TRANSPORT
+*       ONE AT A TIME. THE NEXT SEGMENT IS SENT FROM THE TCP SENT CB. PACKETS
+*       ARE SERIALIZED INTO THE CLIENT TX BUFFER (CLIENT OWNED SEGMENTS). A
+*       PAYLOAD PUBLISHED WITH ESP8266_MQTT_CLIENT_Send_PublishRef IS QUEUED
+*       AS A SEGMENT POINTING AT THE CALLER BUFFER (NEVER COPIED) AND HANDED
+*       BACK THROUGH ITS RELEASE CB ONCE NO LONGER NEEDED. WHILE THE TX BUFFER
+*       IS HELD BY SEGMENTS NOT YET SENT, PACKETS THAT DO NOT FIT FAIL
+*
+*   (10) PAYLOADS LARGER THAN THE CLIENT BUFFER ARE SENT WITH
+*       ESP8266_MQTT_CLIENT_Send_PublishStream. THE TOTAL LENGTH IS GIVEN UP
+*       FRONT AND THE PAYLOAD IS PULLED FROM A READ CB IN CHUNKS (UP TO BUFFER
+*       SIZE) AS THE TCP SENT CB FREES THE PREVIOUS ONE. ONE STREAM AT A TIME.
+*       OTHER PACKETS WAIT IN THE TX BUFFER UNTIL THE STREAM IS SENT. QOS 1 / 2
+*       STREAMS ARE RETRANSMITTED BY READING THE PAYLOAD AGAIN FROM OFFSET 0
+*
+*   (11) SEVERAL CLIENT INSTANCES (BROKER CONNECTIONS) CAN BE USED AT ONCE. ALL
+*       STATE OF A CONNECTION LIVES IN A CALLER OWNED esp8266_mqtt_client_t
+*       (ESP8266_MQTT_CLIENT_InitInstance). ESP8266_MQTT_CLIENT_Select PICKS THE
+*       INSTANCE THE OTHER FUNCTIONS ACT ON (A BUILT IN DEFAULT INSTANCE IS
+*       SELECTED AT START SO SINGLE CONNECTION CODE IS UNCHANGED). USER CBS RUN
+*       WITH THEIR OWN INSTANCE SELECTED. EACH INSTANCE NEEDS ITS OWN TRANSPORT
+*       CONNECTION. ESP8266_TCP_GENERIC HANDLES ONE, SO THE DEFAULT TRANSPORT
+*       BELONGS TO THE FIRST INSTANCE INITIALIZED ON IT. INITIALIZE OF ANY OTHER
+*       INSTANCE STILL ON THE DEFAULT TRANSPORT LOGS AN ERROR AND LEAVES IT
+*       UNUSABLE (GIVE IT ITS OWN WITH ESP8266_MQTT_CLIENT_SetTransport FIRST).
+*       TOPIC HANDLES BELONG TO THE INSTANCE THEY ARE PUBLISHED ON. THE OFFLINE
+*       QUEUE IS AVAILABLE TO ONE INSTANCE. ESP8266_MQTT_POOL ROUTES PUBLISHES
+*       ACROSS INSTANCES
+*
+*   (12) OPTIONAL DNS CACHE (ESP8266_MQTT_CLIENT_SetDnsCache). THE BROKER ADDRESS
+*       IS REMEMBERED FOR ttl_s SECONDS (AND OPTIONALLY KEPT IN RTC MEMORY
+*       ACROSS DEEP SLEEP). ESP8266_MQTT_CLIENT_ResolveHostName THEN REPORTS
+*       THE CACHED ADDRESS THROUGH THE DNS CB RIGHT AWAY (NO DNS ROUND TRIP).
+*       AN EXPIRED ADDRESS IS STILL USED AND RE-RESOLVED IN THE BACKGROUND ONCE
+*       CONNECTED. IF A CONNECT TO A CACHED ADDRESS FAILS THE ENTRY IS DROPPED
+*       AND A FRESH RESOLVE IS STARTED (RESULT THROUGH THE DNS CB AS USUAL).
+*       THE RTC TIMER RESTARTS ON DEEP SLEEP WAKE SO SLEEP TIME CANNOT BE
+*       MEASURED. PASS IT TO ESP8266_MQTT_CLIENT_SaveDnsCache BEFORE SLEEPING
+*
+*   (13) EVERY INSTANCE KEEPS ALWAYS ON STATS (ESP8266_MQTT_CLIENT_GetStats)
+*       - LATENCY OF DNS RESOLUTION, TCP CONNECT, CONNECT -> CONNACK,
+*         PUBLISH -> FIRST ACK (PUBACK / PUBREC) AND PINGREQ -> PINGRESP AS
+*         COUNT / TOTAL / MAX + A FIXED BUCKET HISTOGRAM (UPPER BOUNDS 10, 25,
+*         50, 100, 250, 500, 1000 MS, LAST BUCKET = SLOWER). BUCKETS SATURATE
+*       - BYTES / PACKETS SENT AND RECEIVED, RETRANSMISSIONS, RECONNECT
+*         ATTEMPTS, REPLY TIMEOUTS (CONNACK / PINGRESP / PUBLISH GIVEN UP)
+*       - HEAP HELD BY THE CLIENT (TX / RX / OFFLINE QUEUE / STREAM BUFFERS,
+*         TOPIC HANDLES) NOW AND AT PEAK. SUBSCRIPTION TRIE NODES NOT COUNTED
+*       - SEND QUEUE DEPTH (NOW / PEAK) AND ITS SENT / EXPIRED / DROPPED /
+*         CONFLATED COUNTS
+*       ESP8266_MQTT_CLIENT_SetStatsPublish PUBLISHES THEM AS JSON (QOS 0)
+*       TO A METRICS TOPIC EVERY interval_ms WHILE CONNECTED
+*
+*   (14) ESP8266_MQTT_CLIENT_Send_PublishQueued PUTS THE PUBLISH IN A SMALL RAM
+*       SEND QUEUE WITH A PRIORITY CLASS AND AN OPTIONAL DEADLINE INSTEAD OF
+*       SENDING IT RIGHT AWAY. QUEUED PUBLISHES ARE HANDED OUT ONLY WHILE
+*       CONNECTED AND WHEN NO TX SEGMENT IS WAITING BEHIND THE ONE BEING SENT,
+*       HIGHEST PRIORITY FIRST (IN CALL ORDER WITHIN A PRIORITY). A QOS 1 / 2
+*       PUBLISH ALSO WAITS FOR IN-FLIGHT WINDOW ROOM (A QOS 0 ONE CAN PASS
+*       IT). A PUBLISH STILL QUEUED WHEN ITS DEADLINE PASSES IS DROPPED UNSENT.
+*       WHEN THE QUEUE IS FULL A NEW PUBLISH PUSHES OUT THE OLDEST ONE OF A
+*       LOWER PRIORITY (OR IS REFUSED). DROPPED PUBLISHES COMPLETE WITH FALSE
+*
+*       WITH CONFLATION ON (ESP8266_MQTT_CLIENT_SetConflation) A PUBLISH TO A
+*       TOPIC THAT STILL HAS AN UNSENT ONE IN THE QUEUE REPLACES IT IN PLACE
+*       (LAST VALUE WINS, THE OLD ONE COMPLETES WITH FALSE). THE TOPIC IS
+*       FOUND THROUGH A HASH INDEX. OTHER ENTRIES KEEP THEIR ORDER. STATE
+*       TOPICS THEN HOLD ONE SLOT EACH HOWEVER LONG THE LINK IS DOWN AND ONLY
+*       THEIR LATEST VALUE IS SENT AFTER RECONNECT
+*
+*   (15) DEEP SLEEP FAST RESUME. ESP8266_MQTT_CLIENT_Suspend WRITES THE SESSION
+*       STATE OF THE INSTANCE TO RTC MEMORY (WITH A CHECKSUM) BEFORE DEEP
+*       SLEEP : PACKET ID COUNTER, PACKET IDS OF UNACKNOWLEDGED QOS 1 / 2
+*       MESSAGES (UP TO A FULL IN-FLIGHT WINDOW), LAST BROKER ADDRESS AND THE
+*       CONNECT PACKET (IF IT FITS ESP8266_MQTT_CLIENT_SUSPEND_CONNECT_MAX).
+*       THE RECORD TAKES ESP8266_MQTT_CLIENT_SUSPEND_RTC_BLOCKS BLOCKS. AFTER
+*       WAKE UP
+*
+*           ESP8266_MQTT_CLIENT_Initialize(...);
+*           ESP8266_MQTT_CLIENT_SetCallbackFunctions(...);
+*           if(ESP8266_MQTT_CLIENT_Resume(rtc_block))
+*               ESP8266_MQTT_CLIENT_TcpConnect();   //NO SetOptions, NO DNS
+*
+*       AND CONNECT + PUBLISH FROM THE TCP CONNECT CB WITHOUT WAITING FOR
+*       CONNACK. MESSAGES SENT BEFORE THE CONNACK ARE NOT SENT AGAIN ON IT.
+*       PAYLOADS ARE NOT KEPT (RTC MEMORY IS 512 BYTES). RESTORED IDS ARE NOT
+*       GIVEN TO NEW MESSAGES UNTIL RELEASED. QOS 2 ONES GET A PUBREL ONCE
+*       CONNECTED SO THE BROKER FREES THEM (RELEASED BY PUBCOMP). QOS 1 ONES
+*       ARE RELEASED BY THE CONNACK. A RECORD IS USED ONCE (CLEARED BY RESUME)
+*       AND IGNORED IF IT IS FOR ANOTHER HOST NAME OR OTHER CONNECT OPTIONS.
+*       ITS BLOCKS MUST NOT OVERLAP OTHER RTC RECORDS (DNS CACHE, TLS SESSION).
+*       ESP8266_MQTT_RTC_BLOCK_xxx GIVE A LAYOUT WHERE THEY DO NOT
+*
+*   (16) THE STRING PUBLISH FUNCTIONS SEND THE MESSAGE (UP TO ITS NUL) WITH A 2
+*       BYTE LENGTH PREFIX. ESP8266_MQTT_CLIENT_Send_PublishBinary SENDS A
+*       PAYLOAD OF EXPLICIT LENGTH AS IS (ANY BYTES, NO PREFIX) SO COMPACT
+*       BINARY ENCODINGS CAN BE USED. IT IS NEVER COMPRESSED (ITS FIRST BYTE
+*       MAY BE THE COMPRESSION MARKER). A QOS 0 BINARY PAYLOAD CAN ALSO BE
+*       WRITTEN STRAIGHT INTO THE CLIENT TX BUFFER BETWEEN
+*       ESP8266_MQTT_CLIENT_Send_PublishBegin AND _Commit, EG BY THE
+*       ESP8266_MQTT_CBOR ENCODER (NO INTERMEDIATE BUFFER OR STRING FORMATTING)
+*
+*   (17) FREE ONLINE MQTT BROKER
 *       DIOTY
 *       http://www.dioty.co/mydioty
 *       LOGIN WITH MY GOOGLE ACCOUNT
@@ -42,11 +205,49 @@
 #include "os_type.h"
 #include "user_interface.h"
 #include "string.h"
+#include "ESP8266_MQTT_TOPIC_TRIE.h"
 
 #define ESP8266_MQTT_RETRY_COUNT				(3)
 #define ESP8266_MQTT_PROTOCOL_VERSION			(3)
-#define ESP8266_MQTT_VARIABLE_HEADER_MAX_SIZE	(100)
 #define ESP8266_MQTT_CLIENT_REPLY_TIMEOUT_MS	(5000)
+#define ESP8266_MQTT_CLIENT_KEEPALIVE_MARGIN_MS	(500)
+#define ESP8266_MQTT_CLIENT_RECONNECT_DELAY_MS	(1000)
+#define ESP8266_MQTT_CLIENT_RECONNECT_DELAY_MAX_MS	(60000)
+#define ESP8266_MQTT_CLIENT_RECONNECT_RESOLVE_AFTER	(3)
+#define ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX		(32)
+#define ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_DEFAULT	(8)
+#define ESP8266_MQTT_CLIENT_INFLIGHT_CHECK_MS		(500)
+#define ESP8266_MQTT_CLIENT_COALESCE_THRESHOLD_DEFAULT	(1460)
+#define ESP8266_MQTT_CLIENT_COALESCE_TIMEOUT_MS_DEFAULT	(5)
+#define ESP8266_MQTT_CLIENT_COMPRESS_THRESHOLD_DEFAULT	(128)
+#define ESP8266_MQTT_CLIENT_TX_SEGMENTS_MAX				(8)
+#define ESP8266_MQTT_CLIENT_REMAINING_LENGTH_MAX		(268435455)
+#define ESP8266_MQTT_CLIENT_INBOUND_QOS2_MAX			(8)
+#define ESP8266_MQTT_CLIENT_TOPIC_ALIAS_MAX				(16)
+#define ESP8266_MQTT_CLIENT_SESSION_EXPIRY_S			(86400)
+#define ESP8266_MQTT_CLIENT_DNS_TTL_DEFAULT_S			(600)
+#define ESP8266_MQTT_CLIENT_DNS_TTL_MAX_S				(3600)
+#define ESP8266_MQTT_CLIENT_DNS_CACHE_MAGIC				(0x444E5331)
+#define ESP8266_MQTT_CLIENT_STATS_BUCKETS				(8)
+#define ESP8266_MQTT_CLIENT_STATS_PAYLOAD_MAX			(768)
+#define ESP8266_MQTT_CLIENT_SEND_QUEUE_MAX				(16)
+#define ESP8266_MQTT_CLIENT_SEND_QUEUE_BUCKETS			(16)	//POWER OF 2
+#define ESP8266_MQTT_CLIENT_SEND_QUEUE_DEADLINE_MAX_MS	(3600000)
+#define ESP8266_MQTT_CLIENT_SUSPEND_MAGIC				(0x53505331)
+#define ESP8266_MQTT_CLIENT_SUSPEND_PENDING_MAX			(ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX)	//FULL WINDOW, AT MOST 32 (QOS 2 BITMAPS)
+#define ESP8266_MQTT_CLIENT_SUSPEND_CONNECT_MAX			(128)
+#define ESP8266_MQTT_CLIENT_DNS_CACHE_RTC_BLOCKS		(sizeof(esp8266_mqtt_dns_cache_record_t) / 4)
+#define ESP8266_MQTT_CLIENT_SUSPEND_RTC_BLOCKS			(sizeof(esp8266_mqtt_suspend_record_t) / 4)
+
+//DEFAULT RTC USER MEMORY LAYOUT (FIRST BLOCK OF EACH RECORD). CAN BE MOVED
+//WITH BUILD FLAGS. ESP8266_MQTT_TLS CHECKS AT BUILD TIME THAT THEY DO NOT
+//OVERLAP (WITH ESP8266_MQTT_RTC_BLOCK_TLS_SESSION)
+#ifndef ESP8266_MQTT_RTC_BLOCK_DNS_CACHE
+#define ESP8266_MQTT_RTC_BLOCK_DNS_CACHE				(64)
+#endif
+#ifndef ESP8266_MQTT_RTC_BLOCK_SUSPEND
+#define ESP8266_MQTT_RTC_BLOCK_SUSPEND					(ESP8266_MQTT_RTC_BLOCK_DNS_CACHE + ESP8266_MQTT_CLIENT_DNS_CACHE_RTC_BLOCKS)
+#endif
 
 //CUSTOM VARIABLE STRUCTURES/////////////////////////////
 typedef enum
@@ -58,6 +259,10 @@ typedef enum
 	ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBREC = 5,
 	ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBREL = 6,
 	ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBCOMP = 7,
+	ESP8266_MQTT_CONTROL_PACKET_TYPE_SUBSCRIBE = 8,
+	ESP8266_MQTT_CONTROL_PACKET_TYPE_SUBACK = 9,
+	ESP8266_MQTT_CONTROL_PACKET_TYPE_UNSUBSCRIBE = 10,
+	ESP8266_MQTT_CONTROL_PACKET_TYPE_UNSUBACK = 11,
 	ESP8266_MQTT_CONTROL_PACKET_TYPE_PINGREQ = 12,
 	ESP8266_MQTT_CONTROL_PACKET_TYPE_PINGRESP = 13,
 	ESP8266_MQTT_CONTROL_PACKET_TYPE_DISCONNECT = 14,
@@ -73,11 +278,53 @@ typedef enum
 	ESP8266_MQTT_CONTROL_PACKET_FLAG_PUBREC = 0x00,
 	ESP8266_MQTT_CONTROL_PACKET_FLAG_PUBREL = 0x02,
 	ESP8266_MQTT_CONTROL_PACKET_FLAG_PUBCOMP = 0x00,
+	ESP8266_MQTT_CONTROL_PACKET_FLAG_SUBSCRIBE = 0x02,
+	ESP8266_MQTT_CONTROL_PACKET_FLAG_SUBACK = 0x00,
+	ESP8266_MQTT_CONTROL_PACKET_FLAG_UNSUBSCRIBE = 0x02,
+	ESP8266_MQTT_CONTROL_PACKET_FLAG_UNSUBACK = 0x00,
 	ESP8266_MQTT_CONTROL_PACKET_FLAG_PINGREQ = 0x00,
 	ESP8266_MQTT_CONTROL_PACKET_FLAG_PINGRESP = 0x00,
 	ESP8266_MQTT_CONTROL_PACKET_FLAG_DISCONNECT = 0x00,
 }esp8266_mqtt_client_packet_flag_t;
 
+typedef enum
+{
+	ESP8266_MQTT_PROTOCOL_VERSION_3_1 = 3,
+	ESP8266_MQTT_PROTOCOL_VERSION_3_1_1 = 4,
+	ESP8266_MQTT_PROTOCOL_VERSION_5 = 5
+}esp8266_mqtt_protocol_version_t;
+
+typedef enum
+{
+	ESP8266_MQTT_PROPERTY_PAYLOAD_FORMAT_INDICATOR = 0x01,
+	ESP8266_MQTT_PROPERTY_MESSAGE_EXPIRY_INTERVAL = 0x02,
+	ESP8266_MQTT_PROPERTY_CONTENT_TYPE = 0x03,
+	ESP8266_MQTT_PROPERTY_RESPONSE_TOPIC = 0x08,
+	ESP8266_MQTT_PROPERTY_CORRELATION_DATA = 0x09,
+	ESP8266_MQTT_PROPERTY_SUBSCRIPTION_IDENTIFIER = 0x0B,
+	ESP8266_MQTT_PROPERTY_SESSION_EXPIRY_INTERVAL = 0x11,
+	ESP8266_MQTT_PROPERTY_ASSIGNED_CLIENT_IDENTIFIER = 0x12,
+	ESP8266_MQTT_PROPERTY_SERVER_KEEP_ALIVE = 0x13,
+	ESP8266_MQTT_PROPERTY_AUTHENTICATION_METHOD = 0x15,
+	ESP8266_MQTT_PROPERTY_AUTHENTICATION_DATA = 0x16,
+	ESP8266_MQTT_PROPERTY_REQUEST_PROBLEM_INFORMATION = 0x17,
+	ESP8266_MQTT_PROPERTY_WILL_DELAY_INTERVAL = 0x18,
+	ESP8266_MQTT_PROPERTY_REQUEST_RESPONSE_INFORMATION = 0x19,
+	ESP8266_MQTT_PROPERTY_RESPONSE_INFORMATION = 0x1A,
+	ESP8266_MQTT_PROPERTY_SERVER_REFERENCE = 0x1C,
+	ESP8266_MQTT_PROPERTY_REASON_STRING = 0x1F,
+	ESP8266_MQTT_PROPERTY_RECEIVE_MAXIMUM = 0x21,
+	ESP8266_MQTT_PROPERTY_TOPIC_ALIAS_MAXIMUM = 0x22,
+	ESP8266_MQTT_PROPERTY_TOPIC_ALIAS = 0x23,
+	ESP8266_MQTT_PROPERTY_MAXIMUM_QOS = 0x24,
+	ESP8266_MQTT_PROPERTY_RETAIN_AVAILABLE = 0x25,
+	ESP8266_MQTT_PROPERTY_USER_PROPERTY = 0x26,
+	ESP8266_MQTT_PROPERTY_MAXIMUM_PACKET_SIZE = 0x27,
+	ESP8266_MQTT_PROPERTY_WILDCARD_SUBSCRIPTION_AVAILABLE = 0x28,
+	ESP8266_MQTT_PROPERTY_SUBSCRIPTION_IDENTIFIER_AVAILABLE = 0x29,
+	ESP8266_MQTT_PROPERTY_SHARED_SUBSCRIPTION_AVAILABLE = 0x2A
+}esp8266_mqtt_property_id_t;
+
 typedef enum
 {
 	ESP8266_MQTT_QOS_0 = 0,	//NO ACK FROM THE BROKER
@@ -86,6 +333,15 @@ typedef enum
 	ESP8266_MQTT_QOS_3
 }esp8266_mqtt_qos_t;
 
+typedef enum
+{
+	ESP8266_MQTT_PRIORITY_LOW = 0,		//BULK / ROUTINE TELEMETRY
+	ESP8266_MQTT_PRIORITY_NORMAL,
+	ESP8266_MQTT_PRIORITY_HIGH,
+	ESP8266_MQTT_PRIORITY_URGENT,		//ALARMS
+	ESP8266_MQTT_PRIORITY_COUNT
+}esp8266_mqtt_priority_t;
+
 typedef enum
 {
 	ESP8266_MQTT_CONNACK_ACCEPTED = 0,
@@ -96,22 +352,341 @@ typedef enum
 	ESP8266_MQTT_CONTROL_CONNACK_REFUSED_NOT_AUTHORIZED
 }esp8266_mqtt_connack_return_code_t;
 
+typedef enum
+{
+	ESP8266_MQTT_INFLIGHT_STATE_FREE = 0,
+	ESP8266_MQTT_INFLIGHT_STATE_RESERVED,
+	ESP8266_MQTT_INFLIGHT_STATE_WAIT_PUBACK,		//QOS 1 : PUBLISH SENT
+	ESP8266_MQTT_INFLIGHT_STATE_WAIT_PUBREC,		//QOS 2 : PUBLISH SENT
+	ESP8266_MQTT_INFLIGHT_STATE_WAIT_PUBCOMP		//QOS 2 : PUBREL SENT
+}esp8266_mqtt_inflight_state_t;
+
+typedef struct
+{
+	//ctx IS THE TRANSPORT CONTEXT GIVEN TO ESP8266_MQTT_CLIENT_SetTransport
+	//CBS ARE CALLED WITH THE cb_arg GIVEN TO set_callback_functions
+	void (*initialize)(void* ctx, const char* hostname, const char* host_ip, uint16_t host_port, uint16_t buffer_size);
+	void (*set_dns_server)(void* ctx, char num_dns, ip_addr_t* dns);
+	void (*set_callback_functions)(void* ctx,
+									void* cb_arg,
+									void (*conn_cb)(void*),
+									void (*discon_cb)(void*),
+									void (*send_cb)(void*),
+									void (*recv_cb)(void*, char*, unsigned short),
+									void (*dns_cb)(void*, ip_addr_t*));
+	void (*resolve_host_name)(void* ctx);
+	void (*connect)(void* ctx);
+	void (*disconnect)(void* ctx);
+	void (*send)(void* ctx, uint8_t* data, uint16_t len);
+	void (*set_host_ip)(void* ctx, ip_addr_t* ip);	//OPTIONAL (NULL = NO DNS CACHE FAST PATH)
+}esp8266_mqtt_transport_t;
+
+typedef struct
+{
+	uint8_t* data;
+	uint16_t len;
+	void (*release_cb)(void*);	//CALLED ONCE SENT (NULL FOR CLIENT TX BUFFER BYTES)
+	void* release_arg;
+}esp8266_mqtt_tx_segment_t;
+
+typedef struct
+{
+	char* topic;			//NUL TERMINATED COPY OF THE TOPIC
+	uint16_t topic_len;
+	uint8_t* encoded;		//LENGTH PREFIXED TOPIC (2 + topic_len BYTES)
+	uint16_t alias;			//MQTT 5 TOPIC ALIAS ON THE CURRENT CONNECTION (0 = NONE)
+}esp8266_mqtt_topic_handle_t;
+
 typedef struct
 {
-	uint8_t fixed_header_byte1;
-	uint8_t	fixed_header_remaining_length[4];
-	uint8_t fixed_header_remaining_length_len;
-	uint8_t* variable_header;
-	uint16_t variable_header_len;
-	uint8_t* payload;
-	uint16_t payload_len;
-}esp8266_mqtt_packet_t;
+	uint8_t state;
+	uint8_t qos;
+	uint8_t retries;
+	uint8_t stream;			//PAYLOAD STREAMED (ESP8266_MQTT_CLIENT_Send_PublishStream)
+	uint8_t raw;			//PAYLOAD SENT WITHOUT LENGTH PREFIX (ESP8266_MQTT_CLIENT_Send_PublishBinary)
+	uint8_t resend;			//RETRANSMISSION WAITING FOR TX BUFFER ROOM
+	uint16_t packet_id;
+	uint32_t sent_time_us;
+	char* topic;
+	esp8266_mqtt_topic_handle_t* topic_handle;
+	char* message;
+	uint16_t message_len;
+	void (*complete_cb)(void*, bool);
+	void* cb_arg;
+	void (*release_cb)(void*);	//ZERO COPY PAYLOAD (MESSAGE IS THE CALLER BUFFER)
+	void* release_arg;
+	uint32_t store_addr;
+}esp8266_mqtt_inflight_entry_t;
+
+typedef struct
+{
+	bool used;
+	uint8_t qos;
+	uint8_t priority;
+	uint16_t message_len;
+	uint32_t seq;				//CALL ORDER WITHIN THE PRIORITY
+	uint32_t queued_time_us;
+	uint32_t deadline_ms;		//0 = NO DEADLINE
+	uint32_t topic_hash;
+	uint8_t hash_next;			//NEXT SLOT + 1 IN THE HASH BUCKET (0 = END)
+	char* topic;
+	char* message;
+	void (*complete_cb)(void*, bool);
+	void* cb_arg;
+}esp8266_mqtt_send_queue_entry_t;
+
+typedef enum
+{
+	ESP8266_MQTT_STATS_STAGE_DNS = 0,		//RESOLVE -> DNS CB (CACHE HITS NOT COUNTED)
+	ESP8266_MQTT_STATS_STAGE_TCP_CONNECT,	//TCP CONNECT -> TCP CONNECT CB
+	ESP8266_MQTT_STATS_STAGE_CONNACK,		//CONNECT -> CONNACK
+	ESP8266_MQTT_STATS_STAGE_PUBACK,		//PUBLISH (LAST SENT) -> PUBACK / PUBREC
+	ESP8266_MQTT_STATS_STAGE_PINGRESP,		//PINGREQ -> PINGRESP
+	ESP8266_MQTT_STATS_STAGE_COUNT
+}esp8266_mqtt_stats_stage_t;
+
+typedef struct
+{
+	uint32_t count;
+	uint32_t total_ms;
+	uint32_t max_ms;
+	uint16_t buckets[ESP8266_MQTT_CLIENT_STATS_BUCKETS];
+}esp8266_mqtt_stats_latency_t;
+
+typedef struct
+{
+	esp8266_mqtt_stats_latency_t latency[ESP8266_MQTT_STATS_STAGE_COUNT];
+	uint32_t bytes_sent;
+	uint32_t bytes_received;
+	uint32_t packets_sent;
+	uint32_t packets_received;
+	uint32_t retransmits;		//QOS 1 / 2 MESSAGES SENT AGAIN FOR LACK OF A REPLY
+	uint32_t reconnects;		//LIBRARY DRIVEN RECONNECT ATTEMPTS
+	uint32_t timeouts;			//CONNACK / PINGRESP MISSING, PUBLISHES GIVEN UP
+	uint32_t heap_used;			//BYTES ALLOCATED BY THE CLIENT NOW
+	uint32_t heap_peak;			//MOST BYTES EVER ALLOCATED BY THE CLIENT AT ONCE
+	uint32_t queue_depth;		//PUBLISHES IN THE SEND QUEUE NOW
+	uint32_t queue_peak;		//MOST PUBLISHES EVER IN THE SEND QUEUE AT ONCE
+	uint32_t queue_sent;		//HANDED FROM THE SEND QUEUE TO THE PUBLISH PATH
+	uint32_t queue_expired;		//DROPPED FROM THE SEND QUEUE PAST THEIR DEADLINE
+	uint32_t queue_dropped;		//PUSHED OUT / REFUSED (QUEUE FULL) OR FAILED TO SEND
+	uint32_t queue_conflated;	//REPLACED IN THE SEND QUEUE BY A NEWER PUBLISH
+}esp8266_mqtt_stats_t;
+
+typedef struct
+{
+	//DNS CACHE ENTRY AS KEPT IN RTC MEMORY
+	uint32_t magic;
+	uint32_t host_hash;
+	uint32_t ip;
+	uint32_t ttl_left_s;
+	uint32_t checksum;
+}esp8266_mqtt_dns_cache_record_t;
+
+typedef struct
+{
+	//CLIENT SESSION STATE AS KEPT IN RTC MEMORY (ESP8266_MQTT_CLIENT_Suspend)
+	uint32_t magic;
+	uint32_t host_hash;			//0 = BROKER GIVEN BY IP
+	uint32_t host_ip;			//0 = UNKNOWN
+	uint16_t message_id;
+	uint16_t keepalive_timer;
+	uint8_t protocol_version;
+	uint8_t flag_clean_session;
+	uint8_t pending_count;
+	uint8_t connect_len;		//0 = CONNECT NOT KEPT (TOO BIG)
+	uint16_t pending_ids[ESP8266_MQTT_CLIENT_SUSPEND_PENDING_MAX];
+	uint32_t pending_qos2;		//BIT n SET : pending_ids[n] IS A QOS 2 MESSAGE
+	uint8_t connect_packet[ESP8266_MQTT_CLIENT_SUSPEND_CONNECT_MAX];
+	uint32_t checksum;
+}esp8266_mqtt_suspend_record_t;
+
+typedef struct
+{
+	//ONE CLIENT INSTANCE (ONE BROKER CONNECTION). CALLER OWNED MEMORY
+	//SET UP WITH ESP8266_MQTT_CLIENT_InitInstance. FIELDS ARE PRIVATE
+
+	//TRANSPORT RELATED
+	const esp8266_mqtt_transport_t* transport;
+	void* transport_ctx;
+
+	//OPERATION RELATED
+	uint16_t buffer_size;
+	uint8_t* tx_buffer;
+	uint16_t tx_len;
+	uint8_t* rx_buffer;
+	uint16_t rx_len;
+	uint32_t rx_expected;
+	uint32_t rx_discard;
+	uint8_t rx_header_len;
+
+	//COALESCING RELATED
+	bool flag_coalesce;
+	uint16_t coalesce_threshold;
+	uint16_t coalesce_timeout_ms;
+	os_timer_t tx_flush_os_timer;
+
+	//TX SEGMENT QUEUE RELATED
+	//TX BUFFER BYTES [0, tx_queued) ARE HELD BY SEGMENTS. BYTES
+	//[tx_queued, tx_len) ARE WAITING TO BE QUEUED (COALESCING)
+	esp8266_mqtt_tx_segment_t tx_segments[ESP8266_MQTT_CLIENT_TX_SEGMENTS_MAX];
+	uint8_t tx_segment_head;
+	uint8_t tx_segment_count;
+	uint16_t tx_queued;
+	bool tx_sending;
+	bool tx_flush_pending;
+
+	//STREAMING PUBLISH RELATED
+	//ACTIVE FROM ESP8266_MQTT_CLIENT_Send_PublishStream UNTIL THE MESSAGE COMPLETES
+	//SENDING WHILE THE PAYLOAD IS BEING PULLED / QUEUED
+	bool stream_active;
+	bool stream_sending;
+	char* stream_topic;
+	uint32_t stream_len;
+	uint32_t stream_offset;
+	uint8_t stream_qos;
+	uint16_t stream_packet_id;
+	uint16_t (*stream_read_cb)(void*, uint32_t, uint8_t*, uint16_t);
+	void (*stream_complete_cb)(void*, bool);
+	void* stream_cb_arg;
+	uint8_t* stream_chunk;
+
+	//IN PLACE PUBLISH RELATED
+	//FROM ESP8266_MQTT_CLIENT_Send_PublishBegin TO _Commit
+	bool inplace_active;
+	char* inplace_topic;
+	uint16_t inplace_tx_len;
+	uint8_t inplace_len_header;		//FIXED HEADER SPACE RESERVED
+	uint16_t inplace_len_vheader;
+	uint16_t inplace_max;
+
+	//COMPRESSION RELATED
+	bool flag_compress;
+	uint16_t compress_threshold;
+	uint16_t mqtt_message_id;
+	esp8266_mqtt_client_packet_type_t current_packet_type;
+
+	//IN-FLIGHT (QOS 1 / 2) RELATED
+	esp8266_mqtt_inflight_entry_t inflight[ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX];
+	uint8_t inflight_window;
+	uint8_t inflight_count;
+	bool inflight_resend_pending;	//RETRANSMISSION STOPPED ON A BUSY TX BUFFER (GOES ON FROM THE TCP SENT CB)
+	os_timer_t inflight_os_timer;
+
+	//PROTOCOL RELATED
+	uint8_t protocol_version;
+	uint16_t server_receive_max;
+	uint16_t server_topic_alias_max;
+	esp8266_mqtt_topic_handle_t* topic_alias_handles[ESP8266_MQTT_CLIENT_TOPIC_ALIAS_MAX];
+
+	//SUBSCRIPTION RELATED
+	esp8266_mqtt_topic_trie_node_t subscriptions;
+	uint16_t inbound_qos2_ids[ESP8266_MQTT_CLIENT_INBOUND_QOS2_MAX];
+	uint8_t inbound_qos2_count;
+
+	//SEND QUEUE RELATED
+	esp8266_mqtt_send_queue_entry_t send_queue[ESP8266_MQTT_CLIENT_SEND_QUEUE_MAX];
+	uint8_t send_queue_buckets[ESP8266_MQTT_CLIENT_SEND_QUEUE_BUCKETS];	//TOPIC HASH INDEX (SLOT + 1)
+	uint8_t send_queue_count;
+	uint32_t send_queue_seq;
+	bool send_queue_dispatching;
+	bool flag_conflate;
+
+	//OFFLINE QUEUE RELATED
+	bool flag_offline_queue;
+	bool store_draining;
+	bool store_drain_pending;		//DRAIN STOPPED ON A BUSY TX BUFFER (GOES ON FROM THE TCP SENT CB)
+	uint8_t* store_buffer;
+
+	//PERSISTENT SESSION RELATED
+	bool flag_persistent;
+	bool session_active;
+	bool session_reconnecting;		//LIBRARY DRIVEN (RE)CONNECT UNTIL CONNACK
+	bool session_present;
+	bool mqtt_connected;
+	bool pingresp_pending;
+	uint32_t last_tx_time_us;
+	os_timer_t keepalive_os_timer;
+	os_timer_t pingresp_os_timer;
+	os_timer_t reconnect_os_timer;
+
+	//RECONNECT BACKOFF RELATED
+	uint32_t reconnect_min_ms;		//0 = ESP8266_MQTT_CLIENT_RECONNECT_DELAY_MS
+	uint32_t reconnect_max_ms;		//0 = ESP8266_MQTT_CLIENT_RECONNECT_DELAY_MAX_MS
+	uint8_t reconnect_attempt;
+	bool reconnect_pending;			//RECONNECT TIMER ARMED
+	bool reconnect_resolving;		//NEXT DNS RESULT CONTINUES THE RECONNECT
+
+	//DNS CACHE RELATED
+	bool flag_dns_cache;
+	uint32_t dns_ttl_s;
+	uint8_t dns_rtc_block;			//0 = NOT KEPT IN RTC MEMORY
+	uint32_t dns_host_hash;
+	bool dns_valid;
+	ip_addr_t dns_ip;
+	uint32_t dns_resolved_time_us;
+	uint32_t dns_age_offset_s;		//AGE WHEN LOADED FROM RTC MEMORY
+	bool dns_from_cache;			//CURRENT CONNECT ATTEMPT USES THE CACHED IP
+	bool dns_refresh;				//RE-RESOLVE IN THE BACKGROUND ONCE CONNECTED
+	bool dns_background;			//RESOLVE IN PROGRESS IS A BACKGROUND ONE
+	bool tcp_connected;
+	os_timer_t dns_os_timer;
+
+	//SUSPEND / RESUME RELATED
+	ip_addr_t host_ip;				//LAST BROKER ADDRESS (0 = UNKNOWN)
+	uint16_t resume_ids[ESP8266_MQTT_CLIENT_SUSPEND_PENDING_MAX];	//RESTORED IDS NOT RELEASED YET
+	uint32_t resume_qos2;			//BIT n SET : resume_ids[n] IS A QOS 2 MESSAGE
+	uint8_t resume_count;
+	uint32_t connect_sent_us;		//LAST CONNECT SENT
+
+	//STATS RELATED
+	esp8266_mqtt_stats_t stats;
+	uint32_t stats_start_us[ESP8266_MQTT_STATS_STAGE_COUNT];
+	uint8_t stats_running;			//BIT PER STAGE BEING TIMED
+	char* stats_topic;
+	os_timer_t stats_os_timer;
+
+	//CB FUNCTIONS
+	void (*tcp_conn_cb_function)(void);
+	void (*dns_cb_function)(ip_addr_t*);
+	void (*data_send_cb)(void*);
+	void (*data_recv_cb)(esp8266_mqtt_client_packet_type_t ptype, char*, unsigned short);
+	void (*reason_cb)(esp8266_mqtt_client_packet_type_t ptype, uint16_t, uint8_t);
+
+	//CONNECT PACKET RELATED
+	//BUILT ONCE FROM THE OPTIONS (ESP8266_MQTT_CLIENT_SetOptions), SENT AS IS
+	uint8_t* connect_packet;
+	uint16_t connect_len;
+	uint32_t connect_len_remaining;
+
+	//MQTT RELATED
+	bool flag_dup;
+	uint8_t qos;
+	uint8_t flag_retain;
+	bool flag_username;
+	char* username;
+	bool flag_password;
+	char* password;
+	bool flag_clean_session;
+	uint16_t keepalive_timer;
+	bool flag_will;
+	char* will_topic;
+	char* will_message;
+	uint8_t will_qos;
+	char* client_id;
+}esp8266_mqtt_client_t;
 //END CUSTOM VARIABLE STRUCTURES/////////////////////////
 
 //FUNCTION PROTOTYPES/////////////////////////////////////////////
+//INSTANCE FUNCTIONS
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_InitInstance(esp8266_mqtt_client_t* client);
+esp8266_mqtt_client_t* ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Select(esp8266_mqtt_client_t* client);
+esp8266_mqtt_client_t* ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_GetInstance(void);
+
 //CONFIGURATION FUNCTIONS
 void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetDebug(uint8_t debug_on);
-void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetOptions(uint8_t dup,
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetTransport(const esp8266_mqtt_transport_t* transport, void* transport_ctx);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetOptions(uint8_t dup,
 														uint8_t qos,
 														uint8_t retain,
 														bool use_username,
@@ -129,13 +704,42 @@ void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Initialize(const char* hostname,
 														const char* host_ip,
 														uint16_t host_port,
 														uint16_t buffer_size);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetInflightWindow(uint8_t window_size);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetCoalescing(bool enable,
+                                                        uint16_t flush_threshold,
+                                                        uint16_t flush_timeout_ms);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetCompression(bool enable, uint16_t threshold);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetOfflineQueue(bool enable,
+                                                            uint16_t start_sector,
+                                                            uint16_t sector_count);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetPersistentSession(bool enable);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetReconnectBackoff(uint32_t min_delay_ms, uint32_t max_delay_ms);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetProtocolVersion(esp8266_mqtt_protocol_version_t version);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetReasonCodeCallback(void (*reason_cb)(esp8266_mqtt_client_packet_type_t ptype,
+                                                                                    uint16_t packet_id,
+                                                                                    uint8_t reason_code));
 void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetDnsServer(char num_dns, ip_addr_t* dns);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetDnsCache(bool enable, uint32_t ttl_s, uint8_t rtc_block);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SaveDnsCache(uint32_t sleep_s);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Suspend(uint8_t rtc_block);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Resume(uint8_t rtc_block);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetStatsPublish(char* topic, uint32_t interval_ms);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetConflation(bool enable);
 void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_SetCallbackFunctions(void (tcp_conn_cb)(void),
 																void (data_send_cb)(void*),
 															    void (data_recv_cb)(esp8266_mqtt_client_packet_type_t ptype, char*, unsigned short),
                                                                 void (*user_dns_cb_fn)(ip_addr_t*));
 
+//STATS FUNCTIONS
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_GetStats(esp8266_mqtt_stats_t* stats);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_ResetStats(void);
+
 //OPERATION FUNCTIONS
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_IsConnected(void);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_IsSessionPresent(void);
+uint8_t ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_GetInflightCount(void);
+uint8_t ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_GetSendQueueDepth(void);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Connect(void);
 void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_ResolveHostName(void);
 void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_TcpConnect(void);
 void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_TcpDisonnect(void);
@@ -143,6 +747,56 @@ void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_Connect(void);
 void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_Publish(char* topic,
 														char* message,
                                                         esp8266_mqtt_qos_t qos_level);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_PublishWithCb(char* topic,
+                                                                char* message,
+                                                                esp8266_mqtt_qos_t qos_level,
+                                                                void (*complete_cb)(void*, bool),
+                                                                void* cb_arg);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_PublishBinary(char* topic,
+                                                                uint8_t* payload,
+                                                                uint16_t payload_len,
+                                                                esp8266_mqtt_qos_t qos_level,
+                                                                void (*complete_cb)(void*, bool),
+                                                                void* cb_arg);
+uint8_t* ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_PublishBegin(char* topic, uint16_t* max_len);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_PublishCommit(uint16_t payload_len);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_PublishCancel(void);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_PublishQueued(char* topic,
+                                                                char* message,
+                                                                esp8266_mqtt_qos_t qos_level,
+                                                                esp8266_mqtt_priority_t priority,
+                                                                uint32_t deadline_ms,
+                                                                void (*complete_cb)(void*, bool),
+                                                                void* cb_arg);
+esp8266_mqtt_topic_handle_t* ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_RegisterTopic(const char* topic);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_UnregisterTopic(esp8266_mqtt_topic_handle_t* topic_handle);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_PublishHandle(esp8266_mqtt_topic_handle_t* topic_handle,
+                                                                char* message,
+                                                                esp8266_mqtt_qos_t qos_level,
+                                                                void (*complete_cb)(void*, bool),
+                                                                void* cb_arg);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_PublishRef(char* topic,
+                                                            uint8_t* payload,
+                                                            uint16_t payload_len,
+                                                            esp8266_mqtt_qos_t qos_level,
+                                                            void (*release_cb)(void*),
+                                                            void* release_arg);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_PublishStream(char* topic,
+                                                                uint32_t payload_len,
+                                                                esp8266_mqtt_qos_t qos_level,
+                                                                uint16_t (*read_cb)(void* arg,
+                                                                                    uint32_t offset,
+                                                                                    uint8_t* dest,
+                                                                                    uint16_t max_len),
+                                                                void (*complete_cb)(void*, bool),
+                                                                void* cb_arg);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_IsStreaming(void);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Flush(void);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Subscribe(char* topic_filter,
+                                                    esp8266_mqtt_qos_t qos_level,
+                                                    esp8266_mqtt_topic_handler_t handler,
+                                                    void* handler_arg);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Unsubscribe(char* topic_filter);
 void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_Pingreq(void);
 void ICACHE_FLASH_ATTR ESP8266_MQTT_CLIENT_Send_Disconnect(void);
 
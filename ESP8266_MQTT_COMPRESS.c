@@ -0,0 +1,286 @@
+/**********************************************************************************
+* ESP8266 MQTT COMPRESS
+*
+* NOTE
+* -----
+*   (1) SMALL LZ77 CODEC (LZF STREAM FORMAT) USED BY THE MQTT CLIENT TO SHRINK
+*       LARGE PUBLISH PAYLOADS BEFORE THEY GO OUT ON THE RADIO. NO MALLOC. THE
+*       ONLY RAM USED IS THE STATIC MATCH HASH TABLE
+*
+*   (2) MATCHES ARE FOUND THROUGH A HASH OF THE NEXT 3 BYTES THAT REMEMBERS THE
+*       LAST POSITION EACH HASH WAS SEEN AT (ONE CANDIDATE, NO CHAINS). FAST AND
+*       GOOD ENOUGH FOR THE REPEATED KEYS / VALUES OF JSON PAYLOADS
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_MQTT_COMPRESS.h"
+
+//LOCAL LIBRARY VARIABLES////////////////////////////////
+//MATCH FINDER (POSITION + 1 OF LAST OCCURRENCE, 0 = EMPTY)
+static uint16_t s_compress_hash[1 << ESP8266_MQTT_COMPRESS_HASH_LOG];
+
+//STATS
+static esp8266_mqtt_compress_stats_t s_compress_stats;
+//END LOCAL LIBRARY VARIABLES/////////////////////////////
+
+//LOCAL LIBRARY FUNCTIONS////////////////////////////////
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_compress_hash(const uint8_t* data);
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_compress_lzf(const uint8_t* in,
+                                                                uint16_t in_len,
+                                                                uint8_t* out,
+                                                                uint16_t out_size);
+//END LOCAL LIBRARY FUNCTIONS////////////////////////////////
+
+
+uint16_t ICACHE_FLASH_ATTR ESP8266_MQTT_COMPRESS_Encode(const uint8_t* in,
+                                                        uint16_t in_len,
+                                                        uint8_t* out,
+                                                        uint16_t out_limit)
+{
+    //COMPRESS in INTO out (MARKER HEADER + LZF STREAM)
+    //RETURN COMPRESSED SIZE OR 0 IF THE RESULT DOES NOT FIT IN out_limit BYTES
+    //(CALLER SENDS THE ORIGINAL PAYLOAD THEN)
+
+    uint32_t start_us = system_get_time();
+    uint16_t len = 0;
+
+    s_compress_stats.encode_calls++;
+    if(out_limit > ESP8266_MQTT_COMPRESS_HEADER_SIZE && in_len > 0)
+    {
+        len = s_esp8266_mqtt_compress_lzf(in,
+                                            in_len,
+                                            &out[ESP8266_MQTT_COMPRESS_HEADER_SIZE],
+                                            out_limit - ESP8266_MQTT_COMPRESS_HEADER_SIZE);
+    }
+    if(len != 0)
+    {
+        out[0] = ESP8266_MQTT_COMPRESS_MARKER;
+        out[1] = ESP8266_MQTT_COMPRESS_CODEC_LZF;
+        out[2] = (uint8_t)((in_len & 0xFF00) >> 8);
+        out[3] = (uint8_t)(in_len & 0x00FF);
+        len += ESP8266_MQTT_COMPRESS_HEADER_SIZE;
+
+        s_compress_stats.encode_hits++;
+        s_compress_stats.bytes_in += in_len;
+        s_compress_stats.bytes_out += len;
+    }
+    s_compress_stats.encode_time_us += system_get_time() - start_us;
+    return len;
+}
+
+uint16_t ICACHE_FLASH_ATTR ESP8266_MQTT_COMPRESS_Decode(const uint8_t* in,
+                                                        uint16_t in_len,
+                                                        uint8_t* out,
+                                                        uint16_t out_size)
+{
+    //DECOMPRESS A COMPRESSED PAYLOAD (MARKER HEADER + LZF STREAM) INTO out
+    //RETURN ORIGINAL SIZE OR 0 IF THE PAYLOAD IS MALFORMED OR DOES NOT FIT
+
+    uint16_t len_original;
+    uint16_t ip = ESP8266_MQTT_COMPRESS_HEADER_SIZE;
+    uint16_t op = 0;
+    uint16_t len;
+    uint16_t ref;
+    uint8_t ctrl;
+
+    if(!ESP8266_MQTT_COMPRESS_IsCompressed(in, in_len))
+    {
+        return 0;
+    }
+    len_original = (in[2] << 8) | in[3];
+    if(len_original > out_size)
+    {
+        return 0;
+    }
+
+    while(ip < in_len)
+    {
+        ctrl = in[ip++];
+        if(ctrl < ESP8266_MQTT_COMPRESS_MAX_LITERAL)
+        {
+            //LITERAL RUN
+            len = ctrl + 1;
+            if((ip + len) > in_len || (op + len) > len_original)
+            {
+                return 0;
+            }
+            os_memcpy(&out[op], &in[ip], len);
+            ip += len;
+            op += len;
+        }
+        else
+        {
+            //BACK REFERENCE
+            len = ctrl >> 5;
+            if(len == 7)
+            {
+                if(ip >= in_len)
+                {
+                    return 0;
+                }
+                len += in[ip++];
+            }
+            len += 2;
+            if(ip >= in_len)
+            {
+                return 0;
+            }
+            ref = ((ctrl & 0x1F) << 8) + in[ip++] + 1;
+            if(ref > op || (op + len) > len_original)
+            {
+                return 0;
+            }
+
+            //BYTE BY BYTE (SOURCE AND DESTINATION MAY OVERLAP)
+            while(len--)
+            {
+                out[op] = out[op - ref];
+                op++;
+            }
+        }
+    }
+    return (op == len_original) ? op : 0;
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_COMPRESS_IsCompressed(const uint8_t* payload, uint16_t payload_len)
+{
+    //RETURN TRUE IF THE PAYLOAD CARRIES THE COMPRESSION MARKER HEADER
+
+    return (payload_len > ESP8266_MQTT_COMPRESS_HEADER_SIZE &&
+            payload[0] == ESP8266_MQTT_COMPRESS_MARKER &&
+            payload[1] == ESP8266_MQTT_COMPRESS_CODEC_LZF);
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_COMPRESS_GetStats(esp8266_mqtt_compress_stats_t* stats)
+{
+    //COPY THE ENCODER STATS
+    //BYTES SAVED ON THE WIRE = bytes_in - bytes_out
+
+    os_memcpy(stats, &s_compress_stats, sizeof(esp8266_mqtt_compress_stats_t));
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_COMPRESS_ResetStats(void)
+{
+    //CLEAR THE ENCODER STATS
+
+    os_memset(&s_compress_stats, 0, sizeof(esp8266_mqtt_compress_stats_t));
+}
+
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_compress_hash(const uint8_t* data)
+{
+    //RETURN HASH TABLE INDEX OF THE 3 BYTES AT THE SPECIFIED LOCATION
+
+    uint32_t value = ((uint32_t)data[0] << 16) | ((uint32_t)data[1] << 8) | data[2];
+    return (uint16_t)((value * 2654435761u) >> (32 - ESP8266_MQTT_COMPRESS_HASH_LOG));
+}
+
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_compress_lzf(const uint8_t* in,
+                                                                uint16_t in_len,
+                                                                uint8_t* out,
+                                                                uint16_t out_size)
+{
+    //COMPRESS in INTO AN LZF STREAM
+    //EVERY LITERAL RUN IS PRECEDED BY A CONTROL BYTE THAT IS FILLED IN WHEN THE
+    //RUN ENDS (op ALWAYS POINTS PAST THE CONTROL BYTE OF THE OPEN RUN)
+    //RETURN STREAM SIZE OR 0 IF IT DOES NOT FIT out_size
+
+    uint16_t ip = 0;
+    uint16_t op = 1;
+    uint8_t lit = 0;
+    uint16_t hash;
+    uint16_t ref;
+    uint16_t offset;
+    uint16_t len;
+
+    os_memset(s_compress_hash, 0, sizeof(s_compress_hash));
+
+    while(ip < in_len)
+    {
+        //LOOK FOR A MATCH OF AT LEAST 3 BYTES
+        len = 0;
+        if((ip + 2) < in_len)
+        {
+            hash = s_esp8266_mqtt_compress_hash(&in[ip]);
+            ref = s_compress_hash[hash];
+            s_compress_hash[hash] = ip + 1;
+            if(ref != 0)
+            {
+                ref--;
+                offset = ip - ref - 1;
+                if(offset < ESP8266_MQTT_COMPRESS_MAX_OFFSET &&
+                    in[ref] == in[ip] && in[ref + 1] == in[ip + 1] && in[ref + 2] == in[ip + 2])
+                {
+                    len = 3;
+                    while((ip + len) < in_len && len < ESP8266_MQTT_COMPRESS_MAX_MATCH &&
+                            in[ref + len] == in[ip + len])
+                    {
+                        len++;
+                    }
+                }
+            }
+        }
+
+        if(len == 0)
+        {
+            //LITERAL
+            if(op >= out_size)
+            {
+                return 0;
+            }
+            out[op++] = in[ip++];
+            lit++;
+            if(lit == ESP8266_MQTT_COMPRESS_MAX_LITERAL)
+            {
+                //CLOSE FULL RUN, OPEN NEXT ONE
+                out[op - lit - 1] = lit - 1;
+                lit = 0;
+                op++;
+            }
+            continue;
+        }
+
+        //BACK REFERENCE (3 BYTES WORST CASE + NEXT CONTROL BYTE)
+        if((op + 4) > out_size)
+        {
+            return 0;
+        }
+        if(lit != 0)
+        {
+            out[op - lit - 1] = lit - 1;
+        }
+        else
+        {
+            //DROP UNUSED CONTROL BYTE
+            op--;
+        }
+        len -= 2;
+        if(len < 7)
+        {
+            out[op++] = (uint8_t)((len << 5) | (offset >> 8));
+        }
+        else
+        {
+            out[op++] = (uint8_t)((7 << 5) | (offset >> 8));
+            out[op++] = (uint8_t)(len - 7);
+        }
+        out[op++] = (uint8_t)(offset & 0xFF);
+        ip += len + 2;
+        lit = 0;
+        op++;
+    }
+
+    //CLOSE LAST RUN
+    if(lit != 0)
+    {
+        out[op - lit - 1] = lit - 1;
+    }
+    else
+    {
+        op--;
+    }
+    return (op <= out_size) ? op : 0;
+}
@@ -0,0 +1,83 @@
+/**********************************************************************************
+* ESP8266 MQTT COMPRESS
+*
+* NOTE
+* -----
+*   (1) SMALL LZ77 CODEC (LZF STREAM FORMAT) USED BY THE MQTT CLIENT TO SHRINK
+*       LARGE PUBLISH PAYLOADS BEFORE THEY GO OUT ON THE RADIO. NO MALLOC. THE
+*       ONLY RAM USED IS THE STATIC MATCH HASH TABLE
+*       (2 << ESP8266_MQTT_COMPRESS_HASH_LOG BYTES)
+*
+*   (2) A COMPRESSED PAYLOAD STARTS WITH A 4 BYTE MARKER HEADER. THE FIRST BYTE
+*       IS 0x00 WHICH A STRING PAYLOAD NEVER STARTS WITH, SO CONSUMERS CAN TELL
+*       COMPRESSED PAYLOADS APART FROM PLAIN ONES. A BINARY PAYLOAD CAN START
+*       WITH 0x00 SO THE MQTT CLIENT NEVER COMPRESSES ONE
+*
+*   (3) ENCODE ONLY SUCCEEDS IF THE RESULT (WITH HEADER) FITS THE OUTPUT
+*       LIMIT. THE MQTT CLIENT PASSES A LIMIT BELOW THE ORIGINAL SIZE AND SENDS
+*       THE ORIGINAL PAYLOAD IF COMPRESSION DOES NOT PAY OFF
+*
+*   (4) ESP8266_MQTT_COMPRESS_GetStats REPORTS BYTES IN / OUT AND TIME SPENT
+*       ENCODING SO THE CPU COST CAN BE WEIGHED AGAINST THE BYTES SAVED ON THE
+*       WIRE ON THE ACTUAL DEVICE AND PAYLOADS
+*
+* PAYLOAD LAYOUT
+* ---------------
+*   [0x00][CODEC 1][ORIGINAL LEN 2 (MSB FIRST)][LZF STREAM]
+*
+* LZF STREAM
+* -----------
+*   000LLLLL                    : L + 1 LITERAL BYTES FOLLOW
+*   LLLOOOOO OOOOOOOO           : COPY L + 2 BYTES FROM OFFSET O + 1 BACK (L 1 - 6)
+*   111OOOOO LLLLLLLL OOOOOOOO  : COPY L + 9 BYTES FROM OFFSET O + 1 BACK
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#ifndef _ESP8266_MQTT_COMPRESS_H_
+#define _ESP8266_MQTT_COMPRESS_H_
+
+#include "ets_sys.h"
+#include "osapi.h"
+#include "os_type.h"
+#include "user_interface.h"
+
+#define ESP8266_MQTT_COMPRESS_MARKER				(0x00)
+#define ESP8266_MQTT_COMPRESS_CODEC_LZF				(0x01)
+#define ESP8266_MQTT_COMPRESS_HEADER_SIZE			(4)
+#define ESP8266_MQTT_COMPRESS_HASH_LOG				(8)
+#define ESP8266_MQTT_COMPRESS_MAX_LITERAL			(32)
+#define ESP8266_MQTT_COMPRESS_MAX_OFFSET			(8192)
+#define ESP8266_MQTT_COMPRESS_MAX_MATCH				(264)
+
+//CUSTOM VARIABLE STRUCTURES/////////////////////////////
+typedef struct
+{
+	uint32_t encode_calls;		//PAYLOADS OFFERED TO THE ENCODER
+	uint32_t encode_hits;		//PAYLOADS THAT CAME OUT SMALLER
+	uint32_t bytes_in;			//ORIGINAL BYTES OF THE PAYLOADS THAT CAME OUT SMALLER
+	uint32_t bytes_out;			//COMPRESSED BYTES (WITH HEADER) OF THOSE PAYLOADS
+	uint32_t encode_time_us;	//TOTAL TIME SPENT IN THE ENCODER (ALL CALLS)
+}esp8266_mqtt_compress_stats_t;
+//END CUSTOM VARIABLE STRUCTURES/////////////////////////
+
+//FUNCTION PROTOTYPES/////////////////////////////////////////////
+//OPERATION FUNCTIONS
+uint16_t ICACHE_FLASH_ATTR ESP8266_MQTT_COMPRESS_Encode(const uint8_t* in,
+                                                        uint16_t in_len,
+                                                        uint8_t* out,
+                                                        uint16_t out_limit);
+uint16_t ICACHE_FLASH_ATTR ESP8266_MQTT_COMPRESS_Decode(const uint8_t* in,
+                                                        uint16_t in_len,
+                                                        uint8_t* out,
+                                                        uint16_t out_size);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_COMPRESS_IsCompressed(const uint8_t* payload, uint16_t payload_len);
+
+//STATS FUNCTIONS
+void ICACHE_FLASH_ATTR ESP8266_MQTT_COMPRESS_GetStats(esp8266_mqtt_compress_stats_t* stats);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_COMPRESS_ResetStats(void);
+
+#endif
@@ -0,0 +1,523 @@
+/**********************************************************************************
+* ESP8266 MQTT FLASH QUEUE
+*
+* NOTE
+* -----
+*   (1) PERSISTENT APPEND-ONLY LOG OF MQTT PUBLISHES IN SPI FLASH SECTORS. USED
+*       BY THE MQTT CLIENT TO STORE PUBLISHES WHILE OFFLINE AND DRAIN THEM IN
+*       ORDER ONCE CONNECTED
+*
+*   (2) THE SECTORS ARE USED AS A RING (EACH SECTOR HEADER CARRIES A SEQUENCE
+*       NUMBER) SO EVERY SECTOR IS ERASED ONCE PER PASS (WEAR LEVELING). IF THE
+*       RING IS FULL THE OLDEST SECTOR IS DROPPED
+*
+*   (3) RECORDS ARE CRC'D. A CONSUMED RECORD IS MARKED BY CLEARING ITS STATUS
+*       WORD (NO ERASE NEEDED). A RECORD TORN BY A POWER CUT FAILS THE CRC AND
+*       IS SKIPPED WHEN THE LOG IS SCANNED ON INITIALIZE
+*
+*   (4) APPEND ONLY COPIES THE RECORD INTO A RAM WRITE-BACK CACHE. FLASH WRITES
+*       AND SECTOR ERASES ARE DONE FROM A TIMER, SO THE PUBLISH PATH NEVER
+*       BLOCKS ON FLASH
+*
+*   (5) THE DROP CB IS CALLED BEFORE THE OLDEST SECTOR IS ERASED (RING FULL)
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_MQTT_FLASH_QUEUE.h"
+#include "ESP8266_MQTT_LOG.h"
+
+//LOCAL LIBRARY VARIABLES////////////////////////////////
+//FLASH RELATED
+static uint16_t s_fq_start_sector;
+static uint16_t s_fq_sector_count = 0;
+static uint32_t s_fq_sequence;
+
+//LOG POSITIONS (SECTOR INDEX IN RING + OFFSET IN SECTOR)
+static uint16_t s_fq_head_sector;
+static uint16_t s_fq_head_offset;
+static uint16_t s_fq_tail_sector;
+static uint16_t s_fq_tail_offset;
+static uint16_t s_fq_read_sector;
+static uint16_t s_fq_read_offset;
+
+//RAM WRITE-BACK CACHE
+static uint32_t s_fq_cache[ESP8266_MQTT_FLASH_QUEUE_CACHE_SIZE / 4];
+static uint16_t s_fq_cache_len = 0;
+static bool s_fq_flush_armed = false;
+static os_timer_t s_fq_flush_timer;
+
+//CB FUNCTIONS
+static void (*s_fq_drop_cb)(uint32_t, uint32_t) = NULL;
+//END LOCAL LIBRARY VARIABLES/////////////////////////////
+
+//LOCAL LIBRARY FUNCTIONS////////////////////////////////
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_fq_crc16(uint16_t crc, const uint8_t* data, uint16_t len);
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_fq_record_crc(esp8266_mqtt_flash_queue_record_header_t* header,
+                                                                const uint8_t* data);
+static uint32_t ICACHE_FLASH_ATTR s_esp8266_mqtt_fq_addr(uint16_t sector, uint16_t offset);
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_fq_record_size(uint16_t data_len);
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_fq_next(uint16_t* sector,
+                                                        uint16_t* offset,
+                                                        esp8266_mqtt_flash_queue_record_header_t* header);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_fq_advance_tail(void);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_fq_new_sector(void);
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_fq_load(uint32_t addr,
+                                                        esp8266_mqtt_flash_queue_record_header_t* header,
+                                                        esp8266_mqtt_flash_queue_record_t* record,
+                                                        uint8_t* buffer,
+                                                        uint16_t buffer_size);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_fq_flush_timer_cb(void* arg);
+//END LOCAL LIBRARY FUNCTIONS////////////////////////////////
+
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_FLASH_QUEUE_Initialize(uint16_t start_sector, uint16_t sector_count)
+{
+    //INITIALIZE THE FLASH QUEUE ON THE SPECIFIED SECTOR RANGE (>= 2 SECTORS)
+    //SCAN THE LOG TO RECOVER HEAD / TAIL AFTER A RESET OR POWER CUT
+
+    uint32_t sector_header[2];
+    uint32_t best_sequence = 0;
+    bool found = false;
+    uint16_t i;
+    uint16_t offset;
+    esp8266_mqtt_flash_queue_record_header_t header;
+
+    if(sector_count < 2)
+    {
+        ESP8266_MQTT_LOG_ERROR("FLASH_QUEUE Error ! Need at least 2 sectors (%u given)", sector_count);
+        return false;
+    }
+    s_fq_start_sector = start_sector;
+    s_fq_sector_count = sector_count;
+    s_fq_cache_len = 0;
+    s_fq_flush_armed = false;
+    os_timer_disarm(&s_fq_flush_timer);
+    os_timer_setfn(&s_fq_flush_timer, (os_timer_func_t*)s_esp8266_mqtt_fq_flush_timer_cb, NULL);
+
+    //FIND NEWEST SECTOR (HEAD)
+    for(i = 0; i < s_fq_sector_count; i++)
+    {
+        spi_flash_read(s_esp8266_mqtt_fq_addr(i, 0), sector_header, sizeof(sector_header));
+        if(sector_header[0] == ESP8266_MQTT_FLASH_QUEUE_MAGIC &&
+            (!found || sector_header[1] > best_sequence))
+        {
+            found = true;
+            best_sequence = sector_header[1];
+            s_fq_head_sector = i;
+        }
+    }
+
+    if(!found)
+    {
+        //EMPTY / FOREIGN FLASH. START A NEW LOG
+        s_fq_sequence = 0;
+        s_fq_head_sector = s_fq_sector_count - 1;
+        s_fq_head_offset = SPI_FLASH_SEC_SIZE;
+        s_fq_tail_sector = s_fq_head_sector;
+        s_fq_tail_offset = s_fq_head_offset;
+        s_esp8266_mqtt_fq_new_sector();
+        return true;
+    }
+    s_fq_sequence = best_sequence;
+
+    //FIND OLDEST SECTOR (TAIL). WALK BACK WHILE SEQUENCE IS CONTIGUOUS
+    s_fq_tail_sector = s_fq_head_sector;
+    for(i = 1; i < s_fq_sector_count; i++)
+    {
+        uint16_t prev = (s_fq_head_sector + s_fq_sector_count - i) % s_fq_sector_count;
+        spi_flash_read(s_esp8266_mqtt_fq_addr(prev, 0), sector_header, sizeof(sector_header));
+        if(sector_header[0] != ESP8266_MQTT_FLASH_QUEUE_MAGIC ||
+            sector_header[1] != (best_sequence - i))
+        {
+            break;
+        }
+        s_fq_tail_sector = prev;
+    }
+
+    //FIND WRITE OFFSET IN HEAD SECTOR
+    offset = ESP8266_MQTT_FLASH_QUEUE_SECTOR_HEADER_SIZE;
+    while(offset + ESP8266_MQTT_FLASH_QUEUE_RECORD_HEADER_SIZE <= SPI_FLASH_SEC_SIZE)
+    {
+        spi_flash_read(s_esp8266_mqtt_fq_addr(s_fq_head_sector, offset),
+                        (uint32_t*)&header,
+                        ESP8266_MQTT_FLASH_QUEUE_RECORD_HEADER_SIZE);
+        if(*(uint32_t*)&header == 0xFFFFFFFF)
+        {
+            break;
+        }
+        if(offset + s_esp8266_mqtt_fq_record_size(header.data_len) > SPI_FLASH_SEC_SIZE)
+        {
+            //TORN LENGTH. NOTHING MORE CAN BE TRUSTED IN THIS SECTOR
+            offset = SPI_FLASH_SEC_SIZE;
+            break;
+        }
+        offset += s_esp8266_mqtt_fq_record_size(header.data_len);
+    }
+    s_fq_head_offset = offset;
+
+    //SKIP CONSUMED RECORDS AT TAIL
+    s_fq_tail_offset = ESP8266_MQTT_FLASH_QUEUE_SECTOR_HEADER_SIZE;
+    s_esp8266_mqtt_fq_advance_tail();
+    ESP8266_MQTT_FLASH_QUEUE_Rewind();
+    return true;
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_FLASH_QUEUE_SetDropCallback(void (*drop_cb)(uint32_t start_addr, uint32_t end_addr))
+{
+    //SET THE CB CALLED WITH THE FLASH ADDRESS RANGE [start_addr, end_addr) OF
+    //THE OLDEST SECTOR WHEN IT IS DROPPED (RING FULL), BEFORE IT IS ERASED
+    //RECORDS IN THAT RANGE CAN NOT BE READ BACK OR CONSUMED ANYMORE
+
+    s_fq_drop_cb = drop_cb;
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_FLASH_QUEUE_Append(const char* topic,
+                                                        uint16_t topic_len,
+                                                        const char* message,
+                                                        uint16_t message_len,
+                                                        uint8_t qos)
+{
+    //APPEND A PUBLISH RECORD TO THE RAM WRITE-BACK CACHE
+    //IT IS WRITTEN TO FLASH BY THE FLUSH TIMER
+    //RETURN FALSE IF THE CACHE IS FULL OR THE RECORD TOO BIG
+
+    esp8266_mqtt_flash_queue_record_header_t* header;
+    uint8_t* cache = (uint8_t*)s_fq_cache;
+    uint16_t size = s_esp8266_mqtt_fq_record_size(topic_len + message_len);
+
+    if(s_fq_sector_count == 0 ||
+        (uint32_t)topic_len + message_len > 0xFFFF ||
+        size > (SPI_FLASH_SEC_SIZE - ESP8266_MQTT_FLASH_QUEUE_SECTOR_HEADER_SIZE) ||
+        (s_fq_cache_len + size) > ESP8266_MQTT_FLASH_QUEUE_CACHE_SIZE)
+    {
+        return false;
+    }
+
+    header = (esp8266_mqtt_flash_queue_record_header_t*)&cache[s_fq_cache_len];
+    header->data_len = topic_len + message_len;
+    header->qos = qos;
+    header->reserved = 0x00;
+    header->topic_len = topic_len;
+    header->status = ESP8266_MQTT_FLASH_QUEUE_RECORD_PENDING;
+    os_memcpy(&cache[s_fq_cache_len + ESP8266_MQTT_FLASH_QUEUE_RECORD_HEADER_SIZE], topic, topic_len);
+    os_memcpy(&cache[s_fq_cache_len + ESP8266_MQTT_FLASH_QUEUE_RECORD_HEADER_SIZE + topic_len], message, message_len);
+    os_memset(&cache[s_fq_cache_len + ESP8266_MQTT_FLASH_QUEUE_RECORD_HEADER_SIZE + header->data_len],
+                0xFF,
+                size - ESP8266_MQTT_FLASH_QUEUE_RECORD_HEADER_SIZE - header->data_len);
+    header->crc = s_esp8266_mqtt_fq_record_crc(header, &cache[s_fq_cache_len + ESP8266_MQTT_FLASH_QUEUE_RECORD_HEADER_SIZE]);
+    s_fq_cache_len += size;
+
+    if(!s_fq_flush_armed)
+    {
+        s_fq_flush_armed = true;
+        os_timer_arm(&s_fq_flush_timer, ESP8266_MQTT_FLASH_QUEUE_FLUSH_MS, 0);
+    }
+    return true;
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_FLASH_QUEUE_Flush(void)
+{
+    //WRITE ALL RECORDS IN THE RAM CACHE TO FLASH
+    //MOVES TO (AND ERASES) THE NEXT SECTOR WHEN THE HEAD SECTOR IS FULL
+
+    uint8_t* cache = (uint8_t*)s_fq_cache;
+    uint16_t pos = 0;
+    uint16_t size;
+
+    os_timer_disarm(&s_fq_flush_timer);
+    s_fq_flush_armed = false;
+
+    while(pos < s_fq_cache_len)
+    {
+        size = s_esp8266_mqtt_fq_record_size(((esp8266_mqtt_flash_queue_record_header_t*)&cache[pos])->data_len);
+        if(s_fq_head_offset + size > SPI_FLASH_SEC_SIZE)
+        {
+            s_esp8266_mqtt_fq_new_sector();
+        }
+        spi_flash_write(s_esp8266_mqtt_fq_addr(s_fq_head_sector, s_fq_head_offset),
+                        (uint32_t*)&cache[pos],
+                        size);
+        s_fq_head_offset += size;
+        pos += size;
+    }
+    s_fq_cache_len = 0;
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_FLASH_QUEUE_Read(esp8266_mqtt_flash_queue_record_t* record,
+                                                        uint8_t* buffer,
+                                                        uint16_t buffer_size)
+{
+    //READ THE NEXT PENDING RECORD AFTER THE READ CURSOR INTO THE SPECIFIED
+    //(4 BYTE ALIGNED) BUFFER. TOPIC AND MESSAGE ARE NULL TERMINATED IN IT
+    //RECORDS FAILING THE CRC ARE CONSUMED AND SKIPPED
+    //RETURN FALSE IF THERE IS NOTHING MORE TO READ
+
+    esp8266_mqtt_flash_queue_record_header_t header;
+    uint32_t addr;
+
+    //RECORDS STILL IN RAM GO TO FLASH FIRST SO ORDER IS KEPT
+    if(s_fq_cache_len > 0)
+    {
+        ESP8266_MQTT_FLASH_QUEUE_Flush();
+    }
+
+    while(s_esp8266_mqtt_fq_next(&s_fq_read_sector, &s_fq_read_offset, &header))
+    {
+        addr = s_esp8266_mqtt_fq_addr(s_fq_read_sector, s_fq_read_offset);
+        s_fq_read_offset += s_esp8266_mqtt_fq_record_size(header.data_len);
+
+        if(header.status != ESP8266_MQTT_FLASH_QUEUE_RECORD_PENDING)
+        {
+            continue;
+        }
+        if(s_esp8266_mqtt_fq_load(addr, &header, record, buffer, buffer_size))
+        {
+            return true;
+        }
+        ESP8266_MQTT_FLASH_QUEUE_Consume(addr);
+    }
+    return false;
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_FLASH_QUEUE_ReadAt(uint32_t addr,
+                                                        esp8266_mqtt_flash_queue_record_t* record,
+                                                        uint8_t* buffer,
+                                                        uint16_t buffer_size)
+{
+    //READ THE RECORD AT THE SPECIFIED FLASH ADDRESS (AS RETURNED BY A PREVIOUS
+    //READ) AGAIN. USED FOR RETRANSMISSION
+
+    esp8266_mqtt_flash_queue_record_header_t header;
+
+    spi_flash_read(addr, (uint32_t*)&header, ESP8266_MQTT_FLASH_QUEUE_RECORD_HEADER_SIZE);
+    if(header.status != ESP8266_MQTT_FLASH_QUEUE_RECORD_PENDING)
+    {
+        return false;
+    }
+    return s_esp8266_mqtt_fq_load(addr, &header, record, buffer, buffer_size);
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_FLASH_QUEUE_Consume(uint32_t addr)
+{
+    //MARK THE RECORD AT THE SPECIFIED FLASH ADDRESS CONSUMED
+    //(CLEARS THE STATUS WORD. NO ERASE NEEDED)
+
+    uint32_t status = ESP8266_MQTT_FLASH_QUEUE_RECORD_CONSUMED;
+
+    spi_flash_write(addr + 8, &status, sizeof(status));
+    if(addr == s_esp8266_mqtt_fq_addr(s_fq_tail_sector, s_fq_tail_offset))
+    {
+        s_esp8266_mqtt_fq_advance_tail();
+    }
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_FLASH_QUEUE_Rewind(void)
+{
+    //MOVE THE READ CURSOR BACK TO THE OLDEST PENDING RECORD
+    //(RECORDS READ BUT NOT CONSUMED WILL BE READ AGAIN)
+
+    s_fq_read_sector = s_fq_tail_sector;
+    s_fq_read_offset = s_fq_tail_offset;
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_FLASH_QUEUE_IsEmpty(void)
+{
+    //RETURN TRUE IF THERE ARE NO PENDING RECORDS (FLASH OR RAM CACHE)
+
+    return (s_fq_cache_len == 0 &&
+            s_fq_tail_sector == s_fq_head_sector &&
+            s_fq_tail_offset >= s_fq_head_offset);
+}
+
+//INTERNAL FUNCTIONS
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_fq_crc16(uint16_t crc, const uint8_t* data, uint16_t len)
+{
+    //CRC-16/CCITT
+
+    uint8_t i;
+
+    while(len--)
+    {
+        crc ^= ((uint16_t)*data++) << 8;
+        for(i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_fq_record_crc(esp8266_mqtt_flash_queue_record_header_t* header,
+                                                                const uint8_t* data)
+{
+    //CRC OVER THE RECORD HEADER FIELDS (EXCEPT CRC + STATUS) AND DATA
+
+    uint16_t crc = 0xFFFF;
+
+    crc = s_esp8266_mqtt_fq_crc16(crc, (const uint8_t*)header, 6);
+    crc = s_esp8266_mqtt_fq_crc16(crc, data, header->data_len);
+    return crc;
+}
+
+static uint32_t ICACHE_FLASH_ATTR s_esp8266_mqtt_fq_addr(uint16_t sector, uint16_t offset)
+{
+    //FLASH ADDRESS OF THE SPECIFIED RING POSITION
+
+    return ((uint32_t)(s_fq_start_sector + sector) * SPI_FLASH_SEC_SIZE) + offset;
+}
+
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_fq_record_size(uint16_t data_len)
+{
+    //FLASH SIZE OF A RECORD (HEADER + DATA PADDED TO 4 BYTES)
+
+    return ESP8266_MQTT_FLASH_QUEUE_RECORD_HEADER_SIZE + ((data_len + 3) & ~0x03);
+}
+
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_fq_next(uint16_t* sector,
+                                                        uint16_t* offset,
+                                                        esp8266_mqtt_flash_queue_record_header_t* header)
+{
+    //POSITION THE SPECIFIED CURSOR ON THE NEXT RECORD (MOVING TO THE NEXT
+    //SECTOR AT THE END OF ONE) AND READ ITS HEADER
+    //RETURN FALSE IF THE CURSOR REACHED THE HEAD OF THE LOG
+
+    while(1)
+    {
+        if(*sector == s_fq_head_sector && *offset >= s_fq_head_offset)
+        {
+            return false;
+        }
+        if((*offset + ESP8266_MQTT_FLASH_QUEUE_RECORD_HEADER_SIZE) <= SPI_FLASH_SEC_SIZE)
+        {
+            spi_flash_read(s_esp8266_mqtt_fq_addr(*sector, *offset),
+                            (uint32_t*)header,
+                            ESP8266_MQTT_FLASH_QUEUE_RECORD_HEADER_SIZE);
+            if(*(uint32_t*)header != 0xFFFFFFFF &&
+                (*offset + s_esp8266_mqtt_fq_record_size(header->data_len)) <= SPI_FLASH_SEC_SIZE)
+            {
+                return true;
+            }
+        }
+        if(*sector == s_fq_head_sector)
+        {
+            return false;
+        }
+        *sector = (*sector + 1) % s_fq_sector_count;
+        *offset = ESP8266_MQTT_FLASH_QUEUE_SECTOR_HEADER_SIZE;
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_fq_advance_tail(void)
+{
+    //MOVE THE TAIL PAST CONSUMED RECORDS
+
+    esp8266_mqtt_flash_queue_record_header_t header;
+    bool read_at_tail = (s_fq_read_sector == s_fq_tail_sector && s_fq_read_offset == s_fq_tail_offset);
+
+    while(s_esp8266_mqtt_fq_next(&s_fq_tail_sector, &s_fq_tail_offset, &header))
+    {
+        if(header.status == ESP8266_MQTT_FLASH_QUEUE_RECORD_PENDING)
+        {
+            break;
+        }
+        s_fq_tail_offset += s_esp8266_mqtt_fq_record_size(header.data_len);
+    }
+    if(read_at_tail)
+    {
+        ESP8266_MQTT_FLASH_QUEUE_Rewind();
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_fq_new_sector(void)
+{
+    //MOVE THE HEAD TO THE NEXT SECTOR IN THE RING. ERASE IT AND WRITE ITS HEADER
+    //IF THE TAIL IS STILL IN THAT SECTOR THE RING IS FULL. OLDEST SECTOR IS DROPPED
+
+    uint32_t sector_header[2];
+    uint16_t next = (s_fq_head_sector + 1) % s_fq_sector_count;
+    bool read_in_dropped = (s_fq_read_sector == next);
+
+    if(s_fq_tail_sector == next && s_fq_tail_sector != s_fq_head_sector)
+    {
+        ESP8266_MQTT_LOG_WARN("FLASH_QUEUE Full ! Oldest sector %u dropped", s_fq_start_sector + next);
+        s_fq_tail_sector = (next + 1) % s_fq_sector_count;
+        s_fq_tail_offset = ESP8266_MQTT_FLASH_QUEUE_SECTOR_HEADER_SIZE;
+        if(read_in_dropped)
+        {
+            ESP8266_MQTT_FLASH_QUEUE_Rewind();
+        }
+
+        //LET THE USER FORGET RECORD ADDRESSES IN THE SECTOR BEFORE IT IS REUSED
+        if(s_fq_drop_cb != NULL)
+        {
+            (*s_fq_drop_cb)(s_esp8266_mqtt_fq_addr(next, 0), s_esp8266_mqtt_fq_addr(next, 0) + SPI_FLASH_SEC_SIZE);
+        }
+    }
+
+    //SEQUENCE FIRST, MAGIC LAST. A HEADER TORN BY A POWER CUT HAS NO MAGIC SO
+    //A HALF WRITTEN SEQUENCE IS NEVER TAKEN AS THE NEWEST SECTOR ON INITIALIZE
+    spi_flash_erase_sector(s_fq_start_sector + next);
+    s_fq_sequence++;
+    sector_header[0] = ESP8266_MQTT_FLASH_QUEUE_MAGIC;
+    sector_header[1] = s_fq_sequence;
+    spi_flash_write(s_esp8266_mqtt_fq_addr(next, 4), &sector_header[1], 4);
+    spi_flash_write(s_esp8266_mqtt_fq_addr(next, 0), &sector_header[0], 4);
+
+    //EMPTY LOG. TAIL FOLLOWS HEAD
+    if(s_fq_tail_sector == s_fq_head_sector && s_fq_tail_offset >= s_fq_head_offset)
+    {
+        s_fq_tail_sector = next;
+        s_fq_tail_offset = ESP8266_MQTT_FLASH_QUEUE_SECTOR_HEADER_SIZE;
+        ESP8266_MQTT_FLASH_QUEUE_Rewind();
+    }
+    s_fq_head_sector = next;
+    s_fq_head_offset = ESP8266_MQTT_FLASH_QUEUE_SECTOR_HEADER_SIZE;
+}
+
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_fq_load(uint32_t addr,
+                                                        esp8266_mqtt_flash_queue_record_header_t* header,
+                                                        esp8266_mqtt_flash_queue_record_t* record,
+                                                        uint8_t* buffer,
+                                                        uint16_t buffer_size)
+{
+    //READ THE RECORD DATA INTO THE SPECIFIED BUFFER AND CHECK ITS CRC
+    //TOPIC AND MESSAGE ARE SEPARATED / TERMINATED WITH NULL IN THE BUFFER
+
+    uint16_t len_padded = (header->data_len + 3) & ~0x03;
+    uint16_t message_len;
+
+    if(header->topic_len > header->data_len || ESP8266_MQTT_FLASH_QUEUE_READ_SIZE(header->data_len) > buffer_size)
+    {
+        return false;
+    }
+    spi_flash_read(addr + ESP8266_MQTT_FLASH_QUEUE_RECORD_HEADER_SIZE, (uint32_t*)buffer, len_padded);
+    if(s_esp8266_mqtt_fq_record_crc(header, buffer) != header->crc)
+    {
+        ESP8266_MQTT_LOG_WARN("FLASH_QUEUE Record CRC error at 0x%x. Skipped", addr);
+        return false;
+    }
+
+    message_len = header->data_len - header->topic_len;
+    os_memmove(&buffer[header->topic_len + 1], &buffer[header->topic_len], message_len);
+    buffer[header->topic_len] = '\0';
+    buffer[header->data_len + 1] = '\0';
+
+    record->addr = addr;
+    record->qos = header->qos;
+    record->topic = (char*)buffer;
+    record->topic_len = header->topic_len;
+    record->message = (char*)&buffer[header->topic_len + 1];
+    record->message_len = message_len;
+    return true;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_fq_flush_timer_cb(void* arg)
+{
+    //RAM CACHE FLUSH TIMER CB
+
+    ESP8266_MQTT_FLASH_QUEUE_Flush();
+}
@@ -0,0 +1,106 @@
+/**********************************************************************************
+* ESP8266 MQTT FLASH QUEUE
+*
+* NOTE
+* -----
+*   (1) PERSISTENT APPEND-ONLY LOG OF MQTT PUBLISHES IN SPI FLASH SECTORS. USED
+*       BY THE MQTT CLIENT TO STORE PUBLISHES WHILE OFFLINE AND DRAIN THEM IN
+*       ORDER ONCE CONNECTED
+*
+*   (2) THE SECTORS ARE USED AS A RING (EACH SECTOR HEADER CARRIES A SEQUENCE
+*       NUMBER) SO EVERY SECTOR IS ERASED ONCE PER PASS (WEAR LEVELING). IF THE
+*       RING IS FULL THE OLDEST SECTOR IS DROPPED
+*
+*   (3) RECORDS ARE CRC'D. A CONSUMED RECORD IS MARKED BY CLEARING ITS STATUS
+*       WORD (NO ERASE NEEDED). A RECORD TORN BY A POWER CUT FAILS THE CRC AND
+*       IS SKIPPED WHEN THE LOG IS SCANNED ON INITIALIZE
+*
+*   (4) APPEND ONLY COPIES THE RECORD INTO A RAM WRITE-BACK CACHE. FLASH WRITES
+*       AND SECTOR ERASES ARE DONE FROM A TIMER, SO THE PUBLISH PATH NEVER
+*       BLOCKS ON FLASH
+*
+*   (5) WHEN THE OLDEST SECTOR IS DROPPED THE DROP CB (IF SET) IS CALLED WITH ITS
+*       FLASH ADDRESS RANGE [start_addr, end_addr) BEFORE IT IS ERASED, SO ANY
+*       RECORD ADDRESS HELD BY THE USER (E.G. A MESSAGE STILL IN FLIGHT) CAN BE
+*       FORGOTTEN BEFORE THE SECTOR IS REUSED FOR NEW RECORDS
+*
+* SECTOR LAYOUT
+* --------------
+*   [MAGIC 4][SEQUENCE 4][RECORD][RECORD]...[0xFF...]
+*
+* RECORD LAYOUT (4 BYTE ALIGNED)
+* -------------------------------
+*   [DATA LEN 2][QOS 1][0x00 1][TOPIC LEN 2][CRC 2][STATUS 4][TOPIC][MESSAGE][PAD]
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#ifndef _ESP8266_MQTT_FLASH_QUEUE_H_
+#define _ESP8266_MQTT_FLASH_QUEUE_H_
+
+#include "ets_sys.h"
+#include "osapi.h"
+#include "os_type.h"
+#include "user_interface.h"
+#include "spi_flash.h"
+#include "mem.h"
+
+#define ESP8266_MQTT_FLASH_QUEUE_MAGIC					(0x5146514D)
+#define ESP8266_MQTT_FLASH_QUEUE_SECTOR_HEADER_SIZE		(8)
+#define ESP8266_MQTT_FLASH_QUEUE_RECORD_HEADER_SIZE		(12)
+#define ESP8266_MQTT_FLASH_QUEUE_RECORD_PENDING			(0xFFFFFFFF)
+#define ESP8266_MQTT_FLASH_QUEUE_RECORD_CONSUMED		(0x00000000)
+#define ESP8266_MQTT_FLASH_QUEUE_CACHE_SIZE				(1024)
+#define ESP8266_MQTT_FLASH_QUEUE_FLUSH_MS				(100)
+#define ESP8266_MQTT_FLASH_QUEUE_FLAG_RAW				(0x80)	//QOS BYTE : BINARY PAYLOAD (NO LENGTH PREFIX)
+#define ESP8266_MQTT_FLASH_QUEUE_READ_SIZE(data_len)	((((data_len) + 3) & ~0x03) + 2)	//BUFFER NEEDED TO READ A RECORD BACK
+
+//CUSTOM VARIABLE STRUCTURES/////////////////////////////
+typedef struct
+{
+	uint16_t data_len;
+	uint8_t qos;
+	uint8_t reserved;
+	uint16_t topic_len;
+	uint16_t crc;
+	uint32_t status;
+}esp8266_mqtt_flash_queue_record_header_t;
+
+typedef struct
+{
+	uint32_t addr;
+	uint8_t qos;
+	char* topic;
+	uint16_t topic_len;
+	char* message;
+	uint16_t message_len;
+}esp8266_mqtt_flash_queue_record_t;
+//END CUSTOM VARIABLE STRUCTURES/////////////////////////
+
+//FUNCTION PROTOTYPES/////////////////////////////////////////////
+//CONFIGURATION FUNCTIONS
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_FLASH_QUEUE_Initialize(uint16_t start_sector, uint16_t sector_count);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_FLASH_QUEUE_SetDropCallback(void (*drop_cb)(uint32_t start_addr, uint32_t end_addr));
+
+//OPERATION FUNCTIONS
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_FLASH_QUEUE_Append(const char* topic,
+                                                        uint16_t topic_len,
+                                                        const char* message,
+                                                        uint16_t message_len,
+                                                        uint8_t qos);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_FLASH_QUEUE_Flush(void);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_FLASH_QUEUE_Read(esp8266_mqtt_flash_queue_record_t* record,
+                                                        uint8_t* buffer,
+                                                        uint16_t buffer_size);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_FLASH_QUEUE_ReadAt(uint32_t addr,
+                                                        esp8266_mqtt_flash_queue_record_t* record,
+                                                        uint8_t* buffer,
+                                                        uint16_t buffer_size);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_FLASH_QUEUE_Consume(uint32_t addr);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_FLASH_QUEUE_Rewind(void);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_FLASH_QUEUE_IsEmpty(void);
+
+#endif
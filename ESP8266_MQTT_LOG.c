@@ -0,0 +1,168 @@
+/**********************************************************************************
+* ESP8266 MQTT LOG
+*
+* NOTE
+* -----
+*   (1) DEFERRED BINARY LOG. SEE HEADER
+*
+*   (2) ONE RING FOR ALL CLIENT INSTANCES (ONE UART)
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_MQTT_LOG.h"
+
+//LOCAL LIBRARY VARIABLES////////////////////////////////
+//RING RELATED
+static esp8266_mqtt_log_record_t s_log_ring[ESP8266_MQTT_LOG_RING_SIZE];
+static uint16_t s_log_head = 0;
+static uint16_t s_log_count = 0;
+static uint32_t s_log_lost = 0;
+static uint8_t s_log_level = ESP8266_MQTT_LOG_LEVEL;
+
+//DRAIN TASK RELATED
+static bool s_log_auto_drain = false;
+static bool s_log_task_ready = false;
+static bool s_log_task_posted = false;
+static os_event_t s_log_task_queue[ESP8266_MQTT_LOG_TASK_QUEUE_LEN];
+
+static const char s_log_level_chars[] = "-EWIDT";
+//END LOCAL LIBRARY VARIABLES/////////////////////////////
+
+//LOCAL LIBRARY FUNCTIONS////////////////////////////////
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_log_post(void);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_log_task(os_event_t* event);
+//END LOCAL LIBRARY FUNCTIONS////////////////////////////////
+
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_LOG_SetLevel(uint8_t level)
+{
+    //SET THE RUN TIME LEVEL. RECORDS ABOVE IT ARE NOT STORED
+    //(CANNOT GO ABOVE THE COMPILE TIME ESP8266_MQTT_LOG_LEVEL)
+
+    s_log_level = level;
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_LOG_SetAutoDrain(bool enable)
+{
+    //ENABLE / DISABLE PRINTING RECORDS FROM A LOW PRIORITY TASK
+    //THE TASK USES SDK USER TASK PRIORITY ESP8266_MQTT_LOG_TASK_PRIO. IT MUST NOT
+    //BE USED BY THE APPLICATION
+
+    if(enable && !s_log_task_ready)
+    {
+        s_log_task_ready = system_os_task(s_esp8266_mqtt_log_task,
+                                            ESP8266_MQTT_LOG_TASK_PRIO,
+                                            s_log_task_queue,
+                                            ESP8266_MQTT_LOG_TASK_QUEUE_LEN);
+    }
+    s_log_auto_drain = enable;
+    if(enable && s_log_count > 0)
+    {
+        s_esp8266_mqtt_log_post();
+    }
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_LOG_Write(uint8_t level,
+                                                const char* format,
+                                                uint32_t a0,
+                                                uint32_t a1,
+                                                uint32_t a2,
+                                                uint32_t a3)
+{
+    //STORE ONE RECORD (CALLED THROUGH THE ESP8266_MQTT_LOG_xxx MACROS)
+    //RING FULL : THE OLDEST RECORD IS OVERWRITTEN
+
+    esp8266_mqtt_log_record_t* record;
+
+    if(level > s_log_level)
+    {
+        return;
+    }
+
+    record = &s_log_ring[(s_log_head + s_log_count) % ESP8266_MQTT_LOG_RING_SIZE];
+    if(s_log_count == ESP8266_MQTT_LOG_RING_SIZE)
+    {
+        s_log_head = (s_log_head + 1) % ESP8266_MQTT_LOG_RING_SIZE;
+        s_log_lost++;
+    }
+    else
+    {
+        s_log_count++;
+    }
+    record->time_us = system_get_time();
+    record->format = format;
+    record->args[0] = a0;
+    record->args[1] = a1;
+    record->args[2] = a2;
+    record->args[3] = a3;
+    record->level = level;
+
+    if(s_log_auto_drain)
+    {
+        s_esp8266_mqtt_log_post();
+    }
+}
+
+uint16_t ICACHE_FLASH_ATTR ESP8266_MQTT_LOG_Drain(uint16_t max_records)
+{
+    //FORMAT + PRINT UP TO max_records OLDEST RECORDS (0 = ALL)
+    //RETURN NUMBER OF RECORDS PRINTED
+
+    esp8266_mqtt_log_record_t* record;
+    uint16_t printed = 0;
+
+    if(s_log_lost > 0)
+    {
+        os_printf("ESP8266 MQTT : %u log records lost\n", s_log_lost);
+        s_log_lost = 0;
+    }
+    while(s_log_count > 0 && (max_records == 0 || printed < max_records))
+    {
+        record = &s_log_ring[s_log_head];
+        os_printf("ESP8266 MQTT [%u.%03u] %c : ",
+                    record->time_us / 1000000,
+                    (record->time_us / 1000) % 1000,
+                    s_log_level_chars[record->level]);
+        os_printf(record->format, record->args[0], record->args[1], record->args[2], record->args[3]);
+        os_printf("\n");
+
+        s_log_head = (s_log_head + 1) % ESP8266_MQTT_LOG_RING_SIZE;
+        s_log_count--;
+        printed++;
+    }
+    return printed;
+}
+
+uint16_t ICACHE_FLASH_ATTR ESP8266_MQTT_LOG_Pending(void)
+{
+    //RETURN NUMBER OF RECORDS WAITING TO BE PRINTED
+
+    return s_log_count;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_log_post(void)
+{
+    //WAKE THE DRAIN TASK (ONCE UNTIL IT RUNS)
+
+    if(s_log_task_ready && !s_log_task_posted)
+    {
+        s_log_task_posted = system_os_post(ESP8266_MQTT_LOG_TASK_PRIO, 0, 0);
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_log_task(os_event_t* event)
+{
+    //DRAIN TASK
+    //PRINT A FEW RECORDS AND YIELD. COME BACK LATER FOR THE REST
+
+    s_log_task_posted = false;
+    ESP8266_MQTT_LOG_Drain(ESP8266_MQTT_LOG_DRAIN_BATCH);
+    if(s_log_auto_drain && s_log_count > 0)
+    {
+        s_esp8266_mqtt_log_post();
+    }
+}
@@ -0,0 +1,112 @@
+/**********************************************************************************
+* ESP8266 MQTT LOG
+*
+* NOTE
+* -----
+*   (1) DEFERRED BINARY LOG USED BY THE MQTT LIBRARY INSTEAD OF INLINE os_printf.
+*       A LOG STATEMENT ONLY STORES A RECORD (TIMESTAMP, LEVEL, FORMAT STRING
+*       ADDRESS AS EVENT ID, UP TO 4 INTEGER ARGUMENTS) IN A RAM RING. NOTHING
+*       IS FORMATTED OR PRINTED ON THE HOT PATH
+*
+*   (2) STATEMENTS BELOW ESP8266_MQTT_LOG_LEVEL ARE COMPILED OUT (ARGUMENTS ARE
+*       NOT EVALUATED). DEFINE IT IN THE BUILD (-DESP8266_MQTT_LOG_LEVEL=4) TO
+*       CHANGE IT. ESP8266_MQTT_LOG_SetLevel LOWERS IT FURTHER AT RUN TIME
+*
+*   (3) RECORDS ARE FORMATTED + PRINTED LATER, ON DEMAND (ESP8266_MQTT_LOG_Drain)
+*       OR BY A LOW PRIORITY TASK (ESP8266_MQTT_LOG_SetAutoDrain) A FEW RECORDS
+*       AT A TIME. WHEN THE RING IS FULL THE OLDEST RECORD IS OVERWRITTEN (THE
+*       NUMBER LOST IS PRINTED WITH THE NEXT DRAIN)
+*
+*   (4) FORMAT STRINGS MUST BE STRING LITERALS (ONLY THEIR ADDRESS IS KEPT).
+*       ARGUMENTS ARE STORED AS uint32_t SO ONLY INTEGER CONVERSIONS (%u %d %x
+*       %c) CAN BE USED. NO %s
+*
+*   (5) LEVEL ESP8266_MQTT_LOG_LEVEL_TRACE ALSO COMPILES IN THE SYNCHRONOUS HEX
+*       DUMP OF EVERY PACKET (BENCH DEBUGGING ONLY)
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#ifndef _ESP8266_MQTT_LOG_H_
+#define _ESP8266_MQTT_LOG_H_
+
+#include "ets_sys.h"
+#include "osapi.h"
+#include "os_type.h"
+#include "user_interface.h"
+
+#define ESP8266_MQTT_LOG_LEVEL_NONE			(0)
+#define ESP8266_MQTT_LOG_LEVEL_ERROR		(1)
+#define ESP8266_MQTT_LOG_LEVEL_WARN			(2)
+#define ESP8266_MQTT_LOG_LEVEL_INFO			(3)
+#define ESP8266_MQTT_LOG_LEVEL_DEBUG		(4)
+#define ESP8266_MQTT_LOG_LEVEL_TRACE		(5)
+
+#ifndef ESP8266_MQTT_LOG_LEVEL
+#define ESP8266_MQTT_LOG_LEVEL				ESP8266_MQTT_LOG_LEVEL_INFO
+#endif
+
+#define ESP8266_MQTT_LOG_RING_SIZE			(32)
+#define ESP8266_MQTT_LOG_DRAIN_BATCH		(4)
+#define ESP8266_MQTT_LOG_TASK_PRIO			USER_TASK_PRIO_0
+#define ESP8266_MQTT_LOG_TASK_QUEUE_LEN		(1)
+
+//LOG STATEMENTS//////////////////////////////////////////////////
+//ESP8266_MQTT_LOG_xxx(FORMAT [, ARG0 [, ARG1 [, ARG2 [, ARG3]]]])
+#define ESP8266_MQTT_LOG_RECORD(level, format, a0, a1, a2, a3, ...) \
+			ESP8266_MQTT_LOG_Write((level), (format), (uint32_t)(a0), (uint32_t)(a1), (uint32_t)(a2), (uint32_t)(a3))
+
+#if ESP8266_MQTT_LOG_LEVEL >= ESP8266_MQTT_LOG_LEVEL_ERROR
+#define ESP8266_MQTT_LOG_ERROR(...)	ESP8266_MQTT_LOG_RECORD(ESP8266_MQTT_LOG_LEVEL_ERROR, __VA_ARGS__, 0, 0, 0, 0)
+#else
+#define ESP8266_MQTT_LOG_ERROR(...)	do {} while(0)
+#endif
+
+#if ESP8266_MQTT_LOG_LEVEL >= ESP8266_MQTT_LOG_LEVEL_WARN
+#define ESP8266_MQTT_LOG_WARN(...)	ESP8266_MQTT_LOG_RECORD(ESP8266_MQTT_LOG_LEVEL_WARN, __VA_ARGS__, 0, 0, 0, 0)
+#else
+#define ESP8266_MQTT_LOG_WARN(...)	do {} while(0)
+#endif
+
+#if ESP8266_MQTT_LOG_LEVEL >= ESP8266_MQTT_LOG_LEVEL_INFO
+#define ESP8266_MQTT_LOG_INFO(...)	ESP8266_MQTT_LOG_RECORD(ESP8266_MQTT_LOG_LEVEL_INFO, __VA_ARGS__, 0, 0, 0, 0)
+#else
+#define ESP8266_MQTT_LOG_INFO(...)	do {} while(0)
+#endif
+
+#if ESP8266_MQTT_LOG_LEVEL >= ESP8266_MQTT_LOG_LEVEL_DEBUG
+#define ESP8266_MQTT_LOG_DEBUG(...)	ESP8266_MQTT_LOG_RECORD(ESP8266_MQTT_LOG_LEVEL_DEBUG, __VA_ARGS__, 0, 0, 0, 0)
+#else
+#define ESP8266_MQTT_LOG_DEBUG(...)	do {} while(0)
+#endif
+//END LOG STATEMENTS//////////////////////////////////////////////
+
+//CUSTOM VARIABLE STRUCTURES/////////////////////////////
+typedef struct
+{
+	uint32_t time_us;
+	const char* format;		//EVENT ID (ADDRESS OF THE FORMAT STRING LITERAL)
+	uint32_t args[4];
+	uint8_t level;
+}esp8266_mqtt_log_record_t;
+//END CUSTOM VARIABLE STRUCTURES/////////////////////////
+
+//FUNCTION PROTOTYPES/////////////////////////////////////////////
+//CONFIGURATION FUNCTIONS
+void ICACHE_FLASH_ATTR ESP8266_MQTT_LOG_SetLevel(uint8_t level);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_LOG_SetAutoDrain(bool enable);
+
+//OPERATION FUNCTIONS
+void ICACHE_FLASH_ATTR ESP8266_MQTT_LOG_Write(uint8_t level,
+                                                const char* format,
+                                                uint32_t a0,
+                                                uint32_t a1,
+                                                uint32_t a2,
+                                                uint32_t a3);
+uint16_t ICACHE_FLASH_ATTR ESP8266_MQTT_LOG_Drain(uint16_t max_records);
+uint16_t ICACHE_FLASH_ATTR ESP8266_MQTT_LOG_Pending(void);
+
+#endif
@@ -0,0 +1,218 @@
+/**********************************************************************************
+* ESP8266 MQTT POOL
+*
+* NOTE
+* -----
+*   (1) ROUTES PUBLISHES ACROSS SEVERAL MQTT CLIENT INSTANCES. SEE HEADER
+*
+*   (2) MEMBERS ARE RANKED AGAIN FOR EVERY PUBLISH (AT MOST
+*       ESP8266_MQTT_POOL_MEMBERS_MAX, SO A SIMPLE INSERTION SORT)
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_MQTT_POOL.h"
+
+//LOCAL LIBRARY FUNCTIONS////////////////////////////////
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_pool_healthy(esp8266_mqtt_pool_member_t* member,
+                                                            uint32_t now,
+                                                            uint8_t* inflight_count);
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_pool_better(esp8266_mqtt_pool_member_t* a,
+                                                            bool a_healthy,
+                                                            uint8_t a_inflight,
+                                                            esp8266_mqtt_pool_member_t* b,
+                                                            bool b_healthy,
+                                                            uint8_t b_inflight);
+static uint8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_pool_rank(esp8266_mqtt_pool_t* pool, uint8_t* order);
+//END LOCAL LIBRARY FUNCTIONS////////////////////////////////
+
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_POOL_Initialize(esp8266_mqtt_pool_t* pool)
+{
+    //SET UP AN EMPTY POOL
+
+    os_memset(pool, 0, sizeof(esp8266_mqtt_pool_t));
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_POOL_Add(esp8266_mqtt_pool_t* pool,
+                                                esp8266_mqtt_client_t* client,
+                                                uint8_t priority)
+{
+    //ADD A CLIENT INSTANCE TO THE POOL (priority 0 = PRIMARY, HIGHER = FALLBACK)
+    //RETURN FALSE IF THE POOL IS FULL OR THE INSTANCE IS ALREADY A MEMBER
+
+    uint8_t i;
+    esp8266_mqtt_pool_member_t* member;
+
+    if(client == NULL || pool->count >= ESP8266_MQTT_POOL_MEMBERS_MAX)
+    {
+        return false;
+    }
+    for(i = 0; i < pool->count; i++)
+    {
+        if(pool->members[i].client == client)
+        {
+            return false;
+        }
+    }
+
+    member = &pool->members[pool->count++];
+    os_memset(member, 0, sizeof(esp8266_mqtt_pool_member_t));
+    member->client = client;
+    member->priority = priority;
+    return true;
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_POOL_Remove(esp8266_mqtt_pool_t* pool, esp8266_mqtt_client_t* client)
+{
+    //REMOVE A CLIENT INSTANCE FROM THE POOL
+
+    uint8_t i;
+
+    for(i = 0; i < pool->count; i++)
+    {
+        if(pool->members[i].client == client)
+        {
+            pool->count--;
+            os_memmove(&pool->members[i],
+                        &pool->members[i + 1],
+                        (pool->count - i) * sizeof(esp8266_mqtt_pool_member_t));
+            return;
+        }
+    }
+}
+
+esp8266_mqtt_client_t* ICACHE_FLASH_ATTR ESP8266_MQTT_POOL_Pick(esp8266_mqtt_pool_t* pool)
+{
+    //RETURN THE HEALTHIEST MEMBER (NULL IF THE POOL IS EMPTY)
+    //FOR TRAFFIC THE POOL DOES NOT PUBLISH ITSELF (SUBSCRIBE, STREAMS ...)
+
+    uint8_t order[ESP8266_MQTT_POOL_MEMBERS_MAX];
+
+    if(s_esp8266_mqtt_pool_rank(pool, order) == 0)
+    {
+        return NULL;
+    }
+    return pool->members[order[0]].client;
+}
+
+esp8266_mqtt_client_t* ICACHE_FLASH_ATTR ESP8266_MQTT_POOL_Publish(esp8266_mqtt_pool_t* pool,
+                                                                    char* topic,
+                                                                    char* message,
+                                                                    esp8266_mqtt_qos_t qos_level,
+                                                                    void (*complete_cb)(void*, bool),
+                                                                    void* cb_arg)
+{
+    //PUBLISH THROUGH THE HEALTHIEST MEMBER. A MEMBER THAT REFUSES THE PUBLISH
+    //GOES INTO HOLDOFF AND THE NEXT ONE IS TRIED
+    //RETURN THE INSTANCE THAT TOOK THE PUBLISH OR NULL IF ALL REFUSED IT
+
+    uint8_t order[ESP8266_MQTT_POOL_MEMBERS_MAX];
+    uint8_t count;
+    uint8_t i;
+    esp8266_mqtt_pool_member_t* member;
+    esp8266_mqtt_client_t* previous;
+    bool accepted;
+
+    count = s_esp8266_mqtt_pool_rank(pool, order);
+    for(i = 0; i < count; i++)
+    {
+        member = &pool->members[order[i]];
+
+        previous = ESP8266_MQTT_CLIENT_Select(member->client);
+        accepted = ESP8266_MQTT_CLIENT_Send_PublishWithCb(topic, message, qos_level, complete_cb, cb_arg);
+        ESP8266_MQTT_CLIENT_Select(previous);
+
+        if(accepted)
+        {
+            member->published++;
+            member->holdoff = false;
+            return member->client;
+        }
+        member->refused++;
+        member->holdoff = true;
+        member->holdoff_time_us = system_get_time();
+    }
+    return NULL;
+}
+
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_pool_healthy(esp8266_mqtt_pool_member_t* member,
+                                                            uint32_t now,
+                                                            uint8_t* inflight_count)
+{
+    //RETURN TRUE IF THE MEMBER IS CONNECTED AND NOT IN HOLDOFF
+    //ALSO RETURN ITS NUMBER OF MESSAGES IN FLIGHT
+
+    esp8266_mqtt_client_t* previous;
+    bool connected;
+
+    if(member->holdoff &&
+        (now - member->holdoff_time_us) >= ((uint32_t)ESP8266_MQTT_POOL_HOLDOFF_MS * 1000))
+    {
+        member->holdoff = false;
+    }
+
+    previous = ESP8266_MQTT_CLIENT_Select(member->client);
+    connected = ESP8266_MQTT_CLIENT_IsConnected();
+    *inflight_count = ESP8266_MQTT_CLIENT_GetInflightCount();
+    ESP8266_MQTT_CLIENT_Select(previous);
+
+    return (connected && !member->holdoff);
+}
+
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_pool_better(esp8266_mqtt_pool_member_t* a,
+                                                            bool a_healthy,
+                                                            uint8_t a_inflight,
+                                                            esp8266_mqtt_pool_member_t* b,
+                                                            bool b_healthy,
+                                                            uint8_t b_inflight)
+{
+    //RETURN TRUE IF MEMBER a SHOULD BE TRIED BEFORE MEMBER b
+
+    if(a_healthy != b_healthy)
+    {
+        return a_healthy;
+    }
+    if(a->priority != b->priority)
+    {
+        return (a->priority < b->priority);
+    }
+    return (a_inflight < b_inflight);
+}
+
+static uint8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_pool_rank(esp8266_mqtt_pool_t* pool, uint8_t* order)
+{
+    //FILL order WITH MEMBER INDEXES, HEALTHIEST FIRST
+    //RETURN NUMBER OF MEMBERS
+
+    bool healthy[ESP8266_MQTT_POOL_MEMBERS_MAX];
+    uint8_t inflight[ESP8266_MQTT_POOL_MEMBERS_MAX];
+    uint32_t now = system_get_time();
+    uint8_t i;
+    uint8_t j;
+    uint8_t index;
+
+    for(i = 0; i < pool->count; i++)
+    {
+        healthy[i] = s_esp8266_mqtt_pool_healthy(&pool->members[i], now, &inflight[i]);
+
+        //INSERTION SORT (STABLE, EQUAL MEMBERS KEEP THEIR ADD ORDER)
+        j = i;
+        while(j > 0)
+        {
+            index = order[j - 1];
+            if(!s_esp8266_mqtt_pool_better(&pool->members[i], healthy[i], inflight[i],
+                                            &pool->members[index], healthy[index], inflight[index]))
+            {
+                break;
+            }
+            order[j] = index;
+            j--;
+        }
+        order[j] = i;
+    }
+    return pool->count;
+}
@@ -0,0 +1,81 @@
+/**********************************************************************************
+* ESP8266 MQTT POOL
+*
+* NOTE
+* -----
+*   (1) ROUTES PUBLISHES ACROSS SEVERAL MQTT CLIENT INSTANCES (EG A PRIMARY AND A
+*       FALLBACK BROKER). EACH PUBLISH GOES TO THE HEALTHIEST MEMBER
+*         - CONNECTED MEMBERS NOT IN FAILURE HOLDOFF FIRST
+*         - THEN LOWEST PRIORITY VALUE (0 = PRIMARY)
+*         - THEN FEWEST QOS 1 / 2 MESSAGES IN FLIGHT
+*
+*   (2) A MEMBER THAT REFUSES A PUBLISH (WINDOW FULL, TX BUFFER BUSY, NOT
+*       CONNECTED) IS PUT IN HOLDOFF FOR ESP8266_MQTT_POOL_HOLDOFF_MS AND THE
+*       SAME PUBLISH IS OFFERED TO THE NEXT MEMBER RIGHT AWAY. THE CALLER NEVER
+*       WAITS FOR A BAD CONNECTION
+*
+*   (3) IF NO MEMBER IS CONNECTED THE PUBLISH STILL GOES TO THE BEST MEMBER (ITS
+*       OFFLINE QUEUE, IF ENABLED, STORES IT)
+*
+*   (4) THE POOL DOES NOT OWN THE INSTANCES. CONNECT / DISCONNECT THEM AS USUAL
+*       (ESP8266_MQTT_CLIENT_Select + ESP8266_MQTT_CLIENT_xxx)
+*
+*   (5) AT MOST ONE MEMBER CAN BE ON THE DEFAULT TRANSPORT (ESP8266_TCP_GENERIC
+*       HAS ONE CONNECTION). EVERY OTHER MEMBER NEEDS ITS OWN TRANSPORT
+*       (ESP8266_MQTT_CLIENT_SetTransport BEFORE ESP8266_MQTT_CLIENT_Initialize)
+*       OR ITS INITIALIZE FAILS AND IT NEVER CONNECTS
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#ifndef _ESP8266_MQTT_POOL_H_
+#define _ESP8266_MQTT_POOL_H_
+
+#include "ets_sys.h"
+#include "osapi.h"
+#include "os_type.h"
+#include "user_interface.h"
+#include "ESP8266_MQTT_CLIENT.h"
+
+#define ESP8266_MQTT_POOL_MEMBERS_MAX		(4)
+#define ESP8266_MQTT_POOL_HOLDOFF_MS		(5000)
+
+//CUSTOM VARIABLE STRUCTURES/////////////////////////////
+typedef struct
+{
+	esp8266_mqtt_client_t* client;
+	uint8_t priority;			//LOWER IS PREFERRED
+	uint32_t holdoff_time_us;	//TIME OF LAST REFUSED PUBLISH
+	bool holdoff;
+	uint32_t published;			//PUBLISHES ACCEPTED
+	uint32_t refused;			//PUBLISHES REFUSED
+}esp8266_mqtt_pool_member_t;
+
+typedef struct
+{
+	esp8266_mqtt_pool_member_t members[ESP8266_MQTT_POOL_MEMBERS_MAX];
+	uint8_t count;
+}esp8266_mqtt_pool_t;
+//END CUSTOM VARIABLE STRUCTURES/////////////////////////
+
+//FUNCTION PROTOTYPES/////////////////////////////////////////////
+//CONFIGURATION FUNCTIONS
+void ICACHE_FLASH_ATTR ESP8266_MQTT_POOL_Initialize(esp8266_mqtt_pool_t* pool);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_POOL_Add(esp8266_mqtt_pool_t* pool,
+                                                esp8266_mqtt_client_t* client,
+                                                uint8_t priority);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_POOL_Remove(esp8266_mqtt_pool_t* pool, esp8266_mqtt_client_t* client);
+
+//OPERATION FUNCTIONS
+esp8266_mqtt_client_t* ICACHE_FLASH_ATTR ESP8266_MQTT_POOL_Pick(esp8266_mqtt_pool_t* pool);
+esp8266_mqtt_client_t* ICACHE_FLASH_ATTR ESP8266_MQTT_POOL_Publish(esp8266_mqtt_pool_t* pool,
+                                                                    char* topic,
+                                                                    char* message,
+                                                                    esp8266_mqtt_qos_t qos_level,
+                                                                    void (*complete_cb)(void*, bool),
+                                                                    void* cb_arg);
+
+#endif
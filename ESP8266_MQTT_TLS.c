@@ -0,0 +1,590 @@
+/**********************************************************************************
+* ESP8266 MQTT TLS
+*
+* NOTE
+* -----
+*   (1) TLS TRANSPORT FOR THE MQTT CLIENT WITH A SESSION CACHE. SEE HEADER
+*
+*   (2) ESPCONN CBS GET THE struct espconn. ITS reverse FIELD POINTS BACK AT
+*       THE esp8266_mqtt_tls_t
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_MQTT_TLS.h"
+
+//LOCAL LIBRARY FUNCTIONS////////////////////////////////
+//TRANSPORT OPERATIONS
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_initialize(void* ctx,
+                                                            const char* hostname,
+                                                            const char* host_ip,
+                                                            uint16_t host_port,
+                                                            uint16_t buffer_size);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_set_dns_server(void* ctx, char num_dns, ip_addr_t* dns);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_set_callback_functions(void* ctx,
+                                                                        void* cb_arg,
+                                                                        void (*conn_cb)(void*),
+                                                                        void (*discon_cb)(void*),
+                                                                        void (*send_cb)(void*),
+                                                                        void (*recv_cb)(void*, char*, unsigned short),
+                                                                        void (*dns_cb)(void*, ip_addr_t*));
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_resolve_host_name(void* ctx);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_connect(void* ctx);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_disconnect(void* ctx);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_send(void* ctx, uint8_t* data, uint16_t len);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_set_host_ip(void* ctx, ip_addr_t* ip);
+
+//ESPCONN CBS
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_dns_found_cb(const char* name, ip_addr_t* ipAddr, void* arg);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_conn_cb(void* arg);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_reconn_cb(void* arg, sint8 err);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_discon_cb(void* arg);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_sent_cb(void* arg);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_recv_cb(void* arg, char* pusrdata, unsigned short length);
+
+//SESSION CACHE
+static uint32_t ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_hash(const uint8_t* data, uint16_t len);
+static uint32_t ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_session_age(esp8266_mqtt_tls_t* tls);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_session_load(esp8266_mqtt_tls_t* tls);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_handshake_record(esp8266_mqtt_tls_t* tls,
+                                                                    esp8266_mqtt_tls_handshake_stats_t* stats,
+                                                                    uint32_t elapsed_us);
+//END LOCAL LIBRARY FUNCTIONS////////////////////////////////
+
+//RTC LAYOUT CHECK. THE BUILD FAILS (NEGATIVE ARRAY SIZE) IF THE DEFAULT
+//BLOCKS OF THE TLS SESSION, DNS CACHE AND SUSPEND RECORDS OVERLAP OR LEAVE
+//RTC USER MEMORY (BLOCKS 64 - 191)
+#define ESP8266_MQTT_TLS_RTC_APART(a, a_blocks, b, b_blocks)	((a) + (a_blocks) <= (b) || (b) + (b_blocks) <= (a))
+#define ESP8266_MQTT_TLS_RTC_INSIDE(a, a_blocks)				((a) >= 64 && (a) + (a_blocks) <= 192)
+
+typedef char s_esp8266_mqtt_tls_rtc_layout_check[(ESP8266_MQTT_TLS_RTC_INSIDE(ESP8266_MQTT_RTC_BLOCK_TLS_SESSION,
+                                                                                ESP8266_MQTT_TLS_SESSION_RTC_BLOCKS) &&
+                                                    ESP8266_MQTT_TLS_RTC_INSIDE(ESP8266_MQTT_RTC_BLOCK_DNS_CACHE,
+                                                                                ESP8266_MQTT_CLIENT_DNS_CACHE_RTC_BLOCKS) &&
+                                                    ESP8266_MQTT_TLS_RTC_INSIDE(ESP8266_MQTT_RTC_BLOCK_SUSPEND,
+                                                                                ESP8266_MQTT_CLIENT_SUSPEND_RTC_BLOCKS) &&
+                                                    ESP8266_MQTT_TLS_RTC_APART(ESP8266_MQTT_RTC_BLOCK_TLS_SESSION,
+                                                                                ESP8266_MQTT_TLS_SESSION_RTC_BLOCKS,
+                                                                                ESP8266_MQTT_RTC_BLOCK_DNS_CACHE,
+                                                                                ESP8266_MQTT_CLIENT_DNS_CACHE_RTC_BLOCKS) &&
+                                                    ESP8266_MQTT_TLS_RTC_APART(ESP8266_MQTT_RTC_BLOCK_TLS_SESSION,
+                                                                                ESP8266_MQTT_TLS_SESSION_RTC_BLOCKS,
+                                                                                ESP8266_MQTT_RTC_BLOCK_SUSPEND,
+                                                                                ESP8266_MQTT_CLIENT_SUSPEND_RTC_BLOCKS) &&
+                                                    ESP8266_MQTT_TLS_RTC_APART(ESP8266_MQTT_RTC_BLOCK_DNS_CACHE,
+                                                                                ESP8266_MQTT_CLIENT_DNS_CACHE_RTC_BLOCKS,
+                                                                                ESP8266_MQTT_RTC_BLOCK_SUSPEND,
+                                                                                ESP8266_MQTT_CLIENT_SUSPEND_RTC_BLOCKS)) ? 1 : -1];
+
+//LOCAL LIBRARY VARIABLES////////////////////////////////
+static const esp8266_mqtt_transport_t s_transport_tls = {s_esp8266_mqtt_tls_initialize,
+                                                            s_esp8266_mqtt_tls_set_dns_server,
+                                                            s_esp8266_mqtt_tls_set_callback_functions,
+                                                            s_esp8266_mqtt_tls_resolve_host_name,
+                                                            s_esp8266_mqtt_tls_connect,
+                                                            s_esp8266_mqtt_tls_disconnect,
+                                                            s_esp8266_mqtt_tls_send,
+                                                            s_esp8266_mqtt_tls_set_host_ip};
+//END LOCAL LIBRARY VARIABLES/////////////////////////////
+
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_TLS_Initialize(esp8266_mqtt_tls_t* tls)
+{
+    //SET UP A TLS TRANSPORT CONTEXT (NO SESSION CACHE, NO CERTIFICATE
+    //VERIFICATION)
+
+    os_memset(tls, 0, sizeof(esp8266_mqtt_tls_t));
+    tls->session_lifetime_s = ESP8266_MQTT_TLS_SESSION_LIFETIME_DEFAULT_S;
+}
+
+const esp8266_mqtt_transport_t* ICACHE_FLASH_ATTR ESP8266_MQTT_TLS_GetTransport(void)
+{
+    //RETURN THE TLS TRANSPORT OPERATIONS (FOR ESP8266_MQTT_CLIENT_SetTransport)
+
+    return &s_transport_tls;
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_TLS_SetCaSector(esp8266_mqtt_tls_t* tls, uint32_t ca_sector)
+{
+    //VERIFY THE BROKER CERTIFICATE AGAINST THE CA STORED AT FLASH SECTOR
+    //ca_sector (0 = NO VERIFICATION). USED FROM THE NEXT CONNECT
+
+    tls->ca_sector = ca_sector;
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_TLS_SetSessionCache(esp8266_mqtt_tls_t* tls,
+                                                        bool enable,
+                                                        uint32_t lifetime_s,
+                                                        uint8_t rtc_block)
+{
+    //ENABLE / DISABLE THE TLS SESSION CACHE
+    //lifetime_s : SECONDS A SESSION IS OFFERED FOR RESUMPTION (0 = DEFAULT,
+    //             CAPPED TO ESP8266_MQTT_TLS_SESSION_LIFETIME_MAX_S)
+    //rtc_block : FIRST RTC USER MEMORY BLOCK (64 - 191) TO KEEP THE SESSION IN
+    //            ACROSS DEEP SLEEP (0 = RAM ONLY). A SESSION ALREADY THERE FOR
+    //            THE SAME BROKER IS LOADED (NOW OR WHEN THE CLIENT IS INITIALIZED)
+    //RETURN FALSE IF THE RTC BLOCK RANGE IS INVALID
+
+    if(rtc_block != 0 &&
+        (rtc_block < 64 || (rtc_block + ESP8266_MQTT_TLS_SESSION_RTC_BLOCKS) > 192))
+    {
+        return false;
+    }
+
+    tls->flag_session_cache = enable;
+    tls->session_valid = false;
+    if(!enable)
+    {
+        return true;
+    }
+
+    if(lifetime_s == 0)
+    {
+        lifetime_s = ESP8266_MQTT_TLS_SESSION_LIFETIME_DEFAULT_S;
+    }
+    if(lifetime_s > ESP8266_MQTT_TLS_SESSION_LIFETIME_MAX_S)
+    {
+        //system_get_time WRAPS AFTER ~71 MINUTES
+        lifetime_s = ESP8266_MQTT_TLS_SESSION_LIFETIME_MAX_S;
+    }
+    tls->session_lifetime_s = lifetime_s;
+    tls->session_rtc_block = rtc_block;
+    s_esp8266_mqtt_tls_session_load(tls);
+    return true;
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_TLS_SetSessionHooks(esp8266_mqtt_tls_t* tls,
+                                                        const esp8266_mqtt_tls_session_hooks_t* hooks,
+                                                        void* engine_arg)
+{
+    //SET THE TLS ENGINE SESSION HOOKS (NULL = NO RESUMPTION)
+
+    tls->session_hooks = hooks;
+    tls->engine_arg = engine_arg;
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_TLS_SaveSession(esp8266_mqtt_tls_t* tls, uint32_t sleep_s)
+{
+    //WRITE THE CACHED SESSION TO RTC MEMORY BEFORE DEEP SLEEP
+    //sleep_s IS COUNTED AS AGE SO THE SESSION EXPIRES ON TIME AFTER WAKE UP.
+    //A SESSION THAT EXPIRES BEFORE WAKE UP IS NOT WRITTEN
+
+    esp8266_mqtt_tls_session_record_t record;
+    uint32_t age;
+
+    if(!tls->flag_session_cache || !tls->session_valid || tls->session_rtc_block == 0)
+    {
+        return;
+    }
+    age = s_esp8266_mqtt_tls_session_age(tls) + sleep_s;
+    if(age >= tls->session_lifetime_s)
+    {
+        ESP8266_MQTT_TLS_DropSession(tls);
+        return;
+    }
+
+    os_memset(&record, 0, sizeof(record));
+    record.magic = ESP8266_MQTT_TLS_SESSION_MAGIC;
+    record.key_hash = tls->session_key_hash;
+    record.lifetime_left_s = tls->session_lifetime_s - age;
+    os_memcpy(&record.session, &tls->session, sizeof(esp8266_mqtt_tls_session_t));
+    record.checksum = s_esp8266_mqtt_tls_hash((uint8_t*)&record, sizeof(record) - 4);
+    system_rtc_mem_write(tls->session_rtc_block, &record, sizeof(record));
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_TLS_DropSession(esp8266_mqtt_tls_t* tls)
+{
+    //FORGET THE CACHED SESSION (RAM + RTC MEMORY). THE NEXT HANDSHAKE IS FULL
+
+    esp8266_mqtt_tls_session_record_t record;
+
+    tls->session_valid = false;
+    os_memset(&tls->session, 0, sizeof(esp8266_mqtt_tls_session_t));
+    if(tls->session_rtc_block != 0)
+    {
+        os_memset(&record, 0, sizeof(record));
+        system_rtc_mem_write(tls->session_rtc_block, &record, sizeof(record));
+    }
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_TLS_GetStats(esp8266_mqtt_tls_t* tls, esp8266_mqtt_tls_stats_t* stats)
+{
+    //COPY A SNAPSHOT OF THE HANDSHAKE / TRAFFIC STATS
+
+    os_memcpy(stats, &tls->stats, sizeof(esp8266_mqtt_tls_stats_t));
+}
+
+//INTERNAL FUNCTIONS
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_initialize(void* ctx,
+                                                            const char* hostname,
+                                                            const char* host_ip,
+                                                            uint16_t host_port,
+                                                            uint16_t buffer_size)
+{
+    //TLS TRANSPORT INITIALIZE
+    //buffer_size IS THE MQTT CLIENT BUFFER. THE TLS RECORD BUFFER IS SET
+    //SEPARATELY (ESP8266_MQTT_TLS_BUFFER_SIZE)
+
+    esp8266_mqtt_tls_t* tls = (esp8266_mqtt_tls_t*)ctx;
+    uint8_t key[2];
+
+    tls->hostname = hostname;
+    tls->host_port = host_port;
+    tls->host_ip.addr = (host_ip != NULL && host_ip[0] != '\0') ? ipaddr_addr(host_ip) : 0;
+    tls->handshaking = false;
+
+    os_memset(&tls->conn, 0, sizeof(struct espconn));
+    os_memset(&tls->tcp, 0, sizeof(esp_tcp));
+    tls->conn.type = ESPCONN_TCP;
+    tls->conn.state = ESPCONN_NONE;
+    tls->conn.proto.tcp = &tls->tcp;
+    tls->conn.reverse = tls;
+    tls->tcp.remote_port = host_port;
+    espconn_regist_connectcb(&tls->conn, s_esp8266_mqtt_tls_conn_cb);
+    espconn_regist_reconcb(&tls->conn, s_esp8266_mqtt_tls_reconn_cb);
+    espconn_regist_disconcb(&tls->conn, s_esp8266_mqtt_tls_discon_cb);
+    espconn_regist_sentcb(&tls->conn, s_esp8266_mqtt_tls_sent_cb);
+    espconn_regist_recvcb(&tls->conn, s_esp8266_mqtt_tls_recv_cb);
+    espconn_secure_set_size(ESPCONN_CLIENT, ESP8266_MQTT_TLS_BUFFER_SIZE);
+
+    //SESSION KEY : HOST NAME (OR IP) + PORT
+    key[0] = (uint8_t)(host_port >> 8);
+    key[1] = (uint8_t)(host_port & 0xFF);
+    tls->session_key_hash = s_esp8266_mqtt_tls_hash((const uint8_t*)key, 2);
+    if(hostname != NULL && hostname[0] != '\0')
+    {
+        tls->session_key_hash ^= s_esp8266_mqtt_tls_hash((const uint8_t*)hostname, os_strlen(hostname));
+    }
+    else
+    {
+        tls->session_key_hash ^= s_esp8266_mqtt_tls_hash((const uint8_t*)&tls->host_ip.addr, 4);
+    }
+    if(tls->flag_session_cache && !tls->session_valid)
+    {
+        s_esp8266_mqtt_tls_session_load(tls);
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_set_dns_server(void* ctx, char num_dns, ip_addr_t* dns)
+{
+    //TLS TRANSPORT SET DNS SERVER
+
+    espconn_dns_setserver(num_dns, dns);
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_set_callback_functions(void* ctx,
+                                                                        void* cb_arg,
+                                                                        void (*conn_cb)(void*),
+                                                                        void (*discon_cb)(void*),
+                                                                        void (*send_cb)(void*),
+                                                                        void (*recv_cb)(void*, char*, unsigned short),
+                                                                        void (*dns_cb)(void*, ip_addr_t*))
+{
+    //TLS TRANSPORT SET CB FUNCTIONS
+
+    esp8266_mqtt_tls_t* tls = (esp8266_mqtt_tls_t*)ctx;
+
+    tls->cb_arg = cb_arg;
+    tls->conn_cb = conn_cb;
+    tls->discon_cb = discon_cb;
+    tls->send_cb = send_cb;
+    tls->recv_cb = recv_cb;
+    tls->dns_cb = dns_cb;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_resolve_host_name(void* ctx)
+{
+    //TLS TRANSPORT RESOLVE HOST NAME
+    //AN ADDRESS ALREADY IN THE LWIP DNS TABLE IS REPORTED RIGHT AWAY
+
+    esp8266_mqtt_tls_t* tls = (esp8266_mqtt_tls_t*)ctx;
+    ip_addr_t ip;
+    err_t result;
+
+    if(tls->hostname == NULL || tls->hostname[0] == '\0')
+    {
+        s_esp8266_mqtt_tls_dns_found_cb(NULL, (tls->host_ip.addr != 0) ? &tls->host_ip : NULL, &tls->conn);
+        return;
+    }
+    result = espconn_gethostbyname(&tls->conn, tls->hostname, &ip, s_esp8266_mqtt_tls_dns_found_cb);
+    if(result == ESPCONN_OK)
+    {
+        s_esp8266_mqtt_tls_dns_found_cb(tls->hostname, &ip, &tls->conn);
+    }
+    else if(result != ESPCONN_INPROGRESS)
+    {
+        s_esp8266_mqtt_tls_dns_found_cb(tls->hostname, NULL, &tls->conn);
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_connect(void* ctx)
+{
+    //TLS TRANSPORT CONNECT
+    //OFFER THE CACHED SESSION (IF STILL WITHIN ITS LIFETIME) AND START THE
+    //TCP CONNECT + HANDSHAKE. THE CONNECT CB COMES ONCE THE HANDSHAKE IS DONE
+
+    esp8266_mqtt_tls_t* tls = (esp8266_mqtt_tls_t*)ctx;
+
+    os_memcpy(tls->tcp.remote_ip, &tls->host_ip.addr, 4);
+    tls->tcp.remote_port = tls->host_port;
+    tls->tcp.local_port = espconn_port();
+
+    if(tls->ca_sector != 0)
+    {
+        espconn_secure_ca_enable(ESPCONN_CLIENT, tls->ca_sector);
+    }
+    else
+    {
+        espconn_secure_ca_disable(ESPCONN_CLIENT);
+    }
+
+    tls->session_offered = false;
+    if(tls->flag_session_cache && tls->session_valid &&
+        s_esp8266_mqtt_tls_session_age(tls) >= tls->session_lifetime_s)
+    {
+        ESP8266_MQTT_TLS_DropSession(tls);
+    }
+    if(tls->flag_session_cache && tls->session_valid &&
+        tls->session_hooks != NULL && tls->session_hooks->offer != NULL)
+    {
+        (*tls->session_hooks->offer)(tls->engine_arg, &tls->session);
+        tls->session_offered = true;
+    }
+
+    tls->handshaking = true;
+    tls->handshake_start_us = system_get_time();
+    tls->handshake_wire_sent = 0;
+    tls->handshake_wire_received = 0;
+    if(tls->session_hooks != NULL && tls->session_hooks->wire_bytes != NULL)
+    {
+        (*tls->session_hooks->wire_bytes)(tls->engine_arg, &tls->handshake_wire_sent, &tls->handshake_wire_received);
+    }
+    if(espconn_secure_connect(&tls->conn) != ESPCONN_OK)
+    {
+        s_esp8266_mqtt_tls_reconn_cb(&tls->conn, ESPCONN_ARG);
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_disconnect(void* ctx)
+{
+    //TLS TRANSPORT DISCONNECT
+
+    esp8266_mqtt_tls_t* tls = (esp8266_mqtt_tls_t*)ctx;
+
+    espconn_secure_disconnect(&tls->conn);
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_send(void* ctx, uint8_t* data, uint16_t len)
+{
+    //TLS TRANSPORT SEND
+
+    esp8266_mqtt_tls_t* tls = (esp8266_mqtt_tls_t*)ctx;
+
+    tls->stats.bytes_sent += len;
+    espconn_secure_send(&tls->conn, data, len);
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_set_host_ip(void* ctx, ip_addr_t* ip)
+{
+    //TLS TRANSPORT SET HOST IP (CLIENT DNS CACHE)
+
+    esp8266_mqtt_tls_t* tls = (esp8266_mqtt_tls_t*)ctx;
+
+    tls->host_ip = *ip;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_dns_found_cb(const char* name, ip_addr_t* ipAddr, void* arg)
+{
+    //DNS RESULT -> CLIENT (NULL ipAddr = FAILED)
+
+    esp8266_mqtt_tls_t* tls = (esp8266_mqtt_tls_t*)((struct espconn*)arg)->reverse;
+
+    if(ipAddr != NULL)
+    {
+        tls->host_ip = *ipAddr;
+    }
+    if(tls->dns_cb != NULL)
+    {
+        (*tls->dns_cb)(tls->cb_arg, ipAddr);
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_conn_cb(void* arg)
+{
+    //SECURE CONNECT CB (HANDSHAKE DONE) -> CLIENT
+    //RECORD THE HANDSHAKE TIME AND KEEP THE NEW SESSION FOR THE NEXT CONNECT
+
+    esp8266_mqtt_tls_t* tls = (esp8266_mqtt_tls_t*)((struct espconn*)arg)->reverse;
+    uint32_t elapsed_us = system_get_time() - tls->handshake_start_us;
+    bool resumed = false;
+
+    tls->handshaking = false;
+    if(tls->session_hooks != NULL && tls->session_hooks->fetch != NULL)
+    {
+        if((*tls->session_hooks->fetch)(tls->engine_arg, &tls->session, &resumed) &&
+            tls->session.id_len > 0 &&
+            tls->session.id_len <= ESP8266_MQTT_TLS_SESSION_ID_MAX)
+        {
+            //RESUMED SESSION KEEPS ITS AGE
+            if(!resumed || !tls->session_valid)
+            {
+                tls->session_time_us = system_get_time();
+                tls->session_age_offset_s = 0;
+            }
+            tls->session_valid = tls->flag_session_cache;
+        }
+        else
+        {
+            tls->session_valid = false;
+        }
+    }
+    s_esp8266_mqtt_tls_handshake_record(tls, resumed ? &tls->stats.resumed : &tls->stats.full, elapsed_us);
+
+    if(tls->conn_cb != NULL)
+    {
+        (*tls->conn_cb)(tls->cb_arg);
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_reconn_cb(void* arg, sint8 err)
+{
+    //CONNECTION ERROR CB -> CLIENT (AS A DISCONNECT)
+    //DURING THE HANDSHAKE WITH A SESSION OFFERED : THE BROKER MAY HAVE
+    //FORGOTTEN IT. DROP IT SO THE NEXT ATTEMPT IS A FULL HANDSHAKE
+
+    esp8266_mqtt_tls_t* tls = (esp8266_mqtt_tls_t*)((struct espconn*)arg)->reverse;
+
+    tls->stats.failed++;
+    if(tls->handshaking && tls->session_offered)
+    {
+        ESP8266_MQTT_TLS_DropSession(tls);
+    }
+    tls->handshaking = false;
+    if(tls->discon_cb != NULL)
+    {
+        (*tls->discon_cb)(tls->cb_arg);
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_discon_cb(void* arg)
+{
+    //DISCONNECT CB -> CLIENT
+
+    esp8266_mqtt_tls_t* tls = (esp8266_mqtt_tls_t*)((struct espconn*)arg)->reverse;
+
+    if(tls->handshaking)
+    {
+        //CLOSED BY THE PEER DURING THE HANDSHAKE
+        s_esp8266_mqtt_tls_reconn_cb(arg, ESPCONN_ARG);
+        return;
+    }
+    if(tls->discon_cb != NULL)
+    {
+        (*tls->discon_cb)(tls->cb_arg);
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_sent_cb(void* arg)
+{
+    //SENT CB -> CLIENT
+
+    esp8266_mqtt_tls_t* tls = (esp8266_mqtt_tls_t*)((struct espconn*)arg)->reverse;
+
+    if(tls->send_cb != NULL)
+    {
+        (*tls->send_cb)(tls->cb_arg);
+    }
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_recv_cb(void* arg, char* pusrdata, unsigned short length)
+{
+    //RECEIVE CB (DECRYPTED DATA) -> CLIENT
+
+    esp8266_mqtt_tls_t* tls = (esp8266_mqtt_tls_t*)((struct espconn*)arg)->reverse;
+
+    tls->stats.bytes_received += length;
+    if(tls->recv_cb != NULL)
+    {
+        (*tls->recv_cb)(tls->cb_arg, pusrdata, length);
+    }
+}
+
+static uint32_t ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_hash(const uint8_t* data, uint16_t len)
+{
+    //FNV-1A HASH (SESSION KEY / RTC RECORD CHECKSUM)
+
+    uint32_t hash = 2166136261u;
+
+    while(len--)
+    {
+        hash ^= *data++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_session_age(esp8266_mqtt_tls_t* tls)
+{
+    //RETURN AGE OF THE CACHED SESSION IN SECONDS
+
+    return tls->session_age_offset_s + (system_get_time() - tls->session_time_us) / 1000000;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_session_load(esp8266_mqtt_tls_t* tls)
+{
+    //LOAD THE CACHED SESSION FROM RTC MEMORY (IF ANY, INTACT AND FOR THE
+    //BROKER GIVEN TO THE CLIENT INITIALIZE)
+
+    esp8266_mqtt_tls_session_record_t record;
+
+    if(tls->session_rtc_block == 0 ||
+        tls->session_key_hash == 0 ||
+        !system_rtc_mem_read(tls->session_rtc_block, &record, sizeof(record)))
+    {
+        return;
+    }
+    if(record.magic != ESP8266_MQTT_TLS_SESSION_MAGIC ||
+        record.checksum != s_esp8266_mqtt_tls_hash((uint8_t*)&record, sizeof(record) - 4) ||
+        record.key_hash != tls->session_key_hash ||
+        record.lifetime_left_s == 0 ||
+        record.session.id_len == 0 ||
+        record.session.id_len > ESP8266_MQTT_TLS_SESSION_ID_MAX)
+    {
+        return;
+    }
+
+    os_memcpy(&tls->session, &record.session, sizeof(esp8266_mqtt_tls_session_t));
+    tls->session_time_us = system_get_time();
+    tls->session_age_offset_s = (record.lifetime_left_s < tls->session_lifetime_s) ?
+                                    (tls->session_lifetime_s - record.lifetime_left_s) : 0;
+    tls->session_valid = true;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_tls_handshake_record(esp8266_mqtt_tls_t* tls,
+                                                                    esp8266_mqtt_tls_handshake_stats_t* stats,
+                                                                    uint32_t elapsed_us)
+{
+    //ADD ONE HANDSHAKE TIME SAMPLE (+ ITS BYTES ON THE WIRE IF THE ENGINE
+    //COUNTS THEM)
+
+    uint32_t elapsed_ms = elapsed_us / 1000;
+    uint32_t sent;
+    uint32_t received;
+
+    if(tls->session_hooks != NULL && tls->session_hooks->wire_bytes != NULL)
+    {
+        (*tls->session_hooks->wire_bytes)(tls->engine_arg, &sent, &received);
+        stats->bytes_sent += sent - tls->handshake_wire_sent;
+        stats->bytes_received += received - tls->handshake_wire_received;
+    }
+
+    stats->count++;
+    stats->total_ms += elapsed_ms;
+    if(elapsed_ms > stats->max_ms)
+    {
+        stats->max_ms = elapsed_ms;
+    }
+}
@@ -0,0 +1,196 @@
+/**********************************************************************************
+* ESP8266 MQTT TLS
+*
+* NOTE
+* -----
+*   (1) TLS TRANSPORT FOR THE MQTT CLIENT (esp8266_mqtt_transport_t). BUILT ON
+*       THE SDK SECURE ESPCONN API (espconn_secure_xxx). USE IT WITH
+*
+*           ESP8266_MQTT_TLS_Initialize(&tls);
+*           ESP8266_MQTT_CLIENT_SetTransport(ESP8266_MQTT_TLS_GetTransport(), &tls);
+*
+*       BEFORE ESP8266_MQTT_CLIENT_Initialize. THE esp8266_mqtt_tls_t IS CALLER
+*       OWNED AND MUST STAY VALID WHILE THE CLIENT USES IT
+*
+*   (2) SDK LIMITS : ONLY ONE SECURE CLIENT CONNECTION AT A TIME (ONE CLIENT
+*       INSTANCE ON TLS). THE TLS RECORD BUFFER (ESP8266_MQTT_TLS_BUFFER_SIZE)
+*       IS ALLOCATED BY THE SDK FROM THE HEAP FOR EACH CONNECTION. THE BROKER
+*       CERTIFICATE IS ONLY VERIFIED IF A CA SECTOR IS SET
+*       (ESP8266_MQTT_TLS_SetCaSector, SDK esp_ca_cert.bin FORMAT)
+*
+*   (3) SESSION RESUMPTION. A FULL HANDSHAKE TAKES SECONDS OF CPU ON AN 80 MHZ
+*       CORE. A RESUMED ONE (SESSION ID + MASTER SECRET OF AN EARLIER SESSION)
+*       SKIPS THE PUBLIC KEY OPERATIONS AND A ROUND TRIP. THE TRANSPORT KEEPS
+*       ONE SESSION PER BROKER (HOST NAME + PORT) IN RAM AND OPTIONALLY IN RTC
+*       MEMORY ACROSS DEEP SLEEP (ESP8266_MQTT_TLS_SetSessionCache). IT IS
+*       OFFERED BEFORE EVERY CONNECT AND REPLACED AFTER EVERY HANDSHAKE. A
+*       HANDSHAKE THAT FAILS WITH A SESSION OFFERED DROPS IT (NEXT ONE IS FULL)
+*
+*       WITH THE STOCK NONOS SDK NOTHING IS RESUMED : ITS SECURE ESPCONN API
+*       (espconn_secure_xxx) HAS NO CALL TO GET OR SET THE TLS SESSION, SO
+*       EVERY HANDSHAKE IS A FULL ONE AND THE CACHE STAYS EMPTY. THE SESSION
+*       IS MOVED IN / OUT OF THE TLS ENGINE ONLY THROUGH SESSION HOOKS
+*       (ESP8266_MQTT_TLS_SetSessionHooks) WRITTEN FOR A TLS ENGINE THAT CAN
+*       DO IT (EG A PATCHED AXTLS / MBEDTLS BUILD). THE HOST BUILD HAS SUCH AN
+*       ENGINE (OPENSSL BEHIND THE ESPCONN CALLS, host/ESP8266_HOST_ESPCONN.h)
+*
+*   (4) THE RTC RECORD TAKES ESP8266_MQTT_TLS_SESSION_RTC_BLOCKS BLOCKS. IT MUST
+*       NOT OVERLAP THE BLOCKS OF THE CLIENT DNS CACHE
+*       (ESP8266_MQTT_CLIENT_SetDnsCache, ESP8266_MQTT_CLIENT_DNS_CACHE_RTC_BLOCKS)
+*       OR OF THE CLIENT SUSPEND RECORD (ESP8266_MQTT_CLIENT_Suspend,
+*       ESP8266_MQTT_CLIENT_SUSPEND_RTC_BLOCKS). PASS THE DEFAULT LAYOUT
+*       (ESP8266_MQTT_RTC_BLOCK_DNS_CACHE / _SUSPEND / _TLS_SESSION, MOVABLE
+*       WITH BUILD FLAGS) : THE BUILD FAILS IF THOSE OVERLAP OR LEAVE RTC USER
+*       MEMORY. THE RTC TIMER RESTARTS ON DEEP SLEEP WAKE. PASS THE SLEEP TIME
+*       TO ESP8266_MQTT_TLS_SaveSession
+*
+*   (5) HANDSHAKE TIME (CONNECT -> SECURE CONNECT CB) AND HANDSHAKE BYTES ON
+*       THE WIRE ARE KEPT SEPARATELY FOR FULL AND RESUMED HANDSHAKES, WITH THE
+*       APPLICATION BYTES SENT / RECEIVED (ESP8266_MQTT_TLS_GetStats). THE SDK
+*       DOES NOT REPORT BYTES ON THE WIRE. HANDSHAKE BYTES ARE ONLY COUNTED
+*       WITH A wire_bytes SESSION HOOK (0 OTHERWISE)
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#ifndef _ESP8266_MQTT_TLS_H_
+#define _ESP8266_MQTT_TLS_H_
+
+#include "ets_sys.h"
+#include "osapi.h"
+#include "os_type.h"
+#include "user_interface.h"
+#include "espconn.h"
+#include "ESP8266_MQTT_CLIENT.h"
+
+#define ESP8266_MQTT_TLS_BUFFER_SIZE					(5120)
+#define ESP8266_MQTT_TLS_SESSION_ID_MAX					(32)
+#define ESP8266_MQTT_TLS_MASTER_SECRET_SIZE				(48)
+#define ESP8266_MQTT_TLS_SESSION_LIFETIME_DEFAULT_S		(3600)
+#define ESP8266_MQTT_TLS_SESSION_LIFETIME_MAX_S			(3600)
+#define ESP8266_MQTT_TLS_SESSION_MAGIC					(0x544C5331)
+#define ESP8266_MQTT_TLS_SESSION_RTC_BLOCKS				(sizeof(esp8266_mqtt_tls_session_record_t) / 4)
+
+//DEFAULT RTC BLOCK OF THE SESSION RECORD (AFTER THE CLIENT RECORDS, SEE
+//ESP8266_MQTT_RTC_BLOCK_DNS_CACHE)
+#ifndef ESP8266_MQTT_RTC_BLOCK_TLS_SESSION
+#define ESP8266_MQTT_RTC_BLOCK_TLS_SESSION				(ESP8266_MQTT_RTC_BLOCK_SUSPEND + ESP8266_MQTT_CLIENT_SUSPEND_RTC_BLOCKS)
+#endif
+
+//CUSTOM VARIABLE STRUCTURES/////////////////////////////
+typedef struct
+{
+	uint8_t id_len;			//0 = NO SESSION
+	uint8_t id[ESP8266_MQTT_TLS_SESSION_ID_MAX];
+	uint8_t master_secret[ESP8266_MQTT_TLS_MASTER_SECRET_SIZE];
+}esp8266_mqtt_tls_session_t;
+
+typedef struct
+{
+	//TLS ENGINE SESSION HOOKS. engine_arg IS THE ARG GIVEN WITH THEM
+	//offer : CALLED BEFORE THE HANDSHAKE WITH THE CACHED SESSION TO TRY
+	//fetch : CALLED ONCE THE HANDSHAKE IS DONE. FILL session WITH THE CURRENT
+	//        SESSION (id_len 0 = NOT RESUMABLE) AND SET resumed IF THE OFFERED
+	//        ONE WAS ACCEPTED. RETURN FALSE IF NOTHING IS AVAILABLE
+	//wire_bytes : OPTIONAL (NULL = NOT COUNTED). SET THE TLS RECORD BYTES THE
+	//        ENGINE HAS SENT / RECEIVED SO FAR (RUNNING TOTALS, NOT RESET BY A
+	//        CONNECT). CALLED BEFORE AND AFTER EACH HANDSHAKE
+	void (*offer)(void* engine_arg, const esp8266_mqtt_tls_session_t* session);
+	bool (*fetch)(void* engine_arg, esp8266_mqtt_tls_session_t* session, bool* resumed);
+	void (*wire_bytes)(void* engine_arg, uint32_t* sent, uint32_t* received);
+}esp8266_mqtt_tls_session_hooks_t;
+
+typedef struct
+{
+	//SESSION AS KEPT IN RTC MEMORY
+	uint32_t magic;
+	uint32_t key_hash;
+	uint32_t lifetime_left_s;
+	esp8266_mqtt_tls_session_t session;
+	uint8_t pad[3];
+	uint32_t checksum;
+}esp8266_mqtt_tls_session_record_t;
+
+typedef struct
+{
+	uint32_t count;
+	uint32_t total_ms;
+	uint32_t max_ms;
+	uint32_t bytes_sent;		//ON THE WIRE, ALL THESE HANDSHAKES (wire_bytes HOOK)
+	uint32_t bytes_received;
+}esp8266_mqtt_tls_handshake_stats_t;
+
+typedef struct
+{
+	esp8266_mqtt_tls_handshake_stats_t full;
+	esp8266_mqtt_tls_handshake_stats_t resumed;
+	uint32_t failed;			//HANDSHAKES / CONNECTS THAT ENDED IN AN ERROR
+	uint32_t bytes_sent;		//APPLICATION BYTES (BEFORE TLS FRAMING)
+	uint32_t bytes_received;
+}esp8266_mqtt_tls_stats_t;
+
+typedef struct
+{
+	//ONE TLS TRANSPORT CONTEXT (ONE CONNECTION). CALLER OWNED MEMORY
+	//SET UP WITH ESP8266_MQTT_TLS_Initialize. FIELDS ARE PRIVATE
+
+	//CONNECTION RELATED
+	struct espconn conn;
+	esp_tcp tcp;
+	const char* hostname;
+	ip_addr_t host_ip;
+	uint16_t host_port;
+	uint32_t ca_sector;			//0 = NO CERTIFICATE VERIFICATION
+	bool handshaking;
+	uint32_t handshake_start_us;
+	uint32_t handshake_wire_sent;		//wire_bytes HOOK TOTALS AT HANDSHAKE START
+	uint32_t handshake_wire_received;
+
+	//SESSION CACHE RELATED
+	bool flag_session_cache;
+	uint32_t session_lifetime_s;
+	uint8_t session_rtc_block;	//0 = NOT KEPT IN RTC MEMORY
+	uint32_t session_key_hash;	//HOST NAME + PORT
+	bool session_valid;
+	bool session_offered;
+	esp8266_mqtt_tls_session_t session;
+	uint32_t session_time_us;
+	uint32_t session_age_offset_s;	//AGE WHEN LOADED FROM RTC MEMORY
+	const esp8266_mqtt_tls_session_hooks_t* session_hooks;
+	void* engine_arg;
+
+	//STATS RELATED
+	esp8266_mqtt_tls_stats_t stats;
+
+	//CB FUNCTIONS (MQTT CLIENT)
+	void* cb_arg;
+	void (*conn_cb)(void*);
+	void (*discon_cb)(void*);
+	void (*send_cb)(void*);
+	void (*recv_cb)(void*, char*, unsigned short);
+	void (*dns_cb)(void*, ip_addr_t*);
+}esp8266_mqtt_tls_t;
+//END CUSTOM VARIABLE STRUCTURES/////////////////////////
+
+//FUNCTION PROTOTYPES/////////////////////////////////////////////
+//CONFIGURATION FUNCTIONS
+void ICACHE_FLASH_ATTR ESP8266_MQTT_TLS_Initialize(esp8266_mqtt_tls_t* tls);
+const esp8266_mqtt_transport_t* ICACHE_FLASH_ATTR ESP8266_MQTT_TLS_GetTransport(void);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_TLS_SetCaSector(esp8266_mqtt_tls_t* tls, uint32_t ca_sector);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_TLS_SetSessionCache(esp8266_mqtt_tls_t* tls,
+                                                        bool enable,
+                                                        uint32_t lifetime_s,
+                                                        uint8_t rtc_block);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_TLS_SetSessionHooks(esp8266_mqtt_tls_t* tls,
+                                                        const esp8266_mqtt_tls_session_hooks_t* hooks,
+                                                        void* engine_arg);
+
+//OPERATION FUNCTIONS
+void ICACHE_FLASH_ATTR ESP8266_MQTT_TLS_SaveSession(esp8266_mqtt_tls_t* tls, uint32_t sleep_s);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_TLS_DropSession(esp8266_mqtt_tls_t* tls);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_TLS_GetStats(esp8266_mqtt_tls_t* tls, esp8266_mqtt_tls_stats_t* stats);
+
+#endif
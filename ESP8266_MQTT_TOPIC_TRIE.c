@@ -0,0 +1,394 @@
+/**********************************************************************************
+* ESP8266 MQTT TOPIC TRIE
+*
+* NOTE
+* -----
+*   (1) TOPIC FILTER -> HANDLER LOOKUP USED BY THE MQTT CLIENT TO DISPATCH
+*       RECEIVED PUBLISH MESSAGES. THE TRIE IS KEYED ON TOPIC LEVELS (TEXT
+*       BETWEEN '/') SO MATCHING A TOPIC COSTS O(TOPIC LEVELS), NOT A SCAN OF
+*       EVERY REGISTERED FILTER
+*
+*   (2) SUPPORTS THE MQTT WILDCARDS. '+' MATCHES EXACTLY ONE LEVEL, '#' (LAST
+*       LEVEL ONLY) MATCHES THE PARENT LEVEL AND EVERYTHING BELOW IT. TOPICS
+*       STARTING WITH '$' ARE NOT MATCHED BY A WILDCARD IN THE FIRST LEVEL
+*
+*   (3) ONE NODE (os_zalloc) PER LEVEL. THE LEVEL TEXT IS STORED RIGHT AFTER
+*       THE NODE IN THE SAME ALLOCATION. CHILDREN ARE KEPT AS A SIBLING LIST.
+*       NODES ARE FREED WHEN THE LAST FILTER USING THEM IS REMOVED
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_MQTT_TOPIC_TRIE.h"
+
+//LOCAL LIBRARY FUNCTIONS////////////////////////////////
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_trie_level_len(const char* str, uint16_t len, uint16_t pos);
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_trie_level_has(const char* level, uint16_t level_len, char c);
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_trie_level_is(esp8266_mqtt_topic_trie_node_t* node,
+                                                            const char* level,
+                                                            uint16_t level_len);
+static esp8266_mqtt_topic_trie_node_t* ICACHE_FLASH_ATTR s_esp8266_mqtt_trie_find_child(esp8266_mqtt_topic_trie_node_t* parent,
+                                                                                        const char* level,
+                                                                                        uint16_t level_len);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_trie_unlink(esp8266_mqtt_topic_trie_node_t* parent,
+                                                            esp8266_mqtt_topic_trie_node_t* node);
+static uint8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_trie_match(esp8266_mqtt_topic_trie_node_t* parent,
+                                                            char* topic,
+                                                            uint16_t topic_len,
+                                                            uint16_t pos,
+                                                            bool wildcard_ok,
+                                                            char* payload,
+                                                            uint16_t payload_len);
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_trie_walk(esp8266_mqtt_topic_trie_node_t* parent,
+                                                        char* buffer,
+                                                        uint16_t buffer_size,
+                                                        uint16_t len,
+                                                        void (*walk_cb)(void*, char*, uint16_t, uint8_t),
+                                                        void* walk_arg);
+//END LOCAL LIBRARY FUNCTIONS////////////////////////////////
+
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_TOPIC_TRIE_Insert(esp8266_mqtt_topic_trie_node_t* root,
+                                                        const char* filter,
+                                                        uint16_t filter_len,
+                                                        uint8_t qos,
+                                                        esp8266_mqtt_topic_handler_t handler,
+                                                        void* handler_arg)
+{
+    //ADD THE TOPIC FILTER TO THE TRIE (OR REPLACE THE HANDLER OF AN EXISTING
+    //ONE). NODES FOR MISSING LEVELS ARE ALLOCATED
+    //RETURN FALSE IF THE FILTER IS INVALID OR OUT OF MEMORY
+
+    esp8266_mqtt_topic_trie_node_t* node = root;
+    esp8266_mqtt_topic_trie_node_t* child;
+    uint16_t pos = 0;
+    uint16_t level_len;
+    uint8_t levels = 0;
+
+    if(filter_len == 0)
+    {
+        return false;
+    }
+
+    //VALIDATE WILDCARDS FIRST SO A BAD FILTER ALLOCATES NOTHING
+    while(pos <= filter_len)
+    {
+        level_len = s_esp8266_mqtt_trie_level_len(filter, filter_len, pos);
+        if(s_esp8266_mqtt_trie_level_has(&filter[pos], level_len, '#') &&
+            (level_len != 1 || (pos + level_len) != filter_len))
+        {
+            return false;
+        }
+        if(s_esp8266_mqtt_trie_level_has(&filter[pos], level_len, '+') && level_len != 1)
+        {
+            return false;
+        }
+        if(++levels > ESP8266_MQTT_TOPIC_TRIE_MAX_LEVELS)
+        {
+            return false;
+        }
+        pos += level_len + 1;
+    }
+
+    pos = 0;
+    while(pos <= filter_len)
+    {
+        level_len = s_esp8266_mqtt_trie_level_len(filter, filter_len, pos);
+        child = s_esp8266_mqtt_trie_find_child(node, &filter[pos], level_len);
+        if(child == NULL)
+        {
+            child = (esp8266_mqtt_topic_trie_node_t*)os_zalloc(sizeof(esp8266_mqtt_topic_trie_node_t) + level_len + 1);
+            if(child == NULL)
+            {
+                //LEAVE NO HALF BUILT BRANCH BEHIND
+                ESP8266_MQTT_TOPIC_TRIE_Remove(root, filter, filter_len);
+                return false;
+            }
+            child->level = (char*)(child + 1);
+            child->level_len = level_len;
+            os_memcpy(child->level, &filter[pos], level_len);
+            child->sibling = node->child;
+            node->child = child;
+        }
+        node = child;
+        pos += level_len + 1;
+    }
+
+    node->handler = handler;
+    node->handler_arg = handler_arg;
+    node->qos = qos;
+    return true;
+}
+
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_TOPIC_TRIE_Remove(esp8266_mqtt_topic_trie_node_t* root,
+                                                        const char* filter,
+                                                        uint16_t filter_len)
+{
+    //REMOVE THE TOPIC FILTER FROM THE TRIE. NODES NO LONGER USED BY ANY
+    //OTHER FILTER ARE FREED
+    //RETURN FALSE IF THE FILTER WAS NOT REGISTERED
+
+    esp8266_mqtt_topic_trie_node_t* path[ESP8266_MQTT_TOPIC_TRIE_MAX_LEVELS + 1];
+    uint8_t depth = 0;
+    uint16_t pos = 0;
+    uint16_t level_len;
+    bool found;
+
+    path[0] = root;
+    while(pos <= filter_len && depth < ESP8266_MQTT_TOPIC_TRIE_MAX_LEVELS)
+    {
+        level_len = s_esp8266_mqtt_trie_level_len(filter, filter_len, pos);
+        path[depth + 1] = s_esp8266_mqtt_trie_find_child(path[depth], &filter[pos], level_len);
+        if(path[depth + 1] == NULL)
+        {
+            break;
+        }
+        depth++;
+        pos += level_len + 1;
+    }
+
+    //FULL FILTER MATCHED ?
+    found = (pos > filter_len && depth > 0 && path[depth]->handler != NULL);
+    if(pos > filter_len && depth > 0)
+    {
+        path[depth]->handler = NULL;
+        path[depth]->handler_arg = NULL;
+    }
+
+    //PRUNE UNUSED NODES BOTTOM UP
+    while(depth > 0 && path[depth]->handler == NULL && path[depth]->child == NULL)
+    {
+        s_esp8266_mqtt_trie_unlink(path[depth - 1], path[depth]);
+        os_free(path[depth]);
+        depth--;
+    }
+    return found;
+}
+
+uint8_t ICACHE_FLASH_ATTR ESP8266_MQTT_TOPIC_TRIE_Dispatch(esp8266_mqtt_topic_trie_node_t* root,
+                                                            char* topic,
+                                                            uint16_t topic_len,
+                                                            char* payload,
+                                                            uint16_t payload_len)
+{
+    //CALL THE HANDLER OF EVERY FILTER MATCHING THE TOPIC
+    //HANDLERS MUST NOT ADD / REMOVE FILTERS
+    //RETURN NUMBER OF HANDLERS CALLED
+
+    return s_esp8266_mqtt_trie_match(root,
+                                        topic,
+                                        topic_len,
+                                        0,
+                                        (topic_len == 0 || topic[0] != '$'),
+                                        payload,
+                                        payload_len);
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_TOPIC_TRIE_Walk(esp8266_mqtt_topic_trie_node_t* root,
+                                                    char* buffer,
+                                                    uint16_t buffer_size,
+                                                    void (*walk_cb)(void*, char*, uint16_t, uint8_t),
+                                                    void* walk_arg)
+{
+    //CALL walk_cb WITH EVERY REGISTERED FILTER (REBUILT IN buffer) AND ITS QOS
+    //FILTERS LONGER THAN buffer_size ARE SKIPPED
+
+    s_esp8266_mqtt_trie_walk(root, buffer, buffer_size, 0, walk_cb, walk_arg);
+}
+
+void ICACHE_FLASH_ATTR ESP8266_MQTT_TOPIC_TRIE_Clear(esp8266_mqtt_topic_trie_node_t* root)
+{
+    //FREE ALL NODES BELOW THE ROOT
+
+    esp8266_mqtt_topic_trie_node_t* child;
+
+    while(root->child != NULL)
+    {
+        child = root->child;
+        ESP8266_MQTT_TOPIC_TRIE_Clear(child);
+        root->child = child->sibling;
+        os_free(child);
+    }
+}
+
+//INTERNAL FUNCTIONS
+static uint16_t ICACHE_FLASH_ATTR s_esp8266_mqtt_trie_level_len(const char* str, uint16_t len, uint16_t pos)
+{
+    //RETURN LENGTH OF THE TOPIC LEVEL STARTING AT pos (UP TO '/' OR END)
+
+    uint16_t end = pos;
+
+    while(end < len && str[end] != '/')
+    {
+        end++;
+    }
+    return (end - pos);
+}
+
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_trie_level_has(const char* level, uint16_t level_len, char c)
+{
+    //RETURN TRUE IF THE LEVEL TEXT CONTAINS THE SPECIFIED CHARACTER
+
+    uint16_t i;
+
+    for(i = 0; i < level_len; i++)
+    {
+        if(level[i] == c)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ICACHE_FLASH_ATTR s_esp8266_mqtt_trie_level_is(esp8266_mqtt_topic_trie_node_t* node,
+                                                            const char* level,
+                                                            uint16_t level_len)
+{
+    //RETURN TRUE IF THE NODE LEVEL TEXT EQUALS THE SPECIFIED LEVEL
+
+    return (node->level_len == level_len && os_memcmp(node->level, level, level_len) == 0);
+}
+
+static esp8266_mqtt_topic_trie_node_t* ICACHE_FLASH_ATTR s_esp8266_mqtt_trie_find_child(esp8266_mqtt_topic_trie_node_t* parent,
+                                                                                        const char* level,
+                                                                                        uint16_t level_len)
+{
+    //RETURN THE CHILD NODE WITH THE SPECIFIED LEVEL TEXT (NULL IF NONE)
+
+    esp8266_mqtt_topic_trie_node_t* child;
+
+    for(child = parent->child; child != NULL; child = child->sibling)
+    {
+        if(s_esp8266_mqtt_trie_level_is(child, level, level_len))
+        {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_trie_unlink(esp8266_mqtt_topic_trie_node_t* parent,
+                                                            esp8266_mqtt_topic_trie_node_t* node)
+{
+    //REMOVE THE NODE FROM ITS PARENT CHILD LIST
+
+    esp8266_mqtt_topic_trie_node_t** link = &parent->child;
+
+    while(*link != NULL)
+    {
+        if(*link == node)
+        {
+            *link = node->sibling;
+            return;
+        }
+        link = &(*link)->sibling;
+    }
+}
+
+static uint8_t ICACHE_FLASH_ATTR s_esp8266_mqtt_trie_match(esp8266_mqtt_topic_trie_node_t* parent,
+                                                            char* topic,
+                                                            uint16_t topic_len,
+                                                            uint16_t pos,
+                                                            bool wildcard_ok,
+                                                            char* payload,
+                                                            uint16_t payload_len)
+{
+    //MATCH THE TOPIC LEVEL STARTING AT pos AGAINST THE CHILDREN OF parent
+    //AND RECURSE INTO MATCHING CHILDREN FOR THE REMAINING LEVELS
+    //RETURN NUMBER OF HANDLERS CALLED
+
+    esp8266_mqtt_topic_trie_node_t* child;
+    esp8266_mqtt_topic_trie_node_t* grandchild;
+    uint16_t level_len = s_esp8266_mqtt_trie_level_len(topic, topic_len, pos);
+    bool last = ((pos + level_len) >= topic_len);
+    uint8_t count = 0;
+
+    for(child = parent->child; child != NULL; child = child->sibling)
+    {
+        //'#' MATCHES THIS LEVEL AND EVERYTHING BELOW
+        if(s_esp8266_mqtt_trie_level_is(child, "#", 1))
+        {
+            if(wildcard_ok && child->handler != NULL)
+            {
+                (*child->handler)(child->handler_arg, topic, topic_len, payload, payload_len);
+                count++;
+            }
+            continue;
+        }
+
+        if(!s_esp8266_mqtt_trie_level_is(child, &topic[pos], level_len) &&
+            !(wildcard_ok && s_esp8266_mqtt_trie_level_is(child, "+", 1)))
+        {
+            continue;
+        }
+
+        if(!last)
+        {
+            count += s_esp8266_mqtt_trie_match(child,
+                                                topic,
+                                                topic_len,
+                                                pos + level_len + 1,
+                                                true,
+                                                payload,
+                                                payload_len);
+            continue;
+        }
+
+        //LAST TOPIC LEVEL
+        if(child->handler != NULL)
+        {
+            (*child->handler)(child->handler_arg, topic, topic_len, payload, payload_len);
+            count++;
+        }
+
+        //"a/#" ALSO MATCHES "a"
+        for(grandchild = child->child; grandchild != NULL; grandchild = grandchild->sibling)
+        {
+            if(s_esp8266_mqtt_trie_level_is(grandchild, "#", 1) && grandchild->handler != NULL)
+            {
+                (*grandchild->handler)(grandchild->handler_arg, topic, topic_len, payload, payload_len);
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+static void ICACHE_FLASH_ATTR s_esp8266_mqtt_trie_walk(esp8266_mqtt_topic_trie_node_t* parent,
+                                                        char* buffer,
+                                                        uint16_t buffer_size,
+                                                        uint16_t len,
+                                                        void (*walk_cb)(void*, char*, uint16_t, uint8_t),
+                                                        void* walk_arg)
+{
+    //DEPTH FIRST WALK. buffer HOLDS THE FILTER TEXT UP TO parent (len BYTES)
+
+    esp8266_mqtt_topic_trie_node_t* child;
+    uint16_t len_child;
+
+    for(child = parent->child; child != NULL; child = child->sibling)
+    {
+        //'/' SEPARATOR + LEVEL TEXT + NUL
+        len_child = len + ((parent->level != NULL) ? 1 : 0) + child->level_len;
+        if((len_child + 1) > buffer_size)
+        {
+            continue;
+        }
+        if(len_child > len + child->level_len)
+        {
+            buffer[len] = '/';
+        }
+        os_memcpy(&buffer[len_child - child->level_len], child->level, child->level_len);
+        buffer[len_child] = '\0';
+
+        if(child->handler != NULL)
+        {
+            (*walk_cb)(walk_arg, buffer, len_child, child->qos);
+        }
+        s_esp8266_mqtt_trie_walk(child, buffer, buffer_size, len_child, walk_cb, walk_arg);
+    }
+}
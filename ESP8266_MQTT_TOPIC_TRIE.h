@@ -0,0 +1,78 @@
+/**********************************************************************************
+* ESP8266 MQTT TOPIC TRIE
+*
+* NOTE
+* -----
+*   (1) TOPIC FILTER -> HANDLER LOOKUP USED BY THE MQTT CLIENT TO DISPATCH
+*       RECEIVED PUBLISH MESSAGES. THE TRIE IS KEYED ON TOPIC LEVELS (TEXT
+*       BETWEEN '/') SO MATCHING A TOPIC COSTS O(TOPIC LEVELS), NOT A SCAN OF
+*       EVERY REGISTERED FILTER
+*
+*   (2) SUPPORTS THE MQTT WILDCARDS. '+' MATCHES EXACTLY ONE LEVEL, '#' (LAST
+*       LEVEL ONLY) MATCHES THE PARENT LEVEL AND EVERYTHING BELOW IT. TOPICS
+*       STARTING WITH '$' ARE NOT MATCHED BY A WILDCARD IN THE FIRST LEVEL
+*
+*   (3) ONE NODE (os_zalloc) PER LEVEL. THE LEVEL TEXT IS STORED RIGHT AFTER
+*       THE NODE IN THE SAME ALLOCATION. CHILDREN ARE KEPT AS A SIBLING LIST.
+*       NODES ARE FREED WHEN THE LAST FILTER USING THEM IS REMOVED
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#ifndef _ESP8266_MQTT_TOPIC_TRIE_H_
+#define _ESP8266_MQTT_TOPIC_TRIE_H_
+
+#include "ets_sys.h"
+#include "osapi.h"
+#include "os_type.h"
+#include "user_interface.h"
+#include "mem.h"
+
+#define ESP8266_MQTT_TOPIC_TRIE_MAX_LEVELS		(16)
+
+//CUSTOM VARIABLE STRUCTURES/////////////////////////////
+typedef void (*esp8266_mqtt_topic_handler_t)(void* arg,
+                                                char* topic,
+                                                uint16_t topic_len,
+                                                char* payload,
+                                                uint16_t payload_len);
+
+typedef struct esp8266_mqtt_topic_trie_node
+{
+	struct esp8266_mqtt_topic_trie_node* child;
+	struct esp8266_mqtt_topic_trie_node* sibling;
+	esp8266_mqtt_topic_handler_t handler;
+	void* handler_arg;
+	uint8_t qos;
+	uint16_t level_len;
+	char* level;
+}esp8266_mqtt_topic_trie_node_t;
+//END CUSTOM VARIABLE STRUCTURES/////////////////////////
+
+//FUNCTION PROTOTYPES/////////////////////////////////////////////
+//OPERATION FUNCTIONS
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_TOPIC_TRIE_Insert(esp8266_mqtt_topic_trie_node_t* root,
+                                                        const char* filter,
+                                                        uint16_t filter_len,
+                                                        uint8_t qos,
+                                                        esp8266_mqtt_topic_handler_t handler,
+                                                        void* handler_arg);
+bool ICACHE_FLASH_ATTR ESP8266_MQTT_TOPIC_TRIE_Remove(esp8266_mqtt_topic_trie_node_t* root,
+                                                        const char* filter,
+                                                        uint16_t filter_len);
+uint8_t ICACHE_FLASH_ATTR ESP8266_MQTT_TOPIC_TRIE_Dispatch(esp8266_mqtt_topic_trie_node_t* root,
+                                                            char* topic,
+                                                            uint16_t topic_len,
+                                                            char* payload,
+                                                            uint16_t payload_len);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_TOPIC_TRIE_Walk(esp8266_mqtt_topic_trie_node_t* root,
+                                                    char* buffer,
+                                                    uint16_t buffer_size,
+                                                    void (*walk_cb)(void*, char*, uint16_t, uint8_t),
+                                                    void* walk_arg);
+void ICACHE_FLASH_ATTR ESP8266_MQTT_TOPIC_TRIE_Clear(esp8266_mqtt_topic_trie_node_t* root);
+
+#endif
@@ -0,0 +1,405 @@
+/**********************************************************************************
+* ESP8266 MQTT BENCHMARK (HOST)
+*
+* NOTE
+* -----
+*   (1) RUNS THE CLIENT ENCODER / PARSER OVER THE MOCK TRANSPORT AND PRINTS PER
+*       CASE : MESSAGES PER SECOND (PC CPU, ONLY USEFUL TO COMPARE BUILDS),
+*       BYTES ON THE WIRE PER MESSAGE, os_malloc CALLS PER MESSAGE AND THE PEAK
+*       HEAP (ALL os_malloc BLOCKS LIVE AT ONCE, CLIENT BUFFERS INCLUDED)
+*
+*   (2) ./ESP8266_MQTT_BENCH [ITERATIONS]   (DEFAULT 200000)
+*
+*   (3) THE COMPRESSION SECTION PUBLISHES TELEMETRY LIKE JSON, REPEATED TEXT AND
+*       RANDOM (INCOMPRESSIBLE) PAYLOADS WITH COMPRESSION ON (BYTES/MSG IS THE
+*       WIRE SIZE) AND THEN PRINTS PER PAYLOAD : COMPRESSED / ORIGINAL SIZE AND
+*       ENCODER / DECODER CPU TIME PER PAYLOAD. ON THE CHIP SCALE THE TIMES BY
+*       THE PC / ESP8266 SPEED RATIO (OR READ ESP8266_MQTT_COMPRESS_GetStats)
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include <stdlib.h>
+#include <time.h>
+#include "ESP8266_HOST.h"
+#include "ESP8266_HOST_TRANSPORT.h"
+#include "ESP8266_MQTT_CLIENT.h"
+#include "ESP8266_MQTT_COMPRESS.h"
+
+#define ESP8266_MQTT_BENCH_BUFFER_SIZE		(2048)
+#define ESP8266_MQTT_BENCH_ITERATIONS		(200000)
+#define ESP8266_MQTT_BENCH_PARSE_BATCH		(16)
+#define ESP8266_MQTT_BENCH_COMPRESS_MIN		(64)	//COMPRESSION THRESHOLD (BYTES)
+
+//CUSTOM VARIABLE STRUCTURES/////////////////////////////
+typedef struct
+{
+	struct timespec start;
+	esp8266_host_heap_stats_t heap;
+	uint32_t bytes_sent;
+	uint32_t bytes_received;
+}esp8266_mqtt_bench_mark_t;
+
+typedef enum
+{
+	ESP8266_MQTT_BENCH_PAYLOAD_JSON = 0,
+	ESP8266_MQTT_BENCH_PAYLOAD_TEXT,
+	ESP8266_MQTT_BENCH_PAYLOAD_RANDOM,
+	ESP8266_MQTT_BENCH_PAYLOAD_COUNT
+}esp8266_mqtt_bench_payload_t;
+//END CUSTOM VARIABLE STRUCTURES/////////////////////////
+
+//LOCAL LIBRARY VARIABLES////////////////////////////////
+static esp8266_mqtt_client_t s_client;
+static esp8266_host_transport_t s_transport;
+static uint32_t s_iterations = ESP8266_MQTT_BENCH_ITERATIONS;
+static uint32_t s_handled;
+static uint32_t s_bytes_received;
+static const char* s_payload_names[ESP8266_MQTT_BENCH_PAYLOAD_COUNT] = {"JSON", "TEXT", "RANDOM"};
+//END LOCAL LIBRARY VARIABLES/////////////////////////////
+
+//LOCAL LIBRARY FUNCTIONS////////////////////////////////
+static void s_esp8266_mqtt_bench_open(void);
+static void s_esp8266_mqtt_bench_begin(esp8266_mqtt_bench_mark_t* mark);
+static void s_esp8266_mqtt_bench_end(esp8266_mqtt_bench_mark_t* mark, const char* name, uint32_t messages, bool received);
+static void s_esp8266_mqtt_bench_connect(void);
+static void s_esp8266_mqtt_bench_publish(uint16_t topic_len, uint16_t payload_len, esp8266_mqtt_qos_t qos);
+static void s_esp8266_mqtt_bench_parse(uint16_t payload_len);
+static void s_esp8266_mqtt_bench_payload(char* dest, uint16_t len, esp8266_mqtt_bench_payload_t kind);
+static void s_esp8266_mqtt_bench_compress_publish(esp8266_mqtt_bench_payload_t kind, uint16_t payload_len);
+static void s_esp8266_mqtt_bench_compress_codec(esp8266_mqtt_bench_payload_t kind, uint16_t payload_len);
+static void s_esp8266_mqtt_bench_handler(void* arg, char* topic, uint16_t topic_len, char* payload, uint16_t payload_len);
+//END LOCAL LIBRARY FUNCTIONS/////////////////////////////
+
+int main(int argc, char** argv)
+{
+    uint16_t topic_lens[] = {8, 32, 128};
+    uint16_t payload_lens[] = {16, 256, 1024};
+    uint16_t compress_lens[] = {256, 1024};
+    uint8_t t;
+    uint8_t p;
+    uint8_t k;
+
+    if(argc > 1)
+    {
+        s_iterations = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+    ESP8266_HOST_SetRealTime(true);
+    s_esp8266_mqtt_bench_open();
+
+    printf("%-34s %12s %10s %10s %10s\n", "CASE", "MSGS/S", "BYTES/MSG", "ALLOCS/MSG", "PEAK HEAP");
+    s_esp8266_mqtt_bench_connect();
+    for(t = 0; t < sizeof(topic_lens) / sizeof(topic_lens[0]); t++)
+    {
+        for(p = 0; p < sizeof(payload_lens) / sizeof(payload_lens[0]); p++)
+        {
+            s_esp8266_mqtt_bench_publish(topic_lens[t], payload_lens[p], ESP8266_MQTT_QOS_0);
+        }
+    }
+    s_esp8266_mqtt_bench_publish(32, 256, ESP8266_MQTT_QOS_1);
+    for(p = 0; p < sizeof(payload_lens) / sizeof(payload_lens[0]); p++)
+    {
+        s_esp8266_mqtt_bench_parse(payload_lens[p]);
+    }
+
+    //COMPRESSION : WIRE BYTES THROUGH THE CLIENT, THEN RATIO + CPU COST
+    for(k = 0; k < ESP8266_MQTT_BENCH_PAYLOAD_COUNT; k++)
+    {
+        for(p = 0; p < sizeof(compress_lens) / sizeof(compress_lens[0]); p++)
+        {
+            s_esp8266_mqtt_bench_compress_publish(k, compress_lens[p]);
+        }
+    }
+    printf("\n%-34s %10s %12s %12s %12s\n", "CODEC", "RATIO", "SAVED B", "ENCODE US", "DECODE US");
+    for(k = 0; k < ESP8266_MQTT_BENCH_PAYLOAD_COUNT; k++)
+    {
+        for(p = 0; p < sizeof(compress_lens) / sizeof(compress_lens[0]); p++)
+        {
+            s_esp8266_mqtt_bench_compress_codec(k, compress_lens[p]);
+        }
+    }
+    return 0;
+}
+
+static void s_esp8266_mqtt_bench_open(void)
+{
+    //ONE CLIENT ON A MOCK CONNECTION THAT DROPS THE SENT BYTES (COUNTED)
+
+    const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+
+    ESP8266_HOST_TRANSPORT_Init(&s_transport);
+    s_transport.capture = false;
+    ESP8266_MQTT_CLIENT_InitInstance(&s_client);
+    ESP8266_MQTT_CLIENT_Select(&s_client);
+    ESP8266_MQTT_CLIENT_SetTransport(&ESP8266_HOST_TRANSPORT, &s_transport);
+    ESP8266_MQTT_CLIENT_Initialize("broker.bench", "127.0.0.1", 1883, ESP8266_MQTT_BENCH_BUFFER_SIZE);
+    ESP8266_MQTT_CLIENT_SetOptions(0, 0, 0, true, "user", true, "password", true, 60, false, NULL, NULL, 0, "bench-client");
+    ESP8266_MQTT_CLIENT_SetInflightWindow(ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX);
+    ESP8266_MQTT_CLIENT_TcpConnect();
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_CLIENT_Send_Connect();
+    ESP8266_HOST_Poll();
+    ESP8266_HOST_TRANSPORT_Inject(&s_transport, connack, sizeof(connack));
+    ESP8266_HOST_Poll();
+}
+
+static void s_esp8266_mqtt_bench_begin(esp8266_mqtt_bench_mark_t* mark)
+{
+    ESP8266_HOST_ResetHeapStats();
+    ESP8266_HOST_GetHeapStats(&mark->heap);
+    mark->bytes_sent = s_transport.stats.bytes_sent;
+    mark->bytes_received = s_bytes_received;
+    clock_gettime(CLOCK_MONOTONIC, &mark->start);
+}
+
+static void s_esp8266_mqtt_bench_end(esp8266_mqtt_bench_mark_t* mark, const char* name, uint32_t messages, bool received)
+{
+    //received : BYTES/MSG COUNTS BYTES PARSED INSTEAD OF BYTES SENT
+
+    struct timespec end;
+    esp8266_host_heap_stats_t heap;
+    double seconds;
+    uint32_t bytes;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ESP8266_HOST_GetHeapStats(&heap);
+    seconds = (double)(end.tv_sec - mark->start.tv_sec) + (double)(end.tv_nsec - mark->start.tv_nsec) / 1e9;
+    bytes = received ? (s_bytes_received - mark->bytes_received) : (s_transport.stats.bytes_sent - mark->bytes_sent);
+    printf("%-34s %12.0f %10.1f %10.2f %10u\n",
+            name,
+            (seconds > 0) ? (double)messages / seconds : 0.0,
+            (double)bytes / messages,
+            (double)(heap.allocs - mark->heap.allocs) / messages,
+            heap.bytes_peak);
+}
+
+static void s_esp8266_mqtt_bench_connect(void)
+{
+    //CONNECT PACKET (PREBUILT BY SetOptions) SEND
+
+    esp8266_mqtt_bench_mark_t mark;
+    uint32_t i;
+
+    s_esp8266_mqtt_bench_begin(&mark);
+    for(i = 0; i < s_iterations; i++)
+    {
+        ESP8266_MQTT_CLIENT_Send_Connect();
+        ESP8266_HOST_Poll();
+    }
+    s_esp8266_mqtt_bench_end(&mark, "CONNECT", s_iterations, false);
+}
+
+static void s_esp8266_mqtt_bench_publish(uint16_t topic_len, uint16_t payload_len, esp8266_mqtt_qos_t qos)
+{
+    //STRING PUBLISH. QOS 1 : EVERY PUBLISH ACKNOWLEDGED (PUBACK PARSED) RIGHT AWAY
+
+    esp8266_mqtt_bench_mark_t mark;
+    char name[64];
+    char* topic = malloc(topic_len + 1);
+    char* payload = malloc(payload_len + 1);
+    uint8_t puback[4] = {0x40, 0x02, 0x00, 0x00};
+    uint32_t i;
+
+    memset(topic, 't', topic_len);
+    topic[topic_len] = '\0';
+    memset(payload, 'p', payload_len);
+    payload[payload_len] = '\0';
+
+    s_esp8266_mqtt_bench_begin(&mark);
+    for(i = 0; i < s_iterations; i++)
+    {
+        ESP8266_MQTT_CLIENT_Send_PublishWithCb(topic, payload, qos, NULL, NULL);
+        ESP8266_HOST_Poll();
+        if(qos != ESP8266_MQTT_QOS_0)
+        {
+            puback[2] = (uint8_t)(s_client.mqtt_message_id >> 8);
+            puback[3] = (uint8_t)s_client.mqtt_message_id;
+            ESP8266_HOST_TRANSPORT_Inject(&s_transport, puback, sizeof(puback));
+        }
+    }
+    os_sprintf(name, "PUBLISH QOS %u TOPIC %u PAYLOAD %u", qos, topic_len, payload_len);
+    s_esp8266_mqtt_bench_end(&mark, name, s_iterations, false);
+    free(topic);
+    free(payload);
+}
+
+static void s_esp8266_mqtt_bench_parse(uint16_t payload_len)
+{
+    //INBOUND QOS 0 PUBLISH PARSE + DISPATCH (BATCHES OF PACKETS PER RECEIVE CB)
+
+    esp8266_mqtt_bench_mark_t mark;
+    char name[64];
+    const char* topic = "bench/in";
+    uint16_t topic_len = os_strlen(topic);
+    uint32_t remaining = 2 + topic_len + payload_len;
+    uint16_t packet_len;
+    uint8_t* batch;
+    uint8_t* packet;
+    uint32_t i;
+
+    //FIXED HEADER + TOPIC + PAYLOAD, ESP8266_MQTT_BENCH_PARSE_BATCH TIMES
+    packet = malloc(5 + remaining);
+    packet_len = 0;
+    packet[packet_len++] = 0x30;
+    do
+    {
+        packet[packet_len] = remaining & 0x7F;
+        remaining >>= 7;
+        packet[packet_len++] |= (remaining > 0) ? 0x80 : 0;
+    }while(remaining > 0);
+    packet[packet_len++] = 0;
+    packet[packet_len++] = topic_len;
+    memcpy(&packet[packet_len], topic, topic_len);
+    packet_len += topic_len;
+    memset(&packet[packet_len], 'p', payload_len);
+    packet_len += payload_len;
+    batch = malloc(packet_len * ESP8266_MQTT_BENCH_PARSE_BATCH);
+    for(i = 0; i < ESP8266_MQTT_BENCH_PARSE_BATCH; i++)
+    {
+        memcpy(&batch[i * packet_len], packet, packet_len);
+    }
+
+    ESP8266_MQTT_CLIENT_Subscribe((char*)topic, ESP8266_MQTT_QOS_0, s_esp8266_mqtt_bench_handler, NULL);
+    ESP8266_HOST_Poll();
+    s_handled = 0;
+    s_esp8266_mqtt_bench_begin(&mark);
+    for(i = 0; i < s_iterations / ESP8266_MQTT_BENCH_PARSE_BATCH; i++)
+    {
+        ESP8266_HOST_TRANSPORT_Inject(&s_transport, batch, packet_len * ESP8266_MQTT_BENCH_PARSE_BATCH);
+        s_bytes_received += packet_len * ESP8266_MQTT_BENCH_PARSE_BATCH;
+    }
+    os_sprintf(name, "PARSE PUBLISH PAYLOAD %u", payload_len);
+    s_esp8266_mqtt_bench_end(&mark, name, (s_handled != 0) ? s_handled : 1, true);
+    ESP8266_MQTT_CLIENT_Unsubscribe((char*)topic);
+    ESP8266_HOST_Poll();
+    free(batch);
+    free(packet);
+}
+
+static void s_esp8266_mqtt_bench_payload(char* dest, uint16_t len, esp8266_mqtt_bench_payload_t kind)
+{
+    //len PRINTABLE CHARS (STRING PUBLISH) + NUL
+    //JSON : SENSOR RECORDS WITH CHANGING VALUES. TEXT : ONE SENTENCE REPEATED
+    //RANDOM : NOTHING TO FIND (WORST CASE, ALL ENCODER TIME WASTED)
+
+    const char* sentence = "the quick brown fox jumps over the lazy dog. ";
+    char record[64];
+    uint16_t pos = 0;
+    uint16_t n = 0;
+    uint16_t i;
+
+    while(pos < len)
+    {
+        if(kind == ESP8266_MQTT_BENCH_PAYLOAD_JSON)
+        {
+            os_sprintf(record, "{\"ts\":%u,\"temp\":%u.%u,\"rssi\":-%u},", 1700000000 + n * 60, 20 + (n * 7) % 10, (n * 3) % 10, 50 + (n * 13) % 30);
+        }
+        else if(kind == ESP8266_MQTT_BENCH_PAYLOAD_TEXT)
+        {
+            os_strcpy(record, sentence);
+        }
+        else
+        {
+            for(i = 0; i < 32; i++)
+            {
+                record[i] = '!' + (os_random() % 94);
+            }
+            record[32] = '\0';
+        }
+        for(i = 0; record[i] != '\0' && pos < len; i++)
+        {
+            dest[pos++] = record[i];
+        }
+        n++;
+    }
+    dest[len] = '\0';
+}
+
+static void s_esp8266_mqtt_bench_compress_publish(esp8266_mqtt_bench_payload_t kind, uint16_t payload_len)
+{
+    //QOS 0 STRING PUBLISH WITH COMPRESSION ON. BYTES/MSG IS WHAT GOES ON THE WIRE
+
+    esp8266_mqtt_bench_mark_t mark;
+    char name[64];
+    char* payload = malloc(payload_len + 1);
+    uint32_t i;
+
+    s_esp8266_mqtt_bench_payload(payload, payload_len, kind);
+    ESP8266_MQTT_CLIENT_SetCompression(true, ESP8266_MQTT_BENCH_COMPRESS_MIN);
+    s_esp8266_mqtt_bench_begin(&mark);
+    for(i = 0; i < s_iterations; i++)
+    {
+        ESP8266_MQTT_CLIENT_Send_PublishWithCb("bench/lzf", payload, ESP8266_MQTT_QOS_0, NULL, NULL);
+        ESP8266_HOST_Poll();
+    }
+    os_sprintf(name, "PUBLISH LZF %s PAYLOAD %u", s_payload_names[kind], payload_len);
+    s_esp8266_mqtt_bench_end(&mark, name, s_iterations, false);
+    ESP8266_MQTT_CLIENT_SetCompression(false, 0);
+    free(payload);
+}
+
+static void s_esp8266_mqtt_bench_compress_codec(esp8266_mqtt_bench_payload_t kind, uint16_t payload_len)
+{
+    //ENCODER / DECODER ALONE : COMPRESSED SIZE / ORIGINAL SIZE, BYTES SAVED AND
+    //CPU TIME PER PAYLOAD. AN INCOMPRESSIBLE PAYLOAD COSTS THE ENCODE TIME AND
+    //IS SENT AS IS (RATIO 1.00)
+
+    struct timespec start;
+    struct timespec end;
+    char name[64];
+    char* payload = malloc(payload_len + 1);
+    uint8_t* packed = malloc(payload_len);
+    uint8_t* unpacked = malloc(payload_len);
+    uint32_t runs = (s_iterations / 10) + 1;
+    uint16_t packed_len = 0;
+    double encode_us;
+    double decode_us = 0;
+    uint32_t i;
+
+    s_esp8266_mqtt_bench_payload(payload, payload_len, kind);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(i = 0; i < runs; i++)
+    {
+        packed_len = ESP8266_MQTT_COMPRESS_Encode((uint8_t*)payload, payload_len, packed, payload_len - 1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    encode_us = ((double)(end.tv_sec - start.tv_sec) * 1e6 + (double)(end.tv_nsec - start.tv_nsec) / 1e3) / runs;
+
+    if(packed_len != 0)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for(i = 0; i < runs; i++)
+        {
+            if(ESP8266_MQTT_COMPRESS_Decode(packed, packed_len, unpacked, payload_len) != payload_len)
+            {
+                printf("DECODE FAILED\n");
+                break;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        decode_us = ((double)(end.tv_sec - start.tv_sec) * 1e6 + (double)(end.tv_nsec - start.tv_nsec) / 1e3) / runs;
+    }
+    else
+    {
+        packed_len = payload_len;
+    }
+
+    os_sprintf(name, "%s PAYLOAD %u", s_payload_names[kind], payload_len);
+    printf("%-34s %10.2f %12u %12.2f %12.2f\n",
+            name,
+            (double)packed_len / payload_len,
+            payload_len - packed_len,
+            encode_us,
+            decode_us);
+    free(payload);
+    free(packed);
+    free(unpacked);
+}
+
+static void s_esp8266_mqtt_bench_handler(void* arg, char* topic, uint16_t topic_len, char* payload, uint16_t payload_len)
+{
+    s_handled++;
+}
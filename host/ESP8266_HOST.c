@@ -0,0 +1,599 @@
+/**********************************************************************************
+* ESP8266 HOST RUNTIME
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "ESP8266_HOST.h"
+#include "ip_addr.h"
+
+//LOCAL LIBRARY VARIABLES////////////////////////////////
+//CLOCK / TIMER RELATED
+static uint32_t s_now_us;
+static bool s_real_time;
+static ETSTimer* s_timers;			//ARMED TIMERS SORTED BY EXPIRY
+
+//EVENT RELATED
+typedef struct
+{
+    void (*fn)(void*);
+    void* arg;
+    ETSTask task;
+    ETSEvent event;
+}esp8266_host_event_t;
+static esp8266_host_event_t s_events[ESP8266_HOST_EVENTS_MAX];
+static uint16_t s_event_head;
+static uint16_t s_event_count;
+static ETSTask s_tasks[USER_TASK_PRIO_MAX];
+
+//HEAP RELATED
+//EVERY BLOCK CARRIES ITS SIZE IN A HEADER (KEEPS 16 BYTE ALIGNMENT)
+#define ESP8266_HOST_HEAP_HEADER			(16)
+static esp8266_host_heap_stats_t s_heap;
+
+//RTC RELATED
+static uint8_t s_rtc[ESP8266_HOST_RTC_USER_BLOCKS * 4];
+static int s_rtc_fd = -1;
+
+//FLASH RELATED
+static uint8_t* s_flash;
+static uint32_t s_flash_size;
+static bool s_flash_mapped;
+static uint32_t s_flash_cut_left;
+static bool s_flash_cut_armed;
+static esp8266_host_flash_stats_t s_flash_stats;
+//END LOCAL LIBRARY VARIABLES/////////////////////////////
+
+//LOCAL LIBRARY FUNCTIONS////////////////////////////////
+static void s_esp8266_host_timer_insert(ETSTimer* ptimer);
+static bool s_esp8266_host_timer_remove(ETSTimer* ptimer);
+static bool s_esp8266_host_event_post(void (*fn)(void*), void* arg, ETSTask task, ETSSignal sig, ETSParam par);
+static bool s_esp8266_host_run_events(void);
+static uint32_t s_esp8266_host_real_us(void);
+static bool s_esp8266_host_flash_ready(void);
+static void s_esp8266_host_flash_program(uint8_t* dest, const uint8_t* src, uint32_t len, bool erase);
+//END LOCAL LIBRARY FUNCTIONS/////////////////////////////
+
+//RUNTIME FUNCTIONS
+void ESP8266_HOST_Reset(void)
+{
+    //FORGET ALL TIMERS / EVENTS / TASKS AND RESTART THE VIRTUAL CLOCK
+    //HEAP COUNTERS, RTC AND FLASH CONTENTS ARE KEPT
+
+    s_timers = NULL;
+    s_event_head = 0;
+    s_event_count = 0;
+    memset(s_tasks, 0, sizeof(s_tasks));
+    s_now_us = 0;
+}
+
+void ESP8266_HOST_SetRealTime(bool enable)
+{
+    //system_get_time FOLLOWS THE PC CLOCK (true) OR THE VIRTUAL ONE (false)
+
+    if(s_real_time && !enable)
+    {
+        s_now_us = s_esp8266_host_real_us();
+    }
+    s_real_time = enable;
+}
+
+void ESP8266_HOST_Run(uint32_t ms)
+{
+    //ADVANCE THE CLOCK BY ms, FIRING DUE TIMERS IN ORDER AND RUNNING POSTED
+    //EVENTS BEFORE EACH TIMER AND AT THE END
+
+    uint32_t target = system_get_time() + ms * 1000;
+    ETSTimer* ptimer;
+
+    while(1)
+    {
+        s_esp8266_host_run_events();
+        ptimer = s_timers;
+        if(ptimer == NULL || (int32_t)(ptimer->timer_expire - target) > 0)
+        {
+            break;
+        }
+        if(!s_real_time && (int32_t)(ptimer->timer_expire - s_now_us) > 0)
+        {
+            s_now_us = ptimer->timer_expire;
+        }
+        s_timers = ptimer->timer_next;
+        ptimer->timer_next = NULL;
+        if(ptimer->timer_period != 0)
+        {
+            ptimer->timer_expire += ptimer->timer_period;
+            s_esp8266_host_timer_insert(ptimer);
+        }
+        if(ptimer->timer_func != NULL)
+        {
+            (*ptimer->timer_func)(ptimer->timer_arg);
+        }
+    }
+    if(!s_real_time && (int32_t)(target - s_now_us) > 0)
+    {
+        s_now_us = target;
+    }
+    s_esp8266_host_run_events();
+}
+
+void ESP8266_HOST_Poll(void)
+{
+    //RUN POSTED EVENTS AND TIMERS ALREADY DUE WITHOUT MOVING THE CLOCK
+
+    ESP8266_HOST_Run(0);
+}
+
+bool ESP8266_HOST_Defer(void (*fn)(void*), void* arg)
+{
+    //CALL fn(arg) FROM THE EVENT LOOP (LIKE AN SDK CB)
+
+    return s_esp8266_host_event_post(fn, arg, NULL, 0, 0);
+}
+
+//HEAP FUNCTIONS
+void ESP8266_HOST_GetHeapStats(esp8266_host_heap_stats_t* stats)
+{
+    *stats = s_heap;
+}
+
+void ESP8266_HOST_ResetHeapStats(void)
+{
+    //ZERO THE COUNTERS. THE PEAK RESTARTS FROM THE BYTES IN USE NOW
+
+    s_heap.allocs = 0;
+    s_heap.frees = 0;
+    s_heap.bytes_peak = s_heap.bytes_in_use;
+}
+
+void* ESP8266_HOST_Malloc(size_t size, bool zero)
+{
+    uint8_t* block = zero ? calloc(1, size + ESP8266_HOST_HEAP_HEADER) : malloc(size + ESP8266_HOST_HEAP_HEADER);
+
+    if(block == NULL)
+    {
+        return NULL;
+    }
+    *(size_t*)block = size;
+    s_heap.allocs++;
+    s_heap.bytes_in_use += size;
+    if(s_heap.bytes_in_use > s_heap.bytes_peak)
+    {
+        s_heap.bytes_peak = s_heap.bytes_in_use;
+    }
+    return block + ESP8266_HOST_HEAP_HEADER;
+}
+
+void ESP8266_HOST_Free(void* ptr)
+{
+    uint8_t* block;
+
+    if(ptr == NULL)
+    {
+        return;
+    }
+    block = (uint8_t*)ptr - ESP8266_HOST_HEAP_HEADER;
+    s_heap.frees++;
+    s_heap.bytes_in_use -= *(size_t*)block;
+    free(block);
+}
+
+//RTC MEMORY FUNCTIONS
+bool ESP8266_HOST_RtcOpen(const char* path)
+{
+    //BACK RTC USER MEMORY BY A FILE (CREATED ZEROED IF MISSING). NULL GOES
+    //BACK TO PROCESS MEMORY (CONTENTS KEPT)
+
+    int fd;
+
+    if(s_rtc_fd >= 0)
+    {
+        close(s_rtc_fd);
+        s_rtc_fd = -1;
+    }
+    if(path == NULL)
+    {
+        return true;
+    }
+    fd = open(path, O_RDWR | O_CREAT, 0600);
+    if(fd < 0)
+    {
+        return false;
+    }
+    memset(s_rtc, 0, sizeof(s_rtc));
+    if(pread(fd, s_rtc, sizeof(s_rtc), 0) < 0 || pwrite(fd, s_rtc, sizeof(s_rtc), 0) != (ssize_t)sizeof(s_rtc))
+    {
+        close(fd);
+        return false;
+    }
+    s_rtc_fd = fd;
+    return true;
+}
+
+void ESP8266_HOST_RtcClear(void)
+{
+    //POWER ON RESET CONTENTS
+
+    memset(s_rtc, 0, sizeof(s_rtc));
+    if(s_rtc_fd >= 0 && pwrite(s_rtc_fd, s_rtc, sizeof(s_rtc), 0) < 0)
+    {
+        printf("ESP8266 HOST : RTC file write failed\n");
+    }
+}
+
+//FLASH FUNCTIONS
+bool ESP8266_HOST_FlashOpen(const char* path, uint16_t sectors)
+{
+    //BACK SPI FLASH BY A FILE OF sectors SECTORS (ERASED IF NEW / SHORT).
+    //NULL PATH = PROCESS MEMORY
+
+    int fd;
+    off_t size;
+    uint32_t flash_size = (uint32_t)sectors * SPI_FLASH_SEC_SIZE;
+    uint8_t* flash;
+
+    ESP8266_HOST_FlashClose();
+    if(path == NULL)
+    {
+        flash = malloc(flash_size);
+        if(flash == NULL)
+        {
+            return false;
+        }
+        memset(flash, 0xFF, flash_size);
+        s_flash = flash;
+        s_flash_size = flash_size;
+        s_flash_mapped = false;
+        return true;
+    }
+
+    fd = open(path, O_RDWR | O_CREAT, 0600);
+    if(fd < 0)
+    {
+        return false;
+    }
+    size = lseek(fd, 0, SEEK_END);
+    if(size < (off_t)flash_size && ftruncate(fd, flash_size) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    flash = mmap(NULL, flash_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(flash == MAP_FAILED)
+    {
+        return false;
+    }
+    if(size < (off_t)flash_size)
+    {
+        memset(flash + (size < 0 ? 0 : size), 0xFF, flash_size - (size < 0 ? 0 : (uint32_t)size));
+    }
+    s_flash = flash;
+    s_flash_size = flash_size;
+    s_flash_mapped = true;
+    return true;
+}
+
+void ESP8266_HOST_FlashClose(void)
+{
+    if(s_flash == NULL)
+    {
+        return;
+    }
+    if(s_flash_mapped)
+    {
+        munmap(s_flash, s_flash_size);
+    }
+    else
+    {
+        free(s_flash);
+    }
+    s_flash = NULL;
+    s_flash_size = 0;
+    s_flash_cut_armed = false;
+}
+
+void ESP8266_HOST_FlashPowerCut(uint32_t after_bytes)
+{
+    //END THE PROCESS ONCE after_BYTES MORE BYTES HAVE BEEN WRITTEN / ERASED
+
+    s_flash_cut_left = after_bytes;
+    s_flash_cut_armed = true;
+}
+
+void ESP8266_HOST_GetFlashStats(esp8266_host_flash_stats_t* stats)
+{
+    *stats = s_flash_stats;
+}
+
+//SDK : TIMERS
+void os_timer_setfn(os_timer_t* ptimer, os_timer_func_t* pfunction, void* parg)
+{
+    s_esp8266_host_timer_remove(ptimer);
+    ptimer->timer_func = pfunction;
+    ptimer->timer_arg = parg;
+    ptimer->timer_next = NULL;
+    ptimer->timer_period = 0;
+}
+
+void os_timer_arm(os_timer_t* ptimer, uint32_t milliseconds, bool repeat_flag)
+{
+    s_esp8266_host_timer_remove(ptimer);
+    ptimer->timer_expire = system_get_time() + milliseconds * 1000;
+    ptimer->timer_period = repeat_flag ? (milliseconds == 0 ? 1000 : milliseconds * 1000) : 0;
+    s_esp8266_host_timer_insert(ptimer);
+}
+
+void os_timer_disarm(os_timer_t* ptimer)
+{
+    s_esp8266_host_timer_remove(ptimer);
+}
+
+unsigned long os_random(void)
+{
+    return (unsigned long)random();
+}
+
+//SDK : SYSTEM
+uint32_t system_get_time(void)
+{
+    return s_real_time ? s_esp8266_host_real_us() : s_now_us;
+}
+
+uint32_t system_get_free_heap_size(void)
+{
+    return (s_heap.bytes_in_use < ESP8266_HOST_HEAP_SIZE) ? (ESP8266_HOST_HEAP_SIZE - s_heap.bytes_in_use) : 0;
+}
+
+bool system_rtc_mem_read(uint8_t src_addr, void* des_addr, uint16_t load_size)
+{
+    uint32_t offset;
+
+    if(src_addr < ESP8266_HOST_RTC_USER_BLOCK_FIRST)
+    {
+        return false;
+    }
+    offset = (uint32_t)(src_addr - ESP8266_HOST_RTC_USER_BLOCK_FIRST) * 4;
+    if(offset + load_size > sizeof(s_rtc))
+    {
+        return false;
+    }
+    memcpy(des_addr, s_rtc + offset, load_size);
+    return true;
+}
+
+bool system_rtc_mem_write(uint8_t des_addr, const void* src_addr, uint16_t save_size)
+{
+    uint32_t offset;
+
+    if(des_addr < ESP8266_HOST_RTC_USER_BLOCK_FIRST)
+    {
+        return false;
+    }
+    offset = (uint32_t)(des_addr - ESP8266_HOST_RTC_USER_BLOCK_FIRST) * 4;
+    if(offset + save_size > sizeof(s_rtc))
+    {
+        return false;
+    }
+    memcpy(s_rtc + offset, src_addr, save_size);
+    if(s_rtc_fd >= 0 && pwrite(s_rtc_fd, s_rtc + offset, save_size, offset) != (ssize_t)save_size)
+    {
+        return false;
+    }
+    return true;
+}
+
+bool system_os_task(os_task_t task, uint8_t prio, os_event_t* queue, uint8_t qlen)
+{
+    if(prio >= USER_TASK_PRIO_MAX || task == NULL)
+    {
+        return false;
+    }
+    s_tasks[prio] = task;
+    return true;
+}
+
+bool system_os_post(uint8_t prio, os_signal_t sig, os_param_t par)
+{
+    if(prio >= USER_TASK_PRIO_MAX || s_tasks[prio] == NULL)
+    {
+        return false;
+    }
+    return s_esp8266_host_event_post(NULL, NULL, s_tasks[prio], sig, par);
+}
+
+//SDK : LWIP
+uint32_t ipaddr_addr(const char* cp)
+{
+    unsigned int b[4];
+    char tail;
+
+    if(cp == NULL || sscanf(cp, "%u.%u.%u.%u%c", &b[0], &b[1], &b[2], &b[3], &tail) != 4 ||
+        b[0] > 255 || b[1] > 255 || b[2] > 255 || b[3] > 255)
+    {
+        return 0xFFFFFFFF;
+    }
+    return b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+//SDK : SPI FLASH
+SpiFlashOpResult spi_flash_erase_sector(uint16_t sec)
+{
+    uint32_t addr = (uint32_t)sec * SPI_FLASH_SEC_SIZE;
+
+    if(!s_esp8266_host_flash_ready() || addr + SPI_FLASH_SEC_SIZE > s_flash_size)
+    {
+        s_flash_stats.errors++;
+        return SPI_FLASH_RESULT_ERR;
+    }
+    s_flash_stats.erases++;
+    s_esp8266_host_flash_program(s_flash + addr, NULL, SPI_FLASH_SEC_SIZE, true);
+    return SPI_FLASH_RESULT_OK;
+}
+
+SpiFlashOpResult spi_flash_write(uint32_t des_addr, uint32_t* src_addr, uint32_t size)
+{
+    //NOR : BITS CAN ONLY BE CLEARED. A WRITE THAT WOULD SET A CLEARED BIT
+    //BACK TO 1 IS DONE AS ON THE CHIP (AND) BUT COUNTED AS AN ERROR
+
+    if(!s_esp8266_host_flash_ready() || (des_addr & 3) != 0 || (size & 3) != 0 ||
+        des_addr + size > s_flash_size)
+    {
+        s_flash_stats.errors++;
+        return SPI_FLASH_RESULT_ERR;
+    }
+    s_flash_stats.writes++;
+    s_esp8266_host_flash_program(s_flash + des_addr, (const uint8_t*)src_addr, size, false);
+    return SPI_FLASH_RESULT_OK;
+}
+
+SpiFlashOpResult spi_flash_read(uint32_t src_addr, uint32_t* des_addr, uint32_t size)
+{
+    if(!s_esp8266_host_flash_ready() || (src_addr & 3) != 0 || src_addr + size > s_flash_size)
+    {
+        s_flash_stats.errors++;
+        return SPI_FLASH_RESULT_ERR;
+    }
+    s_flash_stats.reads++;
+    memcpy(des_addr, s_flash + src_addr, size);
+    return SPI_FLASH_RESULT_OK;
+}
+
+static void s_esp8266_host_timer_insert(ETSTimer* ptimer)
+{
+    //KEEP THE LIST SORTED BY EXPIRY (EQUAL EXPIRY : ARM ORDER)
+
+    ETSTimer** link = &s_timers;
+    uint32_t now = system_get_time();
+
+    while(*link != NULL && (int32_t)((*link)->timer_expire - now) <= (int32_t)(ptimer->timer_expire - now))
+    {
+        link = &(*link)->timer_next;
+    }
+    ptimer->timer_next = *link;
+    *link = ptimer;
+}
+
+static bool s_esp8266_host_timer_remove(ETSTimer* ptimer)
+{
+    ETSTimer** link = &s_timers;
+
+    while(*link != NULL)
+    {
+        if(*link == ptimer)
+        {
+            *link = ptimer->timer_next;
+            ptimer->timer_next = NULL;
+            return true;
+        }
+        link = &(*link)->timer_next;
+    }
+    return false;
+}
+
+static bool s_esp8266_host_event_post(void (*fn)(void*), void* arg, ETSTask task, ETSSignal sig, ETSParam par)
+{
+    esp8266_host_event_t* event;
+
+    if(s_event_count >= ESP8266_HOST_EVENTS_MAX)
+    {
+        return false;
+    }
+    event = &s_events[(s_event_head + s_event_count) % ESP8266_HOST_EVENTS_MAX];
+    event->fn = fn;
+    event->arg = arg;
+    event->task = task;
+    event->event.sig = sig;
+    event->event.par = par;
+    s_event_count++;
+    return true;
+}
+
+static bool s_esp8266_host_run_events(void)
+{
+    //RUN POSTED EVENTS UNTIL NONE IS LEFT (EVENTS MAY POST MORE)
+
+    bool ran = false;
+    esp8266_host_event_t event;
+
+    while(s_event_count != 0)
+    {
+        event = s_events[s_event_head];
+        s_event_head = (s_event_head + 1) % ESP8266_HOST_EVENTS_MAX;
+        s_event_count--;
+        if(event.fn != NULL)
+        {
+            (*event.fn)(event.arg);
+        }
+        else
+        {
+            (*event.task)(&event.event);
+        }
+        ran = true;
+    }
+    return ran;
+}
+
+static uint32_t s_esp8266_host_real_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000);
+}
+
+static bool s_esp8266_host_flash_ready(void)
+{
+    //FLASH DEFAULTS TO PROCESS MEMORY
+
+    if(s_flash == NULL)
+    {
+        return ESP8266_HOST_FlashOpen(NULL, ESP8266_HOST_FLASH_SECTORS_DEFAULT);
+    }
+    return true;
+}
+
+static void s_esp8266_host_flash_program(uint8_t* dest, const uint8_t* src, uint32_t len, bool erase)
+{
+    //ERASE (SET TO 0xFF) OR AND-PROGRAM len BYTES. AN ARMED POWER CUT STOPS
+    //THE PROCESS PART WAY THROUGH
+
+    uint32_t i;
+
+    for(i = 0; i < len; i++)
+    {
+        if(s_flash_cut_armed)
+        {
+            if(s_flash_cut_left == 0)
+            {
+                _exit(ESP8266_HOST_POWER_CUT_EXIT);
+            }
+            s_flash_cut_left--;
+        }
+        if(erase)
+        {
+            dest[i] = 0xFF;
+        }
+        else
+        {
+            if((dest[i] & src[i]) != src[i])
+            {
+                s_flash_stats.errors++;
+            }
+            dest[i] &= src[i];
+        }
+    }
+    if(!erase)
+    {
+        s_flash_stats.bytes_written += len;
+    }
+}
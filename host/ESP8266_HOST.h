@@ -0,0 +1,90 @@
+/**********************************************************************************
+* ESP8266 HOST RUNTIME
+*
+* NOTE
+* -----
+*   (1) BACKS THE SDK SHIM HEADERS OF THIS DIRECTORY SO THE LIBRARY RUNS ON A PC
+*       (TESTS + BENCHMARK, SEE CMakeLists.txt). NOTHING HERE IS BUILT FOR THE
+*       CHIP
+*
+*   (2) TIME IS VIRTUAL. system_get_time ONLY MOVES IN ESP8266_HOST_Run, WHICH
+*       FIRES THE DUE os_timer CBS IN EXPIRY ORDER AND RUNS THE EVENTS POSTED
+*       MEANWHILE (system_os_post, DEFERRED TRANSPORT CBS) IN FIFO ORDER, LIKE
+*       THE SDK DOES BETWEEN USER CODE CALLS. ESP8266_HOST_SetRealTime MAKES
+*       system_get_time FOLLOW THE PC CLOCK INSTEAD (BENCHMARK)
+*
+*   (3) os_malloc / os_zalloc / os_free ARE COUNTED (ALLOCATIONS, FREES, BYTES
+*       IN USE AND PEAK)
+*
+*   (4) RTC USER MEMORY (BLOCKS 64 - 191) AND SPI FLASH CAN BE BACKED BY FILES
+*       (ESP8266_HOST_RtcOpen / _FlashOpen) SO THEY OUTLIVE THE PROCESS. A TEST
+*       CAN THEN FORK A CHILD, LET IT DIE (DEEP SLEEP / POWER CUT) AND CHECK
+*       WHAT A FRESH PROCESS RECOVERS. ESP8266_HOST_FlashPowerCut ENDS THE
+*       PROCESS (_exit(ESP8266_HOST_POWER_CUT_EXIT)) PART WAY THROUGH A FLASH
+*       WRITE / ERASE ONCE THE GIVEN NUMBER OF BYTES HAS BEEN PROGRAMMED
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#ifndef _ESP8266_HOST_H_
+#define _ESP8266_HOST_H_
+
+#include "ets_sys.h"
+#include "osapi.h"
+#include "os_type.h"
+#include "user_interface.h"
+#include "spi_flash.h"
+
+#define ESP8266_HOST_EVENTS_MAX				(256)
+#define ESP8266_HOST_HEAP_SIZE				(81920)		//REPORTED BY system_get_free_heap_size
+#define ESP8266_HOST_RTC_USER_BLOCK_FIRST	(64)
+#define ESP8266_HOST_RTC_USER_BLOCKS		(128)
+#define ESP8266_HOST_FLASH_SECTORS_DEFAULT	(1024)		//4 MB
+#define ESP8266_HOST_POWER_CUT_EXIT			(77)
+
+//CUSTOM VARIABLE STRUCTURES/////////////////////////////
+typedef struct
+{
+	uint32_t allocs;
+	uint32_t frees;
+	uint32_t bytes_in_use;
+	uint32_t bytes_peak;
+}esp8266_host_heap_stats_t;
+
+typedef struct
+{
+	uint32_t erases;
+	uint32_t writes;
+	uint32_t reads;
+	uint32_t bytes_written;
+	uint32_t errors;			//MISALIGNED / OUT OF RANGE / NOT ERASED
+}esp8266_host_flash_stats_t;
+//END CUSTOM VARIABLE STRUCTURES/////////////////////////
+
+//FUNCTION PROTOTYPES/////////////////////////////////////////////
+//RUNTIME FUNCTIONS
+void ESP8266_HOST_Reset(void);
+void ESP8266_HOST_SetRealTime(bool enable);
+void ESP8266_HOST_Run(uint32_t ms);
+void ESP8266_HOST_Poll(void);
+bool ESP8266_HOST_Defer(void (*fn)(void*), void* arg);
+
+//HEAP FUNCTIONS
+void ESP8266_HOST_GetHeapStats(esp8266_host_heap_stats_t* stats);
+void ESP8266_HOST_ResetHeapStats(void);
+
+//RTC MEMORY FUNCTIONS
+bool ESP8266_HOST_RtcOpen(const char* path);
+void ESP8266_HOST_RtcClear(void);
+
+//FLASH FUNCTIONS
+bool ESP8266_HOST_FlashOpen(const char* path, uint16_t sectors);
+void ESP8266_HOST_FlashClose(void);
+void ESP8266_HOST_FlashPowerCut(uint32_t after_bytes);
+void ESP8266_HOST_GetFlashStats(esp8266_host_flash_stats_t* stats);
+//END FUNCTION PROTOTYPES/////////////////////////////////////////
+
+#endif
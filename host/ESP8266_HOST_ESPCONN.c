@@ -0,0 +1,535 @@
+/**********************************************************************************
+* ESP8266 HOST ESPCONN
+*
+* NOTE
+* -----
+*   (1) SECURE ESPCONN STAND-IN. SEE HEADER
+*
+*   (2) WITH OPENSSL : THE CLIENT SSL AND THE PEER SSL EACH HAVE A READ AND A
+*       WRITE MEMORY BIO. s_esp8266_host_espconn_pump MOVES THE TLS RECORDS
+*       BETWEEN THEM (COUNTING THE WIRE BYTES) UNTIL NOTHING IS LEFT IN FLIGHT
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_HOST_ESPCONN.h"
+#include "espconn.h"
+
+#ifdef ESP8266_HOST_TLS
+#include <time.h>
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <openssl/ec.h>
+#endif
+
+//LOCAL LIBRARY VARIABLES////////////////////////////////
+static uint32_t s_local_port = 49152;
+
+#ifdef ESP8266_HOST_TLS
+//ENGINE RELATED
+static bool s_ready;
+static SSL_CTX* s_client_ctx;
+static SSL_CTX* s_peer_ctx;
+static const SSL_CIPHER* s_cipher;
+static SSL_SESSION* s_offered;
+
+//CONNECTION RELATED
+static struct espconn* s_conn;
+static SSL* s_client;
+static SSL* s_peer;
+static bool s_connected;
+static esp8266_host_espconn_stats_t s_stats;
+static uint8_t s_peer_rx[ESP8266_HOST_ESPCONN_CAPTURE_MAX];
+static uint32_t s_peer_rx_len;
+#endif
+//END LOCAL LIBRARY VARIABLES/////////////////////////////
+
+#ifdef ESP8266_HOST_TLS
+//LOCAL LIBRARY FUNCTIONS////////////////////////////////
+static bool s_esp8266_host_espconn_setup(void);
+static void s_esp8266_host_espconn_pump(void);
+static void s_esp8266_host_espconn_close(void);
+static void s_esp8266_host_espconn_handshake_event(void* arg);
+static void s_esp8266_host_espconn_sent_event(void* arg);
+static void s_esp8266_host_espconn_discon_event(void* arg);
+
+//SESSION HOOKS
+static void s_esp8266_host_espconn_offer(void* engine_arg, const esp8266_mqtt_tls_session_t* session);
+static bool s_esp8266_host_espconn_fetch(void* engine_arg, esp8266_mqtt_tls_session_t* session, bool* resumed);
+static void s_esp8266_host_espconn_wire_bytes(void* engine_arg, uint32_t* sent, uint32_t* received);
+//END LOCAL LIBRARY FUNCTIONS/////////////////////////////
+
+const esp8266_mqtt_tls_session_hooks_t ESP8266_HOST_ESPCONN_SESSION_HOOKS = {s_esp8266_host_espconn_offer,
+                                                                            s_esp8266_host_espconn_fetch,
+                                                                            s_esp8266_host_espconn_wire_bytes};
+
+void ESP8266_HOST_ESPCONN_GetStats(esp8266_host_espconn_stats_t* stats)
+{
+    *stats = s_stats;
+}
+
+uint32_t ESP8266_HOST_ESPCONN_PeerTake(uint8_t* dest, uint32_t max_len)
+{
+    //COPY OUT (dest MAY BE NULL) AND FORGET THE BYTES THE PEER DECRYPTED
+
+    uint32_t len = s_peer_rx_len;
+
+    if(dest != NULL)
+    {
+        if(len > max_len)
+        {
+            len = max_len;
+        }
+        memcpy(dest, s_peer_rx, len);
+    }
+    s_peer_rx_len = 0;
+    return len;
+}
+
+void ESP8266_HOST_ESPCONN_PeerSend(const uint8_t* data, uint16_t len)
+{
+    //BYTES FROM THE PEER : ENCRYPTED, PUMPED, DECRYPTED BY THE CLIENT SSL AND
+    //GIVEN TO THE RECEIVE CB
+
+    uint8_t buffer[4096];
+    int n;
+
+    if(!s_connected || SSL_write(s_peer, data, len) != len)
+    {
+        return;
+    }
+    s_esp8266_host_espconn_pump();
+    while((n = SSL_read(s_client, buffer, sizeof(buffer))) > 0)
+    {
+        if(s_conn->recv_callback != NULL)
+        {
+            (*s_conn->recv_callback)(s_conn, (char*)buffer, (unsigned short)n);
+        }
+    }
+}
+
+void ESP8266_HOST_ESPCONN_PeerForgetSessions(void)
+{
+    //EMPTY THE PEER SESSION CACHE (EG BROKER RESTARTED). THE NEXT HANDSHAKE IS
+    //A FULL ONE WHATEVER IS OFFERED
+
+    if(s_ready)
+    {
+        SSL_CTX_flush_sessions(s_peer_ctx, (long)time(NULL) + 86400L * 365);
+    }
+}
+
+sint8 espconn_secure_connect(struct espconn* espconn)
+{
+    //NEW TLS CONNECTION TO THE PEER (OFFERED SESSION, IF ANY, TRIED). THE
+    //HANDSHAKE RUNS FROM THE EVENT LOOP
+
+    BIO* bio[4];
+
+    if(!s_esp8266_host_espconn_setup())
+    {
+        return ESPCONN_ARG;
+    }
+    s_esp8266_host_espconn_close();
+
+    s_client = SSL_new(s_client_ctx);
+    s_peer = SSL_new(s_peer_ctx);
+    bio[0] = BIO_new(BIO_s_mem());
+    bio[1] = BIO_new(BIO_s_mem());
+    bio[2] = BIO_new(BIO_s_mem());
+    bio[3] = BIO_new(BIO_s_mem());
+    BIO_set_mem_eof_return(bio[0], -1);
+    BIO_set_mem_eof_return(bio[2], -1);
+    SSL_set_bio(s_client, bio[0], bio[1]);
+    SSL_set_bio(s_peer, bio[2], bio[3]);
+    SSL_set_connect_state(s_client);
+    SSL_set_accept_state(s_peer);
+    if(s_offered != NULL)
+    {
+        SSL_set_session(s_client, s_offered);
+        SSL_SESSION_free(s_offered);
+        s_offered = NULL;
+    }
+
+    s_conn = espconn;
+    s_stats.connects++;
+    ESP8266_HOST_Defer(s_esp8266_host_espconn_handshake_event, espconn);
+    return ESPCONN_OK;
+}
+
+sint8 espconn_secure_disconnect(struct espconn* espconn)
+{
+    //CLOSE NOTIFY BOTH WAYS (THE PEER KEEPS THE SESSION), DISCONNECT CB POSTED
+
+    if(s_client == NULL || espconn != s_conn)
+    {
+        return ESPCONN_ARG;
+    }
+    s_esp8266_host_espconn_close();
+    ESP8266_HOST_Defer(s_esp8266_host_espconn_discon_event, espconn);
+    return ESPCONN_OK;
+}
+
+sint8 espconn_secure_send(struct espconn* espconn, uint8* psent, uint16 length)
+{
+    //ENCRYPT, PUMP, PEER DECRYPTS INTO ITS CAPTURE BUFFER. SENT CB POSTED
+
+    uint8_t* dest;
+    int n;
+
+    if(!s_connected || espconn != s_conn || SSL_write(s_client, psent, length) != length)
+    {
+        return ESPCONN_ARG;
+    }
+    s_esp8266_host_espconn_pump();
+    do
+    {
+        dest = &s_peer_rx[s_peer_rx_len];
+        n = SSL_read(s_peer, dest, sizeof(s_peer_rx) - s_peer_rx_len);
+        if(n > 0)
+        {
+            s_peer_rx_len += n;
+        }
+    }while(n > 0 && s_peer_rx_len < sizeof(s_peer_rx));
+    ESP8266_HOST_Defer(s_esp8266_host_espconn_sent_event, espconn);
+    return ESPCONN_OK;
+}
+#else
+sint8 espconn_secure_connect(struct espconn* espconn)
+{
+    return ESPCONN_ARG;
+}
+
+sint8 espconn_secure_disconnect(struct espconn* espconn)
+{
+    return ESPCONN_ARG;
+}
+
+sint8 espconn_secure_send(struct espconn* espconn, uint8* psent, uint16 length)
+{
+    return ESPCONN_ARG;
+}
+#endif
+
+bool espconn_secure_set_size(uint8 level, uint16 size)
+{
+    return true;
+}
+
+bool espconn_secure_ca_enable(uint8 level, uint32 flash_sector)
+{
+    return true;
+}
+
+bool espconn_secure_ca_disable(uint8 level)
+{
+    return true;
+}
+
+sint8 espconn_regist_connectcb(struct espconn* espconn, espconn_connect_callback connect_cb)
+{
+    espconn->proto.tcp->connect_callback = connect_cb;
+    return ESPCONN_OK;
+}
+
+sint8 espconn_regist_reconcb(struct espconn* espconn, espconn_reconnect_callback recon_cb)
+{
+    espconn->proto.tcp->reconnect_callback = recon_cb;
+    return ESPCONN_OK;
+}
+
+sint8 espconn_regist_disconcb(struct espconn* espconn, espconn_connect_callback discon_cb)
+{
+    espconn->proto.tcp->disconnect_callback = discon_cb;
+    return ESPCONN_OK;
+}
+
+sint8 espconn_regist_recvcb(struct espconn* espconn, espconn_recv_callback recv_cb)
+{
+    espconn->recv_callback = recv_cb;
+    return ESPCONN_OK;
+}
+
+sint8 espconn_regist_sentcb(struct espconn* espconn, espconn_sent_callback sent_cb)
+{
+    espconn->sent_callback = sent_cb;
+    return ESPCONN_OK;
+}
+
+uint32 espconn_port(void)
+{
+    return s_local_port++;
+}
+
+err_t espconn_gethostbyname(struct espconn* pespconn, const char* hostname, ip_addr_t* addr, dns_found_callback found)
+{
+    addr->addr = ipaddr_addr("127.0.0.1");
+    return ESPCONN_OK;
+}
+
+void espconn_dns_setserver(char numdns, ip_addr_t* dnsserver)
+{
+}
+
+#ifdef ESP8266_HOST_TLS
+static bool s_esp8266_host_espconn_setup(void)
+{
+    //ONCE : PEER KEY + SELF SIGNED CERTIFICATE, CLIENT AND PEER CONTEXTS
+    //(TLS 1.2, ONE CIPHER SUITE, SESSION IDS ONLY)
+
+    EVP_PKEY_CTX* key_ctx;
+    EVP_PKEY* key = NULL;
+    X509* cert;
+    X509_NAME* name;
+    SSL* ssl;
+    STACK_OF(SSL_CIPHER)* ciphers;
+    int i;
+
+    if(s_ready)
+    {
+        return true;
+    }
+
+    key_ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
+    if(key_ctx == NULL ||
+        EVP_PKEY_keygen_init(key_ctx) <= 0 ||
+        EVP_PKEY_CTX_set_ec_paramgen_curve_nid(key_ctx, NID_X9_62_prime256v1) <= 0 ||
+        EVP_PKEY_keygen(key_ctx, &key) <= 0)
+    {
+        EVP_PKEY_CTX_free(key_ctx);
+        return false;
+    }
+    EVP_PKEY_CTX_free(key_ctx);
+
+    cert = X509_new();
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 86400L * 365);
+    X509_set_pubkey(cert, key);
+    name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"broker.test", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    X509_sign(cert, key, EVP_sha256());
+
+    s_peer_ctx = SSL_CTX_new(TLS_server_method());
+    s_client_ctx = SSL_CTX_new(TLS_client_method());
+    SSL_CTX_use_certificate(s_peer_ctx, cert);
+    SSL_CTX_use_PrivateKey(s_peer_ctx, key);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+
+    SSL_CTX_set_min_proto_version(s_peer_ctx, TLS1_2_VERSION);
+    SSL_CTX_set_max_proto_version(s_peer_ctx, TLS1_2_VERSION);
+    SSL_CTX_set_min_proto_version(s_client_ctx, TLS1_2_VERSION);
+    SSL_CTX_set_max_proto_version(s_client_ctx, TLS1_2_VERSION);
+    SSL_CTX_set_cipher_list(s_peer_ctx, ESP8266_HOST_ESPCONN_CIPHER);
+    SSL_CTX_set_cipher_list(s_client_ctx, ESP8266_HOST_ESPCONN_CIPHER);
+    SSL_CTX_set_options(s_peer_ctx, SSL_OP_NO_TICKET);
+    SSL_CTX_set_options(s_client_ctx, SSL_OP_NO_TICKET);
+#ifdef SSL_OP_NO_EXTENDED_MASTER_SECRET
+    //A SESSION REBUILT FROM ID + MASTER SECRET CARRIES NO EMS FLAG
+    SSL_CTX_set_options(s_peer_ctx, SSL_OP_NO_EXTENDED_MASTER_SECRET);
+    SSL_CTX_set_options(s_client_ctx, SSL_OP_NO_EXTENDED_MASTER_SECRET);
+#endif
+    SSL_CTX_set_session_cache_mode(s_peer_ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_set_session_id_context(s_peer_ctx, (const unsigned char*)"mqtt", 4);
+    SSL_CTX_set_timeout(s_peer_ctx, ESP8266_MQTT_TLS_SESSION_LIFETIME_MAX_S);
+    SSL_CTX_set_session_cache_mode(s_client_ctx, SSL_SESS_CACHE_OFF);
+    SSL_CTX_set_verify(s_client_ctx, SSL_VERIFY_NONE, NULL);
+
+    //THE CIPHER OF A REBUILT SESSION (THE LIST ALSO HAS THE TLS 1.3 SUITES)
+    ssl = SSL_new(s_client_ctx);
+    ciphers = SSL_get_ciphers(ssl);
+    for(i = 0; i < sk_SSL_CIPHER_num(ciphers); i++)
+    {
+        if(strcmp(SSL_CIPHER_get_name(sk_SSL_CIPHER_value(ciphers, i)), ESP8266_HOST_ESPCONN_CIPHER) == 0)
+        {
+            s_cipher = sk_SSL_CIPHER_value(ciphers, i);
+        }
+    }
+    SSL_free(ssl);
+
+    s_ready = (s_cipher != NULL);
+    return s_ready;
+}
+
+static void s_esp8266_host_espconn_pump(void)
+{
+    //MOVE TLS RECORDS CLIENT <-> PEER UNTIL BOTH WRITE BIOS ARE EMPTY
+
+    uint8_t buffer[4096];
+    bool moved;
+    int n;
+
+    do
+    {
+        moved = false;
+        while((n = BIO_read(SSL_get_wbio(s_client), buffer, sizeof(buffer))) > 0)
+        {
+            s_stats.wire_sent += n;
+            BIO_write(SSL_get_rbio(s_peer), buffer, n);
+            moved = true;
+        }
+        while((n = BIO_read(SSL_get_wbio(s_peer), buffer, sizeof(buffer))) > 0)
+        {
+            s_stats.wire_received += n;
+            BIO_write(SSL_get_rbio(s_client), buffer, n);
+            moved = true;
+        }
+    }while(moved);
+}
+
+static void s_esp8266_host_espconn_close(void)
+{
+    //SHUT BOTH ENDS DOWN CLEANLY (A PEER SSL FREED WITHOUT ITS CLOSE NOTIFY
+    //WOULD DROP THE SESSION FROM THE PEER CACHE) AND FREE THEM
+
+    if(s_client == NULL)
+    {
+        return;
+    }
+    if(s_connected)
+    {
+        SSL_shutdown(s_client);
+        s_esp8266_host_espconn_pump();
+        SSL_shutdown(s_peer);
+        s_esp8266_host_espconn_pump();
+    }
+    SSL_free(s_client);
+    SSL_free(s_peer);
+    s_client = NULL;
+    s_peer = NULL;
+    s_connected = false;
+}
+
+static void s_esp8266_host_espconn_handshake_event(void* arg)
+{
+    //RUN THE HANDSHAKE TO THE END -> CONNECT CB (OR RECONNECT CB WITH
+    //ESPCONN_HANDSHAKE)
+
+    struct espconn* espconn = (struct espconn*)arg;
+    int client_result;
+    int peer_result;
+    bool waiting;
+    uint8_t round;
+
+    if(espconn != s_conn || s_client == NULL || s_connected)
+    {
+        return;
+    }
+    for(round = 0; round < 16; round++)
+    {
+        //ERRORS READ BEFORE THE PUMP (A BIO WRITE CLEARS THE RETRY FLAGS)
+        client_result = SSL_do_handshake(s_client);
+        waiting = (client_result == 1 || SSL_get_error(s_client, client_result) == SSL_ERROR_WANT_READ);
+        peer_result = SSL_do_handshake(s_peer);
+        waiting = waiting && (peer_result == 1 || SSL_get_error(s_peer, peer_result) == SSL_ERROR_WANT_READ);
+        s_esp8266_host_espconn_pump();
+        if(!waiting || (client_result == 1 && peer_result == 1))
+        {
+            break;
+        }
+    }
+
+    if(SSL_is_init_finished(s_client) && SSL_is_init_finished(s_peer))
+    {
+        s_connected = true;
+        s_stats.handshakes++;
+        if(SSL_session_reused(s_peer))
+        {
+            s_stats.resumed++;
+        }
+        if(espconn->proto.tcp->connect_callback != NULL)
+        {
+            (*espconn->proto.tcp->connect_callback)(espconn);
+        }
+        return;
+    }
+
+    s_stats.failed++;
+    s_esp8266_host_espconn_close();
+    if(espconn->proto.tcp->reconnect_callback != NULL)
+    {
+        (*espconn->proto.tcp->reconnect_callback)(espconn, ESPCONN_HANDSHAKE);
+    }
+}
+
+static void s_esp8266_host_espconn_sent_event(void* arg)
+{
+    struct espconn* espconn = (struct espconn*)arg;
+
+    if(espconn == s_conn && s_connected && espconn->sent_callback != NULL)
+    {
+        (*espconn->sent_callback)(espconn);
+    }
+}
+
+static void s_esp8266_host_espconn_discon_event(void* arg)
+{
+    struct espconn* espconn = (struct espconn*)arg;
+
+    if(espconn->proto.tcp->disconnect_callback != NULL)
+    {
+        (*espconn->proto.tcp->disconnect_callback)(espconn);
+    }
+}
+
+static void s_esp8266_host_espconn_offer(void* engine_arg, const esp8266_mqtt_tls_session_t* session)
+{
+    //REBUILD THE CLIENT SESSION FROM ID + MASTER SECRET (THE ONE CIPHER SUITE
+    //AND TLS 1.2 ARE IMPLIED). TRIED BY THE NEXT espconn_secure_connect
+
+    if(!s_esp8266_host_espconn_setup())
+    {
+        return;
+    }
+    if(s_offered != NULL)
+    {
+        SSL_SESSION_free(s_offered);
+    }
+    s_offered = SSL_SESSION_new();
+    SSL_SESSION_set_protocol_version(s_offered, TLS1_2_VERSION);
+    SSL_SESSION_set_cipher(s_offered, s_cipher);
+    SSL_SESSION_set1_id(s_offered, session->id, session->id_len);
+    SSL_SESSION_set1_master_key(s_offered, session->master_secret, ESP8266_MQTT_TLS_MASTER_SECRET_SIZE);
+    SSL_SESSION_set_time(s_offered, (long)time(NULL));
+    SSL_SESSION_set_timeout(s_offered, ESP8266_MQTT_TLS_SESSION_LIFETIME_MAX_S);
+}
+
+static bool s_esp8266_host_espconn_fetch(void* engine_arg, esp8266_mqtt_tls_session_t* session, bool* resumed)
+{
+    //SESSION OF THE CONNECTION JUST SET UP (ID + MASTER SECRET)
+
+    SSL_SESSION* current;
+    const unsigned char* id;
+    unsigned int id_len;
+
+    if(s_client == NULL || (current = SSL_get_session(s_client)) == NULL)
+    {
+        return false;
+    }
+    id = SSL_SESSION_get_id(current, &id_len);
+    memset(session, 0, sizeof(esp8266_mqtt_tls_session_t));
+    if(id_len > ESP8266_MQTT_TLS_SESSION_ID_MAX ||
+        SSL_SESSION_get_master_key(current, session->master_secret, ESP8266_MQTT_TLS_MASTER_SECRET_SIZE) !=
+            ESP8266_MQTT_TLS_MASTER_SECRET_SIZE)
+    {
+        return false;
+    }
+    session->id_len = (uint8_t)id_len;
+    memcpy(session->id, id, id_len);
+    *resumed = SSL_session_reused(s_client);
+    return true;
+}
+
+static void s_esp8266_host_espconn_wire_bytes(void* engine_arg, uint32_t* sent, uint32_t* received)
+{
+    *sent = s_stats.wire_sent;
+    *received = s_stats.wire_received;
+}
+#endif
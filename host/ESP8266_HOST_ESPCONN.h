@@ -0,0 +1,64 @@
+/**********************************************************************************
+* ESP8266 HOST ESPCONN
+*
+* NOTE
+* -----
+*   (1) HOST STAND-IN FOR THE SDK SECURE ESPCONN CALLS (espconn.h) USED BY
+*       ESP8266_MQTT_TLS. BUILT WITH OPENSSL (ESP8266_HOST_TLS DEFINED, SEE
+*       CMakeLists.txt) THE CLIENT CONNECTION TALKS TO AN IN PROCESS TLS PEER
+*       (THE BROKER) THROUGH MEMORY BIOS. OTHERWISE THERE IS NO PEER AND
+*       espconn_secure_connect FAILS (ESPCONN_ARG). HOST NAMES RESOLVE TO
+*       127.0.0.1 RIGHT AWAY. THE CA SECTOR IS NOT USED (NO VERIFICATION)
+*
+*   (2) TLS 1.2 ONLY, ONE CIPHER SUITE (ESP8266_HOST_ESPCONN_CIPHER), SESSION ID
+*       RESUMPTION ONLY (NO TICKETS, NO EXTENDED MASTER SECRET) : WHAT A SMALL
+*       EMBEDDED ENGINE DOES. THE PEER KEEPS A SERVER SESSION CACHE
+*
+*   (3) ESP8266_HOST_ESPCONN_SESSION_HOOKS ARE THE ESP8266_MQTT_TLS SESSION HOOKS
+*       OF THIS ENGINE (engine_arg NULL). A SESSION IS REBUILT FROM ITS ID +
+*       MASTER SECRET ALONE, SO IT ROUND TRIPS THROUGH THE TLS SESSION CACHE
+*       (AND ITS RTC RECORD) LIKE IT WOULD ON THE CHIP
+*
+*   (4) LIKE THE SDK THE CONNECT / SENT / DISCONNECT CBS ARE POSTED TO THE HOST
+*       EVENT LOOP (ESP8266_HOST_Run / _Poll). DATA FROM THE PEER
+*       (ESP8266_HOST_ESPCONN_PeerSend) REACHES THE RECEIVE CB RIGHT AWAY
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#ifndef _ESP8266_HOST_ESPCONN_PEER_H_
+#define _ESP8266_HOST_ESPCONN_PEER_H_
+
+#include "ESP8266_HOST.h"
+#include "ESP8266_MQTT_TLS.h"
+
+#define ESP8266_HOST_ESPCONN_CIPHER			"ECDHE-ECDSA-AES128-GCM-SHA256"
+#define ESP8266_HOST_ESPCONN_CAPTURE_MAX	(65536)
+
+#ifdef ESP8266_HOST_TLS
+//CUSTOM VARIABLE STRUCTURES/////////////////////////////
+typedef struct
+{
+	uint32_t connects;
+	uint32_t handshakes;		//COMPLETED, AS SEEN BY THE PEER
+	uint32_t resumed;			//OF THEM RESUMED
+	uint32_t failed;
+	uint32_t wire_sent;			//TLS RECORD BYTES CLIENT -> PEER
+	uint32_t wire_received;		//TLS RECORD BYTES PEER -> CLIENT
+}esp8266_host_espconn_stats_t;
+//END CUSTOM VARIABLE STRUCTURES/////////////////////////
+
+extern const esp8266_mqtt_tls_session_hooks_t ESP8266_HOST_ESPCONN_SESSION_HOOKS;
+
+//FUNCTION PROTOTYPES/////////////////////////////////////////////
+void ESP8266_HOST_ESPCONN_GetStats(esp8266_host_espconn_stats_t* stats);
+uint32_t ESP8266_HOST_ESPCONN_PeerTake(uint8_t* dest, uint32_t max_len);
+void ESP8266_HOST_ESPCONN_PeerSend(const uint8_t* data, uint16_t len);
+void ESP8266_HOST_ESPCONN_PeerForgetSessions(void);
+//END FUNCTION PROTOTYPES/////////////////////////////////////////
+#endif
+
+#endif
@@ -0,0 +1,277 @@
+/**********************************************************************************
+* ESP8266 HOST MOCK TRANSPORT
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_HOST_TRANSPORT.h"
+
+//LOCAL LIBRARY FUNCTIONS////////////////////////////////
+static void s_esp8266_host_transport_initialize(void* ctx,
+                                                const char* hostname,
+                                                const char* host_ip,
+                                                uint16_t host_port,
+                                                uint16_t buffer_size);
+static void s_esp8266_host_transport_set_dns_server(void* ctx, char num_dns, ip_addr_t* dns);
+static void s_esp8266_host_transport_set_callback_functions(void* ctx,
+                                                            void* cb_arg,
+                                                            void (*conn_cb)(void*),
+                                                            void (*discon_cb)(void*),
+                                                            void (*send_cb)(void*),
+                                                            void (*recv_cb)(void*, char*, unsigned short),
+                                                            void (*dns_cb)(void*, ip_addr_t*));
+static void s_esp8266_host_transport_resolve_host_name(void* ctx);
+static void s_esp8266_host_transport_connect(void* ctx);
+static void s_esp8266_host_transport_disconnect(void* ctx);
+static void s_esp8266_host_transport_send(void* ctx, uint8_t* data, uint16_t len);
+static void s_esp8266_host_transport_set_host_ip(void* ctx, ip_addr_t* ip);
+
+static void s_esp8266_host_transport_dns_event(void* ctx);
+static void s_esp8266_host_transport_connect_event(void* ctx);
+static void s_esp8266_host_transport_discon_event(void* ctx);
+static void s_esp8266_host_transport_sent_event(void* ctx);
+//END LOCAL LIBRARY FUNCTIONS/////////////////////////////
+
+//LOCAL LIBRARY VARIABLES////////////////////////////////
+static esp8266_host_transport_t s_tcp_generic;
+static bool s_tcp_generic_ready;
+//END LOCAL LIBRARY VARIABLES/////////////////////////////
+
+const esp8266_mqtt_transport_t ESP8266_HOST_TRANSPORT = {s_esp8266_host_transport_initialize,
+                                                        s_esp8266_host_transport_set_dns_server,
+                                                        s_esp8266_host_transport_set_callback_functions,
+                                                        s_esp8266_host_transport_resolve_host_name,
+                                                        s_esp8266_host_transport_connect,
+                                                        s_esp8266_host_transport_disconnect,
+                                                        s_esp8266_host_transport_send,
+                                                        s_esp8266_host_transport_set_host_ip};
+
+void ESP8266_HOST_TRANSPORT_Init(esp8266_host_transport_t* transport)
+{
+    //DEFAULTS : CONNECT WORKS, EVERY SEND ACKNOWLEDGED, DNS -> 127.0.0.1
+
+    memset(transport, 0, sizeof(esp8266_host_transport_t));
+    transport->connect_ok = true;
+    transport->auto_ack = true;
+    transport->capture = true;
+    transport->dns_ip.addr = ipaddr_addr("127.0.0.1");
+}
+
+esp8266_host_transport_t* ESP8266_HOST_TRANSPORT_TcpGeneric(void)
+{
+    //THE CONNECTION BEHIND THE HOST ESP8266_TCP_GENERIC
+
+    if(!s_tcp_generic_ready)
+    {
+        ESP8266_HOST_TRANSPORT_Init(&s_tcp_generic);
+        s_tcp_generic_ready = true;
+    }
+    return &s_tcp_generic;
+}
+
+uint32_t ESP8266_HOST_TRANSPORT_Take(esp8266_host_transport_t* transport, uint8_t* dest, uint32_t max_len)
+{
+    //COPY OUT (dest MAY BE NULL) AND FORGET THE CAPTURED BYTES
+
+    uint32_t len = transport->captured_len;
+
+    if(dest != NULL)
+    {
+        if(len > max_len)
+        {
+            len = max_len;
+        }
+        memcpy(dest, transport->captured, len);
+    }
+    transport->captured_len = 0;
+    return len;
+}
+
+void ESP8266_HOST_TRANSPORT_Inject(esp8266_host_transport_t* transport, const uint8_t* data, uint16_t len)
+{
+    //BYTES FROM THE BROKER
+
+    if(transport->recv_cb != NULL)
+    {
+        (*transport->recv_cb)(transport->cb_arg, (char*)data, len);
+    }
+}
+
+void ESP8266_HOST_TRANSPORT_Ack(esp8266_host_transport_t* transport, uint32_t count)
+{
+    //POST SENT CBS FOR UP TO count HELD SENDS
+
+    while(count-- != 0 && transport->unacked != 0)
+    {
+        transport->unacked--;
+        ESP8266_HOST_Defer(s_esp8266_host_transport_sent_event, transport);
+    }
+}
+
+void ESP8266_HOST_TRANSPORT_Drop(esp8266_host_transport_t* transport)
+{
+    //CONNECTION LOST (DISCONNECT CB RIGHT AWAY)
+
+    if(!transport->connected)
+    {
+        return;
+    }
+    transport->connected = false;
+    transport->unacked = 0;
+    if(transport->discon_cb != NULL)
+    {
+        (*transport->discon_cb)(transport->cb_arg);
+    }
+}
+
+static void s_esp8266_host_transport_initialize(void* ctx,
+                                                const char* hostname,
+                                                const char* host_ip,
+                                                uint16_t host_port,
+                                                uint16_t buffer_size)
+{
+    esp8266_host_transport_t* transport = (esp8266_host_transport_t*)ctx;
+
+    transport->stats.initializes++;
+    transport->host_port = host_port;
+    os_strncpy(transport->host_ip, (host_ip != NULL) ? host_ip : "", sizeof(transport->host_ip) - 1);
+}
+
+static void s_esp8266_host_transport_set_dns_server(void* ctx, char num_dns, ip_addr_t* dns)
+{
+}
+
+static void s_esp8266_host_transport_set_callback_functions(void* ctx,
+                                                            void* cb_arg,
+                                                            void (*conn_cb)(void*),
+                                                            void (*discon_cb)(void*),
+                                                            void (*send_cb)(void*),
+                                                            void (*recv_cb)(void*, char*, unsigned short),
+                                                            void (*dns_cb)(void*, ip_addr_t*))
+{
+    esp8266_host_transport_t* transport = (esp8266_host_transport_t*)ctx;
+
+    transport->cb_arg = cb_arg;
+    transport->conn_cb = conn_cb;
+    transport->discon_cb = discon_cb;
+    transport->send_cb = send_cb;
+    transport->recv_cb = recv_cb;
+    transport->dns_cb = dns_cb;
+}
+
+static void s_esp8266_host_transport_resolve_host_name(void* ctx)
+{
+    esp8266_host_transport_t* transport = (esp8266_host_transport_t*)ctx;
+
+    transport->stats.resolves++;
+    ESP8266_HOST_Defer(s_esp8266_host_transport_dns_event, transport);
+}
+
+static void s_esp8266_host_transport_connect(void* ctx)
+{
+    esp8266_host_transport_t* transport = (esp8266_host_transport_t*)ctx;
+
+    transport->stats.connects++;
+    ESP8266_HOST_Defer(s_esp8266_host_transport_connect_event, transport);
+}
+
+static void s_esp8266_host_transport_disconnect(void* ctx)
+{
+    esp8266_host_transport_t* transport = (esp8266_host_transport_t*)ctx;
+
+    transport->stats.disconnects++;
+    if(transport->connected)
+    {
+        transport->connected = false;
+        transport->unacked = 0;
+        ESP8266_HOST_Defer(s_esp8266_host_transport_discon_event, transport);
+    }
+}
+
+static void s_esp8266_host_transport_send(void* ctx, uint8_t* data, uint16_t len)
+{
+    esp8266_host_transport_t* transport = (esp8266_host_transport_t*)ctx;
+    uint32_t room = ESP8266_HOST_TRANSPORT_CAPTURE_MAX - transport->captured_len;
+
+    transport->stats.sends++;
+    transport->stats.bytes_sent += len;
+    if(transport->capture)
+    {
+        if(len > room)
+        {
+            transport->stats.bytes_dropped += len - room;
+        }
+        memcpy(transport->captured + transport->captured_len, data, (len < room) ? len : room);
+        transport->captured_len += (len < room) ? len : room;
+    }
+    if(transport->auto_ack)
+    {
+        ESP8266_HOST_Defer(s_esp8266_host_transport_sent_event, transport);
+    }
+    else
+    {
+        transport->unacked++;
+    }
+}
+
+static void s_esp8266_host_transport_set_host_ip(void* ctx, ip_addr_t* ip)
+{
+    esp8266_host_transport_t* transport = (esp8266_host_transport_t*)ctx;
+
+    os_sprintf(transport->host_ip, IPSTR, IP2STR(ip));
+}
+
+static void s_esp8266_host_transport_dns_event(void* ctx)
+{
+    esp8266_host_transport_t* transport = (esp8266_host_transport_t*)ctx;
+    ip_addr_t ip = transport->dns_ip;
+
+    if(transport->dns_cb != NULL)
+    {
+        (*transport->dns_cb)(transport->cb_arg, (ip.addr != 0) ? &ip : NULL);
+    }
+}
+
+static void s_esp8266_host_transport_connect_event(void* ctx)
+{
+    //A REFUSED CONNECT IS REPORTED THROUGH THE DISCONNECT CB (AS
+    //ESP8266_TCP_GENERIC DOES)
+
+    esp8266_host_transport_t* transport = (esp8266_host_transport_t*)ctx;
+
+    if(transport->connect_ok)
+    {
+        transport->connected = true;
+        if(transport->conn_cb != NULL)
+        {
+            (*transport->conn_cb)(transport->cb_arg);
+        }
+    }
+    else if(transport->discon_cb != NULL)
+    {
+        (*transport->discon_cb)(transport->cb_arg);
+    }
+}
+
+static void s_esp8266_host_transport_discon_event(void* ctx)
+{
+    esp8266_host_transport_t* transport = (esp8266_host_transport_t*)ctx;
+
+    if(transport->discon_cb != NULL)
+    {
+        (*transport->discon_cb)(transport->cb_arg);
+    }
+}
+
+static void s_esp8266_host_transport_sent_event(void* ctx)
+{
+    esp8266_host_transport_t* transport = (esp8266_host_transport_t*)ctx;
+
+    if(transport->send_cb != NULL)
+    {
+        (*transport->send_cb)(transport->cb_arg);
+    }
+}
@@ -0,0 +1,83 @@
+/**********************************************************************************
+* ESP8266 HOST MOCK TRANSPORT
+*
+* NOTE
+* -----
+*   (1) A MOCK esp8266_mqtt_transport_t (ESP8266_MQTT_CLIENT_SetTransport). EACH
+*       esp8266_host_transport_t CONTEXT IS ONE CONNECTION, SO SEVERAL CLIENT
+*       INSTANCES (OR AN ESP8266_MQTT_POOL) CAN EACH HAVE THEIR OWN
+*
+*   (2) BYTES SENT BY THE CLIENT ARE CAPTURED (ESP8266_HOST_TRANSPORT_Take). THE
+*       SENT / CONNECT / DNS CBS ARE POSTED TO THE HOST EVENT LOOP
+*       (ESP8266_HOST_Run / _Poll) LIKE ON THE CHIP. WITH auto_ack OFF SENT CBS
+*       ARE HELD UNTIL ESP8266_HOST_TRANSPORT_Ack. BROKER REPLIES ARE FED WITH
+*       ESP8266_HOST_TRANSPORT_Inject (RECEIVE CB CALLED RIGHT AWAY)
+*
+*   (3) THE HOST BUILD OF ESP8266_TCP_GENERIC (THE CLIENT DEFAULT TRANSPORT) IS
+*       ONE OF THESE CONTEXTS (ESP8266_HOST_TRANSPORT_TcpGeneric)
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#ifndef _ESP8266_HOST_TRANSPORT_H_
+#define _ESP8266_HOST_TRANSPORT_H_
+
+#include "ESP8266_HOST.h"
+#include "ESP8266_MQTT_CLIENT.h"
+
+#define ESP8266_HOST_TRANSPORT_CAPTURE_MAX		(65536)
+
+//CUSTOM VARIABLE STRUCTURES/////////////////////////////
+typedef struct
+{
+	uint32_t initializes;
+	uint32_t resolves;
+	uint32_t connects;
+	uint32_t disconnects;
+	uint32_t sends;
+	uint32_t bytes_sent;
+	uint32_t bytes_dropped;		//SENT WHILE THE CAPTURE BUFFER WAS FULL
+}esp8266_host_transport_stats_t;
+
+typedef struct
+{
+	//SETTINGS (CHANGE ANY TIME)
+	bool connect_ok;			//CONNECT SUCCEEDS (DEFAULT true)
+	bool auto_ack;				//SENT CB POSTED FOR EVERY SEND (DEFAULT true)
+	bool capture;				//KEEP SENT BYTES (DEFAULT true)
+	ip_addr_t dns_ip;			//RESOLVE RESULT (0 = DNS FAILURE)
+
+	//STATE
+	bool connected;
+	uint32_t unacked;			//SENDS WITHOUT A SENT CB YET (auto_ack OFF)
+	char host_ip[16];
+	uint16_t host_port;
+	esp8266_host_transport_stats_t stats;
+	uint8_t captured[ESP8266_HOST_TRANSPORT_CAPTURE_MAX];
+	uint32_t captured_len;
+
+	//CLIENT CBS
+	void* cb_arg;
+	void (*conn_cb)(void*);
+	void (*discon_cb)(void*);
+	void (*send_cb)(void*);
+	void (*recv_cb)(void*, char*, unsigned short);
+	void (*dns_cb)(void*, ip_addr_t*);
+}esp8266_host_transport_t;
+//END CUSTOM VARIABLE STRUCTURES/////////////////////////
+
+extern const esp8266_mqtt_transport_t ESP8266_HOST_TRANSPORT;
+
+//FUNCTION PROTOTYPES/////////////////////////////////////////////
+void ESP8266_HOST_TRANSPORT_Init(esp8266_host_transport_t* transport);
+esp8266_host_transport_t* ESP8266_HOST_TRANSPORT_TcpGeneric(void);
+uint32_t ESP8266_HOST_TRANSPORT_Take(esp8266_host_transport_t* transport, uint8_t* dest, uint32_t max_len);
+void ESP8266_HOST_TRANSPORT_Inject(esp8266_host_transport_t* transport, const uint8_t* data, uint16_t len);
+void ESP8266_HOST_TRANSPORT_Ack(esp8266_host_transport_t* transport, uint32_t count);
+void ESP8266_HOST_TRANSPORT_Drop(esp8266_host_transport_t* transport);
+//END FUNCTION PROTOTYPES/////////////////////////////////////////
+
+#endif
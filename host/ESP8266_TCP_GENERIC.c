@@ -0,0 +1,125 @@
+/**********************************************************************************
+* ESP8266 TCP GENERIC (HOST MOCK)
+*
+* NOTE
+* -----
+*   (1) FORWARDS TO THE ESP8266_HOST_TRANSPORT_TcpGeneric MOCK CONNECTION
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_TCP_GENERIC.h"
+#include "ESP8266_HOST_TRANSPORT.h"
+
+//LOCAL LIBRARY VARIABLES////////////////////////////////
+static void (*s_tcp_con_cb)(void*);
+static void (*s_tcp_discon_cb)(void*);
+static void (*s_tcp_send_cb)(void*);
+static void (*s_tcp_recv_cb)(char*, unsigned short);
+static void (*s_user_dns_cb)(ip_addr_t*);
+//END LOCAL LIBRARY VARIABLES/////////////////////////////
+
+//LOCAL LIBRARY FUNCTIONS////////////////////////////////
+static void s_esp8266_tcp_generic_conn_cb(void* arg);
+static void s_esp8266_tcp_generic_discon_cb(void* arg);
+static void s_esp8266_tcp_generic_send_cb(void* arg);
+static void s_esp8266_tcp_generic_recv_cb(void* arg, char* data, unsigned short len);
+static void s_esp8266_tcp_generic_dns_cb(void* arg, ip_addr_t* ip);
+//END LOCAL LIBRARY FUNCTIONS/////////////////////////////
+
+void ESP8266_TCP_GENERIC_Initialize(const char* hostname,
+                                    const char* host_ip,
+                                    uint16_t host_port,
+                                    const char* host_path,
+                                    uint16_t buffer_size)
+{
+    (*ESP8266_HOST_TRANSPORT.initialize)(ESP8266_HOST_TRANSPORT_TcpGeneric(), hostname, host_ip, host_port, buffer_size);
+}
+
+void ESP8266_TCP_GENERIC_SetDnsServer(char num_dns, ip_addr_t* dns)
+{
+    (*ESP8266_HOST_TRANSPORT.set_dns_server)(ESP8266_HOST_TRANSPORT_TcpGeneric(), num_dns, dns);
+}
+
+void ESP8266_TCP_GENERIC_SetCallbackFunctions(void (*tcp_con_cb)(void*),
+                                                void (*tcp_discon_cb)(void*),
+                                                void (*tcp_send_cb)(void*),
+                                                void (*tcp_recv_cb)(char*, unsigned short),
+                                                void (*user_dns_cb)(ip_addr_t*))
+{
+    s_tcp_con_cb = tcp_con_cb;
+    s_tcp_discon_cb = tcp_discon_cb;
+    s_tcp_send_cb = tcp_send_cb;
+    s_tcp_recv_cb = tcp_recv_cb;
+    s_user_dns_cb = user_dns_cb;
+    (*ESP8266_HOST_TRANSPORT.set_callback_functions)(ESP8266_HOST_TRANSPORT_TcpGeneric(),
+                                                        NULL,
+                                                        s_esp8266_tcp_generic_conn_cb,
+                                                        s_esp8266_tcp_generic_discon_cb,
+                                                        s_esp8266_tcp_generic_send_cb,
+                                                        s_esp8266_tcp_generic_recv_cb,
+                                                        s_esp8266_tcp_generic_dns_cb);
+}
+
+void ESP8266_TCP_GENERIC_ResolveHostName(void)
+{
+    (*ESP8266_HOST_TRANSPORT.resolve_host_name)(ESP8266_HOST_TRANSPORT_TcpGeneric());
+}
+
+void ESP8266_TCP_GENERIC_Connect(void)
+{
+    (*ESP8266_HOST_TRANSPORT.connect)(ESP8266_HOST_TRANSPORT_TcpGeneric());
+}
+
+void ESP8266_TCP_GENERIC_Disonnect(void)
+{
+    (*ESP8266_HOST_TRANSPORT.disconnect)(ESP8266_HOST_TRANSPORT_TcpGeneric());
+}
+
+void ESP8266_TCP_GENERIC_SendAndGetReply(uint8_t* data, uint16_t len)
+{
+    (*ESP8266_HOST_TRANSPORT.send)(ESP8266_HOST_TRANSPORT_TcpGeneric(), data, len);
+}
+
+static void s_esp8266_tcp_generic_conn_cb(void* arg)
+{
+    if(s_tcp_con_cb != NULL)
+    {
+        (*s_tcp_con_cb)(NULL);
+    }
+}
+
+static void s_esp8266_tcp_generic_discon_cb(void* arg)
+{
+    if(s_tcp_discon_cb != NULL)
+    {
+        (*s_tcp_discon_cb)(NULL);
+    }
+}
+
+static void s_esp8266_tcp_generic_send_cb(void* arg)
+{
+    if(s_tcp_send_cb != NULL)
+    {
+        (*s_tcp_send_cb)(NULL);
+    }
+}
+
+static void s_esp8266_tcp_generic_recv_cb(void* arg, char* data, unsigned short len)
+{
+    if(s_tcp_recv_cb != NULL)
+    {
+        (*s_tcp_recv_cb)(data, len);
+    }
+}
+
+static void s_esp8266_tcp_generic_dns_cb(void* arg, ip_addr_t* ip)
+{
+    if(s_user_dns_cb != NULL)
+    {
+        (*s_user_dns_cb)(ip);
+    }
+}
@@ -0,0 +1,41 @@
+/**********************************************************************************
+* ESP8266 TCP GENERIC (HOST MOCK)
+*
+* NOTE
+* -----
+*   (1) SAME API AS THE ESP8266_TCP_GENERIC LIBRARY (ONE CONNECTION) USED BY THE
+*       MQTT CLIENT DEFAULT TRANSPORT. NOTHING GOES ON A NETWORK : SENT BYTES
+*       ARE CAPTURED AND CONNECT / DNS / RECEIVE / DISCONNECT EVENTS ARE DRIVEN
+*       BY THE TEST THROUGH ESP8266_HOST_Tcp* (ESP8266_HOST.h)
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#ifndef _ESP8266_TCP_GENERIC_H_
+#define _ESP8266_TCP_GENERIC_H_
+
+#include "ets_sys.h"
+#include "osapi.h"
+#include "os_type.h"
+#include "user_interface.h"
+
+void ESP8266_TCP_GENERIC_Initialize(const char* hostname,
+                                    const char* host_ip,
+                                    uint16_t host_port,
+                                    const char* host_path,
+                                    uint16_t buffer_size);
+void ESP8266_TCP_GENERIC_SetDnsServer(char num_dns, ip_addr_t* dns);
+void ESP8266_TCP_GENERIC_SetCallbackFunctions(void (*tcp_con_cb)(void*),
+                                                void (*tcp_discon_cb)(void*),
+                                                void (*tcp_send_cb)(void*),
+                                                void (*tcp_recv_cb)(char*, unsigned short),
+                                                void (*user_dns_cb)(ip_addr_t*));
+void ESP8266_TCP_GENERIC_ResolveHostName(void);
+void ESP8266_TCP_GENERIC_Connect(void);
+void ESP8266_TCP_GENERIC_Disonnect(void);
+void ESP8266_TCP_GENERIC_SendAndGetReply(uint8_t* data, uint16_t len);
+
+#endif
@@ -0,0 +1,56 @@
+/**********************************************************************************
+* ESP8266 HOST SDK SHIM : ets_sys.h
+*
+* NOTE
+* -----
+*   (1) MINIMAL STAND-IN FOR THE NONOS SDK HEADER SO THE LIBRARY BUILDS AND RUNS
+*       ON A PC (CMakeLists.txt). ONLY WHAT THE LIBRARY USES IS DECLARED. THE
+*       BEHAVIOUR LIVES IN ESP8266_HOST.c
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#ifndef _ESP8266_HOST_ETS_SYS_H_
+#define _ESP8266_HOST_ETS_SYS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define ICACHE_FLASH_ATTR
+#define ICACHE_RODATA_ATTR
+#define LOCAL							static
+
+typedef uint8_t uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef int8_t sint8;
+typedef int16_t sint16;
+typedef int32_t sint32;
+
+typedef uint32_t ETSSignal;
+typedef uint32_t ETSParam;
+
+typedef struct ETSEventTag
+{
+	ETSSignal sig;
+	ETSParam par;
+}ETSEvent;
+
+typedef void (*ETSTask)(ETSEvent* e);
+
+typedef void ETSTimerFunc(void* timer_arg);
+
+typedef struct _ETSTIMER_
+{
+	struct _ETSTIMER_* timer_next;
+	uint32_t timer_expire;			//system_get_time() AT WHICH IT FIRES
+	uint32_t timer_period;			//US (0 = ONE SHOT)
+	ETSTimerFunc* timer_func;
+	void* timer_arg;
+}ETSTimer;
+
+#endif
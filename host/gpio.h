@@ -0,0 +1,19 @@
+/**********************************************************************************
+* ESP8266 HOST SDK SHIM : gpio.h
+*
+* NOTE
+* -----
+*   (1) INCLUDED BY ESP8266_MQTT_CLIENT.h. NOTHING FROM IT IS USED
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#ifndef _ESP8266_HOST_GPIO_H_
+#define _ESP8266_HOST_GPIO_H_
+
+#include "ets_sys.h"
+
+#endif
@@ -0,0 +1,28 @@
+/**********************************************************************************
+* ESP8266 HOST SDK SHIM : ip_addr.h (LWIP)
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#ifndef _ESP8266_HOST_IP_ADDR_H_
+#define _ESP8266_HOST_IP_ADDR_H_
+
+#include "ets_sys.h"
+
+typedef struct ip_addr
+{
+	uint32_t addr;
+}ip_addr_t;
+
+#define IP2STR(ipaddr)					((uint8_t*)&(ipaddr)->addr)[0], \
+										((uint8_t*)&(ipaddr)->addr)[1], \
+										((uint8_t*)&(ipaddr)->addr)[2], \
+										((uint8_t*)&(ipaddr)->addr)[3]
+#define IPSTR							"%d.%d.%d.%d"
+
+uint32_t ipaddr_addr(const char* cp);
+
+#endif
@@ -0,0 +1,15 @@
+/**********************************************************************************
+* ESP8266 HOST SDK SHIM : mem.h
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#ifndef _ESP8266_HOST_MEM_H_
+#define _ESP8266_HOST_MEM_H_
+
+#include "osapi.h"
+
+#endif
@@ -0,0 +1,22 @@
+/**********************************************************************************
+* ESP8266 HOST SDK SHIM : os_type.h
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#ifndef _ESP8266_HOST_OS_TYPE_H_
+#define _ESP8266_HOST_OS_TYPE_H_
+
+#include "ets_sys.h"
+
+#define os_signal_t						ETSSignal
+#define os_param_t						ETSParam
+#define os_event_t						ETSEvent
+#define os_task_t						ETSTask
+#define os_timer_t						ETSTimer
+#define os_timer_func_t					ETSTimerFunc
+
+#endif
@@ -0,0 +1,47 @@
+/**********************************************************************************
+* ESP8266 HOST SDK SHIM : osapi.h
+*
+* NOTE
+* -----
+*   (1) MEMORY / STRING CALLS MAP TO LIBC. os_malloc / os_zalloc / os_free GO
+*       THROUGH THE COUNTING ALLOCATOR OF ESP8266_HOST SO TESTS AND THE BENCH
+*       CAN REPORT ALLOCATIONS AND PEAK HEAP
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#ifndef _ESP8266_HOST_OSAPI_H_
+#define _ESP8266_HOST_OSAPI_H_
+
+#include <stdio.h>
+#include <string.h>
+#include "os_type.h"
+
+#define os_printf						printf
+#define os_sprintf						sprintf
+#define os_memcpy						memcpy
+#define os_memmove						memmove
+#define os_memset						memset
+#define os_memcmp						memcmp
+#define os_strlen						strlen
+#define os_strcpy						strcpy
+#define os_strncpy						strncpy
+#define os_strcmp						strcmp
+#define os_strncmp						strncmp
+
+#define os_malloc(s)					ESP8266_HOST_Malloc((s), false)
+#define os_zalloc(s)					ESP8266_HOST_Malloc((s), true)
+#define os_free(p)						ESP8266_HOST_Free(p)
+
+void* ESP8266_HOST_Malloc(size_t size, bool zero);
+void ESP8266_HOST_Free(void* ptr);
+
+void os_timer_setfn(os_timer_t* ptimer, os_timer_func_t* pfunction, void* parg);
+void os_timer_arm(os_timer_t* ptimer, uint32_t milliseconds, bool repeat_flag);
+void os_timer_disarm(os_timer_t* ptimer);
+unsigned long os_random(void);
+
+#endif
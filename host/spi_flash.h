@@ -0,0 +1,34 @@
+/**********************************************************************************
+* ESP8266 HOST SDK SHIM : spi_flash.h
+*
+* NOTE
+* -----
+*   (1) FLASH IS A FILE (ESP8266_HOST_FlashOpen) WITH NOR SEMANTICS : ERASE SETS
+*       A SECTOR TO 0xFF, A WRITE CAN ONLY CLEAR BITS. ADDRESS AND LENGTH MUST
+*       BE 4 BYTE ALIGNED LIKE ON THE CHIP
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#ifndef _ESP8266_HOST_SPI_FLASH_H_
+#define _ESP8266_HOST_SPI_FLASH_H_
+
+#include "ets_sys.h"
+
+#define SPI_FLASH_SEC_SIZE				(4096)
+
+typedef enum
+{
+	SPI_FLASH_RESULT_OK,
+	SPI_FLASH_RESULT_ERR,
+	SPI_FLASH_RESULT_TIMEOUT
+}SpiFlashOpResult;
+
+SpiFlashOpResult spi_flash_erase_sector(uint16_t sec);
+SpiFlashOpResult spi_flash_write(uint32_t des_addr, uint32_t* src_addr, uint32_t size);
+SpiFlashOpResult spi_flash_read(uint32_t src_addr, uint32_t* des_addr, uint32_t size);
+
+#endif
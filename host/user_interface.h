@@ -0,0 +1,29 @@
+/**********************************************************************************
+* ESP8266 HOST SDK SHIM : user_interface.h
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#ifndef _ESP8266_HOST_USER_INTERFACE_H_
+#define _ESP8266_HOST_USER_INTERFACE_H_
+
+#include "ets_sys.h"
+#include "os_type.h"
+#include "ip_addr.h"
+
+#define USER_TASK_PRIO_0				(0)
+#define USER_TASK_PRIO_1				(1)
+#define USER_TASK_PRIO_2				(2)
+#define USER_TASK_PRIO_MAX				(3)
+
+uint32_t system_get_time(void);
+uint32_t system_get_free_heap_size(void);
+bool system_rtc_mem_read(uint8_t src_addr, void* des_addr, uint16_t load_size);
+bool system_rtc_mem_write(uint8_t des_addr, const void* src_addr, uint16_t save_size);
+bool system_os_task(os_task_t task, uint8_t prio, os_event_t* queue, uint8_t qlen);
+bool system_os_post(uint8_t prio, os_signal_t sig, os_param_t par);
+
+#endif
@@ -0,0 +1,140 @@
+/**********************************************************************************
+* ESP8266 MQTT TEST
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_MQTT_TEST.h"
+
+uint32_t ESP8266_MQTT_TEST_failures;
+esp8266_mqtt_test_log_t ESP8266_MQTT_TEST_log;
+
+//LOCAL LIBRARY FUNCTIONS////////////////////////////////
+static void s_esp8266_mqtt_test_tcp_conn_cb(void);
+static void s_esp8266_mqtt_test_send_cb(void* arg);
+static void s_esp8266_mqtt_test_recv_cb(esp8266_mqtt_client_packet_type_t ptype, char* data, unsigned short len);
+static void s_esp8266_mqtt_test_dns_cb(ip_addr_t* ip);
+//END LOCAL LIBRARY FUNCTIONS/////////////////////////////
+
+void ESP8266_MQTT_TEST_Begin(void)
+{
+    //FRESH HOST (CLOCK / TIMERS / EVENTS), DEFAULT INSTANCE SELECTED, EMPTY LOG
+
+    ESP8266_HOST_Reset();
+    ESP8266_HOST_TRANSPORT_Init(ESP8266_HOST_TRANSPORT_TcpGeneric());
+    ESP8266_MQTT_CLIENT_Select(NULL);
+    memset(&ESP8266_MQTT_TEST_log, 0, sizeof(ESP8266_MQTT_TEST_log));
+}
+
+int ESP8266_MQTT_TEST_End(void)
+{
+    if(ESP8266_MQTT_TEST_failures != 0)
+    {
+        printf("FAILED : %u check(s)\n", ESP8266_MQTT_TEST_failures);
+        return 1;
+    }
+    printf("PASSED\n");
+    return 0;
+}
+
+void ESP8266_MQTT_TEST_Dump(const char* label, const uint8_t* data, uint32_t len)
+{
+    uint32_t i;
+
+    printf("%s :", label);
+    for(i = 0; i < len; i++)
+    {
+        printf(" %02X", data[i]);
+    }
+    printf("\n");
+}
+
+void ESP8266_MQTT_TEST_Open(esp8266_mqtt_test_conn_t* conn, uint16_t buffer_size)
+{
+    //NEW INSTANCE ON ITS OWN MOCK CONNECTION, SELECTED, OPTIONS SET
+    //(MQTT 3.1, CLIENT ID "dev", KEEPALIVE 60 S, CLEAN SESSION)
+
+    ESP8266_HOST_TRANSPORT_Init(&conn->transport);
+    ESP8266_MQTT_CLIENT_InitInstance(&conn->client);
+    ESP8266_MQTT_CLIENT_Select(&conn->client);
+    ESP8266_MQTT_CLIENT_SetTransport(&ESP8266_HOST_TRANSPORT, &conn->transport);
+    ESP8266_MQTT_CLIENT_Initialize("broker.test", "127.0.0.1", 1883, buffer_size);
+    ESP8266_MQTT_CLIENT_SetOptions(0, 0, 0, false, NULL, false, NULL, true, 60, false, NULL, NULL, 0, "dev");
+    ESP8266_MQTT_TEST_SetCallbacks();
+}
+
+void ESP8266_MQTT_TEST_Connect(esp8266_mqtt_test_conn_t* conn)
+{
+    //TCP CONNECT + CONNECT -> CONNACK (ACCEPTED). CAPTURED BYTES DROPPED
+
+    const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+
+    ESP8266_MQTT_CLIENT_TcpConnect();
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_CLIENT_Send_Connect();
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_TEST_Inject(conn, connack, sizeof(connack));
+    ESP8266_MQTT_TEST_Take(conn, NULL, 0);
+}
+
+uint32_t ESP8266_MQTT_TEST_Take(esp8266_mqtt_test_conn_t* conn, uint8_t* dest, uint32_t max_len)
+{
+    //RUN PENDING EVENTS (SENT CBS PUMP THE NEXT SEGMENTS) THEN TAKE THE BYTES
+
+    ESP8266_HOST_Poll();
+    return ESP8266_HOST_TRANSPORT_Take(&conn->transport, dest, max_len);
+}
+
+void ESP8266_MQTT_TEST_Inject(esp8266_mqtt_test_conn_t* conn, const uint8_t* data, uint16_t len)
+{
+    ESP8266_HOST_TRANSPORT_Inject(&conn->transport, data, len);
+    ESP8266_HOST_Poll();
+}
+
+void ESP8266_MQTT_TEST_SetCallbacks(void)
+{
+    //LOGGING CBS ON THE SELECTED INSTANCE
+
+    ESP8266_MQTT_CLIENT_SetCallbackFunctions(s_esp8266_mqtt_test_tcp_conn_cb,
+                                                s_esp8266_mqtt_test_send_cb,
+                                                s_esp8266_mqtt_test_recv_cb,
+                                                s_esp8266_mqtt_test_dns_cb);
+}
+
+static void s_esp8266_mqtt_test_tcp_conn_cb(void)
+{
+    ESP8266_MQTT_TEST_log.tcp_connected++;
+}
+
+static void s_esp8266_mqtt_test_send_cb(void* arg)
+{
+    ESP8266_MQTT_TEST_log.sent++;
+}
+
+static void s_esp8266_mqtt_test_recv_cb(esp8266_mqtt_client_packet_type_t ptype, char* data, unsigned short len)
+{
+    if(data == NULL)
+    {
+        ESP8266_MQTT_TEST_log.timeouts++;
+        return;
+    }
+    ESP8266_MQTT_TEST_log.count[ptype & 0x0F]++;
+    ESP8266_MQTT_TEST_log.last_type = ptype;
+    ESP8266_MQTT_TEST_log.last_len = (len < sizeof(ESP8266_MQTT_TEST_log.last_data)) ? len : sizeof(ESP8266_MQTT_TEST_log.last_data);
+    memcpy(ESP8266_MQTT_TEST_log.last_data, data, ESP8266_MQTT_TEST_log.last_len);
+}
+
+static void s_esp8266_mqtt_test_dns_cb(ip_addr_t* ip)
+{
+    if(ip != NULL)
+    {
+        ESP8266_MQTT_TEST_log.dns_found++;
+    }
+    else
+    {
+        ESP8266_MQTT_TEST_log.dns_failed++;
+    }
+}
@@ -0,0 +1,104 @@
+/**********************************************************************************
+* ESP8266 MQTT TEST
+*
+* NOTE
+* -----
+*   (1) SHARED HELPERS OF THE HOST TESTS (test/ESP8266_MQTT_TEST_<AREA>.c, ONE
+*       EXECUTABLE + ctest ENTRY EACH). A FAILED CHECK PRINTS FILE:LINE AND
+*       THE TEST FAILS (EXIT CODE 1) ONCE ALL CASES HAVE RUN
+*
+*   (2) ESP8266_MQTT_TEST_Open SETS UP A CLIENT INSTANCE ON ITS OWN MOCK
+*       CONNECTION (ESP8266_HOST_TRANSPORT). PACKETS IT SENDS ARE READ BACK
+*       WITH ESP8266_MQTT_TEST_Take AND BROKER REPLIES FED WITH
+*       ESP8266_MQTT_TEST_Inject. RECEIVE CB CALLS ARE COUNTED PER PACKET TYPE
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#ifndef _ESP8266_MQTT_TEST_H_
+#define _ESP8266_MQTT_TEST_H_
+
+#include <stdio.h>
+#include "ESP8266_HOST.h"
+#include "ESP8266_HOST_TRANSPORT.h"
+#include "ESP8266_MQTT_CLIENT.h"
+
+#define ESP8266_MQTT_TEST_BUFFER_SIZE		(1024)
+
+#define ESP8266_MQTT_TEST_CHECK(cond) \
+	do { \
+		if(!(cond)) \
+		{ \
+			printf("%s:%d: CHECK FAILED : %s\n", __FILE__, __LINE__, #cond); \
+			ESP8266_MQTT_TEST_failures++; \
+		} \
+	} while(0)
+
+#define ESP8266_MQTT_TEST_CHECK_EQ(a, b) \
+	do { \
+		long long _a = (long long)(a), _b = (long long)(b); \
+		if(_a != _b) \
+		{ \
+			printf("%s:%d: CHECK FAILED : %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+			ESP8266_MQTT_TEST_failures++; \
+		} \
+	} while(0)
+
+#define ESP8266_MQTT_TEST_CHECK_BYTES(data, len, ...) \
+	do { \
+		const uint8_t _e[] = {__VA_ARGS__}; \
+		if((uint32_t)(len) != sizeof(_e) || memcmp((data), _e, sizeof(_e)) != 0) \
+		{ \
+			printf("%s:%d: CHECK FAILED : %s bytes\n", __FILE__, __LINE__, #data); \
+			ESP8266_MQTT_TEST_Dump("  got     ", (const uint8_t*)(data), (uint32_t)(len)); \
+			ESP8266_MQTT_TEST_Dump("  expected", _e, sizeof(_e)); \
+			ESP8266_MQTT_TEST_failures++; \
+		} \
+	} while(0)
+
+#define ESP8266_MQTT_TEST_RUN(test) \
+	do { \
+		ESP8266_MQTT_TEST_Begin(); \
+		printf("- %s\n", #test); \
+		test(); \
+	} while(0)
+
+//CUSTOM VARIABLE STRUCTURES/////////////////////////////
+typedef struct
+{
+	esp8266_mqtt_client_t client;
+	esp8266_host_transport_t transport;
+}esp8266_mqtt_test_conn_t;
+
+typedef struct
+{
+	uint32_t count[16];					//RECEIVE CB CALLS PER PACKET TYPE
+	uint32_t timeouts;					//RECEIVE CB CALLS WITHOUT DATA
+	uint32_t sent;						//DATA SEND CB CALLS
+	uint32_t tcp_connected;				//TCP CONNECT CB CALLS
+	uint32_t dns_found;
+	uint32_t dns_failed;
+	esp8266_mqtt_client_packet_type_t last_type;
+	uint8_t last_data[256];
+	uint16_t last_len;
+}esp8266_mqtt_test_log_t;
+//END CUSTOM VARIABLE STRUCTURES/////////////////////////
+
+extern uint32_t ESP8266_MQTT_TEST_failures;
+extern esp8266_mqtt_test_log_t ESP8266_MQTT_TEST_log;
+
+//FUNCTION PROTOTYPES/////////////////////////////////////////////
+void ESP8266_MQTT_TEST_Begin(void);
+int ESP8266_MQTT_TEST_End(void);
+void ESP8266_MQTT_TEST_Dump(const char* label, const uint8_t* data, uint32_t len);
+void ESP8266_MQTT_TEST_Open(esp8266_mqtt_test_conn_t* conn, uint16_t buffer_size);
+void ESP8266_MQTT_TEST_Connect(esp8266_mqtt_test_conn_t* conn);
+uint32_t ESP8266_MQTT_TEST_Take(esp8266_mqtt_test_conn_t* conn, uint8_t* dest, uint32_t max_len);
+void ESP8266_MQTT_TEST_Inject(esp8266_mqtt_test_conn_t* conn, const uint8_t* data, uint16_t len);
+void ESP8266_MQTT_TEST_SetCallbacks(void);
+//END FUNCTION PROTOTYPES/////////////////////////////////////////
+
+#endif
@@ -0,0 +1,85 @@
+/**********************************************************************************
+* ESP8266 MQTT TEST : BINARY PAYLOADS
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_MQTT_TEST.h"
+#include "ESP8266_MQTT_CBOR.h"
+#include "ESP8266_MQTT_COMPRESS.h"
+
+static esp8266_mqtt_test_conn_t s_conn;
+
+static void test_binary_never_compressed(void)
+{
+    //A BINARY PAYLOAD GOES OUT AS IS WITH COMPRESSION ON, EVEN WHEN IT IS
+    //ABOVE THE THRESHOLD AND WOULD SHRINK. A STRING ONE IS STILL COMPRESSED
+
+    static uint8_t payload[200];
+    static char message[201];
+    uint8_t sent[512];
+    uint32_t len;
+
+    ESP8266_MQTT_TEST_Open(&s_conn, ESP8266_MQTT_TEST_BUFFER_SIZE);
+    ESP8266_MQTT_TEST_Connect(&s_conn);
+    ESP8266_MQTT_CLIENT_SetCompression(true, 16);
+
+    memset(payload, 0x00, sizeof(payload));
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishBinary("t", payload, sizeof(payload), ESP8266_MQTT_QOS_0, NULL, NULL));
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_EQ(len, 3 + 2 + 1 + sizeof(payload));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, 6, 0x30, 0xCB, 0x01, 0x00, 0x01, 't');
+    ESP8266_MQTT_TEST_CHECK(memcmp(&sent[6], payload, sizeof(payload)) == 0);
+
+    memset(message, 'a', sizeof(message) - 1);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", message, ESP8266_MQTT_QOS_0, NULL, NULL));
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK(len > 8 && len < 64);
+    ESP8266_MQTT_TEST_CHECK_EQ(sent[7], ESP8266_MQTT_COMPRESS_MARKER);
+}
+
+static void test_cbor_inplace(void)
+{
+    //CBOR ENCODED STRAIGHT INTO THE TX BUFFER : {"t": 21.5, "rh": 48} WITH
+    //21.5 AS A HALF PRECISION FLOAT. THE COMMIT (QOS 0) CALLS THE RECEIVE CB
+    //WITH NULL DATA LIKE ANY OTHER QOS 0 PUBLISH
+
+    esp8266_mqtt_cbor_t cbor;
+    uint16_t max_len;
+    uint8_t* payload;
+    uint8_t sent[64];
+    uint32_t len;
+
+    ESP8266_MQTT_TEST_Open(&s_conn, ESP8266_MQTT_TEST_BUFFER_SIZE);
+    ESP8266_MQTT_TEST_Connect(&s_conn);
+
+    payload = ESP8266_MQTT_CLIENT_Send_PublishBegin("t", &max_len);
+    ESP8266_MQTT_TEST_CHECK(payload != NULL);
+    ESP8266_MQTT_CBOR_Initialize(&cbor, payload, max_len);
+    ESP8266_MQTT_CBOR_Map(&cbor, 2);
+    ESP8266_MQTT_CBOR_Text(&cbor, "t");
+    ESP8266_MQTT_CBOR_Float(&cbor, 21.5);
+    ESP8266_MQTT_CBOR_Text(&cbor, "rh");
+    ESP8266_MQTT_CBOR_Uint(&cbor, 48);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishCommit(ESP8266_MQTT_CBOR_Finish(&cbor)));
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_TEST_log.timeouts, 1);
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len,
+                                    0x30, 0x0E, 0x00, 0x01, 't',
+                                    0xA2, 0x61, 't', 0xF9, 0x4D, 0x60, 0x62, 'r', 'h', 0x18, 0x30);
+
+    //DOES NOT FIT : NOTHING WRITTEN, FINISH GIVES 0
+    ESP8266_MQTT_CBOR_Initialize(&cbor, sent, 2);
+    ESP8266_MQTT_CBOR_Text(&cbor, "rh");
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CBOR_Finish(&cbor), 0);
+}
+
+int main(void)
+{
+    ESP8266_MQTT_TEST_RUN(test_binary_never_compressed);
+    ESP8266_MQTT_TEST_RUN(test_cbor_inplace);
+    return ESP8266_MQTT_TEST_End();
+}
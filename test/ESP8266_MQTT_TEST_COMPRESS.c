@@ -0,0 +1,137 @@
+/**********************************************************************************
+* ESP8266 MQTT TEST : PAYLOAD COMPRESSION
+*
+* NOTE
+* -----
+*   (1) CODEC ROUND TRIPS (REPETITIVE JSON, RANDOM BYTES, LONG RUNS), THE OUTPUT
+*       LIMIT, THE STATS AND THE CLIENT SENDING A LARGE STRING PAYLOAD
+*       COMPRESSED ONLY ABOVE THE THRESHOLD
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include <stdlib.h>
+#include "ESP8266_MQTT_TEST.h"
+#include "ESP8266_MQTT_COMPRESS.h"
+
+static esp8266_mqtt_test_conn_t s_conn;
+
+static uint16_t s_round_trip(const uint8_t* in, uint16_t in_len)
+{
+    //ENCODE (NO LIMIT BEYOND THE WORST CASE) + DECODE, CHECK THE BYTES
+    //RETURN THE COMPRESSED SIZE (0 IF IT DID NOT FIT)
+
+    static uint8_t packed[8192];
+    static uint8_t unpacked[4096];
+    uint16_t len_packed;
+
+    len_packed = ESP8266_MQTT_COMPRESS_Encode(in, in_len, packed, sizeof(packed));
+    if(len_packed == 0)
+    {
+        return 0;
+    }
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_COMPRESS_IsCompressed(packed, len_packed));
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_COMPRESS_Decode(packed, len_packed, unpacked, sizeof(unpacked)), in_len);
+    ESP8266_MQTT_TEST_CHECK(memcmp(unpacked, in, in_len) == 0);
+    return len_packed;
+}
+
+static void test_round_trip(void)
+{
+    //TELEMETRY JSON SHRINKS A LOT, RANDOM BYTES DO NOT, BOTH COME BACK INTACT.
+    //RUNS LONGER THAN THE LONGEST MATCH ARE SPLIT
+
+    static uint8_t data[4096];
+    uint16_t len = 0;
+    uint16_t len_packed;
+    uint16_t i;
+
+    while((uint32_t)len + 48 < sizeof(data))
+    {
+        len += sprintf((char*)&data[len], "{\"t\":%u,\"temp\":21.5,\"rh\":48},", len % 7);
+    }
+    len_packed = s_round_trip(data, len);
+    ESP8266_MQTT_TEST_CHECK(len_packed != 0 && len_packed < len / 4);
+
+    srandom(1);
+    for(i = 0; i < 1024; i++)
+    {
+        data[i] = (uint8_t)random();
+    }
+    len_packed = s_round_trip(data, 1024);
+    ESP8266_MQTT_TEST_CHECK(len_packed > 1024);
+
+    memset(data, 'x', 3000);
+    len_packed = s_round_trip(data, 3000);
+    ESP8266_MQTT_TEST_CHECK(len_packed != 0 && len_packed < 64);
+
+    //TINY INPUTS
+    s_round_trip((const uint8_t*)"a", 1);
+    s_round_trip((const uint8_t*)"abcabcabc", 9);
+}
+
+static void test_limit_and_stats(void)
+{
+    //A RESULT THAT DOES NOT FIT THE LIMIT IS 0 (NOT A HIT). A PLAIN PAYLOAD
+    //IS NOT TAKEN FOR A COMPRESSED ONE
+
+    uint8_t data[256];
+    uint8_t packed[256];
+    esp8266_mqtt_compress_stats_t stats;
+    uint16_t len_packed;
+
+    ESP8266_MQTT_COMPRESS_ResetStats();
+    memset(data, 'x', sizeof(data));
+    len_packed = ESP8266_MQTT_COMPRESS_Encode(data, sizeof(data), packed, sizeof(packed));
+    ESP8266_MQTT_TEST_CHECK(len_packed > ESP8266_MQTT_COMPRESS_HEADER_SIZE);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_COMPRESS_Encode(data, sizeof(data), packed, len_packed - 1), 0);
+
+    ESP8266_MQTT_COMPRESS_GetStats(&stats);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.encode_calls, 2);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.encode_hits, 1);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.bytes_in, sizeof(data));
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.bytes_out, len_packed);
+
+    ESP8266_MQTT_TEST_CHECK(!ESP8266_MQTT_COMPRESS_IsCompressed(data, sizeof(data)));
+}
+
+static void test_client(void)
+{
+    //BELOW THE THRESHOLD SENT AS IS. ABOVE IT COMPRESSED, WITH THE LENGTH
+    //PREFIX OF THE COMPRESSED BYTES. DECODES BACK TO THE MESSAGE
+
+    static char message[301];
+    uint8_t sent[512];
+    uint8_t unpacked[512];
+    uint16_t len_payload;
+    uint32_t len;
+
+    ESP8266_MQTT_TEST_Open(&s_conn, ESP8266_MQTT_TEST_BUFFER_SIZE);
+    ESP8266_MQTT_TEST_Connect(&s_conn);
+    ESP8266_MQTT_CLIENT_SetCompression(true, ESP8266_MQTT_CLIENT_COMPRESS_THRESHOLD_DEFAULT);
+
+    memset(message, 'm', ESP8266_MQTT_CLIENT_COMPRESS_THRESHOLD_DEFAULT - 1);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", message, ESP8266_MQTT_QOS_0, NULL, NULL));
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_EQ(len, 3 + 2 + 1 + 2 + ESP8266_MQTT_CLIENT_COMPRESS_THRESHOLD_DEFAULT - 1);
+
+    memset(message, 'm', sizeof(message) - 1);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", message, ESP8266_MQTT_QOS_0, NULL, NULL));
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK(len > 7 && len < 64);
+    len_payload = (sent[5] << 8) | sent[6];
+    ESP8266_MQTT_TEST_CHECK_EQ(len_payload, len - 7);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_COMPRESS_Decode(&sent[7], len_payload, unpacked, sizeof(unpacked)), sizeof(message) - 1);
+    ESP8266_MQTT_TEST_CHECK(memcmp(unpacked, message, sizeof(message) - 1) == 0);
+}
+
+int main(void)
+{
+    ESP8266_MQTT_TEST_RUN(test_round_trip);
+    ESP8266_MQTT_TEST_RUN(test_limit_and_stats);
+    ESP8266_MQTT_TEST_RUN(test_client);
+    return ESP8266_MQTT_TEST_End();
+}
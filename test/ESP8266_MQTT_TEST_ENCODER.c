@@ -0,0 +1,133 @@
+/**********************************************************************************
+* ESP8266 MQTT TEST : PACKET ENCODER
+*
+* NOTE
+* -----
+*   (1) EXACT BYTES OF THE PACKETS THE CLIENT SENDS : CONNECT (BUILT ONCE FROM
+*       THE OPTIONS AND REUSED), PUBLISH (QOS 0 / 1, MULTI BYTE REMAINING
+*       LENGTH, TOPIC HANDLES), SUBSCRIBE, UNSUBSCRIBE, PINGREQ, DISCONNECT
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_MQTT_TEST.h"
+
+static esp8266_mqtt_test_conn_t s_conn;
+
+static void s_handler(void* arg, char* topic, uint16_t topic_len, char* payload, uint16_t payload_len)
+{
+}
+
+static void test_connect(void)
+{
+    //MQTT 3.1 ("MQIsdp"), CLEAN SESSION, KEEPALIVE 60, CLIENT ID "dev". THE
+    //SAME BYTES ON EVERY CONNECT. INVALID OPTIONS LEAVE NO CONNECT TO SEND
+
+    uint8_t sent[64];
+    uint32_t len;
+    uint8_t i;
+
+    ESP8266_MQTT_TEST_Open(&s_conn, ESP8266_MQTT_TEST_BUFFER_SIZE);
+    for(i = 0; i < 2; i++)
+    {
+        ESP8266_MQTT_CLIENT_Send_Connect();
+        len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+        ESP8266_MQTT_TEST_CHECK_BYTES(sent, len,
+                                        0x10, 0x11,
+                                        0x00, 0x06, 'M', 'Q', 'I', 's', 'd', 'p', 0x03, 0x02, 0x00, 0x3C,
+                                        0x00, 0x03, 'd', 'e', 'v');
+    }
+
+    //3.1.1, USERNAME + PASSWORD + WILL (QOS 1), NO CLEAN SESSION
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_SetProtocolVersion(ESP8266_MQTT_PROTOCOL_VERSION_3_1_1));
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_SetOptions(0, 0, 0, true, "u", true, "p", false, 10, true, "w", "x", 1, "id"));
+    ESP8266_MQTT_CLIENT_Send_Connect();
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len,
+                                    0x10, 0x1A,
+                                    0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, 0xCC, 0x00, 0x0A,
+                                    0x00, 0x02, 'i', 'd',
+                                    0x00, 0x01, 'w', 0x00, 0x01, 'x',
+                                    0x00, 0x01, 'u', 0x00, 0x01, 'p');
+
+    ESP8266_MQTT_TEST_CHECK(!ESP8266_MQTT_CLIENT_SetOptions(0, 0, 0, false, NULL, false, NULL, true, 60, false, NULL, NULL, 0, NULL));
+    ESP8266_MQTT_CLIENT_Send_Connect();
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_TEST_Take(&s_conn, NULL, 0), 0);
+}
+
+static void test_publish(void)
+{
+    //QOS 0 / QOS 1 PUBLISH, A PAYLOAD NEEDING A 2 BYTE REMAINING LENGTH AND
+    //THE SAME PUBLISH THROUGH A TOPIC HANDLE
+
+    static char message[201];
+    esp8266_mqtt_topic_handle_t* handle;
+    uint8_t sent[512];
+    uint8_t sent_handle[512];
+    uint32_t len;
+    uint32_t len_handle;
+
+    ESP8266_MQTT_TEST_Open(&s_conn, ESP8266_MQTT_TEST_BUFFER_SIZE);
+    ESP8266_MQTT_TEST_Connect(&s_conn);
+
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("a/b", "hi", ESP8266_MQTT_QOS_0, NULL, NULL));
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0x30, 0x09, 0x00, 0x03, 'a', '/', 'b', 0x00, 0x02, 'h', 'i');
+
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("a/b", "hi", ESP8266_MQTT_QOS_1, NULL, NULL));
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0x32, 0x0B, 0x00, 0x03, 'a', '/', 'b', 0x00, 0x01, 0x00, 0x02, 'h', 'i');
+
+    //REMAINING LENGTH 2 + 3 + 2 + 200 = 207 -> 0xCF 0x01
+    memset(message, 'm', sizeof(message) - 1);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("a/b", message, ESP8266_MQTT_QOS_0, NULL, NULL));
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_EQ(len, 3 + 207);
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, 10, 0x30, 0xCF, 0x01, 0x00, 0x03, 'a', '/', 'b', 0x00, 0xC8);
+
+    handle = ESP8266_MQTT_CLIENT_RegisterTopic("a/b");
+    ESP8266_MQTT_TEST_CHECK(handle != NULL);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishHandle(handle, message, ESP8266_MQTT_QOS_0, NULL, NULL));
+    len_handle = ESP8266_MQTT_TEST_Take(&s_conn, sent_handle, sizeof(sent_handle));
+    ESP8266_MQTT_TEST_CHECK_EQ(len_handle, len);
+    ESP8266_MQTT_TEST_CHECK(memcmp(sent, sent_handle, len) == 0);
+    ESP8266_MQTT_CLIENT_UnregisterTopic(handle);
+}
+
+static void test_control_packets(void)
+{
+    //SUBSCRIBE (ID 1, QOS 1), UNSUBSCRIBE (ID 2), PINGREQ, DISCONNECT
+
+    uint8_t sent[64];
+    uint32_t len;
+
+    ESP8266_MQTT_TEST_Open(&s_conn, ESP8266_MQTT_TEST_BUFFER_SIZE);
+    ESP8266_MQTT_TEST_Connect(&s_conn);
+
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Subscribe("s/+", ESP8266_MQTT_QOS_1, s_handler, NULL));
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0x82, 0x08, 0x00, 0x01, 0x00, 0x03, 's', '/', '+', 0x01);
+
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Unsubscribe("s/+"));
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0xA2, 0x07, 0x00, 0x02, 0x00, 0x03, 's', '/', '+');
+
+    ESP8266_MQTT_CLIENT_Send_Pingreq();
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0xC0, 0x00);
+
+    ESP8266_MQTT_CLIENT_Send_Disconnect();
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0xE0, 0x00);
+}
+
+int main(void)
+{
+    ESP8266_MQTT_TEST_RUN(test_connect);
+    ESP8266_MQTT_TEST_RUN(test_publish);
+    ESP8266_MQTT_TEST_RUN(test_control_packets);
+    return ESP8266_MQTT_TEST_End();
+}
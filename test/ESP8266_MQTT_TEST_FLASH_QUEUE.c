@@ -0,0 +1,389 @@
+/**********************************************************************************
+* ESP8266 MQTT TEST : FLASH QUEUE (OFFLINE QUEUE)
+*
+* NOTE
+* -----
+*   (1) THE POWER CUT TEST FORKS A CHILD THAT APPENDS TO A FILE BACKED FLASH AND
+*       IS KILLED PART WAY THROUGH A FLASH WRITE / ERASE. THE PARENT THEN SCANS
+*       THE LOG LIKE A REBOOTED DEVICE WOULD
+*
+*   (2) THE DRAIN TESTS USE THE USUAL 1024 BYTE BUFFER AND HOLD THE TCP SENT CBS
+*       (SLOW LINK) SO STORED PUBLISHES FIND THE TX BUFFER BUSY
+*
+*   (3) A PUBLISH TOO BIG TO BE SENT FROM THE QUEUE LATER IS REFUSED UP FRONT
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include <unistd.h>
+#include <sys/wait.h>
+#include "ESP8266_MQTT_TEST.h"
+#include "ESP8266_MQTT_FLASH_QUEUE.h"
+
+#define ESP8266_MQTT_TEST_FLASH_FILE		"ESP8266_MQTT_TEST_FLASH_QUEUE.bin"
+#define ESP8266_MQTT_TEST_FLASH_RECORDS		(30)
+#define ESP8266_MQTT_TEST_FLASH_MESSAGE		(200)
+#define ESP8266_MQTT_TEST_FLASH_RECORD_SIZE	(216)	//HEADER + TOPIC + MESSAGE
+#define ESP8266_MQTT_TEST_FLASH_SECTOR_FULL	(18)	//RECORDS IN THE FIRST SECTOR
+#define ESP8266_MQTT_TEST_DRAIN_RECORDS		(10)
+
+static esp8266_mqtt_test_conn_t s_conn;
+static uint8_t s_sent[65536];				//PAYLOAD CHAR PER PACKET ID (FIRST SEND)
+
+static void s_record(uint16_t index, char* topic, char* message)
+{
+    //RECORD index : TOPIC "t/<index>", MESSAGE OF ONE REPEATED CHAR
+
+    os_sprintf(topic, "t/%02u", index);
+    memset(message, 'a' + (index % 26), ESP8266_MQTT_TEST_FLASH_MESSAGE);
+    message[ESP8266_MQTT_TEST_FLASH_MESSAGE] = '\0';
+}
+
+static void s_power_cut_child(uint32_t cut_after, int report_fd)
+{
+    //APPEND + FLUSH RECORDS ONE BY ONE, REPORTING EACH ONE FULLY IN FLASH,
+    //UNTIL THE POWER CUT ENDS THE PROCESS
+
+    char topic[8];
+    char message[ESP8266_MQTT_TEST_FLASH_MESSAGE + 1];
+    uint8_t done;
+    uint16_t i;
+
+    ESP8266_MQTT_FLASH_QUEUE_Initialize(0, 4);
+    ESP8266_HOST_FlashPowerCut(cut_after);
+    for(i = 0; i < ESP8266_MQTT_TEST_FLASH_RECORDS; i++)
+    {
+        s_record(i, topic, message);
+        ESP8266_MQTT_FLASH_QUEUE_Append(topic, os_strlen(topic), message, ESP8266_MQTT_TEST_FLASH_MESSAGE, 1);
+        ESP8266_MQTT_FLASH_QUEUE_Flush();
+        done = i + 1;
+        if(write(report_fd, &done, 1) != 1)
+        {
+            break;
+        }
+    }
+    _exit(0);
+}
+
+static void s_power_cut_run(uint32_t cut)
+{
+    //ONE CHILD RUN CUT AFTER cut BYTES, THEN THE REBOOT + DRAIN CHECKS
+
+    uint32_t buffer[128];
+    char topic[8];
+    char message[ESP8266_MQTT_TEST_FLASH_MESSAGE + 1];
+    esp8266_mqtt_flash_queue_record_t record;
+    uint8_t done;
+    uint8_t completed = 0;
+    uint16_t count = 0;
+    int pipe_fd[2];
+    int status;
+    pid_t pid;
+
+    unlink(ESP8266_MQTT_TEST_FLASH_FILE);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_HOST_FlashOpen(ESP8266_MQTT_TEST_FLASH_FILE, 4));
+    ESP8266_MQTT_TEST_CHECK(pipe(pipe_fd) == 0);
+    fflush(stdout);
+    pid = fork();
+    if(pid == 0)
+    {
+        close(pipe_fd[0]);
+        s_power_cut_child(cut, pipe_fd[1]);
+    }
+    close(pipe_fd[1]);
+    while(read(pipe_fd[0], &done, 1) == 1)
+    {
+        completed = done;
+    }
+    close(pipe_fd[0]);
+    waitpid(pid, &status, 0);
+    ESP8266_MQTT_TEST_CHECK(WIFEXITED(status));
+    if(WEXITSTATUS(status) == 0)
+    {
+        ESP8266_MQTT_TEST_CHECK_EQ(completed, ESP8266_MQTT_TEST_FLASH_RECORDS);
+    }
+    else
+    {
+        ESP8266_MQTT_TEST_CHECK_EQ(WEXITSTATUS(status), ESP8266_HOST_POWER_CUT_EXIT);
+    }
+
+    //REBOOT
+    ESP8266_MQTT_TEST_CHECK(ESP8266_HOST_FlashOpen(ESP8266_MQTT_TEST_FLASH_FILE, 4));
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_FLASH_QUEUE_Initialize(0, 4));
+    while(ESP8266_MQTT_FLASH_QUEUE_Read(&record, (uint8_t*)buffer, sizeof(buffer)))
+    {
+        s_record(count, topic, message);
+        ESP8266_MQTT_TEST_CHECK(os_strcmp(record.topic, topic) == 0);
+        ESP8266_MQTT_TEST_CHECK_EQ(record.message_len, ESP8266_MQTT_TEST_FLASH_MESSAGE);
+        ESP8266_MQTT_TEST_CHECK(os_memcmp(record.message, message, ESP8266_MQTT_TEST_FLASH_MESSAGE) == 0);
+        ESP8266_MQTT_FLASH_QUEUE_Consume(record.addr);
+        count++;
+    }
+    if(count != completed && count != completed + 1)
+    {
+        printf("  cut after %u bytes : %u records written, %u recovered\n", cut, completed, count);
+        ESP8266_MQTT_TEST_failures++;
+    }
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_FLASH_QUEUE_IsEmpty());
+
+    //DRAINED STATE SURVIVES ANOTHER REBOOT. THE LOG KEEPS WORKING
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_FLASH_QUEUE_Initialize(0, 4));
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_FLASH_QUEUE_IsEmpty());
+    s_record(7, topic, message);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_FLASH_QUEUE_Append(topic, os_strlen(topic), message, ESP8266_MQTT_TEST_FLASH_MESSAGE, 1));
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_FLASH_QUEUE_Read(&record, (uint8_t*)buffer, sizeof(buffer)));
+    ESP8266_MQTT_TEST_CHECK(os_strcmp(record.topic, topic) == 0);
+}
+
+static void test_power_cut_recovery(void)
+{
+    //WHEREVER THE POWER IS CUT, THE LOG SCANNED AFTER THE REBOOT HOLDS EXACTLY
+    //THE RECORDS WRITTEN BEFORE THE CUT (+ THE ONE BEING WRITTEN IF IT MADE IT)
+    //IN ORDER AND INTACT. IT DRAINS TO EMPTY AND TAKES NEW RECORDS
+
+    uint32_t header = ESP8266_MQTT_TEST_FLASH_SECTOR_FULL * ESP8266_MQTT_TEST_FLASH_RECORD_SIZE + SPI_FLASH_SEC_SIZE;
+    uint32_t cut;
+
+    for(cut = 0; cut < 12000; cut += 157)
+    {
+        s_power_cut_run(cut);
+    }
+
+    //EVERY BYTE OF THE SECOND SECTOR HEADER (WRITTEN AFTER ITS ERASE)
+    for(cut = header; cut < header + ESP8266_MQTT_FLASH_QUEUE_SECTOR_HEADER_SIZE; cut++)
+    {
+        s_power_cut_run(cut);
+    }
+    ESP8266_HOST_FlashClose();
+    unlink(ESP8266_MQTT_TEST_FLASH_FILE);
+}
+
+static void s_parse_publishes(uint8_t* data, uint32_t len, bool first_send)
+{
+    //WALK THE CAPTURED QOS 1 PUBLISHES. FIRST SEND : NOTE THE PAYLOAD CHAR OF
+    //EACH PACKET ID. OTHERWISE (RETRANSMISSIONS) CHECK IT IS STILL THE SAME
+
+    uint32_t pos = 0;
+    uint32_t remaining;
+    uint32_t start;
+    uint16_t topic_len;
+    uint16_t packet_id;
+    uint8_t shift;
+
+    while(pos < len)
+    {
+        ESP8266_MQTT_TEST_CHECK_EQ(data[pos] & 0xF6, 0x32);
+        pos++;
+        remaining = 0;
+        shift = 0;
+        do
+        {
+            remaining |= (uint32_t)(data[pos] & 0x7F) << shift;
+            shift += 7;
+        }while(data[pos++] & 0x80);
+        start = pos;
+        topic_len = ((uint16_t)data[pos] << 8) | data[pos + 1];
+        packet_id = ((uint16_t)data[pos + 2 + topic_len] << 8) | data[pos + 3 + topic_len];
+        if(first_send)
+        {
+            s_sent[packet_id] = data[start + remaining - 1];
+        }
+        else
+        {
+            ESP8266_MQTT_TEST_CHECK_EQ(data[start + remaining - 1], s_sent[packet_id]);
+        }
+        pos = start + remaining;
+    }
+}
+
+static void test_dropped_sector_fails_inflight(void)
+{
+    //RING FULL WHILE STORED MESSAGES ARE STILL IN FLIGHT : THE OLDEST SECTOR IS
+    //REUSED, SO THOSE MESSAGES FAIL. A RETRANSMISSION NEVER PICKS UP THE NEW
+    //RECORD NOW AT THE SAME FLASH ADDRESS
+
+    static uint8_t out[32768];
+    char topic[8];
+    char message[601];
+    uint32_t len;
+    uint8_t i;
+
+    //TX BUFFER TAKES ALL THE MESSAGES IN FLIGHT RETRANSMITTED BACK TO BACK
+    ESP8266_HOST_FlashOpen(NULL, 2);
+    ESP8266_MQTT_TEST_Open(&s_conn, 8192);
+    ESP8266_MQTT_CLIENT_SetInflightWindow(ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_SetOfflineQueue(true, 0, 2));
+    memset(s_sent, 0, sizeof(s_sent));
+
+    //6 RECORDS PER SECTOR. 3 STORED WHILE OFFLINE, SENT FROM FLASH ON CONNECT
+    for(i = 0; i < 13; i++)
+    {
+        if(i == 3)
+        {
+            //CONNECT TAKES (DROPS) THE STORED ONES SENT AS IDS 1 - 3
+            ESP8266_MQTT_TEST_Connect(&s_conn);
+            ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetInflightCount(), 3);
+            s_sent[1] = 'A';
+            s_sent[2] = 'B';
+            s_sent[3] = 'C';
+        }
+        os_sprintf(topic, "q/%u", i);
+        memset(message, 'A' + i, 600);
+        message[600] = '\0';
+        ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb(topic, message, ESP8266_MQTT_QOS_1, NULL, NULL));
+        if(i < 3)
+        {
+            //RAM CACHE TO FLASH (ONE RECORD FILLS MOST OF IT)
+            ESP8266_HOST_Run(ESP8266_MQTT_FLASH_QUEUE_FLUSH_MS);
+        }
+        else
+        {
+            len = ESP8266_MQTT_TEST_Take(&s_conn, out, sizeof(out));
+            s_parse_publishes(out, len, true);
+        }
+    }
+
+    //RECORD 12 TOOK OVER SECTOR 0 (RECORDS 0 - 5)
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetInflightCount(), 7);
+    ESP8266_HOST_Run(ESP8266_MQTT_CLIENT_REPLY_TIMEOUT_MS + ESP8266_MQTT_CLIENT_INFLIGHT_CHECK_MS);
+    len = ESP8266_MQTT_TEST_Take(&s_conn, out, sizeof(out));
+    ESP8266_MQTT_TEST_CHECK(len > 0);
+    s_parse_publishes(out, len, false);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetInflightCount(), 7);
+    ESP8266_MQTT_CLIENT_SetOfflineQueue(false, 0, 0);
+}
+
+static void s_drain_run(esp8266_mqtt_qos_t qos_level)
+{
+    //STORED 200 BYTE PUBLISHES DRAINED OVER A LINK THAT ACKNOWLEDGES SENDS ONE
+    //ROUND AT A TIME. A FEW FILL THE TX BUFFER, THE REST FOLLOW FROM THE SENT
+    //CBS, ALL IN ORDER. NONE IS DROPPED FOR A BUSY TX BUFFER
+
+    static uint8_t out[8192];
+    uint8_t puback[] = {0x40, 0x02, 0x00, 0x00};
+    char topic[8];
+    char message[ESP8266_MQTT_TEST_FLASH_MESSAGE + 1];
+    uint32_t len;
+    uint32_t pos;
+    uint32_t remaining;
+    uint16_t topic_len;
+    uint16_t received = 0;
+    uint8_t rounds = 0;
+    uint8_t shift;
+    uint8_t i;
+
+    ESP8266_HOST_FlashOpen(NULL, 4);
+    ESP8266_MQTT_TEST_Open(&s_conn, ESP8266_MQTT_TEST_BUFFER_SIZE);
+    ESP8266_MQTT_CLIENT_SetInflightWindow(8);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_SetOfflineQueue(true, 0, 4));
+    s_conn.transport.auto_ack = false;
+    for(i = 0; i < ESP8266_MQTT_TEST_DRAIN_RECORDS; i++)
+    {
+        s_record(i, topic, message);
+        ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb(topic, message, qos_level, NULL, NULL));
+
+        //RAM CACHE TO FLASH (IT HOLDS A FEW RECORDS ONLY)
+        ESP8266_HOST_Run(ESP8266_MQTT_FLASH_QUEUE_FLUSH_MS);
+    }
+    ESP8266_MQTT_TEST_Connect(&s_conn);
+
+    while(received < ESP8266_MQTT_TEST_DRAIN_RECORDS && rounds++ < 4 * ESP8266_MQTT_TEST_DRAIN_RECORDS)
+    {
+        ESP8266_HOST_TRANSPORT_Ack(&s_conn.transport, 1);
+        len = ESP8266_MQTT_TEST_Take(&s_conn, out, sizeof(out));
+        pos = 0;
+        while(pos < len)
+        {
+            ESP8266_MQTT_TEST_CHECK_EQ(out[pos] & 0xF6, 0x30 | (qos_level << 1));
+            pos++;
+            remaining = 0;
+            shift = 0;
+            do
+            {
+                remaining |= (uint32_t)(out[pos] & 0x7F) << shift;
+                shift += 7;
+            }while(out[pos++] & 0x80);
+            topic_len = ((uint16_t)out[pos] << 8) | out[pos + 1];
+            s_record(received, topic, message);
+            ESP8266_MQTT_TEST_CHECK(topic_len == os_strlen(topic) && os_memcmp(&out[pos + 2], topic, topic_len) == 0);
+            if(qos_level != ESP8266_MQTT_QOS_0)
+            {
+                puback[2] = out[pos + 2 + topic_len];
+                puback[3] = out[pos + 3 + topic_len];
+                ESP8266_MQTT_TEST_Inject(&s_conn, puback, sizeof(puback));
+            }
+            received++;
+            pos += remaining;
+        }
+    }
+    ESP8266_MQTT_TEST_CHECK_EQ(received, ESP8266_MQTT_TEST_DRAIN_RECORDS);
+    ESP8266_MQTT_TEST_CHECK(rounds > 1);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_FLASH_QUEUE_IsEmpty());
+    ESP8266_MQTT_CLIENT_SetOfflineQueue(false, 0, 0);
+}
+
+static void test_drain_busy_buffer_qos0(void)
+{
+    s_drain_run(ESP8266_MQTT_QOS_0);
+}
+
+static void test_drain_busy_buffer_qos1(void)
+{
+    s_drain_run(ESP8266_MQTT_QOS_1);
+}
+
+static void s_complete_cb(void* arg, bool success)
+{
+    (*(uint8_t*)arg)++;
+}
+
+static void test_oversized_not_stored(void)
+{
+    //512 BYTE BUFFER : A QOS 1 PUBLISH TO "big" FITS WITH UP TO 500 PAYLOAD
+    //BYTES (1 + 2 + 2 + 3 + 2 + 2 + 500). ONE BYTE MORE IS REFUSED, NOT STORED
+    //THE STORED ONE COMPLETES RIGHT AWAY AND IS SENT FROM THE QUEUE UNTIL ACKED
+
+    static char message[502];
+    const uint8_t puback[] = {0x40, 0x02, 0x00, 0x01};
+    uint8_t sent[600];
+    uint32_t len;
+    uint8_t completed = 0;
+
+    ESP8266_HOST_FlashOpen(NULL, 2);
+    ESP8266_MQTT_TEST_Open(&s_conn, 512);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_SetOfflineQueue(true, 0, 2));
+    memset(message, 'm', 501);
+    ESP8266_MQTT_TEST_CHECK(!ESP8266_MQTT_CLIENT_Send_PublishWithCb("big", message, ESP8266_MQTT_QOS_1, s_complete_cb, &completed));
+    ESP8266_MQTT_TEST_CHECK_EQ(completed, 0);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_FLASH_QUEUE_IsEmpty());
+    message[500] = '\0';
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("big", message, ESP8266_MQTT_QOS_1, s_complete_cb, &completed));
+    ESP8266_MQTT_TEST_CHECK_EQ(completed, 1);
+    ESP8266_MQTT_TEST_CHECK(!ESP8266_MQTT_FLASH_QUEUE_IsEmpty());
+    ESP8266_HOST_Run(ESP8266_MQTT_FLASH_QUEUE_FLUSH_MS);
+
+    //CONNECT TAKES (DROPS) THE FIRST SEND. THE RETRANSMISSION FILLS THE BUFFER
+    ESP8266_MQTT_TEST_Connect(&s_conn);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetInflightCount(), 1);
+    ESP8266_HOST_Run(ESP8266_MQTT_CLIENT_REPLY_TIMEOUT_MS + ESP8266_MQTT_CLIENT_INFLIGHT_CHECK_MS);
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_EQ(len, 512);
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, 8, 0x3A, 0xFD, 0x03, 0x00, 0x03, 'b', 'i', 'g');
+    ESP8266_MQTT_TEST_Inject(&s_conn, puback, sizeof(puback));
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetInflightCount(), 0);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_FLASH_QUEUE_IsEmpty());
+    ESP8266_MQTT_CLIENT_SetOfflineQueue(false, 0, 0);
+}
+
+int main(void)
+{
+    ESP8266_MQTT_TEST_RUN(test_power_cut_recovery);
+    ESP8266_MQTT_TEST_RUN(test_dropped_sector_fails_inflight);
+    ESP8266_MQTT_TEST_RUN(test_drain_busy_buffer_qos0);
+    ESP8266_MQTT_TEST_RUN(test_drain_busy_buffer_qos1);
+    ESP8266_MQTT_TEST_RUN(test_oversized_not_stored);
+    return ESP8266_MQTT_TEST_End();
+}
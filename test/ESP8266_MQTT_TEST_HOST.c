@@ -0,0 +1,181 @@
+/**********************************************************************************
+* ESP8266 MQTT TEST : HOST BUILD
+*
+* NOTE
+* -----
+*   (1) THE HOST RUNTIME ITSELF (VIRTUAL TIME, TIMERS, EVENTS, HEAP COUNTING) AND
+*       A CONNECT / PUBLISH ROUND TRIP OVER BOTH MOCK TRANSPORTS
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_MQTT_TEST.h"
+
+static uint32_t s_fired[2];
+static uint32_t s_fired_at[2];
+
+static void s_timer_cb(void* arg)
+{
+    uint32_t index = (uint32_t)(uintptr_t)arg;
+
+    s_fired[index]++;
+    s_fired_at[index] = system_get_time();
+}
+
+static void test_timers(void)
+{
+    //ONE SHOT + PERIODIC TIMERS FIRE AT THEIR VIRTUAL TIME
+
+    os_timer_t once;
+    os_timer_t periodic;
+
+    s_fired[0] = s_fired[1] = 0;
+    os_timer_setfn(&once, s_timer_cb, (void*)0);
+    os_timer_setfn(&periodic, s_timer_cb, (void*)1);
+    os_timer_arm(&once, 250, false);
+    os_timer_arm(&periodic, 100, true);
+
+    ESP8266_HOST_Run(99);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_fired[1], 0);
+    ESP8266_HOST_Run(1);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_fired[1], 1);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_fired_at[1], 100000);
+    ESP8266_HOST_Run(400);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_fired[0], 1);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_fired_at[0], 250000);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_fired[1], 5);
+    ESP8266_MQTT_TEST_CHECK_EQ(system_get_time(), 500000);
+
+    //DISARMED TIMERS DO NOT FIRE
+    os_timer_disarm(&periodic);
+    ESP8266_HOST_Run(1000);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_fired[1], 5);
+}
+
+static void test_heap(void)
+{
+    //os_malloc / os_free ARE COUNTED
+
+    esp8266_host_heap_stats_t stats;
+    void* a;
+    void* b;
+
+    ESP8266_HOST_ResetHeapStats();
+    a = os_malloc(100);
+    b = os_zalloc(50);
+    os_free(a);
+    ESP8266_HOST_GetHeapStats(&stats);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.allocs, 2);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.frees, 1);
+    os_free(b);
+    ESP8266_HOST_GetHeapStats(&stats);
+    ESP8266_MQTT_TEST_CHECK(stats.bytes_peak - stats.bytes_in_use == 150);
+}
+
+static void test_default_transport(void)
+{
+    //DEFAULT INSTANCE ON ESP8266_TCP_GENERIC (HOST MOCK)
+
+    esp8266_host_transport_t* tcp = ESP8266_HOST_TRANSPORT_TcpGeneric();
+    const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+    uint8_t out[128];
+    uint32_t len;
+
+    ESP8266_MQTT_CLIENT_Initialize("broker.test", "127.0.0.1", 1883, 512);
+    ESP8266_MQTT_CLIENT_SetOptions(0, 0, 0, false, NULL, false, NULL, true, 60, false, NULL, NULL, 0, "dev");
+    ESP8266_MQTT_TEST_SetCallbacks();
+
+    ESP8266_MQTT_CLIENT_TcpConnect();
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_TEST_log.tcp_connected, 1);
+
+    ESP8266_MQTT_CLIENT_Send_Connect();
+    ESP8266_HOST_Poll();
+    len = ESP8266_HOST_TRANSPORT_Take(tcp, out, sizeof(out));
+    ESP8266_MQTT_TEST_CHECK(len > 2 && out[0] == 0x10 && out[1] == len - 2);
+
+    ESP8266_HOST_TRANSPORT_Inject(tcp, connack, sizeof(connack));
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_TEST_log.count[ESP8266_MQTT_CONTROL_PACKET_TYPE_CONNACK], 1);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_IsConnected());
+
+    ESP8266_MQTT_CLIENT_Send_Publish("a/b", "hi", ESP8266_MQTT_QOS_0);
+    ESP8266_HOST_Poll();
+    len = ESP8266_HOST_TRANSPORT_Take(tcp, out, sizeof(out));
+    ESP8266_MQTT_TEST_CHECK_BYTES(out, len, 0x30, 0x09, 0x00, 0x03, 'a', '/', 'b', 0x00, 0x02, 'h', 'i');
+}
+
+static void test_default_transport_owner(void)
+{
+    //A SECOND INSTANCE LEFT ON THE DEFAULT TRANSPORT IS REFUSED. IT CAN NOT
+    //TOUCH THE CONNECTION OF THE INSTANCE THAT OWNS ESP8266_TCP_GENERIC
+
+    static esp8266_mqtt_client_t second;
+    esp8266_host_transport_t* tcp = ESP8266_HOST_TRANSPORT_TcpGeneric();
+    const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+
+    ESP8266_MQTT_CLIENT_Initialize("broker.test", "127.0.0.1", 1883, 512);
+    ESP8266_MQTT_CLIENT_SetOptions(0, 0, 0, false, NULL, false, NULL, true, 60, false, NULL, NULL, 0, "dev");
+    ESP8266_MQTT_TEST_SetCallbacks();
+    ESP8266_MQTT_CLIENT_TcpConnect();
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_CLIENT_Send_Connect();
+    ESP8266_HOST_Poll();
+    ESP8266_HOST_TRANSPORT_Inject(tcp, connack, sizeof(connack));
+    ESP8266_HOST_TRANSPORT_Take(tcp, NULL, 0);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_IsConnected());
+
+    ESP8266_MQTT_CLIENT_InitInstance(&second);
+    ESP8266_MQTT_CLIENT_Select(&second);
+    ESP8266_MQTT_CLIENT_Initialize("other.test", "127.0.0.2", 1883, 512);
+    ESP8266_MQTT_CLIENT_SetOptions(0, 0, 0, false, NULL, false, NULL, true, 60, false, NULL, NULL, 0, "second");
+    ESP8266_MQTT_CLIENT_TcpConnect();
+    ESP8266_MQTT_CLIENT_TcpDisonnect();
+    ESP8266_MQTT_TEST_CHECK(!ESP8266_MQTT_CLIENT_Send_PublishWithCb("a/b", "hi", ESP8266_MQTT_QOS_0, NULL, NULL));
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_TEST_CHECK_EQ(tcp->stats.initializes, 1);
+    ESP8266_MQTT_TEST_CHECK_EQ(tcp->stats.disconnects, 0);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_HOST_TRANSPORT_Take(tcp, NULL, 0), 0);
+
+    //THE OWNER STILL WORKS
+    ESP8266_MQTT_CLIENT_Select(NULL);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_IsConnected());
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("a/b", "hi", ESP8266_MQTT_QOS_0, NULL, NULL));
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_TEST_CHECK(ESP8266_HOST_TRANSPORT_Take(tcp, NULL, 0) > 0);
+}
+
+static void test_mock_transport(void)
+{
+    //INSTANCE ON ITS OWN MOCK CONNECTION : QOS 1 PUBLISH -> PUBACK
+
+    static esp8266_mqtt_test_conn_t conn;
+    const uint8_t puback[] = {0x40, 0x02, 0x00, 0x01};
+    uint8_t out[128];
+    uint32_t len;
+
+    ESP8266_MQTT_TEST_Open(&conn, ESP8266_MQTT_TEST_BUFFER_SIZE);
+    ESP8266_MQTT_TEST_Connect(&conn);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_IsConnected());
+
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", "x", ESP8266_MQTT_QOS_1, NULL, NULL));
+    len = ESP8266_MQTT_TEST_Take(&conn, out, sizeof(out));
+    ESP8266_MQTT_TEST_CHECK_BYTES(out, len, 0x32, 0x08, 0x00, 0x01, 't', 0x00, 0x01, 0x00, 0x01, 'x');
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetInflightCount(), 1);
+
+    ESP8266_MQTT_TEST_Inject(&conn, puback, sizeof(puback));
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetInflightCount(), 0);
+    ESP8266_MQTT_TEST_CHECK_EQ(conn.transport.stats.connects, 1);
+}
+
+int main(void)
+{
+    ESP8266_MQTT_TEST_RUN(test_timers);
+    ESP8266_MQTT_TEST_RUN(test_heap);
+    ESP8266_MQTT_TEST_RUN(test_default_transport);
+    ESP8266_MQTT_TEST_RUN(test_default_transport_owner);
+    ESP8266_MQTT_TEST_RUN(test_mock_transport);
+    return ESP8266_MQTT_TEST_End();
+}
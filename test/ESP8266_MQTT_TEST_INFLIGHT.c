@@ -0,0 +1,64 @@
+/**********************************************************************************
+* ESP8266 MQTT TEST : IN-FLIGHT TABLE
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_MQTT_TEST.h"
+
+static esp8266_mqtt_test_conn_t s_conn;
+static uint32_t s_completed[2];		//[0] FAILED, [1] DELIVERED
+static uint32_t s_released;
+
+static void s_complete_cb(void* arg, bool success)
+{
+    s_completed[success ? 1 : 0]++;
+}
+
+static void s_release_cb(void* arg)
+{
+    s_released++;
+}
+
+static void test_reinitialize_fails_inflight(void)
+{
+    //RE-INITIALIZE WITH QOS 1 MESSAGES UNACKNOWLEDGED : THEY COMPLETE WITH
+    //FALSE AND ZERO COPY PAYLOADS ARE HANDED BACK (NOT LEAKED BY THE RESET)
+
+    static uint8_t payload[32];
+    const uint8_t puback[] = {0x40, 0x02, 0x00, 0x01};
+
+    s_completed[0] = s_completed[1] = 0;
+    s_released = 0;
+    ESP8266_MQTT_TEST_Open(&s_conn, ESP8266_MQTT_TEST_BUFFER_SIZE);
+    ESP8266_MQTT_TEST_Connect(&s_conn);
+
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("a", "1", ESP8266_MQTT_QOS_1, s_complete_cb, NULL));
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishRef("b", payload, sizeof(payload), ESP8266_MQTT_QOS_1, s_release_cb, NULL));
+    ESP8266_MQTT_TEST_Take(&s_conn, NULL, 0);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetInflightCount(), 2);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_released, 0);
+
+    ESP8266_MQTT_CLIENT_Initialize("broker.test", "127.0.0.1", 1883, ESP8266_MQTT_TEST_BUFFER_SIZE);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetInflightCount(), 0);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_completed[0], 1);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_completed[1], 0);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_released, 1);
+    ESP8266_MQTT_TEST_CHECK(!ESP8266_MQTT_CLIENT_IsConnected());
+
+    //A LATE PUBACK FOR AN OLD ID CHANGES NOTHING. THE TABLE WORKS AGAIN
+    ESP8266_MQTT_TEST_Inject(&s_conn, puback, sizeof(puback));
+    ESP8266_MQTT_TEST_CHECK_EQ(s_completed[1], 0);
+    ESP8266_MQTT_TEST_Connect(&s_conn);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("a", "2", ESP8266_MQTT_QOS_1, s_complete_cb, NULL));
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetInflightCount(), 1);
+}
+
+int main(void)
+{
+    ESP8266_MQTT_TEST_RUN(test_reinitialize_fails_inflight);
+    return ESP8266_MQTT_TEST_End();
+}
@@ -0,0 +1,170 @@
+/**********************************************************************************
+* ESP8266 MQTT TEST : RECEIVE PARSER
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_MQTT_TEST.h"
+
+static esp8266_mqtt_test_conn_t s_conn;
+static uint32_t s_handled;
+static uint16_t s_handled_len;
+
+static void s_handler(void* arg, char* topic, uint16_t topic_len, char* payload, uint16_t payload_len)
+{
+    s_handled++;
+    s_handled_len = payload_len;
+}
+
+static void s_open(uint16_t buffer_size)
+{
+    ESP8266_MQTT_TEST_Open(&s_conn, buffer_size);
+    ESP8266_MQTT_TEST_Connect(&s_conn);
+    ESP8266_MQTT_CLIENT_Subscribe("in/#", ESP8266_MQTT_QOS_0, s_handler, NULL);
+    ESP8266_MQTT_TEST_Take(&s_conn, NULL, 0);
+    s_handled = 0;
+    s_handled_len = 0;
+    memset(&ESP8266_MQTT_TEST_log, 0, sizeof(ESP8266_MQTT_TEST_log));
+}
+
+static uint16_t s_publish(uint8_t* dest, uint32_t payload_len)
+{
+    //INBOUND QOS 0 PUBLISH TO "in/x" (ONLY THE HEADER + TOPIC IF THE PAYLOAD
+    //DOES NOT FIT dest)
+
+    uint32_t remaining = 6 + payload_len;
+    uint16_t len = 0;
+
+    dest[len++] = 0x30;
+    do
+    {
+        dest[len] = remaining & 0x7F;
+        remaining >>= 7;
+        dest[len++] |= (remaining > 0) ? 0x80 : 0;
+    }while(remaining > 0);
+    dest[len++] = 0x00;
+    dest[len++] = 0x04;
+    memcpy(&dest[len], "in/x", 4);
+    len += 4;
+    if(payload_len < 1024)
+    {
+        memset(&dest[len], 'p', payload_len);
+        len += payload_len;
+    }
+    return len;
+}
+
+static void test_packets_in_one_receive(void)
+{
+    //SEVERAL COMPLETE PACKETS IN ONE RECEIVE CB ARE ALL DISPATCHED
+
+    uint8_t data[64];
+    uint16_t len;
+    const uint8_t pingresp[] = {0xD0, 0x00};
+
+    s_open(ESP8266_MQTT_TEST_BUFFER_SIZE);
+    len = s_publish(data, 5);
+    memcpy(&data[len], pingresp, sizeof(pingresp));
+    len += sizeof(pingresp);
+    len += s_publish(&data[len], 3);
+    ESP8266_MQTT_TEST_Inject(&s_conn, data, len);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_handled, 2);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_handled_len, 3);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_TEST_log.count[ESP8266_MQTT_CONTROL_PACKET_TYPE_PINGRESP], 1);
+}
+
+static void test_packet_split_byte_by_byte(void)
+{
+    //A PACKET ARRIVING ONE BYTE PER RECEIVE CB (FIXED HEADER INCLUDED) IS
+    //REASSEMBLED AND DISPATCHED ONCE
+
+    uint8_t data[256];
+    uint16_t len;
+    uint16_t i;
+
+    s_open(ESP8266_MQTT_TEST_BUFFER_SIZE);
+    len = s_publish(data, 200);
+    for(i = 0; i < len; i++)
+    {
+        ESP8266_MQTT_TEST_Inject(&s_conn, &data[i], 1);
+        ESP8266_MQTT_TEST_CHECK_EQ(s_handled, (i == len - 1) ? 1 : 0);
+    }
+    ESP8266_MQTT_TEST_CHECK_EQ(s_handled_len, 200);
+}
+
+static void test_oversized_packet_skipped(void)
+{
+    //A PACKET LARGER THAN THE RX BUFFER IS SKIPPED ACROSS RECEIVE CBS. THE
+    //PACKET AFTER IT (SAME RECEIVE CB AS ITS TAIL) IS STILL PARSED
+
+    uint8_t data[512];
+    uint16_t len;
+    const uint8_t pingresp[] = {0xD0, 0x00};
+
+    s_open(128);
+    len = s_publish(data, 300);
+    memcpy(&data[len], pingresp, sizeof(pingresp));
+    len += sizeof(pingresp);
+    ESP8266_MQTT_TEST_Inject(&s_conn, data, 1);
+    ESP8266_MQTT_TEST_Inject(&s_conn, &data[1], 100);
+    ESP8266_MQTT_TEST_Inject(&s_conn, &data[101], 100);
+    ESP8266_MQTT_TEST_Inject(&s_conn, &data[201], len - 201);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_handled, 0);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_TEST_log.count[ESP8266_MQTT_CONTROL_PACKET_TYPE_PINGRESP], 1);
+}
+
+static void test_oversized_packet_beyond_receive_size(void)
+{
+    //REMAINING LENGTH ABOVE 65535 (MORE THAN ANY ONE RECEIVE CB CAN CARRY) :
+    //THE SKIP COUNT OUTLIVES SEVERAL FULL RECEIVE CBS
+
+    static uint8_t data[60000];
+    uint8_t header[16];
+    uint16_t header_len;
+    uint32_t total = 70000;
+    uint32_t left;
+    const uint8_t pingresp[] = {0xD0, 0x00};
+
+    s_open(128);
+    header_len = s_publish(header, total);
+    ESP8266_MQTT_TEST_Inject(&s_conn, header, header_len);
+    left = total;
+    memset(data, 'p', sizeof(data));
+    while(left > sizeof(data))
+    {
+        ESP8266_MQTT_TEST_Inject(&s_conn, data, sizeof(data));
+        left -= sizeof(data);
+    }
+    memcpy(&data[left], pingresp, sizeof(pingresp));
+    ESP8266_MQTT_TEST_Inject(&s_conn, data, left + sizeof(pingresp));
+    ESP8266_MQTT_TEST_CHECK_EQ(s_handled, 0);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_TEST_log.count[ESP8266_MQTT_CONTROL_PACKET_TYPE_PINGRESP], 1);
+}
+
+static void test_malformed_length(void)
+{
+    //A REMAINING LENGTH OF MORE THAN 4 BYTES IS MALFORMED. THE PARSER RESETS
+    //AND THE NEXT RECEIVE CB STARTS A NEW PACKET
+
+    const uint8_t bad[] = {0x30, 0xFF, 0xFF, 0xFF, 0xFF, 0x01};
+    const uint8_t pingresp[] = {0xD0, 0x00};
+
+    s_open(ESP8266_MQTT_TEST_BUFFER_SIZE);
+    ESP8266_MQTT_TEST_Inject(&s_conn, bad, sizeof(bad));
+    ESP8266_MQTT_TEST_Inject(&s_conn, pingresp, sizeof(pingresp));
+    ESP8266_MQTT_TEST_CHECK_EQ(s_handled, 0);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_TEST_log.count[ESP8266_MQTT_CONTROL_PACKET_TYPE_PINGRESP], 1);
+}
+
+int main(void)
+{
+    ESP8266_MQTT_TEST_RUN(test_packets_in_one_receive);
+    ESP8266_MQTT_TEST_RUN(test_packet_split_byte_by_byte);
+    ESP8266_MQTT_TEST_RUN(test_oversized_packet_skipped);
+    ESP8266_MQTT_TEST_RUN(test_oversized_packet_beyond_receive_size);
+    ESP8266_MQTT_TEST_RUN(test_malformed_length);
+    return ESP8266_MQTT_TEST_End();
+}
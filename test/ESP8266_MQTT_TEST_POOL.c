@@ -0,0 +1,97 @@
+/**********************************************************************************
+* ESP8266 MQTT TEST : MULTI INSTANCE + POOL
+*
+* NOTE
+* -----
+*   (1) TWO CLIENT INSTANCES ON THEIR OWN MOCK CONNECTIONS KEEP SEPARATE STATE.
+*       THE POOL PREFERS THE CONNECTED PRIMARY, FAILS OVER TO THE FALLBACK WHEN
+*       THE PRIMARY REFUSES A PUBLISH (HOLDOFF) OR IS DOWN
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_MQTT_TEST.h"
+#include "ESP8266_MQTT_POOL.h"
+
+static esp8266_mqtt_test_conn_t s_primary;
+static esp8266_mqtt_test_conn_t s_fallback;
+static esp8266_mqtt_pool_t s_pool;
+
+static void s_open(void)
+{
+    //BOTH CONNECTED. PRIMARY WINDOW OF 1
+
+    ESP8266_MQTT_TEST_Open(&s_primary, ESP8266_MQTT_TEST_BUFFER_SIZE);
+    ESP8266_MQTT_CLIENT_SetInflightWindow(1);
+    ESP8266_MQTT_TEST_Connect(&s_primary);
+    ESP8266_MQTT_TEST_Open(&s_fallback, ESP8266_MQTT_TEST_BUFFER_SIZE);
+    ESP8266_MQTT_TEST_Connect(&s_fallback);
+
+    ESP8266_MQTT_POOL_Initialize(&s_pool);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_POOL_Add(&s_pool, &s_fallback.client, 1));
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_POOL_Add(&s_pool, &s_primary.client, 0));
+    ESP8266_MQTT_TEST_CHECK(!ESP8266_MQTT_POOL_Add(&s_pool, &s_primary.client, 0));
+}
+
+static void test_instances(void)
+{
+    //PACKET IDS AND IN-FLIGHT TABLES ARE PER INSTANCE
+
+    uint8_t sent[16];
+    uint32_t len;
+
+    s_open();
+    ESP8266_MQTT_CLIENT_Select(&s_primary.client);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", "m", ESP8266_MQTT_QOS_1, NULL, NULL));
+    ESP8266_MQTT_CLIENT_Select(&s_fallback.client);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetInflightCount(), 0);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", "m", ESP8266_MQTT_QOS_1, NULL, NULL));
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", "m", ESP8266_MQTT_QOS_1, NULL, NULL));
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetInflightCount(), 2);
+
+    len = ESP8266_MQTT_TEST_Take(&s_primary, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0x32, 0x08, 0x00, 0x01, 't', 0x00, 0x01, 0x00, 0x01, 'm');
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_TEST_Take(&s_fallback, NULL, 0), 2 * 10);
+}
+
+static void test_failover(void)
+{
+    //PRIMARY FIRST. WINDOW FULL : REFUSED, SAME PUBLISH GOES TO THE FALLBACK
+    //AND THE PRIMARY IS HELD OFF. BACK AFTER THE HOLDOFF ONCE IT HAS ROOM
+
+    const uint8_t puback[] = {0x40, 0x02, 0x00, 0x01};
+
+    s_open();
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_POOL_Pick(&s_pool) == &s_primary.client);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_POOL_Publish(&s_pool, "t", "m", ESP8266_MQTT_QOS_1, NULL, NULL) == &s_primary.client);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_POOL_Publish(&s_pool, "t", "m", ESP8266_MQTT_QOS_1, NULL, NULL) == &s_fallback.client);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_pool.members[1].refused, 1);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_POOL_Pick(&s_pool) == &s_fallback.client);
+
+    ESP8266_MQTT_CLIENT_Select(&s_primary.client);
+    ESP8266_MQTT_TEST_Inject(&s_primary, puback, sizeof(puback));
+    ESP8266_HOST_Run(ESP8266_MQTT_POOL_HOLDOFF_MS - 1);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_POOL_Pick(&s_pool) == &s_fallback.client);
+    ESP8266_HOST_Run(1);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_POOL_Pick(&s_pool) == &s_primary.client);
+
+    //PRIMARY CONNECTION LOST : FALLBACK WITHOUT A REFUSAL
+    ESP8266_HOST_TRANSPORT_Drop(&s_primary.transport);
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_POOL_Pick(&s_pool) == &s_fallback.client);
+
+    ESP8266_MQTT_POOL_Remove(&s_pool, &s_fallback.client);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_POOL_Pick(&s_pool) == &s_primary.client);
+    ESP8266_MQTT_POOL_Remove(&s_pool, &s_primary.client);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_POOL_Pick(&s_pool) == NULL);
+}
+
+int main(void)
+{
+    ESP8266_MQTT_TEST_RUN(test_instances);
+    ESP8266_MQTT_TEST_RUN(test_failover);
+    return ESP8266_MQTT_TEST_End();
+}
@@ -0,0 +1,203 @@
+/**********************************************************************************
+* ESP8266 MQTT TEST : QOS 1 / 2 FLOWS + SUBSCRIPTIONS
+*
+* NOTE
+* -----
+*   (1) OUTBOUND : IN-FLIGHT WINDOW, RETRANSMISSION WITH DUP AND GIVING UP,
+*       QOS 2 PUBLISH -> PUBREC -> PUBREL -> PUBCOMP. INBOUND : DISPATCH
+*       THROUGH THE WILDCARD TOPIC TRIE, PUBACK, QOS 2 DELIVERED ONCE
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_MQTT_TEST.h"
+
+static esp8266_mqtt_test_conn_t s_conn;
+static uint32_t s_completed[2];		//[0] FAILED, [1] DELIVERED
+static uint32_t s_handled[3];		//PER HANDLER (arg = INDEX)
+static char s_last_payload[16];
+
+static void s_complete_cb(void* arg, bool success)
+{
+    s_completed[success ? 1 : 0]++;
+}
+
+static void s_handler(void* arg, char* topic, uint16_t topic_len, char* payload, uint16_t payload_len)
+{
+    s_handled[(uintptr_t)arg]++;
+    if(payload_len < sizeof(s_last_payload))
+    {
+        memcpy(s_last_payload, payload, payload_len);
+        s_last_payload[payload_len] = '\0';
+    }
+}
+
+static void s_reset(void)
+{
+    memset(s_completed, 0, sizeof(s_completed));
+    memset(s_handled, 0, sizeof(s_handled));
+    ESP8266_MQTT_TEST_Open(&s_conn, ESP8266_MQTT_TEST_BUFFER_SIZE);
+    ESP8266_MQTT_TEST_Connect(&s_conn);
+}
+
+static void test_window(void)
+{
+    //NO MORE THAN THE WINDOW IN FLIGHT. EACH PUBACK FREES A SLOT AND
+    //COMPLETES ITS MESSAGE. IDS KEEP COUNTING UP
+
+    const uint8_t puback_2[] = {0x40, 0x02, 0x00, 0x02};
+    uint8_t sent[64];
+    uint32_t len;
+    uint8_t i;
+
+    s_reset();
+    ESP8266_MQTT_CLIENT_SetInflightWindow(4);
+    for(i = 0; i < 4; i++)
+    {
+        ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", "m", ESP8266_MQTT_QOS_1, s_complete_cb, NULL));
+    }
+    ESP8266_MQTT_TEST_CHECK(!ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", "m", ESP8266_MQTT_QOS_1, s_complete_cb, NULL));
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", "m", ESP8266_MQTT_QOS_0, NULL, NULL));
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetInflightCount(), 4);
+    ESP8266_MQTT_TEST_Take(&s_conn, NULL, 0);
+
+    ESP8266_MQTT_TEST_Inject(&s_conn, puback_2, sizeof(puback_2));
+    ESP8266_MQTT_TEST_CHECK_EQ(s_completed[1], 1);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetInflightCount(), 3);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", "m", ESP8266_MQTT_QOS_1, s_complete_cb, NULL));
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0x32, 0x08, 0x00, 0x01, 't', 0x00, 0x05, 0x00, 0x01, 'm');
+
+    //A PUBACK FOR AN ID NOT IN FLIGHT CHANGES NOTHING
+    ESP8266_MQTT_TEST_Inject(&s_conn, puback_2, sizeof(puback_2));
+    ESP8266_MQTT_TEST_CHECK_EQ(s_completed[1], 1);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetInflightCount(), 4);
+}
+
+static void test_retransmit(void)
+{
+    //NO PUBACK : SENT AGAIN WITH DUP EVERY REPLY TIMEOUT, GIVEN UP (FALSE)
+    //AFTER ESP8266_MQTT_RETRY_COUNT RETRANSMISSIONS
+
+    esp8266_mqtt_stats_t stats;
+    uint8_t sent[64];
+    uint32_t len;
+    uint8_t i;
+
+    s_reset();
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", "m", ESP8266_MQTT_QOS_1, s_complete_cb, NULL));
+    ESP8266_MQTT_TEST_Take(&s_conn, NULL, 0);
+    for(i = 0; i < ESP8266_MQTT_RETRY_COUNT; i++)
+    {
+        ESP8266_HOST_Run(ESP8266_MQTT_CLIENT_REPLY_TIMEOUT_MS + ESP8266_MQTT_CLIENT_INFLIGHT_CHECK_MS);
+        len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+        ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0x3A, 0x08, 0x00, 0x01, 't', 0x00, 0x01, 0x00, 0x01, 'm');
+    }
+    ESP8266_MQTT_TEST_CHECK_EQ(s_completed[0], 0);
+    ESP8266_HOST_Run(ESP8266_MQTT_CLIENT_REPLY_TIMEOUT_MS + ESP8266_MQTT_CLIENT_INFLIGHT_CHECK_MS);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_TEST_Take(&s_conn, NULL, 0), 0);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_completed[0], 1);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetInflightCount(), 0);
+
+    ESP8266_MQTT_CLIENT_GetStats(&stats);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.retransmits, ESP8266_MQTT_RETRY_COUNT);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.timeouts, 1);
+}
+
+static void test_qos2_outbound(void)
+{
+    //PUBLISH -> PUBREC -> PUBREL -> PUBCOMP. ONCE PUBREC IS IN ONLY THE
+    //PUBREL IS RETRANSMITTED (NEVER THE PUBLISH)
+
+    const uint8_t pubrec[] = {0x50, 0x02, 0x00, 0x01};
+    const uint8_t pubcomp[] = {0x70, 0x02, 0x00, 0x01};
+    uint8_t sent[64];
+    uint32_t len;
+
+    s_reset();
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", "m", ESP8266_MQTT_QOS_2, s_complete_cb, NULL));
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0x34, 0x08, 0x00, 0x01, 't', 0x00, 0x01, 0x00, 0x01, 'm');
+
+    ESP8266_MQTT_TEST_Inject(&s_conn, pubrec, sizeof(pubrec));
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0x62, 0x02, 0x00, 0x01);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_completed[1], 0);
+
+    ESP8266_HOST_Run(ESP8266_MQTT_CLIENT_REPLY_TIMEOUT_MS + ESP8266_MQTT_CLIENT_INFLIGHT_CHECK_MS);
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0x62, 0x02, 0x00, 0x01);
+
+    ESP8266_MQTT_TEST_Inject(&s_conn, pubcomp, sizeof(pubcomp));
+    ESP8266_MQTT_TEST_CHECK_EQ(s_completed[1], 1);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetInflightCount(), 0);
+}
+
+static void test_subscribe_dispatch(void)
+{
+    //EVERY MATCHING FILTER GETS THE MESSAGE ('+' ONE LEVEL, '#' THE REST).
+    //INBOUND QOS 1 IS PUBACKED. A RETRANSMITTED QOS 2 PUBLISH IS HANDED OVER
+    //ONCE (PUBREC AGAIN), PUBREL GETS PUBCOMP
+
+    const uint8_t suback[] = {0x90, 0x04, 0x00, 0x01, 0x00, 0x01};
+    const uint8_t publish_a[] = {0x30, 0x06, 0x00, 0x03, 's', '/', 'a', '1'};
+    const uint8_t publish_ab[] = {0x30, 0x08, 0x00, 0x05, 's', '/', 'a', '/', 'b', '2'};
+    const uint8_t publish_q1[] = {0x32, 0x06, 0x00, 0x01, 'x', 0x00, 0x07, '3'};
+    const uint8_t publish_q2[] = {0x34, 0x06, 0x00, 0x01, 'x', 0x00, 0x08, '4'};
+    const uint8_t pubrel[] = {0x62, 0x02, 0x00, 0x08};
+    uint8_t sent[64];
+    uint32_t len;
+
+    s_reset();
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Subscribe("s/+", ESP8266_MQTT_QOS_0, s_handler, (void*)0));
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Subscribe("s/#", ESP8266_MQTT_QOS_0, s_handler, (void*)1));
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Subscribe("x", ESP8266_MQTT_QOS_2, s_handler, (void*)2));
+    ESP8266_MQTT_TEST_Take(&s_conn, NULL, 0);
+    ESP8266_MQTT_TEST_Inject(&s_conn, suback, sizeof(suback));
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_TEST_log.count[ESP8266_MQTT_CONTROL_PACKET_TYPE_SUBACK], 1);
+
+    ESP8266_MQTT_TEST_Inject(&s_conn, publish_a, sizeof(publish_a));
+    ESP8266_MQTT_TEST_CHECK_EQ(s_handled[0], 1);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_handled[1], 1);
+    ESP8266_MQTT_TEST_CHECK(strcmp(s_last_payload, "1") == 0);
+    ESP8266_MQTT_TEST_Inject(&s_conn, publish_ab, sizeof(publish_ab));
+    ESP8266_MQTT_TEST_CHECK_EQ(s_handled[0], 1);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_handled[1], 2);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_TEST_Take(&s_conn, NULL, 0), 0);
+
+    ESP8266_MQTT_TEST_Inject(&s_conn, publish_q1, sizeof(publish_q1));
+    ESP8266_MQTT_TEST_CHECK_EQ(s_handled[2], 1);
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0x40, 0x02, 0x00, 0x07);
+
+    ESP8266_MQTT_TEST_Inject(&s_conn, publish_q2, sizeof(publish_q2));
+    ESP8266_MQTT_TEST_Inject(&s_conn, publish_q2, sizeof(publish_q2));
+    ESP8266_MQTT_TEST_CHECK_EQ(s_handled[2], 2);
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0x50, 0x02, 0x00, 0x08, 0x50, 0x02, 0x00, 0x08);
+    ESP8266_MQTT_TEST_Inject(&s_conn, pubrel, sizeof(pubrel));
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0x70, 0x02, 0x00, 0x08);
+
+    //ONCE RELEASED THE SAME ID IS A NEW MESSAGE
+    ESP8266_MQTT_TEST_Inject(&s_conn, publish_q2, sizeof(publish_q2));
+    ESP8266_MQTT_TEST_CHECK_EQ(s_handled[2], 3);
+
+    //UNSUBSCRIBED FILTERS GET NOTHING
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Unsubscribe("s/#"));
+    ESP8266_MQTT_TEST_Inject(&s_conn, publish_a, sizeof(publish_a));
+    ESP8266_MQTT_TEST_CHECK_EQ(s_handled[0], 2);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_handled[1], 2);
+}
+
+int main(void)
+{
+    ESP8266_MQTT_TEST_RUN(test_window);
+    ESP8266_MQTT_TEST_RUN(test_retransmit);
+    ESP8266_MQTT_TEST_RUN(test_qos2_outbound);
+    ESP8266_MQTT_TEST_RUN(test_subscribe_dispatch);
+    return ESP8266_MQTT_TEST_End();
+}
@@ -0,0 +1,155 @@
+/**********************************************************************************
+* ESP8266 MQTT TEST : SEND QUEUE
+*
+* NOTE
+* -----
+*   (1) PRIORITY ORDER (CALL ORDER WITHIN A PRIORITY), DEADLINES, QUEUE FULL
+*       (LOWER PRIORITY PUSHED OUT OR THE NEW PUBLISH REFUSED) AND LAST VALUE
+*       WINS CONFLATION PER TOPIC
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_MQTT_TEST.h"
+
+static esp8266_mqtt_test_conn_t s_conn;
+static uint32_t s_completed[2];		//[0] FAILED, [1] DELIVERED
+
+static void s_complete_cb(void* arg, bool success)
+{
+    s_completed[success ? 1 : 0]++;
+}
+
+static void s_reset(void)
+{
+    //QUEUE FILLED WHILE DISCONNECTED, NOTHING LEAVES BEFORE CONNACK
+
+    memset(s_completed, 0, sizeof(s_completed));
+    ESP8266_MQTT_TEST_Open(&s_conn, ESP8266_MQTT_TEST_BUFFER_SIZE);
+}
+
+static void s_connect(void)
+{
+    //TCP CONNECT + CONNECT -> CONNACK. ONLY THE CONNECT BYTES ARE DROPPED
+
+    const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+
+    ESP8266_MQTT_CLIENT_TcpConnect();
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_CLIENT_Send_Connect();
+    ESP8266_MQTT_TEST_Take(&s_conn, NULL, 0);
+    ESP8266_MQTT_TEST_Inject(&s_conn, connack, sizeof(connack));
+}
+
+static void test_priority_and_deadline(void)
+{
+    //URGENT, THEN NORMAL (IN CALL ORDER), THEN LOW. A PUBLISH STILL QUEUED
+    //PAST ITS DEADLINE IS DROPPED UNSENT
+
+    esp8266_mqtt_stats_t stats;
+    uint8_t sent[128];
+    uint32_t len;
+
+    s_reset();
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishQueued("a", "1", ESP8266_MQTT_QOS_0, ESP8266_MQTT_PRIORITY_LOW, 0, s_complete_cb, NULL));
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishQueued("b", "2", ESP8266_MQTT_QOS_0, ESP8266_MQTT_PRIORITY_NORMAL, 0, s_complete_cb, NULL));
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishQueued("c", "3", ESP8266_MQTT_QOS_0, ESP8266_MQTT_PRIORITY_NORMAL, 0, s_complete_cb, NULL));
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishQueued("d", "4", ESP8266_MQTT_QOS_0, ESP8266_MQTT_PRIORITY_URGENT, 0, s_complete_cb, NULL));
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishQueued("e", "5", ESP8266_MQTT_QOS_0, ESP8266_MQTT_PRIORITY_URGENT, 100, s_complete_cb, NULL));
+    ESP8266_MQTT_TEST_CHECK(!ESP8266_MQTT_CLIENT_Send_PublishQueued("f", "6", ESP8266_MQTT_QOS_0, ESP8266_MQTT_PRIORITY_COUNT, 0, s_complete_cb, NULL));
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetSendQueueDepth(), 5);
+
+    ESP8266_HOST_Run(100);
+    s_connect();
+    ESP8266_MQTT_TEST_CHECK_EQ(s_completed[0], 1);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_completed[1], 4);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetSendQueueDepth(), 0);
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len,
+                                    0x30, 0x06, 0x00, 0x01, 'd', 0x00, 0x01, '4',
+                                    0x30, 0x06, 0x00, 0x01, 'b', 0x00, 0x01, '2',
+                                    0x30, 0x06, 0x00, 0x01, 'c', 0x00, 0x01, '3',
+                                    0x30, 0x06, 0x00, 0x01, 'a', 0x00, 0x01, '1');
+
+    ESP8266_MQTT_CLIENT_GetStats(&stats);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.queue_expired, 1);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.queue_sent, 4);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.queue_peak, 5);
+}
+
+static void test_queue_full(void)
+{
+    //FULL OF LOW : A HIGH PUBLISH PUSHES OUT THE OLDEST LOW ONE, ANOTHER LOW
+    //ONE IS REFUSED
+
+    esp8266_mqtt_stats_t stats;
+    uint8_t sent[256];
+    uint32_t len;
+    uint8_t i;
+
+    s_reset();
+    for(i = 0; i < ESP8266_MQTT_CLIENT_SEND_QUEUE_MAX; i++)
+    {
+        ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishQueued(i == 0 ? "old" : "t", "m", ESP8266_MQTT_QOS_0, ESP8266_MQTT_PRIORITY_LOW, 0, s_complete_cb, NULL));
+    }
+    ESP8266_MQTT_TEST_CHECK(!ESP8266_MQTT_CLIENT_Send_PublishQueued("t", "m", ESP8266_MQTT_QOS_0, ESP8266_MQTT_PRIORITY_LOW, 0, s_complete_cb, NULL));
+    ESP8266_MQTT_TEST_CHECK_EQ(s_completed[0], 0);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishQueued("h", "m", ESP8266_MQTT_QOS_0, ESP8266_MQTT_PRIORITY_HIGH, 0, s_complete_cb, NULL));
+    ESP8266_MQTT_TEST_CHECK_EQ(s_completed[0], 1);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetSendQueueDepth(), ESP8266_MQTT_CLIENT_SEND_QUEUE_MAX);
+
+    ESP8266_MQTT_CLIENT_GetStats(&stats);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.queue_dropped, 2);
+
+    //THE HIGH ONE GOES FIRST, "old" NEVER
+    s_connect();
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_EQ(len, 8 * ESP8266_MQTT_CLIENT_SEND_QUEUE_MAX);
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, 8, 0x30, 0x06, 0x00, 0x01, 'h', 0x00, 0x01, 'm');
+    ESP8266_MQTT_TEST_CHECK_EQ(s_completed[1], ESP8266_MQTT_CLIENT_SEND_QUEUE_MAX);
+}
+
+static void test_conflation(void)
+{
+    //A NEWER VALUE FOR A QUEUED TOPIC REPLACES IT IN PLACE (OLD ONE FAILS).
+    //PRIORITY IS NEVER LOWERED. OFF : BOTH ARE KEPT
+
+    esp8266_mqtt_stats_t stats;
+    uint8_t sent[64];
+    uint32_t len;
+
+    s_reset();
+    ESP8266_MQTT_CLIENT_SetConflation(true);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishQueued("s", "1", ESP8266_MQTT_QOS_0, ESP8266_MQTT_PRIORITY_HIGH, 0, s_complete_cb, NULL));
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishQueued("x", "9", ESP8266_MQTT_QOS_0, ESP8266_MQTT_PRIORITY_NORMAL, 0, s_complete_cb, NULL));
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishQueued("s", "2", ESP8266_MQTT_QOS_0, ESP8266_MQTT_PRIORITY_LOW, 0, s_complete_cb, NULL));
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishQueued("s", "3", ESP8266_MQTT_QOS_0, ESP8266_MQTT_PRIORITY_LOW, 0, s_complete_cb, NULL));
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetSendQueueDepth(), 2);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_completed[0], 2);
+
+    s_connect();
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len,
+                                    0x30, 0x06, 0x00, 0x01, 's', 0x00, 0x01, '3',
+                                    0x30, 0x06, 0x00, 0x01, 'x', 0x00, 0x01, '9');
+    ESP8266_MQTT_CLIENT_GetStats(&stats);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.queue_conflated, 2);
+
+    ESP8266_MQTT_CLIENT_TcpDisonnect();
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_CLIENT_SetConflation(false);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishQueued("s", "1", ESP8266_MQTT_QOS_0, ESP8266_MQTT_PRIORITY_LOW, 0, s_complete_cb, NULL));
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishQueued("s", "2", ESP8266_MQTT_QOS_0, ESP8266_MQTT_PRIORITY_LOW, 0, s_complete_cb, NULL));
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetSendQueueDepth(), 2);
+}
+
+int main(void)
+{
+    ESP8266_MQTT_TEST_RUN(test_priority_and_deadline);
+    ESP8266_MQTT_TEST_RUN(test_queue_full);
+    ESP8266_MQTT_TEST_RUN(test_conflation);
+    return ESP8266_MQTT_TEST_End();
+}
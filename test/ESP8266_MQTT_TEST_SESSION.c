@@ -0,0 +1,255 @@
+/**********************************************************************************
+* ESP8266 MQTT TEST : PERSISTENT SESSION
+*
+* NOTE
+* -----
+*   (1) KEEPALIVE PINGREQ SCHEDULING, PINGRESP TIMEOUT -> RECONNECT, RECONNECT
+*       BACKOFF (DOUBLING, CAPPED, 50 - 100% JITTER, HOST NAME RESOLVED AGAIN
+*       EVERY ESP8266_MQTT_CLIENT_RECONNECT_RESOLVE_AFTER ATTEMPTS) AND CONNACK
+*       REFUSALS. ALL ON VIRTUAL TIME (ESP8266_HOST_Run)
+*
+*   (2) A FULL IN-FLIGHT WINDOW RETRANSMITTED ON A RESUMED SESSION DOES NOT FIT
+*       THE 1024 BYTE TX BUFFER AT ONCE. THE REST FOLLOWS FROM THE TCP SENT CBS
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_MQTT_TEST.h"
+
+#define ESP8266_MQTT_TEST_KEEPALIVE_S		(10)
+#define ESP8266_MQTT_TEST_BACKOFF_MIN_MS	(100)
+#define ESP8266_MQTT_TEST_BACKOFF_MAX_MS	(800)
+#define ESP8266_MQTT_TEST_RESEND_WINDOW		(8)
+#define ESP8266_MQTT_TEST_RESEND_MESSAGE	(200)
+
+static esp8266_mqtt_test_conn_t s_conn;
+static uint32_t s_completed[2];		//[0] FAILED, [1] DELIVERED
+
+static void s_complete_cb(void* arg, bool success)
+{
+    s_completed[success ? 1 : 0]++;
+}
+
+static void s_open(void)
+{
+    //PERSISTENT SESSION, KEEPALIVE 10 S
+
+    ESP8266_MQTT_TEST_Open(&s_conn, ESP8266_MQTT_TEST_BUFFER_SIZE);
+    ESP8266_MQTT_CLIENT_SetOptions(0, 0, 0, false, NULL, false, NULL, true, ESP8266_MQTT_TEST_KEEPALIVE_S, false, NULL, NULL, 0, "dev");
+    ESP8266_MQTT_CLIENT_SetPersistentSession(true);
+    ESP8266_MQTT_CLIENT_SetReconnectBackoff(ESP8266_MQTT_TEST_BACKOFF_MIN_MS, ESP8266_MQTT_TEST_BACKOFF_MAX_MS);
+}
+
+static bool s_connect(void)
+{
+    //DNS -> TCP -> CONNECT (SENT BY THE LIBRARY) -> CONNACK
+
+    const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+    uint8_t sent[64];
+    uint32_t len;
+
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Connect());
+    ESP8266_HOST_Poll();
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_Inject(&s_conn, connack, sizeof(connack));
+    return (len > 0 && sent[0] == 0x10 && ESP8266_MQTT_CLIENT_IsConnected());
+}
+
+static void test_keepalive(void)
+{
+    //PINGREQ ONLY AFTER A FULL KEEPALIVE INTERVAL WITHOUT ANY PACKET SENT. A
+    //PUBLISH PUSHES IT BACK. PINGRESP IN TIME KEEPS THE CONNECTION
+
+    const uint8_t pingresp[] = {0xD0, 0x00};
+    uint8_t sent[64];
+    uint32_t len;
+
+    s_open();
+    ESP8266_MQTT_TEST_CHECK(s_connect());
+
+    ESP8266_HOST_Run(ESP8266_MQTT_TEST_KEEPALIVE_S * 1000 - 1000);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_TEST_Take(&s_conn, NULL, 0), 0);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", "m", ESP8266_MQTT_QOS_0, NULL, NULL));
+    ESP8266_MQTT_TEST_Take(&s_conn, NULL, 0);
+
+    ESP8266_HOST_Run(ESP8266_MQTT_TEST_KEEPALIVE_S * 1000 - 1000);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_TEST_Take(&s_conn, NULL, 0), 0);
+    ESP8266_HOST_Run(1000);
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0xC0, 0x00);
+
+    ESP8266_MQTT_TEST_Inject(&s_conn, pingresp, sizeof(pingresp));
+    ESP8266_HOST_Run(ESP8266_MQTT_CLIENT_REPLY_TIMEOUT_MS);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_IsConnected());
+    ESP8266_MQTT_TEST_CHECK_EQ(s_conn.transport.stats.disconnects, 0);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_TEST_log.count[ESP8266_MQTT_CONTROL_PACKET_TYPE_PINGRESP], 1);
+}
+
+static void test_pingresp_timeout(void)
+{
+    //NO PINGRESP : CONNECTION TORN DOWN, RECONNECTED WITHIN THE FIRST BACKOFF
+    //DELAY AND THE CONNECT SENT AGAIN BY THE LIBRARY
+
+    esp8266_mqtt_stats_t stats;
+    uint8_t sent[64];
+    uint32_t len;
+
+    s_open();
+    ESP8266_MQTT_TEST_CHECK(s_connect());
+    ESP8266_HOST_Run(ESP8266_MQTT_TEST_KEEPALIVE_S * 1000);
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0xC0, 0x00);
+
+    ESP8266_HOST_Run(ESP8266_MQTT_CLIENT_REPLY_TIMEOUT_MS);
+    ESP8266_MQTT_TEST_CHECK(!ESP8266_MQTT_CLIENT_IsConnected());
+    ESP8266_MQTT_TEST_CHECK_EQ(s_conn.transport.stats.disconnects, 1);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_conn.transport.stats.connects, 1);
+
+    ESP8266_HOST_Run(ESP8266_MQTT_TEST_BACKOFF_MIN_MS);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_conn.transport.stats.connects, 2);
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK(len > 0 && sent[0] == 0x10);
+
+    ESP8266_MQTT_CLIENT_GetStats(&stats);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.timeouts, 1);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.reconnects, 1);
+}
+
+static void test_backoff(void)
+{
+    //BROKER UNREACHABLE : ATTEMPT n WAITS 50 - 100% OF MIN << n (CAPPED TO
+    //MAX). EVERY THIRD ATTEMPT STARTS WITH A FRESH DNS RESOLVE
+
+    uint32_t last_ms = 0;
+    uint32_t connects = 0;
+    uint32_t base_ms;
+    uint32_t gap_ms;
+    uint32_t now_ms;
+    uint8_t attempt = 0;
+
+    s_open();
+    s_conn.transport.connect_ok = false;
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Connect());
+    for(now_ms = 0; now_ms < 6000; now_ms++)
+    {
+        ESP8266_HOST_Run(1);
+        if(s_conn.transport.stats.connects == connects)
+        {
+            continue;
+        }
+        connects = s_conn.transport.stats.connects;
+        if(connects > 1)
+        {
+            base_ms = ESP8266_MQTT_TEST_BACKOFF_MIN_MS << attempt;
+            base_ms = (base_ms > ESP8266_MQTT_TEST_BACKOFF_MAX_MS) ? ESP8266_MQTT_TEST_BACKOFF_MAX_MS : base_ms;
+            gap_ms = now_ms - last_ms;
+            ESP8266_MQTT_TEST_CHECK(gap_ms >= base_ms / 2 && gap_ms <= base_ms + 1);
+            attempt++;
+        }
+        last_ms = now_ms;
+    }
+    ESP8266_MQTT_TEST_CHECK(attempt >= 6);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_conn.transport.stats.resolves, 1 + attempt / ESP8266_MQTT_CLIENT_RECONNECT_RESOLVE_AFTER);
+
+    //BROKER BACK : CONNECTED, NEXT FAILURE STARTS AGAIN FROM THE MINIMUM
+    s_conn.transport.connect_ok = true;
+    ESP8266_HOST_Run(ESP8266_MQTT_TEST_BACKOFF_MAX_MS);
+    ESP8266_MQTT_TEST_CHECK(s_conn.transport.connected);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_conn.client.reconnect_attempt, attempt + 1);
+}
+
+static void test_connack_refused(void)
+{
+    //SERVER UNAVAILABLE IS RETRIED. NOT AUTHORIZED ENDS THE SESSION
+
+    const uint8_t unavailable[] = {0x20, 0x02, 0x00, ESP8266_MQTT_CONNACK_REFUSED_SERVER_UNAVAILABLE};
+    const uint8_t not_authorized[] = {0x20, 0x02, 0x00, ESP8266_MQTT_CONTROL_CONNACK_REFUSED_NOT_AUTHORIZED};
+
+    s_open();
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Connect());
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_TEST_Inject(&s_conn, unavailable, sizeof(unavailable));
+    ESP8266_MQTT_TEST_CHECK(!ESP8266_MQTT_CLIENT_IsConnected());
+    ESP8266_HOST_Run(ESP8266_MQTT_TEST_BACKOFF_MIN_MS);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_conn.transport.stats.connects, 2);
+
+    ESP8266_MQTT_TEST_Inject(&s_conn, not_authorized, sizeof(not_authorized));
+    ESP8266_HOST_Run(ESP8266_MQTT_CLIENT_RECONNECT_DELAY_MAX_MS);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_conn.transport.stats.connects, 2);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_TEST_log.count[ESP8266_MQTT_CONTROL_PACKET_TYPE_CONNACK], 2);
+}
+
+static void test_retransmit_busy_buffer(void)
+{
+    //8 X 200 BYTE QOS 1 IN FLIGHT, CONNECTION LOST. ON THE RESUMED SESSION
+    //ONLY 4 RETRANSMISSIONS FIT THE TX BUFFER. THE OTHERS WAIT FOR ROOM AND GO
+    //OUT IN ORDER (NOT FAILED, NOT COUNTED AS RETRIES)
+
+    const uint8_t connack_session[] = {0x20, 0x02, 0x01, 0x00};
+    uint8_t puback[] = {0x40, 0x02, 0x00, 0x00};
+    static uint8_t sent[4096];
+    char message[ESP8266_MQTT_TEST_RESEND_MESSAGE + 1];
+    esp8266_mqtt_stats_t stats;
+    uint32_t len;
+    uint32_t pos = 0;
+    uint16_t packet_id;
+    uint8_t received = 0;
+    uint8_t i;
+
+    memset(s_completed, 0, sizeof(s_completed));
+    s_open();
+    ESP8266_MQTT_CLIENT_SetInflightWindow(ESP8266_MQTT_TEST_RESEND_WINDOW);
+    ESP8266_MQTT_TEST_CHECK(s_connect());
+    memset(message, 'm', ESP8266_MQTT_TEST_RESEND_MESSAGE);
+    message[ESP8266_MQTT_TEST_RESEND_MESSAGE] = '\0';
+    for(i = 0; i < ESP8266_MQTT_TEST_RESEND_WINDOW; i++)
+    {
+        ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", message, ESP8266_MQTT_QOS_1, s_complete_cb, NULL));
+        ESP8266_HOST_Poll();
+    }
+    ESP8266_MQTT_TEST_Take(&s_conn, NULL, 0);
+
+    ESP8266_HOST_TRANSPORT_Drop(&s_conn.transport);
+    ESP8266_HOST_Poll();
+    ESP8266_HOST_Run(ESP8266_MQTT_TEST_BACKOFF_MIN_MS);
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK(len > 0 && sent[0] == 0x10);
+    ESP8266_MQTT_TEST_Inject(&s_conn, connack_session, sizeof(connack_session));
+    ESP8266_HOST_Poll();
+
+    //PUBLISH (DUP) : 0x3A, REMAINING LENGTH 2 BYTES, "t", ID, PAYLOAD
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    while(pos + 8 <= len && sent[pos] == 0x3A)
+    {
+        received++;
+        packet_id = ((uint16_t)sent[pos + 6] << 8) | sent[pos + 7];
+        ESP8266_MQTT_TEST_CHECK_EQ(packet_id, received);
+        pos += 3 + (sent[pos + 1] & 0x7F) + ((uint32_t)sent[pos + 2] << 7);
+    }
+    ESP8266_MQTT_TEST_CHECK_EQ(pos, len);
+    ESP8266_MQTT_TEST_CHECK_EQ(received, ESP8266_MQTT_TEST_RESEND_WINDOW);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_completed[0], 0);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetInflightCount(), ESP8266_MQTT_TEST_RESEND_WINDOW);
+
+    for(i = 1; i <= ESP8266_MQTT_TEST_RESEND_WINDOW; i++)
+    {
+        puback[3] = i;
+        ESP8266_MQTT_TEST_Inject(&s_conn, puback, sizeof(puback));
+    }
+    ESP8266_MQTT_TEST_CHECK_EQ(s_completed[1], ESP8266_MQTT_TEST_RESEND_WINDOW);
+    ESP8266_MQTT_CLIENT_GetStats(&stats);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.retransmits, 0);
+}
+
+int main(void)
+{
+    ESP8266_MQTT_TEST_RUN(test_keepalive);
+    ESP8266_MQTT_TEST_RUN(test_pingresp_timeout);
+    ESP8266_MQTT_TEST_RUN(test_backoff);
+    ESP8266_MQTT_TEST_RUN(test_connack_refused);
+    ESP8266_MQTT_TEST_RUN(test_retransmit_busy_buffer);
+    return ESP8266_MQTT_TEST_End();
+}
@@ -0,0 +1,168 @@
+/**********************************************************************************
+* ESP8266 MQTT TEST : DEEP SLEEP SUSPEND / RESUME
+*
+* NOTE
+* -----
+*   (1) A FORKED CHILD FILLS THE IN-FLIGHT WINDOW, SUSPENDS TO A FILE BACKED RTC
+*       MEMORY AND DIES (DEEP SLEEP). THE PARENT WAKES UP LIKE A FRESH BOOT :
+*       NEW INSTANCE, RESUME, OPTIONS, CONNECT
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include <unistd.h>
+#include <sys/wait.h>
+#include "ESP8266_MQTT_TEST.h"
+
+#define ESP8266_MQTT_TEST_RTC_FILE			"ESP8266_MQTT_TEST_SUSPEND.rtc"
+#define ESP8266_MQTT_TEST_SUSPEND_ACKED		(8)		//ACKED BEFORE SLEEP (IDS 1 - 8)
+#define ESP8266_MQTT_TEST_SUSPEND_QOS2		(2)		//LAST IDS SENT AS QOS 2
+
+static esp8266_mqtt_test_conn_t s_conn;
+
+static void s_options(void)
+{
+    //PERSISTENT SESSION (PENDING IDS MEAN SOMETHING TO THE BROKER)
+
+    ESP8266_MQTT_CLIENT_SetOptions(0, 0, 0, false, NULL, false, NULL, false, 60, false, NULL, NULL, 0, "dev");
+}
+
+static void s_sleep_child(void)
+{
+    //FULL WINDOW IN FLIGHT (IDS 9 - 40, THE LAST ONES QOS 2, COUNTER AHEAD OF
+    //THE FIRST PENDING ID) THEN SUSPEND AND DIE. EXIT 0 IF ALL WENT AS PLANNED
+
+    uint8_t puback[] = {0x40, 0x02, 0x00, 0x00};
+    uint16_t i;
+    bool ok = true;
+
+    ESP8266_MQTT_TEST_Open(&s_conn, 4096);
+    s_options();
+    ESP8266_MQTT_CLIENT_SetInflightWindow(ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX);
+    ESP8266_MQTT_CLIENT_ResolveHostName();
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_TEST_Connect(&s_conn);
+    for(i = 0; i < ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX; i++)
+    {
+        ok = ok && ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", "m", ESP8266_MQTT_QOS_1, NULL, NULL);
+    }
+    for(i = 1; i <= ESP8266_MQTT_TEST_SUSPEND_ACKED; i++)
+    {
+        puback[3] = (uint8_t)i;
+        ESP8266_MQTT_TEST_Inject(&s_conn, puback, sizeof(puback));
+    }
+    for(i = 0; i < ESP8266_MQTT_TEST_SUSPEND_ACKED; i++)
+    {
+        ok = ok && ESP8266_MQTT_CLIENT_Send_PublishWithCb("t",
+                                                            "m",
+                                                            (i < ESP8266_MQTT_TEST_SUSPEND_ACKED - ESP8266_MQTT_TEST_SUSPEND_QOS2) ?
+                                                                ESP8266_MQTT_QOS_1 : ESP8266_MQTT_QOS_2,
+                                                            NULL,
+                                                            NULL);
+    }
+    ESP8266_MQTT_TEST_Take(&s_conn, NULL, 0);
+    ok = ok && (ESP8266_MQTT_CLIENT_GetInflightCount() == ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX);
+    ok = ok && ESP8266_MQTT_CLIENT_Suspend(ESP8266_MQTT_RTC_BLOCK_SUSPEND);
+    _exit(ok ? 0 : 1);
+}
+
+static bool s_contains(const uint8_t* data, uint32_t len, const uint8_t* packet, uint32_t packet_len)
+{
+    uint32_t i;
+
+    for(i = 0; i + packet_len <= len; i++)
+    {
+        if(memcmp(&data[i], packet, packet_len) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void test_full_window_survives_deep_sleep(void)
+{
+    //ALL 32 PENDING IDS COME BACK, THE PACKET ID COUNTER SURVIVES OPTIONS SET
+    //AFTER THE RESUME, QOS 2 IDS ARE RELEASED WITH PUBREL -> PUBCOMP
+
+    const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+    const uint8_t pubrel_39[] = {0x62, 0x02, 0x00, 39};
+    const uint8_t pubrel_40[] = {0x62, 0x02, 0x00, 40};
+    const uint8_t pubcomp_39[] = {0x70, 0x02, 0x00, 39};
+    const uint8_t pubcomp_40[] = {0x70, 0x02, 0x00, 40};
+    uint8_t sent[256];
+    uint32_t len;
+    uint32_t qos2 = 0;
+    uint8_t i;
+    int status;
+    pid_t pid;
+
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_SUSPEND_PENDING_MAX, ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_SUSPEND_RTC_BLOCKS, 55);
+
+    unlink(ESP8266_MQTT_TEST_RTC_FILE);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_HOST_RtcOpen(ESP8266_MQTT_TEST_RTC_FILE));
+    fflush(stdout);
+    pid = fork();
+    if(pid == 0)
+    {
+        s_sleep_child();
+    }
+    waitpid(pid, &status, 0);
+    ESP8266_MQTT_TEST_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    //WAKE UP
+    ESP8266_HOST_Reset();
+    ESP8266_MQTT_TEST_CHECK(ESP8266_HOST_RtcOpen(ESP8266_MQTT_TEST_RTC_FILE));
+    ESP8266_HOST_TRANSPORT_Init(&s_conn.transport);
+    ESP8266_MQTT_CLIENT_InitInstance(&s_conn.client);
+    ESP8266_MQTT_CLIENT_Select(&s_conn.client);
+    ESP8266_MQTT_CLIENT_SetTransport(&ESP8266_HOST_TRANSPORT, &s_conn.transport);
+    ESP8266_MQTT_CLIENT_Initialize("broker.test", "127.0.0.1", 1883, 4096);
+    ESP8266_MQTT_TEST_SetCallbacks();
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Resume(ESP8266_MQTT_RTC_BLOCK_SUSPEND));
+    ESP8266_MQTT_TEST_CHECK_EQ(s_conn.client.resume_count, ESP8266_MQTT_CLIENT_INFLIGHT_WINDOW_MAX);
+    for(i = 0; i < s_conn.client.resume_count; i++)
+    {
+        qos2 += (s_conn.client.resume_qos2 & (1UL << i)) ? 1 : 0;
+        ESP8266_MQTT_TEST_CHECK_EQ((s_conn.client.resume_qos2 >> i) & 1, s_conn.client.resume_ids[i] >= 39);
+        ESP8266_MQTT_TEST_CHECK(s_conn.client.resume_ids[i] > ESP8266_MQTT_TEST_SUSPEND_ACKED &&
+                                s_conn.client.resume_ids[i] <= 40);
+    }
+    ESP8266_MQTT_TEST_CHECK_EQ(qos2, ESP8266_MQTT_TEST_SUSPEND_QOS2);
+    s_options();
+
+    //NEW MESSAGE : NEXT ID AFTER THE COUNTER (41), NOT A FREE LOW ONE
+    ESP8266_MQTT_CLIENT_TcpConnect();
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_CLIENT_Send_Connect();
+    ESP8266_MQTT_TEST_Take(&s_conn, NULL, 0);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", "n", ESP8266_MQTT_QOS_1, NULL, NULL));
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK(len > 6 && sent[0] == 0x32);
+    ESP8266_MQTT_TEST_CHECK_EQ((sent[5] << 8) | sent[6], 41);
+
+    //CONNACK RELEASES THE QOS 1 IDS AND SENDS PUBREL FOR THE QOS 2 ONES
+    ESP8266_MQTT_TEST_Inject(&s_conn, connack, sizeof(connack));
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK(s_contains(sent, len, pubrel_39, sizeof(pubrel_39)));
+    ESP8266_MQTT_TEST_CHECK(s_contains(sent, len, pubrel_40, sizeof(pubrel_40)));
+    ESP8266_MQTT_TEST_CHECK_EQ(s_conn.client.resume_count, ESP8266_MQTT_TEST_SUSPEND_QOS2);
+    ESP8266_MQTT_TEST_Inject(&s_conn, pubcomp_39, sizeof(pubcomp_39));
+    ESP8266_MQTT_TEST_Inject(&s_conn, pubcomp_40, sizeof(pubcomp_40));
+    ESP8266_MQTT_TEST_CHECK_EQ(s_conn.client.resume_count, 0);
+
+    //THE RECORD IS USED ONCE
+    ESP8266_MQTT_TEST_CHECK(!ESP8266_MQTT_CLIENT_Resume(ESP8266_MQTT_RTC_BLOCK_SUSPEND));
+    ESP8266_HOST_RtcOpen(NULL);
+    unlink(ESP8266_MQTT_TEST_RTC_FILE);
+}
+
+int main(void)
+{
+    ESP8266_MQTT_TEST_RUN(test_full_window_survives_deep_sleep);
+    return ESP8266_MQTT_TEST_End();
+}
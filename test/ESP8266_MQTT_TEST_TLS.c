@@ -0,0 +1,160 @@
+/**********************************************************************************
+* ESP8266 MQTT TEST : TLS TRANSPORT SESSION CACHE
+*
+* NOTE
+* -----
+*   (1) RUNS ESP8266_MQTT_TLS OVER THE OPENSSL ESPCONN STAND-IN (ONLY BUILT WITH
+*       OPENSSL, SEE CMakeLists.txt) : FULL VS RESUMED HANDSHAKES, THEIR WIRE
+*       BYTES AND THE SESSION KEPT IN RTC MEMORY ACROSS DEEP SLEEP
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_MQTT_TEST.h"
+#include "ESP8266_HOST_ESPCONN.h"
+
+static esp8266_mqtt_client_t s_client;
+static esp8266_mqtt_tls_t s_tls;
+
+static void s_open(uint8_t rtc_block, bool hooks)
+{
+    //CLIENT INSTANCE ON A FRESH TLS CONTEXT WITH THE SESSION CACHE ON
+
+    ESP8266_MQTT_TLS_Initialize(&s_tls);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_TLS_SetSessionCache(&s_tls, true, 0, rtc_block));
+    if(hooks)
+    {
+        ESP8266_MQTT_TLS_SetSessionHooks(&s_tls, &ESP8266_HOST_ESPCONN_SESSION_HOOKS, NULL);
+    }
+    ESP8266_MQTT_CLIENT_InitInstance(&s_client);
+    ESP8266_MQTT_CLIENT_Select(&s_client);
+    ESP8266_MQTT_CLIENT_SetTransport(ESP8266_MQTT_TLS_GetTransport(), &s_tls);
+    ESP8266_MQTT_CLIENT_Initialize("broker.test", "127.0.0.1", 8883, ESP8266_MQTT_TEST_BUFFER_SIZE);
+    ESP8266_MQTT_CLIENT_SetOptions(0, 0, 0, false, NULL, false, NULL, true, 60, false, NULL, NULL, 0, "dev");
+    ESP8266_MQTT_TEST_SetCallbacks();
+}
+
+static void s_session(void)
+{
+    //TLS CONNECT, MQTT CONNECT -> CONNACK THROUGH THE PEER, DISCONNECT
+
+    const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+    uint8_t received[64];
+    uint32_t len;
+
+    ESP8266_MQTT_CLIENT_TcpConnect();
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_CLIENT_Send_Connect();
+    ESP8266_HOST_Poll();
+    len = ESP8266_HOST_ESPCONN_PeerTake(received, sizeof(received));
+    ESP8266_MQTT_TEST_CHECK(len > 2 && received[0] == 0x10);
+    ESP8266_HOST_ESPCONN_PeerSend(connack, sizeof(connack));
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_IsConnected());
+    ESP8266_MQTT_CLIENT_TcpDisonnect();
+    ESP8266_HOST_Poll();
+}
+
+static void test_session_resumed(void)
+{
+    //SECOND CONNECT RESUMES THE FIRST SESSION : NO CERTIFICATE / KEY EXCHANGE
+    //ON THE WIRE, SO FAR FEWER HANDSHAKE BYTES
+
+    esp8266_mqtt_tls_stats_t stats;
+    esp8266_host_espconn_stats_t peer;
+    esp8266_host_espconn_stats_t peer_before;
+
+    ESP8266_HOST_ESPCONN_GetStats(&peer_before);
+    s_open(0, true);
+    s_session();
+    s_session();
+    ESP8266_MQTT_TLS_GetStats(&s_tls, &stats);
+    ESP8266_HOST_ESPCONN_GetStats(&peer);
+
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.full.count, 1);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.resumed.count, 1);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.failed, 0);
+    ESP8266_MQTT_TEST_CHECK_EQ(peer.handshakes - peer_before.handshakes, 2);
+    ESP8266_MQTT_TEST_CHECK_EQ(peer.resumed - peer_before.resumed, 1);
+    ESP8266_MQTT_TEST_CHECK(stats.full.bytes_sent > 0 && stats.full.bytes_received > 0);
+    ESP8266_MQTT_TEST_CHECK(stats.resumed.bytes_sent > 0 && stats.resumed.bytes_received > 0);
+    ESP8266_MQTT_TEST_CHECK(stats.resumed.bytes_received < stats.full.bytes_received / 2);
+    ESP8266_MQTT_TEST_CHECK(stats.resumed.bytes_sent < stats.full.bytes_sent);
+
+    //APPLICATION BYTES ARE COUNTED APART (CONNECT TWICE, CONNACK TWICE)
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.bytes_received, 8);
+    ESP8266_MQTT_TEST_CHECK(stats.bytes_sent > 0 && stats.bytes_sent < 64);
+}
+
+static void test_forgotten_session(void)
+{
+    //PEER FORGOT THE SESSION (BROKER RESTART) : THE OFFER IS REFUSED AND A
+    //FULL HANDSHAKE IS DONE (NOT A FAILURE). THE NEW SESSION IS RESUMED NEXT
+
+    esp8266_mqtt_tls_stats_t stats;
+
+    s_open(0, true);
+    s_session();
+    ESP8266_HOST_ESPCONN_PeerForgetSessions();
+    s_session();
+    s_session();
+    ESP8266_MQTT_TLS_GetStats(&s_tls, &stats);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.full.count, 2);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.resumed.count, 1);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.failed, 0);
+}
+
+static void test_session_across_deep_sleep(void)
+{
+    //SESSION SAVED TO RTC MEMORY BEFORE SLEEP, LOADED BY A FRESH CONTEXT (RAM
+    //LOST) AFTER WAKE UP AND RESUMED. PAST ITS LIFETIME IT IS NOT WRITTEN
+
+    esp8266_mqtt_tls_stats_t stats;
+
+    ESP8266_HOST_RtcClear();
+    s_open(ESP8266_MQTT_RTC_BLOCK_TLS_SESSION, true);
+    s_session();
+    ESP8266_MQTT_TLS_SaveSession(&s_tls, 60);
+
+    memset(&s_tls, 0xA5, sizeof(s_tls));
+    s_open(ESP8266_MQTT_RTC_BLOCK_TLS_SESSION, true);
+    s_session();
+    ESP8266_MQTT_TLS_GetStats(&s_tls, &stats);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.full.count, 0);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.resumed.count, 1);
+
+    ESP8266_MQTT_TLS_SaveSession(&s_tls, ESP8266_MQTT_TLS_SESSION_LIFETIME_MAX_S);
+    s_open(ESP8266_MQTT_RTC_BLOCK_TLS_SESSION, true);
+    s_session();
+    ESP8266_MQTT_TLS_GetStats(&s_tls, &stats);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.full.count, 1);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.resumed.count, 0);
+}
+
+static void test_no_hooks(void)
+{
+    //STOCK SDK CASE (NO SESSION HOOKS) : EVERY HANDSHAKE IS FULL, NO WIRE BYTES
+
+    esp8266_mqtt_tls_stats_t stats;
+
+    s_open(0, false);
+    s_session();
+    s_session();
+    ESP8266_MQTT_TLS_GetStats(&s_tls, &stats);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.full.count, 2);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.resumed.count, 0);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.full.bytes_sent, 0);
+    ESP8266_MQTT_TEST_CHECK_EQ(stats.full.bytes_received, 0);
+}
+
+int main(void)
+{
+    ESP8266_MQTT_TEST_RUN(test_session_resumed);
+    ESP8266_MQTT_TEST_RUN(test_forgotten_session);
+    ESP8266_MQTT_TEST_RUN(test_session_across_deep_sleep);
+    ESP8266_MQTT_TEST_RUN(test_no_hooks);
+    return ESP8266_MQTT_TEST_End();
+}
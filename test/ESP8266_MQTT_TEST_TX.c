@@ -0,0 +1,176 @@
+/**********************************************************************************
+* ESP8266 MQTT TEST : TX PATH
+*
+* NOTE
+* -----
+*   (1) PUBLISH COALESCING (ONE TRANSPORT SEND FOR SEVERAL PACKETS), ZERO COPY
+*       PUBLISH (CALLER BUFFER HANDED BACK ONCE SENT / ACKED) AND STREAMED
+*       PUBLISH OF A PAYLOAD LARGER THAN THE CLIENT BUFFER
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_MQTT_TEST.h"
+
+#define ESP8266_MQTT_TEST_STREAM_LEN		(3000)
+
+static esp8266_mqtt_test_conn_t s_conn;
+static uint32_t s_released;
+static uint32_t s_completed[2];		//[0] FAILED, [1] DELIVERED
+static uint32_t s_reads;
+
+static void s_release_cb(void* arg)
+{
+    s_released++;
+}
+
+static void s_complete_cb(void* arg, bool success)
+{
+    s_completed[success ? 1 : 0]++;
+}
+
+static uint16_t s_read_cb(void* arg, uint32_t offset, uint8_t* dest, uint16_t max_len)
+{
+    //PAYLOAD BYTE n IS n & 0xFF
+
+    uint16_t i;
+
+    s_reads++;
+    if(max_len > ESP8266_MQTT_TEST_STREAM_LEN - offset)
+    {
+        max_len = ESP8266_MQTT_TEST_STREAM_LEN - offset;
+    }
+    for(i = 0; i < max_len; i++)
+    {
+        dest[i] = (uint8_t)((offset + i) & 0xFF);
+    }
+    return max_len;
+}
+
+static void s_reset(void)
+{
+    s_released = 0;
+    s_reads = 0;
+    memset(s_completed, 0, sizeof(s_completed));
+    ESP8266_MQTT_TEST_Open(&s_conn, ESP8266_MQTT_TEST_BUFFER_SIZE);
+    ESP8266_MQTT_TEST_Connect(&s_conn);
+}
+
+static void test_coalescing(void)
+{
+    //PUBLISHES WAIT UNTIL THE FLUSH TIMEOUT OR THRESHOLD, THEN GO OUT IN ONE
+    //SEND. OFF AGAIN : EVERY PACKET IS ITS OWN SEND
+
+    uint8_t sent[128];
+    uint32_t sends;
+    uint32_t len;
+    uint8_t i;
+
+    s_reset();
+    ESP8266_MQTT_CLIENT_SetCoalescing(true, 64, 5);
+    sends = s_conn.transport.stats.sends;
+    for(i = 0; i < 3; i++)
+    {
+        ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", "m", ESP8266_MQTT_QOS_0, NULL, NULL));
+    }
+    ESP8266_HOST_Run(4);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_conn.transport.stats.sends, sends);
+    ESP8266_HOST_Run(1);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_conn.transport.stats.sends, sends + 1);
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len,
+                                    0x30, 0x06, 0x00, 0x01, 't', 0x00, 0x01, 'm',
+                                    0x30, 0x06, 0x00, 0x01, 't', 0x00, 0x01, 'm',
+                                    0x30, 0x06, 0x00, 0x01, 't', 0x00, 0x01, 'm');
+
+    //8 BYTE PACKETS : THE 8TH REACHES THE 64 BYTE THRESHOLD
+    for(i = 0; i < 8; i++)
+    {
+        ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", "m", ESP8266_MQTT_QOS_0, NULL, NULL));
+    }
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_TEST_CHECK_EQ(s_conn.transport.stats.sends, sends + 2);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_TEST_Take(&s_conn, NULL, 0), 64);
+
+    ESP8266_MQTT_CLIENT_SetCoalescing(false, 0, 0);
+    for(i = 0; i < 2; i++)
+    {
+        ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", "m", ESP8266_MQTT_QOS_0, NULL, NULL));
+    }
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_TEST_CHECK_EQ(s_conn.transport.stats.sends, sends + 4);
+}
+
+static void test_zero_copy(void)
+{
+    //QOS 0 : HEADER AND CALLER PAYLOAD ARE SEPARATE SENDS, THE BUFFER IS
+    //HANDED BACK ONCE THE TRANSPORT HAS SENT IT. QOS 1 : KEPT UNTIL PUBACK
+
+    static uint8_t payload[4] = {'a', 'b', 'c', 'd'};
+    const uint8_t puback[] = {0x40, 0x02, 0x00, 0x01};
+    uint8_t sent[64];
+    uint32_t sends;
+    uint32_t len;
+
+    s_reset();
+    s_conn.transport.auto_ack = false;
+    sends = s_conn.transport.stats.sends;
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishRef("t", payload, sizeof(payload), ESP8266_MQTT_QOS_0, s_release_cb, NULL));
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_TEST_CHECK_EQ(s_conn.transport.stats.sends, sends + 1);
+    ESP8266_HOST_TRANSPORT_Ack(&s_conn.transport, 1);
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_TEST_CHECK_EQ(s_conn.transport.stats.sends, sends + 2);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_released, 0);
+    ESP8266_HOST_TRANSPORT_Ack(&s_conn.transport, 1);
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_TEST_CHECK_EQ(s_released, 1);
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0x30, 0x09, 0x00, 0x01, 't', 0x00, 0x04, 'a', 'b', 'c', 'd');
+
+    s_conn.transport.auto_ack = true;
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishRef("t", payload, sizeof(payload), ESP8266_MQTT_QOS_1, s_release_cb, NULL));
+    ESP8266_MQTT_TEST_Take(&s_conn, NULL, 0);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_released, 1);
+    ESP8266_MQTT_TEST_Inject(&s_conn, puback, sizeof(puback));
+    ESP8266_MQTT_TEST_CHECK_EQ(s_released, 2);
+}
+
+static void test_stream(void)
+{
+    //3000 BYTE PAYLOAD THROUGH A 1024 BYTE CLIENT BUFFER : PULLED IN CHUNKS,
+    //SENT AS ONE PUBLISH. ONE STREAM AT A TIME. QOS 0 COMPLETES ONCE SENT
+
+    static uint8_t sent[4096];
+    uint32_t len;
+    uint32_t i;
+    bool ok = true;
+
+    s_reset();
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishStream("t", ESP8266_MQTT_TEST_STREAM_LEN, ESP8266_MQTT_QOS_0, s_read_cb, s_complete_cb, NULL));
+    ESP8266_MQTT_TEST_CHECK(!ESP8266_MQTT_CLIENT_Send_PublishStream("t", 1, ESP8266_MQTT_QOS_0, s_read_cb, s_complete_cb, NULL));
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK(!ESP8266_MQTT_CLIENT_IsStreaming());
+    ESP8266_MQTT_TEST_CHECK_EQ(s_completed[1], 1);
+    ESP8266_MQTT_TEST_CHECK(s_reads >= ESP8266_MQTT_TEST_STREAM_LEN / ESP8266_MQTT_TEST_BUFFER_SIZE);
+
+    //REMAINING LENGTH 2 + 1 + 3000 = 3003 -> 0xBB 0x17
+    ESP8266_MQTT_TEST_CHECK_EQ(len, 3 + 3 + ESP8266_MQTT_TEST_STREAM_LEN);
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, 6, 0x30, 0xBB, 0x17, 0x00, 0x01, 't');
+    for(i = 0; i < ESP8266_MQTT_TEST_STREAM_LEN; i++)
+    {
+        ok = ok && (sent[6 + i] == (uint8_t)(i & 0xFF));
+    }
+    ESP8266_MQTT_TEST_CHECK(ok);
+}
+
+int main(void)
+{
+    ESP8266_MQTT_TEST_RUN(test_coalescing);
+    ESP8266_MQTT_TEST_RUN(test_zero_copy);
+    ESP8266_MQTT_TEST_RUN(test_stream);
+    return ESP8266_MQTT_TEST_End();
+}
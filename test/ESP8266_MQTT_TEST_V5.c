@@ -0,0 +1,150 @@
+/**********************************************************************************
+* ESP8266 MQTT TEST : MQTT 5
+*
+* NOTE
+* -----
+*   (1) CONNECT PROPERTIES, BROKER LIMITS FROM CONNACK (RECEIVE MAXIMUM CAPS THE
+*       IN-FLIGHT WINDOW, TOPIC ALIAS MAXIMUM), TOPIC ALIASES ON TOPIC HANDLES
+*       (RESET ON RECONNECT) AND REASON CODES
+*
+* OCTOBER 17 2026
+*
+* ANKIT BHATNAGAR
+* ANKIT.BHATNAGARINDIA@GMAIL.COM
+/**********************************************************************************/
+
+#include "ESP8266_MQTT_TEST.h"
+
+static esp8266_mqtt_test_conn_t s_conn;
+static esp8266_mqtt_client_packet_type_t s_reason_type;
+static uint16_t s_reason_id;
+static uint8_t s_reason_code;
+
+static void s_reason_cb(esp8266_mqtt_client_packet_type_t ptype, uint16_t packet_id, uint8_t reason_code)
+{
+    s_reason_type = ptype;
+    s_reason_id = packet_id;
+    s_reason_code = reason_code;
+}
+
+static void s_connect(void)
+{
+    //CONNACK : RECEIVE MAXIMUM 2, TOPIC ALIAS MAXIMUM 4
+
+    const uint8_t connack[] = {0x20, 0x09, 0x00, 0x00, 0x06, 0x21, 0x00, 0x02, 0x22, 0x00, 0x04};
+
+    ESP8266_MQTT_CLIENT_TcpConnect();
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_CLIENT_Send_Connect();
+    ESP8266_HOST_Poll();
+    ESP8266_MQTT_TEST_Inject(&s_conn, connack, sizeof(connack));
+}
+
+static void test_connect(void)
+{
+    //"MQTT" LEVEL 5, RECEIVE MAXIMUM PROPERTY. NO CLEAN SESSION ADDS THE
+    //SESSION EXPIRY INTERVAL (86400 S)
+
+    uint8_t sent[64];
+    uint32_t len;
+
+    ESP8266_MQTT_TEST_Open(&s_conn, ESP8266_MQTT_TEST_BUFFER_SIZE);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_SetProtocolVersion(ESP8266_MQTT_PROTOCOL_VERSION_5));
+    ESP8266_MQTT_CLIENT_Send_Connect();
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len,
+                                    0x10, 0x13,
+                                    0x00, 0x04, 'M', 'Q', 'T', 'T', 0x05, 0x02, 0x00, 0x3C,
+                                    0x03, 0x21, 0x00, ESP8266_MQTT_CLIENT_INBOUND_QOS2_MAX,
+                                    0x00, 0x03, 'd', 'e', 'v');
+
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_SetOptions(0, 0, 0, false, NULL, false, NULL, false, 60, false, NULL, NULL, 0, "dev"));
+    ESP8266_MQTT_CLIENT_Send_Connect();
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len,
+                                    0x10, 0x18,
+                                    0x00, 0x04, 'M', 'Q', 'T', 'T', 0x05, 0x00, 0x00, 0x3C,
+                                    0x08, 0x21, 0x00, ESP8266_MQTT_CLIENT_INBOUND_QOS2_MAX, 0x11, 0x00, 0x01, 0x51, 0x80,
+                                    0x00, 0x03, 'd', 'e', 'v');
+}
+
+static void test_receive_maximum(void)
+{
+    //BROKER RECEIVE MAXIMUM 2 BEATS THE DEFAULT WINDOW (8)
+
+    ESP8266_MQTT_TEST_Open(&s_conn, ESP8266_MQTT_TEST_BUFFER_SIZE);
+    ESP8266_MQTT_CLIENT_SetProtocolVersion(ESP8266_MQTT_PROTOCOL_VERSION_5);
+    s_connect();
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_IsConnected());
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", "m", ESP8266_MQTT_QOS_1, NULL, NULL));
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", "m", ESP8266_MQTT_QOS_1, NULL, NULL));
+    ESP8266_MQTT_TEST_CHECK(!ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", "m", ESP8266_MQTT_QOS_1, NULL, NULL));
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetInflightCount(), 2);
+}
+
+static void test_topic_alias(void)
+{
+    //FIRST PUBLISH TO A HANDLE : TOPIC + NEW ALIAS. THEN EMPTY TOPIC + ALIAS.
+    //A NEW CONNECTION STARTS WITHOUT ALIASES
+
+    esp8266_mqtt_topic_handle_t* handle;
+    uint8_t sent[64];
+    uint32_t len;
+
+    ESP8266_MQTT_TEST_Open(&s_conn, ESP8266_MQTT_TEST_BUFFER_SIZE);
+    ESP8266_MQTT_CLIENT_SetProtocolVersion(ESP8266_MQTT_PROTOCOL_VERSION_5);
+    s_connect();
+    ESP8266_MQTT_TEST_Take(&s_conn, NULL, 0);
+    handle = ESP8266_MQTT_CLIENT_RegisterTopic("a/b");
+    ESP8266_MQTT_TEST_CHECK(handle != NULL);
+
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishHandle(handle, "hi", ESP8266_MQTT_QOS_0, NULL, NULL));
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0x30, 0x0D, 0x00, 0x03, 'a', '/', 'b', 0x03, 0x23, 0x00, 0x01, 0x00, 0x02, 'h', 'i');
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishHandle(handle, "hi", ESP8266_MQTT_QOS_0, NULL, NULL));
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0x30, 0x0A, 0x00, 0x00, 0x03, 0x23, 0x00, 0x01, 0x00, 0x02, 'h', 'i');
+
+    //PLAIN TOPIC PUBLISHES HAVE NO ALIAS (EMPTY PROPERTIES)
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("a/b", "hi", ESP8266_MQTT_QOS_0, NULL, NULL));
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0x30, 0x0A, 0x00, 0x03, 'a', '/', 'b', 0x00, 0x00, 0x02, 'h', 'i');
+
+    s_connect();
+    ESP8266_MQTT_TEST_Take(&s_conn, NULL, 0);
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishHandle(handle, "hi", ESP8266_MQTT_QOS_0, NULL, NULL));
+    len = ESP8266_MQTT_TEST_Take(&s_conn, sent, sizeof(sent));
+    ESP8266_MQTT_TEST_CHECK_BYTES(sent, len, 0x30, 0x0D, 0x00, 0x03, 'a', '/', 'b', 0x03, 0x23, 0x00, 0x01, 0x00, 0x02, 'h', 'i');
+    ESP8266_MQTT_CLIENT_UnregisterTopic(handle);
+}
+
+static void test_reason_codes(void)
+{
+    //PUBACK 0x10 (NO MATCHING SUBSCRIBERS) REACHES THE REASON CODE CB. THE
+    //MESSAGE IS STILL DELIVERED (CODE < 0x80)
+
+    const uint8_t puback[] = {0x40, 0x03, 0x00, 0x01, 0x10};
+
+    ESP8266_MQTT_TEST_Open(&s_conn, ESP8266_MQTT_TEST_BUFFER_SIZE);
+    ESP8266_MQTT_CLIENT_SetProtocolVersion(ESP8266_MQTT_PROTOCOL_VERSION_5);
+    ESP8266_MQTT_CLIENT_SetReasonCodeCallback(s_reason_cb);
+    s_connect();
+    ESP8266_MQTT_TEST_CHECK_EQ(s_reason_type, ESP8266_MQTT_CONTROL_PACKET_TYPE_CONNACK);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_reason_code, 0x00);
+
+    ESP8266_MQTT_TEST_CHECK(ESP8266_MQTT_CLIENT_Send_PublishWithCb("t", "m", ESP8266_MQTT_QOS_1, NULL, NULL));
+    ESP8266_MQTT_TEST_Inject(&s_conn, puback, sizeof(puback));
+    ESP8266_MQTT_TEST_CHECK_EQ(s_reason_type, ESP8266_MQTT_CONTROL_PACKET_TYPE_PUBACK);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_reason_id, 1);
+    ESP8266_MQTT_TEST_CHECK_EQ(s_reason_code, 0x10);
+    ESP8266_MQTT_TEST_CHECK_EQ(ESP8266_MQTT_CLIENT_GetInflightCount(), 0);
+}
+
+int main(void)
+{
+    ESP8266_MQTT_TEST_RUN(test_connect);
+    ESP8266_MQTT_TEST_RUN(test_receive_maximum);
+    ESP8266_MQTT_TEST_RUN(test_topic_alias);
+    ESP8266_MQTT_TEST_RUN(test_reason_codes);
+    return ESP8266_MQTT_TEST_End();
+}